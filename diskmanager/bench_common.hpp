@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Small helpers shared by the *.bench.cpp executables. */
+
+// Run `op` `ops_count` times and return the average latency of a single call in nanoseconds.
+template <typename Operation>
+double measureNsPerOp(const size_t ops_count, Operation&& op){
+    const auto started_at = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops_count; ++i){
+        op(i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - started_at;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops_count);
+}
+
+// Generate `count` uniformly distributed indexes in [0, upper_bound).
+inline std::vector<size_t> makeRandomIndexes(const size_t count, const size_t upper_bound, const unsigned seed = 42){
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> dist(0, upper_bound - 1);
+    std::vector<size_t> indexes(count);
+    for (size_t& index : indexes){
+        index = dist(rng);
+    }
+    return indexes;
+}
+
+// Read an optional numeric command line argument.
+inline size_t readSizeArgument(const int argc, char** argv, const int position, const size_t default_value){
+    if (argc <= position){
+        return default_value;
+    }
+    return static_cast<size_t>(std::strtoull(argv[position], nullptr, 10));
+}
+
+// Prevent the compiler from optimizing away a computed value.
+template <typename T>
+inline void doNotOptimize(const T& value){
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/* Generates keys in [0, keys_count) following a Zipfian distribution: key `k` is drawn with probability ~ 1 / (k + 1)^skew. */
+class ZipfianGenerator{
+public:
+    ZipfianGenerator(const size_t keys_count, const double skew, const unsigned seed = 42)
+        : cdf_(keys_count), rng_(seed){
+        double sum = 0.0;
+        for (size_t key = 0; key < keys_count; ++key){
+            sum += 1.0 / std::pow(static_cast<double>(key + 1), skew);
+            cdf_[key] = sum;
+        }
+        for (double& value : cdf_){
+            value /= sum;
+        }
+    }
+
+    size_t next(){
+        const double point = dist_(rng_);
+        return static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), point) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> dist_{0.0, 1.0};
+};
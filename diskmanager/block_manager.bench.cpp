@@ -0,0 +1,80 @@
+#include "block_manager.hpp"
+#include "bench_common.hpp"
+
+/* Compares the ways of inserting data blocks into DuckDB, in blocks per second:
+   - a SQL string built for every block (the original insert path),
+   - the cached prepared INSERT BlockManager uses for single blocks,
+   - the Appender BlockManager uses for bulk writes.
+   Every path writes the same distinct blocks into its own in-memory database.
+   Usage: BlockManagerBenchmark [blocks = 20000] [blocks_per_bulk_write = 1024] */
+
+using namespace std::string_literals;
+
+namespace{
+    // Printable payloads without quotes or backslashes, so the SQL string path can embed them.
+    std::vector<char> makeBlocksData(const size_t blocks_count){
+        std::vector<char> data(blocks_count * MAX_DATA_BLOCK_SIZE);
+        for (size_t block = 0; block < blocks_count; ++block){
+            char* block_data = data.data() + block * MAX_DATA_BLOCK_SIZE;
+            for (size_t i = 0; i < MAX_DATA_BLOCK_SIZE; ++i){
+                block_data[i] = static_cast<char>('a' + (block * 7 + i) % 26);
+            }
+            const std::string block_number = std::to_string(block);
+            std::memcpy(block_data, block_number.data(), block_number.size());
+        }
+        return data;
+    }
+
+    double measureBlocksPerSecond(const size_t blocks_count, const std::function<void()>& write_all){
+        const auto started_at = std::chrono::steady_clock::now();
+        write_all();
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+        return static_cast<double>(blocks_count) / elapsed_s;
+    }
+}
+
+int main(int argc, char** argv){
+    const size_t blocks_count = readSizeArgument(argc, argv, 1, 20'000);
+    const size_t blocks_per_bulk_write = std::max(readSizeArgument(argc, argv, 2, 1'024), static_cast<size_t>(1));
+    const std::vector<char> data = makeBlocksData(blocks_count);
+    // the buffer is kept small, so the cache does not dominate the measurement
+    const size_t buffer_memory_budget = BufferManager::getMemoryBudgetForBlocks(1'024);
+
+    const double string_rate = measureBlocksPerSecond(blocks_count, [&](){
+        duckdb::DuckDB db(nullptr);
+        BlockManager bmanager(db, buffer_memory_budget);       // creates the table
+        duckdb::Connection conn(db);
+        const std::vector<DataBlock> dblocks = BlockManager::createDataBlocks(data.data(), data.size());
+        for (size_t i = 0; i < dblocks.size(); ++i){
+            auto res = conn.Query("INSERT OR IGNORE INTO blocks (block_id, data, data_size, seq_no) VALUES ("s + std::to_string(dblocks[i].Hash())
+                                  + ", '"s + std::string(dblocks[i].data, dblocks[i].data_size) + "'::BLOB, "s
+                                  + std::to_string(dblocks[i].data_size) + ", "s + std::to_string(i) + ");"s);
+            if (res->HasError()){
+                throw std::runtime_error(res->GetError());
+            }
+        }
+    });
+
+    const double prepared_rate = measureBlocksPerSecond(blocks_count, [&](){
+        duckdb::DuckDB db(nullptr);
+        BlockManager bmanager(db, buffer_memory_budget);
+        for (size_t block = 0; block < blocks_count; ++block){
+            bmanager.writeBlock(data.data() + block * MAX_DATA_BLOCK_SIZE, MAX_DATA_BLOCK_SIZE);
+        }
+    });
+
+    const double appender_rate = measureBlocksPerSecond(blocks_count, [&](){
+        duckdb::DuckDB db(nullptr);
+        BlockManager bmanager(db, buffer_memory_budget);
+        for (size_t block = 0; block < blocks_count; block += blocks_per_bulk_write){
+            const size_t write_blocks = std::min(blocks_per_bulk_write, blocks_count - block);
+            bmanager.writeBlock(data.data() + block * MAX_DATA_BLOCK_SIZE, write_blocks * MAX_DATA_BLOCK_SIZE);
+        }
+    });
+
+    std::cout << std::setw(24) << "path" << std::setw(16) << "blocks/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << std::setw(24) << "SQL string per block" << std::setw(16) << string_rate << std::endl;
+    std::cout << std::setw(24) << "prepared INSERT" << std::setw(16) << prepared_rate << std::endl;
+    std::cout << std::setw(24) << "Appender bulk write" << std::setw(16) << appender_rate << std::endl;
+}
@@ -1,54 +1,572 @@
 #include "block_manager.hpp"
+#include <unordered_map>
+#include <cerrno>
+
+#include <unistd.h>
 
 using namespace std::string_literals;
 
-BlockManager::BlockManager(duckdb::DuckDB& db_obj){
-    conn_db_ = std::make_unique<duckdb::Connection>(db_obj);
-    conn_db_->Query("CREATE TABLE IF NOT EXISTS blocks (block_id INTEGER, data VARCHAR, PRIMARY KEY(block_id));");
+BlockManager::BlockManager(duckdb::DuckDB& db_obj, const size_t buffer_memory_budget, const size_t max_buffer_memory_budget)
+    : BlockManager(std::make_unique<DuckDBBlockStore>(db_obj), buffer_memory_budget, max_buffer_memory_budget){
+}
+
+BlockManager::BlockManager(std::unique_ptr<BlockStore> store, const size_t buffer_memory_budget, const size_t max_buffer_memory_budget)
+    : buff_manager_(buffer_memory_budget, max_buffer_memory_budget), store_(std::move(store)),
+      seq_no_hints_(std::max(buffer_memory_budget, max_buffer_memory_budget) / BufferManager::getBytesPerFrame()),
+      unverified_checksums_(std::max(buffer_memory_budget, max_buffer_memory_budget) / BufferManager::getBytesPerFrame()),
+      verified_views_(std::max(buffer_memory_budget, max_buffer_memory_budget) / BufferManager::getBytesPerFrame()){
+    if (!store_){
+        throw std::invalid_argument("BlockManager needs a block storage"s);
+    }
+    next_seq_no_ = store_->getNextSeqNo();
+    stored_blocks_ = indexStoredBlocks(*store_);
+    mapped_store_ = store_->isMapped();
+    registerBufferMemory();
+}
+
+BlockManager::~BlockManager(){
+    stopPrefetcher();
+    stopFlusher();
 }
 
 
-void BlockManager::writeBlock(const char* data_bytes, const size_t data_size){
+void BlockManager::writeBlock(const char* data_bytes, const size_t data_size, const ChunkingMode chunking_mode){
     if (!data_bytes || data_size == 0){
         return;
     }
 
-    const std::vector<DataBlock> data_blocks = createDataBlocks(data_bytes, data_size);
-    for (const DataBlock& dblock : data_blocks){
-        const size_t block_hash = dblock.Hash();
+    // the data is cut straight from the caller's buffer, a batch at a time
+    const ChunkingParameters chunking_parameters = getChunkingParameters(chunking_mode);
+    const size_t min_chunk_size = chunking_mode == ChunkingMode::CONTENT_DEFINED ? chunking_parameters.min_size : MAX_DATA_BLOCK_SIZE;
+    const std::unique_ptr<BlockWritePipeline> pipeline = makeWritePipeline(data_size >= PARALLEL_WRITE_MIN_SIZE,
+                                                                           std::min(data_size / min_chunk_size + 1, STREAM_BATCH_BLOCKS), nullptr);
+    writeChunkedData(data_bytes, data_size, true, chunking_mode, chunking_parameters, *pipeline);
+    pipeline->finish();
+}
+
+size_t BlockManager::writeStream(const DataSource& source, const ChunkingMode chunking_mode, std::vector<size_t>* block_hashes){
+    const ChunkingParameters chunking_parameters = getChunkingParameters(chunking_mode);
+    const std::unique_ptr<BlockWritePipeline> pipeline = makeWritePipeline(true, STREAM_BATCH_BLOCKS, block_hashes);
+    std::unique_ptr<char[]> window(new char[STREAM_WINDOW_SIZE]);
+    size_t window_size = 0;
+    size_t written_bytes = 0;
+    bool source_ended = false;
+    while (!source_ended){
+        while (window_size < STREAM_WINDOW_SIZE){
+            const size_t read_bytes = source(window.get() + window_size, STREAM_WINDOW_SIZE - window_size);
+            if (read_bytes == 0){
+                source_ended = true;
+                break;
+            }
+            window_size += std::min(read_bytes, STREAM_WINDOW_SIZE - window_size);
+        }
+        // a full window holds many blocks, so every round cuts some; the unfinished tail moves to the front
+        const size_t consumed_bytes = writeChunkedData(window.get(), window_size, source_ended, chunking_mode, chunking_parameters, *pipeline);
+        std::memmove(window.get(), window.get() + consumed_bytes, window_size - consumed_bytes);
+        window_size -= consumed_bytes;
+        written_bytes += consumed_bytes;
+    }
+    pipeline->finish();
+    return written_bytes;
+}
+
+size_t BlockManager::writeStream(std::istream& input, const ChunkingMode chunking_mode, std::vector<size_t>* block_hashes){
+    return writeStream([&input](char* buffer, const size_t capacity){
+        input.read(buffer, static_cast<std::streamsize>(capacity));
+        if (input.bad()){
+            throw std::runtime_error("Failed to read the data to write from the stream"s);
+        }
+        return static_cast<size_t>(input.gcount());
+    }, chunking_mode, block_hashes);
+}
+
+size_t BlockManager::writeFile(const int fd, const ChunkingMode chunking_mode, std::vector<size_t>* block_hashes){
+    return writeStream([fd](char* buffer, const size_t capacity){
+        while (true){
+            const ssize_t read_bytes = ::read(fd, buffer, capacity);
+            if (read_bytes >= 0){
+                return static_cast<size_t>(read_bytes);
+            }
+            if (errno != EINTR){
+                throw std::runtime_error("Failed to read the data to write from the file: "s + std::strerror(errno));
+            }
+        }
+    }, chunking_mode, block_hashes);
+}
+
+void BlockManager::setWriteThreadsCount(const size_t threads_count) noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    write_threads_count_ = threads_count;
+}
+
+size_t BlockManager::writeChunkedData(const char* data, const size_t size, const bool is_last_piece, const ChunkingMode chunking_mode,
+                                      const ChunkingParameters& chunking_parameters, BlockWritePipeline& pipeline){
+    const size_t max_chunk_size = getMaxChunkSize(chunking_mode, chunking_parameters);
+    size_t offset = 0;
+    while (offset < size && (is_last_piece || size - offset >= max_chunk_size)){
+        DataBlock& dblock = pipeline.nextBlock();
+        dblock.data_size = findChunkSize(data + offset, size - offset, chunking_mode, chunking_parameters);
+        std::memcpy(dblock.data, data + offset, dblock.data_size);
+        // the bytes after the chunk are left from an earlier batch
+        std::memset(dblock.data + dblock.data_size, 0x00, MAX_DATA_BLOCK_SIZE - dblock.data_size);
+        offset += dblock.data_size;
+    }
+    return offset;
+}
+
+std::unique_ptr<BlockWritePipeline> BlockManager::makeWritePipeline(const bool parallel, const size_t batch_blocks_count,
+                                                                    std::vector<size_t>* block_hashes){
+    size_t hash_threads_count = 0;
+    if (parallel){
+        std::lock_guard<std::mutex> guard(latch_);
+        hash_threads_count = write_threads_count_ > 1 ? write_threads_count_ : 0;
+    }
+    return std::make_unique<BlockWritePipeline>(hash_threads_count, batch_blocks_count,
+        [this, block_hashes](const DataBlock* dblocks, const BlockFingerprint* fingerprints, const size_t dblocks_count){
+            writeDataBlocks(dblocks, fingerprints, dblocks_count);
+            if (block_hashes){
+                for (size_t i = 0; i < dblocks_count; ++i){
+                    block_hashes->push_back(static_cast<size_t>(fingerprints[i].low));
+                }
+            }
+        });
+}
+
+void BlockManager::writeDataBlocks(const DataBlock* dblocks, const BlockFingerprint* fingerprints, const size_t dblocks_count){
+    std::unique_lock<std::mutex> lock(latch_);
+    std::vector<StoredDataBlock> new_blocks;
+    // positions of the blocks in `new_blocks`, so a block repeated within the batch is stored once and numbered once
+    HashIndex<uint32_t> new_block_positions(dblocks_count);
+    for (size_t i = 0; i < dblocks_count; ++i){
+        const DataBlock& dblock = dblocks[i];
+        const size_t block_hash = static_cast<size_t>(fingerprints[i].low);
+        // a block another writer is storing counts as stored only once that write has succeeded
+        batch_flushed_.wait(lock, [this, block_hash](){
+            return storing_blocks_.count(block_hash) == 0;
+        });
         // Don't write to the file if the block is cached (exists)
-        if (buff_manager_.getDataBlock(block_hash).has_value()){
+        BlockHandle cached_block = buff_manager_.getDataBlock(block_hash);
+        const uint32_t* new_block_position = new_block_positions.find(block_hash);
+        const DataBlock* known_block = new_block_position != nullptr ? &new_blocks[*new_block_position].dblock : nullptr;
+        if (cached_block.isValid() || known_block != nullptr){
+            const char* known_data = cached_block.isValid() ? cached_block.getData() : known_block->data;
+            const size_t known_data_size = cached_block.isValid() ? cached_block.getDataSize() : known_block->data_size;
+            if (known_data_size != dblock.data_size || std::memcmp(known_data, dblock.data, dblock.data_size) != 0){
+                // the blocks before it are still written, as they would be if it were the last one
+                cached_block.release();
+                storeDataBlocks(new_blocks, lock);
+                throw std::runtime_error("Failed to write a data block: its key "s + std::to_string(block_hash) + " belongs to a different block"s);
+            }
             continue;
         }
-        insertDataBlockToDB(dblock, block_hash);
+        // a block which has left the buffer is still known to the index, which keeps the high half of its fingerprint
+        const uint64_t* stored_fingerprint_high = stored_blocks_.find(block_hash);
+        if (stored_fingerprint_high != nullptr){
+            // 0 stands for a block an older storage has listed without it
+            if (*stored_fingerprint_high != fingerprints[i].high && *stored_fingerprint_high != 0){
+                storeDataBlocks(new_blocks, lock);
+                throw std::runtime_error("Failed to write a data block: its key "s + std::to_string(block_hash) + " belongs to a different block"s);
+            }
+            continue;
+        }
+        const uint64_t seq_no = next_seq_no_++;
+        if (write_back_enabled_){
+            bufferDataBlock(dblock, fingerprints[i], seq_no, lock);
+            rememberSeqNo(block_hash, seq_no);
+        } else{
+            new_block_positions.insert(block_hash, static_cast<uint32_t>(new_blocks.size()));
+            StoredDataBlock& new_block = new_blocks.emplace_back();
+            new_block.block_hash = block_hash;
+            new_block.fingerprint_high = fingerprints[i].high;
+            new_block.seq_no = seq_no;
+            new_block.dblock = dblock;
+        }
+    }
+    storeDataBlocks(new_blocks, lock);
+}
+
+ChunkingParameters BlockManager::getChunkingParameters(const ChunkingMode chunking_mode) const{
+    if (chunking_mode != ChunkingMode::CONTENT_DEFINED){
+        return ChunkingParameters();
+    }
+    std::lock_guard<std::mutex> guard(latch_);
+    return chunking_parameters_;
+}
+
+HashIndex<uint64_t> BlockManager::indexStoredBlocks(BlockStore& store){
+    const std::vector<StoredBlockKey> block_keys = store.listBlockKeys();
+    // room for as many new blocks again before the index grows
+    HashIndex<uint64_t> stored_blocks(block_keys.size() * 2);
+    for (const StoredBlockKey& block_key : block_keys){
+        stored_blocks.insert(block_key.block_hash, block_key.fingerprint_high);
+    }
+    return stored_blocks;
+}
+
+void BlockManager::indexStoredBlock(const size_t block_hash, const uint64_t fingerprint_high){
+    if (stored_blocks_.find(block_hash) != nullptr){
+        return;
+    }
+    if (stored_blocks_.size() >= stored_blocks_.capacity()){
+        stored_blocks_.reserve(stored_blocks_.capacity() * 2);
+    }
+    stored_blocks_.insert(block_hash, fingerprint_high);
+}
+
+void BlockManager::setChunkingParameters(const ChunkingParameters& parameters){
+    checkChunkingParameters(parameters);
+    std::lock_guard<std::mutex> guard(latch_);
+    chunking_parameters_ = parameters;
+}
+
+void BlockManager::setWriteBackEnabled(const bool enabled){
+    if (!enabled){
+        flush();
+        stopFlusher();
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(latch_);
+    if (write_back_enabled_){
+        return;
+    }
+    if (!store_){
+        throw std::runtime_error("Failed to enable the write-back mode: no block storage is open"s);
+    }
+    write_back_enabled_ = true;
+    flusher_ = std::thread(&BlockManager::flushDirtyBlocks, this);
+}
+
+bool BlockManager::isWriteBackEnabled() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return write_back_enabled_;
+}
+
+void BlockManager::flush(){
+    std::unique_lock<std::mutex> lock(latch_);
+    flush_requested_ = true;
+    flusher_wakeup_.notify_one();
+    batch_flushed_.wait(lock, [this](){
+        return (dirty_blocks_.empty() && flushing_blocks_count_ == 0) || !flush_error_.empty();
+    });
+    if (!flush_error_.empty()){
+        throw std::runtime_error("Failed to write dirty data blocks to the database: "s + std::exchange(flush_error_, std::string()));
+    }
+    if (store_){
+        store_->sync();
     }
 }
 
 bool BlockManager::readBlock(const size_t block_hash, DataBlock& in_block) noexcept{
-    std::optional<DataBlock> cached_block = buff_manager_.getDataBlock(block_hash);
-    // The block has not been found in the cache
-    if (!cached_block.has_value()){
+    return readBlocks(&block_hash, 1, &in_block) == 1;
+}
+
+size_t BlockManager::readBlocks(const size_t* block_hashes, const size_t count, DataBlock* in_blocks) noexcept{
+    if (!block_hashes || !in_blocks || count == 0){
+        return 0;
+    }
+
+    try{
+        // cache hits are copied without the latch, only the misses take it
+        size_t read_count = 0;
+        std::vector<size_t> missing_indexes;
+        for (size_t i = 0; i < count; ++i){
+            if (readCachedBlock(block_hashes[i], in_blocks[i])){
+                ++read_count;
+            } else{
+                missing_indexes.push_back(i);
+            }
+        }
+        if (missing_indexes.empty()){
+            return read_count;
+        }
+        std::lock_guard<std::mutex> guard(latch_);
+        return read_count + copyBlocks(block_hashes, missing_indexes, in_blocks);
+    } catch (const std::bad_alloc&){
+        // the misses cannot be collected, so the batch counts as not read
+        return 0;
+    }
+}
+
+bool BlockManager::readBlockChecked(const size_t block_hash, DataBlock& in_block){
+    // a block copied without the latch has been verified already
+    if (readCachedBlock(block_hash, in_block)){
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(latch_);
+    // the background threads count their failures under the latch, so a new failure belongs to this read
+    const size_t checksum_failures_count = checksum_failures_count_;
+    if (copyBlocks(&block_hash, std::vector<size_t>{0}, &in_block) == 1){
+        return true;
+    }
+    if (checksum_failures_count_ != checksum_failures_count){
+        throw BlockChecksumError(block_hash);
+    }
+    return false;
+}
+
+size_t BlockManager::copyBlocks(const size_t* block_hashes, const std::vector<size_t>& indexes, DataBlock* in_blocks){
+    size_t read_count = 0;
+    std::vector<size_t> missing_indexes;
+    std::vector<size_t> missing_hashes;
+    for (const size_t i : indexes){
+        // The handle keeps the block pinned, so it cannot be evicted while being copied
+        const BlockHandle cached_block = pinCachedBlock(block_hashes[i]);
+        if (!cached_block.isValid()){
+            missing_indexes.push_back(i);
+            missing_hashes.push_back(block_hashes[i]);
+            continue;
+        }
+        // DataBlock compares whole buffers, so the padding is copied as well
+        in_blocks[i].data_size = cached_block.getDataSize();
+        std::memcpy(in_blocks[i].data, cached_block.getData(), MAX_DATA_BLOCK_SIZE);
+        ++read_count;
+    }
+    if (missing_hashes.empty()){
+        return read_count;
+    }
+
+    if (mapped_store_){
+        // the page cache keeps the blocks of a mapped storage, they are copied straight from the mapping
+        for (const size_t i : missing_indexes){
+            size_t data_size = 0;
+            const char* block_data = viewMappedBlock(block_hashes[i], data_size);
+            if (block_data != nullptr){
+                in_blocks[i].data_size = data_size;
+                std::memcpy(in_blocks[i].data, block_data, MAX_DATA_BLOCK_SIZE);
+                ++read_count;
+            }
+        }
+        return read_count;
+    }
+
+    // all misses are fetched with one query
+    const std::vector<StoredDataBlock> uncached_blocks = readThrough(missing_hashes.data(), missing_hashes.size());
+    std::unordered_map<size_t, const DataBlock*> uncached_by_hash;
+    for (const StoredDataBlock& uncached_block : uncached_blocks){
+        uncached_by_hash.emplace(uncached_block.block_hash, &uncached_block.dblock);
+    }
+    for (const size_t i : missing_indexes){
+        // the read has been counted by the read-through already
+        if (buff_manager_.copyDataBlock(block_hashes[i], in_blocks[i])){
+            ++read_count;
+            continue;
+        }
+        const auto uncached = uncached_by_hash.find(block_hashes[i]);
+        if (uncached != uncached_by_hash.end()){
+            in_blocks[i] = *uncached->second;
+            ++read_count;
+        }
+    }
+    return read_count;
+}
+
+bool BlockManager::readBlock(const size_t block_hash, char* buffer, const size_t buffer_size, size_t& data_size) noexcept{
+    // a hit is copied without the latch, through a scratch buffer if the caller's one cannot take every block
+    char scratch_data[MAX_DATA_BLOCK_SIZE];
+    char* read_buffer = buffer_size < MAX_DATA_BLOCK_SIZE ? scratch_data : buffer;
+    size_t cached_size = 0;
+    if (readCachedBlock(block_hash, read_buffer, cached_size)){
+        if (cached_size > buffer_size){
+            return false;
+        }
+        if (read_buffer != buffer){
+            std::memcpy(buffer, read_buffer, cached_size);
+        }
+        data_size = cached_size;
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(latch_);
+    BlockHandle cached_block = pinCachedBlock(block_hash);
+    if (!cached_block.isValid() && mapped_store_){
+        size_t block_size = 0;
+        const char* block_data = viewMappedBlock(block_hash, block_size);
+        if (block_data == nullptr || block_size > buffer_size){
+            return false;
+        }
+        data_size = block_size;
+        std::memcpy(buffer, block_data, data_size);
+        return true;
+    }
+
+    std::vector<StoredDataBlock> uncached_blocks;
+    if (!cached_block.isValid()){
+        uncached_blocks = readThrough(&block_hash, 1);
+        if (uncached_blocks.empty()){
+            cached_block = buff_manager_.pinBlock(block_hash);
+        }
+    }
+
+    const char* block_data = cached_block.getData();
+    size_t block_size = cached_block.getDataSize();
+    if (!uncached_blocks.empty()){
+        block_data = uncached_blocks.front().dblock.data;
+        block_size = uncached_blocks.front().dblock.data_size;
+    } else if (!cached_block.isValid()){
+        return false;
+    }
+    if (block_size > buffer_size){
         return false;
     }
 
-    in_block = cached_block.value();
-    ++read_blocks_count_;
+    data_size = block_size;
+    std::memcpy(buffer, block_data, data_size);
     return true;
 }
 
-void BlockManager::setNewDBObject(duckdb::DuckDB& db_obj) noexcept{
-    buff_manager_.clearBuffer();
+BlockHandle BlockManager::readBlockView(const size_t block_hash) noexcept{
+    // a view pins its frame, which changes the replacement state, so unlike a copy it is always taken under the latch
+    std::lock_guard<std::mutex> guard(latch_);
+    BlockHandle cached_block = pinCachedBlock(block_hash);
+    if (!cached_block.isValid() && mapped_store_){
+        // the view points into the mapping, the buffer only counts the pin
+        size_t data_size = 0;
+        const char* block_data = viewMappedBlock(block_hash, data_size);
+        if (block_data != nullptr){
+            cached_block = buff_manager_.pinExternalBlock(block_hash, block_data, data_size);
+        }
+    } else if (!cached_block.isValid()){
+        // a block the buffer has not taken cannot be viewed; the read has been counted by the read-through already
+        readThrough(&block_hash, 1);
+        cached_block = buff_manager_.pinBlock(block_hash);
+    }
+    // the background threads share the buffer, so the block is unpinned under the latch
+    if (cached_block.isValid()){
+        cached_block.owner_latch_ = &latch_;
+    }
+    return cached_block;
+}
 
-    conn_db_.reset();
-    conn_db_ = std::make_unique<duckdb::Connection>(db_obj);
+bool BlockManager::removeBlock(const size_t block_hash){
+    std::unique_lock<std::mutex> lock(latch_);
+    // the batch the background writer or a write-through is storing may carry the block
+    batch_flushed_.wait(lock, [this](){
+        return flushing_blocks_count_ == 0 && storing_writes_count_ == 0;
+    });
+    if (buff_manager_.getPinCount(block_hash) != 0 || !store_){
+        return false;
+    }
+
+    // the storage goes first, so a failed removal leaves the block where it has been
+    const bool stored = store_->removeBlocks({block_hash}) != 0;
+    const auto dirty_block = std::find_if(dirty_blocks_.begin(), dirty_blocks_.end(), [block_hash](const std::pair<size_t, uint64_t>& dirty){
+        return dirty.first == block_hash;
+    });
+    const bool dirty = dirty_block != dirty_blocks_.end();
+    if (dirty){
+        dirty_blocks_.erase(dirty_block);
+        buff_manager_.markBlockClean(block_hash);
+    }
+    buff_manager_.removeDataBlock(block_hash);
+    stored_blocks_.erase(block_hash);
+    seq_no_hints_.erase(block_hash);
+    unverified_checksums_.erase(block_hash);
+    verified_views_.erase(block_hash);
+    ++removals_count_;
+    return stored || dirty;
+}
+
+void BlockManager::prefetch(const size_t* block_hashes, const size_t count){
+    if (!block_hashes || count == 0){
+        return;
+    }
+    PrefetchRequest request;
+    request.block_hashes.assign(block_hashes, block_hashes + count);
+
+    std::lock_guard<std::mutex> guard(latch_);
+    if (mapped_store_){
+        // the kernel reads the blocks into the page cache in the background
+        store_->adviseWillNeed(request.block_hashes);
+        return;
+    }
+    schedulePrefetch(std::move(request));
+}
+
+void BlockManager::waitForPrefetches(){
+    std::unique_lock<std::mutex> lock(latch_);
+    prefetch_loaded_.wait(lock, [this](){
+        return prefetch_requests_.empty() && loading_requests_count_ == 0;
+    });
+}
+
+void BlockManager::setReadAheadWindow(const size_t blocks_count) noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    read_ahead_blocks_.store(blocks_count, std::memory_order_relaxed);
+    sequential_reads_count_.store(0, std::memory_order_relaxed);
 }
 
-std::vector<DataBlock> BlockManager::createDataBlocks(const char* data, const size_t data_size){
+void BlockManager::setNewDBObject(duckdb::DuckDB& db_obj){
+    setBlockStore(std::make_unique<DuckDBBlockStore>(db_obj));
+}
+
+void BlockManager::setBlockStore(std::unique_ptr<BlockStore> store){
+    if (!store){
+        throw std::invalid_argument("BlockManager needs a block storage"s);
+    }
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        checkNoBlocksPinned();
+    }
+
+    // the blocks are listed before anything changes, so a failure leaves the old storage in place
+    HashIndex<uint64_t> stored_blocks = indexStoredBlocks(*store);
+
+    // the pending blocks belong to the old storage
+    const bool write_back_enabled = isWriteBackEnabled();
+    setWriteBackEnabled(false);
+
+    stopPrefetcher();
+
+    {
+        std::unique_lock<std::mutex> lock(latch_);
+        batch_flushed_.wait(lock, [this](){
+            return storing_writes_count_ == 0;
+        });
+        // a view may have been taken while the latch was free; its block would stay cached under the new storage
+        try{
+            checkNoBlocksPinned();
+        } catch (const std::runtime_error&){
+            lock.unlock();
+            setWriteBackEnabled(write_back_enabled);
+            throw;
+        }
+        buff_manager_.clearBuffer();
+        seq_no_hints_.clear();
+        unverified_checksums_.clear();
+        verified_views_.clear();
+        sequential_reads_count_.store(0, std::memory_order_relaxed);
+        read_ahead_end_seq_no_.store(0, std::memory_order_relaxed);
+
+        store_ = std::move(store);
+        next_seq_no_ = store_->getNextSeqNo();
+        stored_blocks_ = std::move(stored_blocks);
+        mapped_store_.store(store_->isMapped(), std::memory_order_relaxed);
+        registerBufferMemory();
+    }
+    setWriteBackEnabled(write_back_enabled);
+}
+
+std::vector<DataBlock> BlockManager::createDataBlocks(const char* data, const size_t data_size, const ChunkingMode chunking_mode,
+                                                     const ChunkingParameters& chunking_parameters){
     std::vector<DataBlock> ret_vec;
     if (!data || data_size == 0){
         return ret_vec;
     }
 
+    if (chunking_mode == ChunkingMode::CONTENT_DEFINED){
+        ret_vec.reserve(data_size / chunking_parameters.avg_size + 1);
+        size_t offset = 0;
+        while (offset < data_size){
+            DataBlock& dblock = ret_vec.emplace_back();
+            dblock.data_size = findChunkBoundary(data + offset, data_size - offset, chunking_parameters);
+            std::memcpy(dblock.data, data + offset, dblock.data_size);
+            offset += dblock.data_size;
+        }
+        return ret_vec;
+    }
+
     size_t blocks_num = (data_size + MAX_DATA_BLOCK_SIZE - 1) / MAX_DATA_BLOCK_SIZE; // There has to be at least one data block
     ret_vec.reserve(blocks_num);
 
@@ -72,23 +590,642 @@ std::vector<DataBlock> BlockManager::createDataBlocks(const char* data, const si
 }
 
 
-void BlockManager::insertDataBlockToDB(const DataBlock& dblock, const size_t block_hash){
-    auto res = conn_db_->Query("INSERT INTO blocks VALUES ("s + std::to_string(block_hash) + ", '"s + std::string(dblock.data, MAX_DATA_BLOCK_SIZE) + "', "s + std::to_string(MAX_DATA_BLOCK_SIZE) + ") "s);
-    if (res->HasError()){
-        throw std::runtime_error("Failed to insert data block to the database file: "s + res->GetError());
+void BlockManager::storeDataBlocks(const std::vector<StoredDataBlock>& dblocks, std::unique_lock<std::mutex>& lock){
+    if (dblocks.empty()){
+        return;
+    }
+    if (!store_){
+        throw std::runtime_error("Failed to write data blocks: no block storage is open"s);
+    }
+
+    // the new blocks are reserved in the dedup index before the latch is released; the dirty ones are there already
+    std::vector<size_t> reserved_hashes;
+    reserved_hashes.reserve(dblocks.size());
+    try{
+        for (const StoredDataBlock& stored_block : dblocks){
+            if (stored_blocks_.find(stored_block.block_hash) == nullptr){
+                reserved_hashes.push_back(stored_block.block_hash);
+                storing_blocks_.insert(stored_block.block_hash);
+                indexStoredBlock(stored_block.block_hash, stored_block.fingerprint_high);
+            }
+        }
+    } catch (...){
+        for (const size_t block_hash : reserved_hashes){
+            storing_blocks_.erase(block_hash);
+            stored_blocks_.erase(block_hash);
+        }
+        throw;
+    }
+
+    // the storage is not replaced and no block is removed while the count is held
+    ++storing_writes_count_;
+    lock.unlock();
+    try{
+        store_->writeBlocks(dblocks);
+    } catch (...){
+        lock.lock();
+        for (const size_t block_hash : reserved_hashes){
+            storing_blocks_.erase(block_hash);
+            stored_blocks_.erase(block_hash);
+        }
+        --storing_writes_count_;
+        batch_flushed_.notify_all();
+        throw;
+    }
+    lock.lock();
+    for (const size_t block_hash : reserved_hashes){
+        storing_blocks_.erase(block_hash);
+    }
+    --storing_writes_count_;
+    batch_flushed_.notify_all();
+    // a mapped storage is read through the page cache, so the new blocks are not cached twice
+    for (const StoredDataBlock& stored_block : dblocks){
+        if (!mapped_store_){
+            buff_manager_.addDataBlock(stored_block.dblock, stored_block.block_hash);
+        }
+        rememberSeqNo(stored_block.block_hash, stored_block.seq_no);
+    }
+    written_blocks_count_ += dblocks.size();
+}
+
+void BlockManager::bufferDataBlock(const DataBlock& dblock, const BlockFingerprint& fingerprint, const uint64_t seq_no,
+                                   std::unique_lock<std::mutex>& lock){
+    const size_t block_hash = static_cast<size_t>(fingerprint.low);
+    // dirty blocks cannot be evicted, so a buffer full of them has to wait for the writer
+    while (!buff_manager_.addDataBlock(dblock, block_hash, true)){
+        if (dirty_blocks_.empty() && flushing_blocks_count_ == 0){
+            // nothing is going to become clean (every cached block is pinned), so the block is written through
+            StoredDataBlock stored_block;
+            stored_block.block_hash = block_hash;
+            stored_block.fingerprint_high = fingerprint.high;
+            stored_block.seq_no = seq_no;
+            stored_block.dblock = dblock;
+            storeDataBlocks({stored_block}, lock);
+            return;
+        }
+        flush_requested_ = true;
+        flusher_wakeup_.notify_one();
+        batch_flushed_.wait(lock);
+        if (!flush_error_.empty()){
+            throw std::runtime_error("Failed to write dirty data blocks to the database: "s + std::exchange(flush_error_, std::string()));
+        }
+    }
+
+    dirty_blocks_.emplace_back(block_hash, seq_no);
+    indexStoredBlock(block_hash, fingerprint.high);
+    if (dirty_blocks_.size() >= WRITE_BACK_BATCH_SIZE){
+        flusher_wakeup_.notify_one();
     }
-    buff_manager_.addDataBlock(dblock, block_hash);
-    ++written_blocks_count_;
+}
+
+void BlockManager::flushDirtyBlocks(){
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true){
+        flusher_wakeup_.wait_for(lock, WRITE_BACK_INTERVAL, [this](){
+            return stop_flusher_ || flush_requested_ || dirty_blocks_.size() >= WRITE_BACK_BATCH_SIZE;
+        });
+        if (dirty_blocks_.empty()){
+            flush_requested_ = false;
+            batch_flushed_.notify_all();
+            if (stop_flusher_){
+                return;
+            }
+            continue;
+        }
+
+        // the batch is copied, so the buffer stays available while the database is busy
+        std::vector<StoredDataBlock> batch;
+        batch.reserve(std::min(dirty_blocks_.size(), WRITE_BACK_BATCH_SIZE));
+        while (batch.size() < WRITE_BACK_BATCH_SIZE && !dirty_blocks_.empty()){
+            StoredDataBlock& dirty_block = batch.emplace_back();
+            std::tie(dirty_block.block_hash, dirty_block.seq_no) = dirty_blocks_.front();
+            dirty_blocks_.pop_front();
+            // a dirty block is in the dedup index from the moment it is cached
+            dirty_block.fingerprint_high = *stored_blocks_.find(dirty_block.block_hash);
+            buff_manager_.copyDataBlock(dirty_block.block_hash, dirty_block.dblock);
+        }
+        flushing_blocks_count_ = batch.size();
+        lock.unlock();
+
+        std::string error;
+        try{
+            store_->writeBlocks(batch);
+        } catch (const std::exception& e){
+            error = e.what();
+        }
+
+        lock.lock();
+        flushing_blocks_count_ = 0;
+        if (error.empty()){
+            for (const StoredDataBlock& dirty_block : batch){
+                buff_manager_.markBlockClean(dirty_block.block_hash);
+            }
+            written_blocks_count_ += batch.size();
+            batch_flushed_.notify_all();
+            continue;
+        }
+
+        // the blocks stay dirty and are retried after a pause
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it){
+            dirty_blocks_.emplace_front(it->block_hash, it->seq_no);
+        }
+        flush_error_ = std::move(error);
+        flush_requested_ = false;
+        batch_flushed_.notify_all();
+        if (flusher_wakeup_.wait_for(lock, WRITE_BACK_INTERVAL, [this](){ return stop_flusher_; })){
+            return;
+        }
+    }
+}
+
+void BlockManager::stopFlusher() noexcept{
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        if (!flusher_.joinable()){
+            return;
+        }
+        stop_flusher_ = true;
+    }
+    flusher_wakeup_.notify_one();
+    flusher_.join();
+
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_flusher_ = false;
+    write_back_enabled_ = false;
+}
+
+BlockHandle BlockManager::pinCachedBlock(const size_t block_hash) noexcept{
+    BlockHandle cached_block = buff_manager_.pinBlock(block_hash);
+    const uint32_t* checksum = cached_block.isValid() ? unverified_checksums_.find(block_hash) : nullptr;
+    if (checksum != nullptr){
+        // a block loaded in the lazy mode is verified by its first reader
+        const bool valid = isBlockChecksumValid(cached_block.getData(), cached_block.getDataSize(), *checksum);
+        unverified_checksums_.erase(block_hash);
+        if (!valid){
+            cached_block.release();
+            buff_manager_.removeDataBlock(block_hash);
+            ++checksum_failures_count_;
+            return cached_block;
+        }
+    }
+    if (cached_block.isValid()){
+        read_blocks_count_.fetch_add(1, std::memory_order_relaxed);
+        detectSequentialRead(block_hash);
+    }
+    return cached_block;
+}
+
+bool BlockManager::readCachedBlock(const size_t block_hash, char* buffer, size_t& data_size) noexcept{
+    // the buffer is only changed under the latch, so the read races one modifying thread at a time
+    OptimisticReadStatus status = OptimisticReadStatus::CONFLICT;
+    for (size_t attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS && status == OptimisticReadStatus::CONFLICT; ++attempt){
+        status = buff_manager_.readBlockOptimistic(block_hash, buffer, data_size);
+    }
+    if (status != OptimisticReadStatus::SUCCESS){
+        return false;
+    }
+
+    // the checksum of a lazily loaded block is deferred before the block is added, so a found block has its entry visible;
+    // a miss is trusted only if no erase has shifted the entries meanwhile
+    uint32_t checksum = 0;
+    const uint64_t index_version = unverified_checksums_.getVersion();
+    if (unverified_checksums_.findUnsynchronized(block_hash, checksum)){
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (index_version % 2 != 0 || unverified_checksums_.getVersion() != index_version){
+        return false;
+    }
+
+    read_blocks_count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t seq_no = 0;
+    if (isReadAheadDue(block_hash, seq_no)){
+        std::lock_guard<std::mutex> guard(latch_);
+        scheduleReadAhead(seq_no);
+    }
+    return true;
+}
+
+bool BlockManager::readCachedBlock(const size_t block_hash, DataBlock& in_block) noexcept{
+    char block_data[MAX_DATA_BLOCK_SIZE];
+    size_t data_size = 0;
+    if (!readCachedBlock(block_hash, block_data, data_size)){
+        return false;
+    }
+    // DataBlock compares whole buffers, so the padding is cleared
+    in_block.data_size = data_size;
+    std::memcpy(in_block.data, block_data, data_size);
+    std::memset(in_block.data + data_size, 0x00, MAX_DATA_BLOCK_SIZE - data_size);
+    return true;
+}
+
+void BlockManager::checkNoBlocksPinned() const{
+    if (buff_manager_.getExternalPinsCount() != 0){
+        throw std::runtime_error("Failed to change the block storage: views into the mapped storage are still in use"s);
+    }
+    if (buff_manager_.getPinnedFramesCount() != 0){
+        throw std::runtime_error("Failed to change the block storage: views of cached blocks are still in use"s);
+    }
+}
+
+void BlockManager::rememberSeqNo(const size_t block_hash, const uint64_t seq_no) noexcept{
+    // readers look the hints up without the latch
+    if (seq_no_hints_.update(block_hash, seq_no)){
+        return;
+    }
+    // entries of evicted blocks are never removed one by one, so the hints start over once they fill up
+    if (!seq_no_hints_.insert(block_hash, seq_no)){
+        seq_no_hints_.clear();
+        seq_no_hints_.insert(block_hash, seq_no);
+    }
+}
+
+void BlockManager::detectSequentialRead(const size_t block_hash) noexcept{
+    uint64_t seq_no = 0;
+    if (isReadAheadDue(block_hash, seq_no)){
+        scheduleReadAhead(seq_no);
+    }
+}
+
+bool BlockManager::isReadAheadDue(const size_t block_hash, uint64_t& seq_no) noexcept{
+    // a mapped storage reads ahead on its own
+    if (read_ahead_blocks_.load(std::memory_order_relaxed) == 0 || mapped_store_.load(std::memory_order_relaxed)
+        || !seq_no_hints_.findUnsynchronized(block_hash, seq_no)){
+        sequential_reads_count_.store(0, std::memory_order_relaxed);
+        return false;
+    }
+
+    const bool sequential = seq_no == last_read_seq_no_.load(std::memory_order_relaxed) + 1;
+    const size_t sequential_reads_count = sequential ? sequential_reads_count_.load(std::memory_order_relaxed) + 1 : 0;
+    sequential_reads_count_.store(sequential_reads_count, std::memory_order_relaxed);
+    last_read_seq_no_.store(seq_no, std::memory_order_relaxed);
+    uint64_t first_seq_no = 0;
+    uint64_t last_seq_no = 0;
+    return sequential_reads_count >= SEQUENTIAL_READS_BEFORE_READ_AHEAD && getReadAheadWindow(seq_no, first_seq_no, last_seq_no);
+}
+
+void BlockManager::scheduleReadAhead(const uint64_t seq_no) noexcept{
+    // another reader may have scheduled the window while the latch was free
+    PrefetchRequest request;
+    if (!getReadAheadWindow(seq_no, request.first_seq_no, request.last_seq_no)){
+        return;
+    }
+    try{
+        const uint64_t window_end = request.last_seq_no;
+        schedulePrefetch(std::move(request));
+        read_ahead_end_seq_no_.store(window_end, std::memory_order_relaxed);
+    } catch (const std::exception&){
+        // read-ahead is only a hint, the reader falls back to single block reads
+    }
+}
+
+bool BlockManager::getReadAheadWindow(const uint64_t seq_no, uint64_t& first_seq_no, uint64_t& last_seq_no) const noexcept{
+    // the next window is requested once the reader has consumed half of the current one
+    const size_t read_ahead_blocks = read_ahead_blocks_.load(std::memory_order_relaxed);
+    first_seq_no = std::max(seq_no + 1, read_ahead_end_seq_no_.load(std::memory_order_relaxed));
+    last_seq_no = seq_no + 1 + read_ahead_blocks;
+    return first_seq_no < last_seq_no && last_seq_no - first_seq_no >= (read_ahead_blocks + 1) / 2;
+}
+
+void BlockManager::schedulePrefetch(PrefetchRequest&& request){
+    if (!store_){
+        return;
+    }
+    if (!prefetcher_.joinable()){
+        prefetcher_ = std::thread(&BlockManager::loadPrefetchedBlocks, this);
+    }
+    prefetch_requests_.push_back(std::move(request));
+    prefetcher_wakeup_.notify_one();
+}
+
+std::vector<StoredDataBlock> BlockManager::readThrough(const size_t* block_hashes, const size_t count) noexcept{
+    std::vector<StoredDataBlock> uncached_blocks;
+    std::vector<BlockReadTarget> targets;
+    std::vector<frame_id_t> frame_ids;
+    if (!store_){
+        return uncached_blocks;
+    }
+
+    try{
+        // a block missing from the dedup index is not stored, so it costs neither a storage read nor a frame
+        targets.reserve(count);
+        for (size_t i = 0; i < count; ++i){
+            if (stored_blocks_.find(block_hashes[i]) != nullptr){
+                targets.emplace_back().block_hash = block_hashes[i];
+            }
+        }
+        if (targets.empty()){
+            return uncached_blocks;
+        }
+
+        // the blocks are read straight into free frames of the buffer; the rest are read into a scratch buffer,
+        // so a full buffer evicts a block only for a block which has been found
+        std::vector<size_t> scratch_indexes;
+        scratch_indexes.reserve(targets.size());
+        frame_ids.reserve(targets.size());
+        for (size_t i = 0; i < targets.size(); ++i){
+            frame_ids.push_back(buff_manager_.beginBlockLoad(targets[i].block_hash, targets[i].buffer, false));
+            if (frame_ids[i] == INVALID_FRAME_ID){
+                scratch_indexes.push_back(i);
+            }
+        }
+        AlignedBuffer scratch_data = allocateAlignedBuffer(scratch_indexes.size() * MAX_DATA_BLOCK_SIZE);
+        for (size_t i = 0; i < scratch_indexes.size(); ++i){
+            targets[scratch_indexes[i]].buffer = scratch_data.get() + i * MAX_DATA_BLOCK_SIZE;
+        }
+        store_->readBlocksInto(targets.data(), targets.size());
+        // the blocks are about to be read, so they are verified right away in either mode
+        checksum_failures_count_ += verifyLoadedBlocks(targets);
+        for (const BlockReadTarget& target : targets){
+            unverified_checksums_.erase(target.block_hash);
+        }
+
+        // the admission filter may keep a found block out, the caller gets a copy of it then
+        uncached_blocks.reserve(scratch_indexes.size());
+        for (const size_t i : scratch_indexes){
+            if (targets[i].data_size != 0){
+                StoredDataBlock& uncached_block = uncached_blocks.emplace_back();
+                uncached_block.block_hash = targets[i].block_hash;
+                uncached_block.seq_no = targets[i].seq_no;
+                uncached_block.dblock.data_size = targets[i].data_size;
+                std::memcpy(uncached_block.dblock.data, targets[i].buffer, MAX_DATA_BLOCK_SIZE);
+                buff_manager_.addDataBlock(uncached_block.dblock, uncached_block.block_hash);
+            }
+        }
+    } catch (const std::exception&){
+        // the storage cannot be read or the memory is short, so the blocks are reported as missing
+        for (const frame_id_t frame_id : frame_ids){
+            if (frame_id != INVALID_FRAME_ID){
+                buff_manager_.completeBlockLoad(frame_id, 0);
+            }
+        }
+        return {};
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i){
+        if (frame_ids[i] != INVALID_FRAME_ID){
+            buff_manager_.completeBlockLoad(frame_ids[i], targets[i].data_size);
+        }
+        if (targets[i].data_size != 0){
+            rememberSeqNo(targets[i].block_hash, targets[i].seq_no);
+            read_blocks_count_.fetch_add(1, std::memory_order_relaxed);
+            detectSequentialRead(targets[i].block_hash);
+        }
+    }
+    return uncached_blocks;
+}
+
+void BlockManager::loadPrefetchedBlocks(){
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true){
+        prefetcher_wakeup_.wait(lock, [this](){
+            return stop_prefetcher_ || !prefetch_requests_.empty();
+        });
+        if (stop_prefetcher_){
+            return;
+        }
+
+        PrefetchRequest request = std::move(prefetch_requests_.front());
+        prefetch_requests_.pop_front();
+        ++loading_requests_count_;
+        if (request.block_hashes.empty()){
+            loadBlockRange(request.first_seq_no, request.last_seq_no, lock);
+        } else{
+            loadBlocksIntoBuffer(request.block_hashes, lock);
+        }
+        --loading_requests_count_;
+        prefetch_loaded_.notify_all();
+    }
+}
+
+void BlockManager::loadBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no, std::unique_lock<std::mutex>& lock) noexcept{
+    // the hashes of a range are known only once it is read, so its blocks are copied into the buffer
+    const size_t removals_count = removals_count_;
+    const bool lazy_checksums = lazy_checksums_enabled_;
+    lock.unlock();
+    std::vector<StoredDataBlock> loaded_blocks;
+    size_t checksum_failures_count = 0;
+    try{
+        loaded_blocks = store_->readBlockRange(first_seq_no, last_seq_no);
+    } catch (const std::exception&){
+        // a failed prefetch only costs the reader a cache miss, so errors are not reported
+    }
+    if (!lazy_checksums){
+        const auto corrupted_begin = std::remove_if(loaded_blocks.begin(), loaded_blocks.end(), [](const StoredDataBlock& loaded_block){
+            return !isBlockChecksumValid(loaded_block.dblock.data, loaded_block.dblock.data_size, loaded_block.checksum);
+        });
+        checksum_failures_count = static_cast<size_t>(loaded_blocks.end() - corrupted_begin);
+        loaded_blocks.erase(corrupted_begin, loaded_blocks.end());
+    }
+
+    lock.lock();
+    checksum_failures_count_ += checksum_failures_count;
+    // a block removed in the meantime may be among the loaded ones
+    if (removals_count_ != removals_count){
+        return;
+    }
+    for (const StoredDataBlock& loaded_block : loaded_blocks){
+        if (buff_manager_.isBlockCached(loaded_block.block_hash)){
+            continue;
+        }
+        if (lazy_checksums
+            && !deferChecksum(loaded_block.block_hash, loaded_block.dblock.data, loaded_block.dblock.data_size, loaded_block.checksum)){
+            continue;
+        }
+        if (buff_manager_.addDataBlock(loaded_block.dblock, loaded_block.block_hash)){
+            ++prefetched_blocks_count_;
+            rememberSeqNo(loaded_block.block_hash, loaded_block.seq_no);
+        }
+    }
+}
+
+void BlockManager::loadBlocksIntoBuffer(const std::vector<size_t>& block_hashes, std::unique_lock<std::mutex>& lock) noexcept{
+    // frames are taken under the latch and filled without it; until the load completes they are pinned and cannot be found
+    std::vector<BlockReadTarget> targets;
+    std::vector<frame_id_t> frame_ids;
+    for (const size_t block_hash : block_hashes){
+        // cached blocks are not loaded again, and a block missing from the dedup index is not stored
+        if (stored_blocks_.find(block_hash) == nullptr){
+            continue;
+        }
+        char* frame_data = nullptr;
+        const frame_id_t frame_id = buff_manager_.beginBlockLoad(block_hash, frame_data);
+        if (frame_id == INVALID_FRAME_ID){
+            continue;
+        }
+        BlockReadTarget& target = targets.emplace_back();
+        target.block_hash = block_hash;
+        target.buffer = frame_data;
+        frame_ids.push_back(frame_id);
+    }
+    if (targets.empty()){
+        return;
+    }
+    const size_t removals_count = removals_count_;
+    const bool lazy_checksums = lazy_checksums_enabled_;
+    lock.unlock();
+
+    size_t checksum_failures_count = 0;
+    try{
+        store_->readBlocksInto(targets.data(), targets.size());
+        // the frames cannot be found yet, so the blocks are verified without the latch
+        if (!lazy_checksums){
+            checksum_failures_count = verifyLoadedBlocks(targets);
+        }
+    } catch (const std::exception&){
+        // a failed prefetch only costs the reader a cache miss, so errors are not reported
+        for (BlockReadTarget& target : targets){
+            target.data_size = 0;
+        }
+    }
+
+    lock.lock();
+    checksum_failures_count_ += checksum_failures_count;
+    for (size_t i = 0; i < targets.size(); ++i){
+        // a block removed in the meantime may have been loaded, so the frames are freed instead
+        if (removals_count_ != removals_count){
+            targets[i].data_size = 0;
+        }
+        if (lazy_checksums && targets[i].data_size != 0
+            && !deferChecksum(targets[i].block_hash, targets[i].buffer, targets[i].data_size, targets[i].checksum)){
+            targets[i].data_size = 0;
+        }
+        if (buff_manager_.completeBlockLoad(frame_ids[i], targets[i].data_size)){
+            ++prefetched_blocks_count_;
+            rememberSeqNo(targets[i].block_hash, targets[i].seq_no);
+        }
+    }
+}
+
+const char* BlockManager::viewMappedBlock(const size_t block_hash, size_t& data_size) noexcept{
+    uint32_t checksum = 0;
+    const char* block_data = store_->viewBlock(block_hash, data_size, checksum);
+    if (block_data == nullptr){
+        return nullptr;
+    }
+
+    // the lazy mode verifies a block once; a block found in the set again is trusted if its checksum is the same
+    const uint32_t* verified_checksum = lazy_checksums_enabled_ ? verified_views_.find(block_hash) : nullptr;
+    if (verified_checksum == nullptr || *verified_checksum != checksum){
+        if (!isBlockChecksumValid(block_data, data_size, checksum)){
+            ++checksum_failures_count_;
+            return nullptr;
+        }
+        // forgetting a verified block only costs another verification, so the set starts over once it fills up
+        if (lazy_checksums_enabled_ && verified_checksum == nullptr && !verified_views_.insert(block_hash, checksum)){
+            verified_views_.clear();
+            verified_views_.insert(block_hash, checksum);
+        }
+    }
+    read_blocks_count_.fetch_add(1, std::memory_order_relaxed);
+    return block_data;
+}
+
+size_t BlockManager::verifyLoadedBlocks(std::vector<BlockReadTarget>& targets) noexcept{
+    size_t checksum_failures_count = 0;
+    for (BlockReadTarget& target : targets){
+        if (target.data_size != 0 && !isBlockChecksumValid(target.buffer, target.data_size, target.checksum)){
+            // a corrupted block is reported as missing, so it never reaches the buffer
+            target.data_size = 0;
+            ++checksum_failures_count;
+        }
+    }
+    return checksum_failures_count;
+}
+
+bool BlockManager::deferChecksum(const size_t block_hash, const char* data, const size_t data_size, const uint32_t checksum) noexcept{
+    // readers look the checksums up without the latch
+    if (checksum == 0 || unverified_checksums_.update(block_hash, checksum)){
+        return true;
+    }
+    // entries of evicted blocks are only dropped by their next read, so a full index verifies the block right away instead
+    if (!unverified_checksums_.insert(block_hash, checksum) && !isBlockChecksumValid(data, data_size, checksum)){
+        ++checksum_failures_count_;
+        return false;
+    }
+    return true;
+}
+
+void BlockManager::registerBufferMemory() noexcept{
+    IoEngine* io_engine = store_ ? store_->getIoEngine() : nullptr;
+    if (io_engine != nullptr){
+        // without the registration every request maps the frames itself, so a failure only costs speed
+        io_engine->registerBuffers({buff_manager_.getFramesMemory()});
+    }
+}
+
+void BlockManager::stopPrefetcher() noexcept{
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        if (!prefetcher_.joinable()){
+            return;
+        }
+        stop_prefetcher_ = true;
+        prefetch_requests_.clear();
+    }
+    prefetcher_wakeup_.notify_one();
+    prefetcher_.join();
+
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_prefetcher_ = false;
+    prefetch_loaded_.notify_all();
 }
 
 size_t BlockManager::getBufferSize() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
     return buff_manager_.getCacheSize();
 }
 
+size_t BlockManager::getDirtyBlocksCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return buff_manager_.getDirtyBlocksCount();
+}
+
+size_t BlockManager::getStoredBlocksCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return stored_blocks_.size();
+}
+
+size_t BlockManager::getBufferResidentBytes() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return buff_manager_.getResidentBytes();
+}
+
+bool BlockManager::setBufferMemoryBudget(const size_t memory_budget) noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    const bool resized = buff_manager_.setMemoryBudget(memory_budget);
+    // the frames given back to the OS are mapped to new pages when used again
+    registerBufferMemory();
+    return resized;
+}
+
+void BlockManager::setBufferAdmissionFilterEnabled(const bool enabled){
+    std::lock_guard<std::mutex> guard(latch_);
+    buff_manager_.setAdmissionFilterEnabled(enabled);
+}
+
+void BlockManager::setLazyChecksumVerificationEnabled(const bool enabled) noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    lazy_checksums_enabled_ = enabled;
+    // the blocks loaded lazily so far are still verified by their first readers
+    verified_views_.clear();
+}
+
+size_t BlockManager::getChecksumFailuresCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return checksum_failures_count_;
+}
+
+size_t BlockManager::getPrefetchedBlocksCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return prefetched_blocks_count_;
+}
+
 size_t BlockManager::getTotalReadBlocksCount() const noexcept{
-    return written_blocks_count_;
+    return read_blocks_count_.load(std::memory_order_relaxed);
 }
 
 size_t BlockManager::getTotalWrittenBlocksCount() const noexcept{
-    return read_blocks_count_;
+    std::lock_guard<std::mutex> guard(latch_);
+    return written_blocks_count_;
 }
\ No newline at end of file
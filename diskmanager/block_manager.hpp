@@ -3,9 +3,19 @@
 #include "common.hpp"
 
 #include "buffer_manager.hpp"
+#include "block_store.hpp"
+#include "block_write_pipeline.hpp"
+#include "chunking.hpp"
+#include "duckdb_block_store.hpp"
 
 #include <filesystem>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <unordered_set>
 
 /*
 Тестовое задание: Разработка Buffer Manager и Block Manager для работы с диском
@@ -54,32 +64,226 @@ Referenses:
 class BlockManager{
 public:
     explicit BlockManager() = default;
-    explicit BlockManager(duckdb::DuckDB& db_obj);
+
+    /** Open the block storage in the database. A blocks table of the old VARCHAR schema is migrated; its rows have no size,
+     * so payloads which end with NUL bytes lose them.
+     * @param[in] db_obj a reference to the database object
+     * @param[in] buffer_memory_budget number of bytes the block cache may use
+     * @param[in] max_buffer_memory_budget upper limit for `setBufferMemoryBudget()`; `0` means `buffer_memory_budget`
+     * @throw `std::runtime_error` if the blocks table cannot be created or migrated.
+    */
+    explicit BlockManager(duckdb::DuckDB& db_obj, const size_t buffer_memory_budget = DEFAULT_BUFFER_MEMORY_BUDGET,
+                          const size_t max_buffer_memory_budget = 0);
+
+    /** Keep the blocks in the given storage, e.g. a `RawFileBlockStore`. With a mapped storage (`MappedFileBlockStore`) clean
+     * blocks are read through the kernel page cache; the buffer keeps only the dirty blocks of the write-back mode and
+     * counts the pins of the views.
+     * @param[in] store the block storage; must not be `nullptr`
+     * @param[in] buffer_memory_budget number of bytes the block cache may use
+     * @param[in] max_buffer_memory_budget upper limit for `setBufferMemoryBudget()`; `0` means `buffer_memory_budget`
+     * @throw `std::invalid_argument` if there is no storage, `std::runtime_error` if its blocks cannot be listed.
+    */
+    explicit BlockManager(std::unique_ptr<BlockStore> store, const size_t buffer_memory_budget = DEFAULT_BUFFER_MEMORY_BUDGET,
+                          const size_t max_buffer_memory_budget = 0);
+
+    // Writes all pending blocks of the write-back mode to the database before closing. Pending prefetches are dropped.
+    ~BlockManager();
+
+    BlockManager(const BlockManager&) = delete;
+    BlockManager& operator=(const BlockManager&) = delete;
 
 public:
     /** Writes data to the currently openned file and caches the value in the buffer.
+     * Blocks the storage has already are skipped, whether they are cached or not; the manager keeps an index of the
+     * stored blocks, so that costs no storage access.
+     * Blocks are identified by their 64-bit key, `DataBlock::Hash()`. A different block with the key of a cached block
+     * is caught by comparing the bytes, one with the key of a block which is only stored by comparing the high halves of
+     * their 128-bit fingerprints, which the index keeps next to the keys. Only a block an older storage has listed
+     * without the high half is taken for a duplicate on its key alone.
+     * In the write-back mode new blocks are only cached and marked dirty; a background thread writes them to the database.
      * @param[in] data_bytes a pointer to the data buffer000
      * @param[in] data_size a number of bytes to read from the data buffer
+     * @param[in] chunking_mode how the data is split into blocks; `ChunkingMode::CONTENT_DEFINED` lets an edited copy
+     * of earlier data share most of its blocks with it, using the sizes set by `setChunkingParameters()`
+     * @throw `std::runtime_error` on fail to insert the data to the database,
+     * or if a block has the same key as a different cached or stored block rather than being skipped as a duplicate.
+    */
+    void writeBlock(const char* data_bytes, const size_t data_size, const ChunkingMode chunking_mode = ChunkingMode::FIXED_SIZE);
+
+    /* Produces the data of a streaming write: copies up to `capacity` bytes into `buffer` and returns how many
+       it has copied, `0` at the end of the data. */
+    using DataSource = std::function<size_t(char* buffer, const size_t capacity)>;
+
+    /** Writes data produced piece by piece like `writeBlock()` writes a buffer, without holding all of it in memory.
+     * The data is read into a window of `STREAM_WINDOW_SIZE` bytes, cut into blocks and written in batches of
+     * `STREAM_BATCH_BLOCKS` blocks, so the memory used does not depend on the size of the data.
+     * The batches are fingerprinted in parallel if `setWriteThreadsCount()` allows it. Blocks written before a failure stay written.
+     * @param[in] source called until it returns `0`
+     * @param[in] chunking_mode how the data is split into blocks, see `writeBlock()`
+     * @param[out] block_hashes if not `nullptr`, the hashes of all blocks the data has been cut into, new or not, are
+     * appended to it in the order of the data
+     * @return the number of bytes written.
+     * @throw `std::runtime_error` on fail to insert the data to the database, see `writeBlock()`; exceptions of the source are passed on.
+    */
+    size_t writeStream(const DataSource& source, const ChunkingMode chunking_mode = ChunkingMode::FIXED_SIZE,
+                       std::vector<size_t>* block_hashes = nullptr);
+
+    /** Writes the rest of an input stream, see `writeStream(const DataSource&, const ChunkingMode, std::vector<size_t>*)`.
+     * @throw `std::runtime_error` also if the stream fails to read.
+    */
+    size_t writeStream(std::istream& input, const ChunkingMode chunking_mode = ChunkingMode::FIXED_SIZE,
+                       std::vector<size_t>* block_hashes = nullptr);
+
+    /** Writes everything that can be read from a file descriptor (a file, a pipe or a socket) until the end of it,
+     * see `writeStream(const DataSource&, const ChunkingMode, std::vector<size_t>*)`. The descriptor is not closed.
+     * @throw `std::runtime_error` also if the descriptor fails to read.
     */
-    void writeBlock(const char* data_bytes, const size_t data_size);
+    size_t writeFile(const int fd, const ChunkingMode chunking_mode = ChunkingMode::FIXED_SIZE, std::vector<size_t>* block_hashes = nullptr);
 
-    /** Reads a data block from the storage file by its data hash.
+    /** Set the number of threads taking part in large writes: streamed ones and `writeBlock()` calls of at least
+     * `PARALLEL_WRITE_MIN_SIZE` bytes. With more than one, the writing thread only cuts the data into blocks, that many
+     * workers fingerprint them and one more thread deduplicates and stores them in the order of the data.
+     * @param[in] threads_count `0` or `1` does every stage on the writing thread
+    */
+    void setWriteThreadsCount(const size_t threads_count) noexcept;
+
+    /** Set the chunk sizes of the content-defined writes.
+     * @throw `std::invalid_argument` if the sizes do not fit into data blocks, see `checkChunkingParameters()`.
+    */
+    void setChunkingParameters(const ChunkingParameters& parameters);
+
+    /** Turn the write-back mode on or off. Turning it off writes all pending blocks first.
+     * @param[in] enabled `true` to cache new blocks as dirty and write them in batches in the background,
+     * `false` to write every new block to the database before `writeBlock()` returns
+     * @throw `std::runtime_error` if the pending blocks cannot be written.
+    */
+    void setWriteBackEnabled(const bool enabled);
+
+    bool isWriteBackEnabled() const noexcept;
+
+    /** Wait until every block written so far is in the database and sync the storage. A durability point of the write-back mode.
+     * @throw `std::runtime_error` if the background writer has failed to write a batch; its blocks stay dirty and are retried.
+    */
+    void flush();
+
+    /** Reads a data block from the storage file by its data hash. A block missing from the buffer is read from the database
+     * and cached.
      * @param[in] data_hash hash for the datablock to read00
      * @param[in] in_block a block object to read a data block to
      * @return `true` if the block existed and has been successfully read, `false` otherwise.
     */ 
     bool readBlock(const size_t data_hash, DataBlock& in_block) noexcept;
 
-    /** Change the current database.
+    /** Reads a batch of data blocks. Blocks missing from the buffer are fetched from the database with one query and cached.
+     * @param[in] data_hashes hashes of the blocks to read
+     * @param[in] count number of hashes
+     * @param[out] in_blocks `count` block objects; the ones of blocks which do not exist are left untouched
+     * @return number of blocks which have been read.
+    */
+    size_t readBlocks(const size_t* data_hashes, const size_t count, DataBlock* in_blocks) noexcept;
+
+    /** Reads a data block like `readBlock()`, but tells a corrupted block from a missing one.
+     * @param[in] data_hash hash for the datablock to read
+     * @param[in] in_block a block object to read a data block to
+     * @return `false` if the block does not exist or cannot be read from the storage.
+     * @throw `BlockChecksumError` if the block read from the storage does not match its checksum; it is not cached then.
+     * @throw `std::bad_alloc` if the read cannot be prepared.
+    */
+    bool readBlockChecked(const size_t data_hash, DataBlock& in_block);
+
+    /** Copies only the meaningful bytes of a data block into the caller's buffer, reading it through the buffer.
+     * @param[in] data_hash hash for the datablock to read
+     * @param[out] buffer destination of at least `buffer_size` bytes
+     * @param[in] buffer_size size of the destination
+     * @param[out] data_size number of bytes copied
+     * @return `false` if the block does not exist or does not fit into the buffer.
+    */
+    bool readBlock(const size_t data_hash, char* buffer, const size_t buffer_size, size_t& data_size) noexcept;
+
+    /** Get a pinned, read-only view of a data block, so it can be used without being copied. A missing block is read
+     * into the buffer first; with a mapped storage the view points into the mapping instead and the buffer only counts the pin.
+     * The block cannot be evicted until the handle is released. The handle must not outlive the BlockManager.
+     * @param[in] data_hash hash for the datablock to read
+     * @return an empty handle if the block does not exist or the buffer cannot take it.
+    */
+    BlockHandle readBlockView(const size_t data_hash) noexcept;
+
+    /** Remove a data block from the buffer and the storage, so the space it takes on disk can be reused by new blocks.
+     * Blocks are addressed by their contents, so a block is shared by every write of the same data; the caller must know
+     * that none of them needs it any more. A block of the write-back mode is dropped before it reaches the storage.
+     * @param[in] data_hash hash for the datablock to remove
+     * @return `false` if the block does not exist or is pinned, e.g. by a handle of `readBlockView()`.
+     * @throw `std::runtime_error` on fail to remove the block from the storage; the block stays readable then.
+    */
+    bool removeBlock(const size_t data_hash);
+
+    /** Load data blocks into the buffer in the background, so later `readBlock()` calls hit the cache.
+     * Blocks which are cached already or are not in the database are skipped. All blocks are fetched with one query.
+     * @param[in] block_hashes hashes of the blocks to load
+     * @param[in] count number of hashes
+    */
+    void prefetch(const size_t* block_hashes, const size_t count);
+
+    // Wait until all requested prefetches, including automatic read-ahead, have been loaded into the buffer.
+    void waitForPrefetches();
+
+    /** Set the read-ahead window. Once blocks are read in the order they have been written, the next `blocks_count`
+     * blocks are loaded in the background with one range query.
+     * @param[in] blocks_count number of blocks to read ahead; `0` turns the read-ahead off
+    */
+    void setReadAheadWindow(const size_t blocks_count) noexcept;
+
+    /** Change the current database. Pending blocks of the write-back mode are written to the old database first.
      * @param[in] n_db a reference to a new database object
+     * @throw `std::runtime_error` if the pending blocks cannot be written.
+    */
+    void setNewDBObject(duckdb::DuckDB& n_db);
+
+    /** Change the block storage. Pending blocks of the write-back mode are written to the old storage first.
+     * @param[in] store the new block storage; must not be `nullptr`
+     * @throw `std::runtime_error` if the pending blocks cannot be written, views of cached blocks or into the old mapped
+     * storage are alive, or the blocks of the new storage cannot be listed.
     */
-    void setNewDBObject(duckdb::DuckDB& n_db) noexcept;
+    void setBlockStore(std::unique_ptr<BlockStore> store);
 
 public:
 
     // Get a number of data blocks currently in the buffer.
     size_t getBufferSize() const noexcept;
 
+    // Get a number of written blocks which are not in the database yet.
+    size_t getDirtyBlocksCount() const noexcept;
+
+    // Get a number of distinct blocks in the storage, including the ones of the write-back mode which are not there yet.
+    size_t getStoredBlocksCount() const noexcept;
+
+    // Get a number of bytes used by the buffer, including its bookkeeping.
+    size_t getBufferResidentBytes() const noexcept;
+
+    /** Resize the buffer at runtime. Shrinking evicts the least recently used blocks.
+     * @param[in] memory_budget new number of bytes the buffer may use
+     * @return `false` if the budget exceeds the maximum set at construction.
+    */
+    bool setBufferMemoryBudget(const size_t memory_budget) noexcept;
+
+    /** Turn on the TinyLFU admission filter of the buffer, so blocks written once (e.g. by a bulk ingest)
+     * do not evict frequently read ones.
+    */
+    void setBufferAdmissionFilterEnabled(const bool enabled);
+
+    /** Turn the lazy checksum verification on or off. By default every block read from the storage is verified as soon as
+     * it is read. In the lazy mode blocks loaded by prefetches and the read-ahead are verified by their first reader instead,
+     * so the ones which are never read cost nothing, and views into a mapped storage are verified once instead of on every read.
+     * A block which does not match its checksum is treated as missing and counted by `getChecksumFailuresCount()`.
+    */
+    void setLazyChecksumVerificationEnabled(const bool enabled) noexcept;
+
+    // Get a number of blocks read from the storage which have not matched their checksums.
+    size_t getChecksumFailuresCount() const noexcept;
+
+    // Get a number of blocks loaded into the buffer by prefetches and read-ahead.
+    size_t getPrefetchedBlocksCount() const noexcept;
+
     // Get a total number of read data blocks.
     size_t getTotalReadBlocksCount() const noexcept;
     
@@ -89,23 +293,206 @@ public:
     /** Create new data blocks and place the data evenly inside of them
      * @param[in] data a buffer to read the data from.
      * @param[in] data_size number of bytes to read
+     * @param[in] chunking_mode cut the blocks at fixed offsets or where the content defines
+     * @param[in] chunking_parameters chunk sizes of `ChunkingMode::CONTENT_DEFINED`, which must have passed `checkChunkingParameters()`
      * @return `std::vector` with DataBlock objects
     */
-    static std::vector<DataBlock> createDataBlocks(const char* data, const size_t data_size);
+    static std::vector<DataBlock> createDataBlocks(const char* data, const size_t data_size,
+                                                   const ChunkingMode chunking_mode = ChunkingMode::FIXED_SIZE,
+                                                   const ChunkingParameters& chunking_parameters = ChunkingParameters());
 
 private:
-    /** Inserts a new data block to the database and the buffer.
-     * @param[in] dblock DataBlock object
-     * @param[in] block_hash a hash of the data block
-     * @throw `std::runtime_error` on fail to insert the data to the database.
+    /** Cut data into blocks and send them down the pipeline, which writes them in batches.
+     * @param[in] is_last_piece `false` to leave unwritten a tail shorter than the largest block, which the next piece may extend
+     * @return the number of bytes cut into blocks, all of them if `is_last_piece` is `true`.
+     * @throw `std::runtime_error` like `writeBlock()`.
+    */
+    size_t writeChunkedData(const char* data, const size_t size, const bool is_last_piece, const ChunkingMode chunking_mode,
+                            const ChunkingParameters& chunking_parameters, BlockWritePipeline& pipeline);
+
+    /** Create a pipeline writing batches with `writeDataBlocks()`.
+     * @param[in] parallel `true` to fingerprint the batches on `write_threads_count_` workers
+     * @param[out] block_hashes if not `nullptr`, the hashes of the written blocks are appended to it in order
+    */
+    std::unique_ptr<BlockWritePipeline> makeWritePipeline(const bool parallel, const size_t batch_blocks_count,
+                                                          std::vector<size_t>* block_hashes);
+
+    /** Skip the blocks found in the buffer or the dedup index, then store and cache the rest.
+     * @throw `std::runtime_error` like `writeBlock()`.
+    */
+    void writeDataBlocks(const DataBlock* dblocks, const BlockFingerprint* fingerprints, const size_t dblocks_count);
+
+    ChunkingParameters getChunkingParameters(const ChunkingMode chunking_mode) const;
+
+    /** Build the dedup index of the blocks a storage holds.
+     * @throw `std::runtime_error` on fail to list the blocks.
+    */
+    static HashIndex<uint64_t> indexStoredBlocks(BlockStore& store);
+
+    // Add a block to the dedup index unless it is there, growing the index once it is full. Must be called under the latch.
+    void indexStoredBlock(const size_t block_hash, const uint64_t fingerprint_high);
+
+    /** Writes new data blocks to the storage in one batch and caches them.
+     * The latch is released while the storage writes, so concurrent writers can share one commit of it; the new blocks
+     * are in the dedup index and in `storing_blocks_` meanwhile, so no other writer stores them as well.
+     * @throw `std::runtime_error` on fail to write the data to the storage.
+    */
+    void storeDataBlocks(const std::vector<StoredDataBlock>& dblocks, std::unique_lock<std::mutex>& lock);
+
+    /** Caches a new data block as dirty and queues it for the background writer.
+     * Waits for the writer if the buffer is full of dirty blocks.
+    */
+    void bufferDataBlock(const DataBlock& dblock, const BlockFingerprint& fingerprint, const uint64_t seq_no,
+                         std::unique_lock<std::mutex>& lock);
+
+    /** Copies the blocks at `indexes` out of the buffer and reads the missing ones through. Must be called under the latch.
+     * @throw `std::bad_alloc` if the misses cannot be collected.
+    */
+    size_t copyBlocks(const size_t* block_hashes, const std::vector<size_t>& indexes, DataBlock* in_blocks);
+
+    /** Copies a cached block without the latch and counts the read. A block waiting for its lazy checksum verification
+     * is left to the latched path, and so is a block whose frame keeps changing under the reader.
+     * @param[out] buffer at least `MAX_DATA_BLOCK_SIZE` bytes; only `data_size` bytes are written
+     * @return `false` if the block has to be read under the latch.
+    */
+    bool readCachedBlock(const size_t block_hash, char* buffer, size_t& data_size) noexcept;
+
+    // Copies a cached block into a block object like `readCachedBlock()`; the object is left untouched if it returns `false`.
+    bool readCachedBlock(const size_t block_hash, DataBlock& in_block) noexcept;
+
+    // Pins a cached block and counts the read; a block loaded in the lazy checksum mode is verified first. Must be called under the latch.
+    BlockHandle pinCachedBlock(const size_t block_hash) noexcept;
+
+    /** Makes sure no view of a block is alive, so the buffer can be emptied for a new storage. Must be called under the latch.
+     * @throw `std::runtime_error` if a block is pinned.
+    */
+    void checkNoBlocksPinned() const;
+
+    // Remember the write sequence number of a cached block for the read-ahead.
+    void rememberSeqNo(const size_t block_hash, const uint64_t seq_no) noexcept;
+
+    // Track the order of reads and schedule the read-ahead once they turn sequential. Must be called under the latch.
+    void detectSequentialRead(const size_t block_hash) noexcept;
+
+    /** Track the order of reads without the latch; concurrent readers may lose each other's updates, which only delays
+     * the read-ahead.
+     * @param[out] seq_no sequence number of the block, to pass to `scheduleReadAhead()`
+     * @return `true` if the reader has consumed half of the read-ahead window and the next one should be scheduled.
+    */
+    bool isReadAheadDue(const size_t block_hash, uint64_t& seq_no) noexcept;
+
+    // Schedule the read-ahead window following the block `seq_no`, unless another reader has done it. Must be called under the latch.
+    void scheduleReadAhead(const uint64_t seq_no) noexcept;
+
+    // Get the read-ahead window following the block `seq_no`; `false` if less than half of it is left to schedule.
+    bool getReadAheadWindow(const uint64_t seq_no, uint64_t& first_seq_no, uint64_t& last_seq_no) const noexcept;
+
+    /* A batch of blocks to load: either a list of hashes or a range of write sequence numbers. */
+    struct PrefetchRequest{
+        std::vector<size_t> block_hashes;
+        uint64_t first_seq_no = 0;
+        uint64_t last_seq_no = 0;                       /* exclusive */
+    };
+
+    // Queue a prefetch request, starting the loader thread on first use.
+    void schedulePrefetch(PrefetchRequest&& request);
+
+    /** Reads blocks missing from the buffer from the storage with one call, straight into free frames of the buffer.
+     * Blocks missing from the dedup index are skipped, and a full buffer makes space only for the blocks which are found.
+     * Must be called under the latch.
+     * @return copies of the found blocks which have not been read into a frame; the rest can be pinned from the buffer.
+    */
+    std::vector<StoredDataBlock> readThrough(const size_t* block_hashes, const size_t count) noexcept;
+
+    // Body of the background loader thread: loads every request with one call and caches the found blocks.
+    void loadPrefetchedBlocks();
+
+    // Loads a range of blocks for the read-ahead and caches them. Releases the latch while the storage is read.
+    void loadBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no, std::unique_lock<std::mutex>& lock) noexcept;
+
+    // Loads blocks straight into frames of the buffer. Releases the latch while the storage is read.
+    void loadBlocksIntoBuffer(const std::vector<size_t>& block_hashes, std::unique_lock<std::mutex>& lock) noexcept;
+
+    // Register the frames of the buffer with the I/O engine of the storage, if it has one.
+    void registerBufferMemory() noexcept;
+
+    // Get a verified block straight from the mapping of a mapped storage and count the read. Must be called under the latch.
+    const char* viewMappedBlock(const size_t block_hash, size_t& data_size) noexcept;
+
+    // Verify loaded blocks against their checksums, marking the corrupted ones as not found. Returns the number of those.
+    static size_t verifyLoadedBlocks(std::vector<BlockReadTarget>& targets) noexcept;
+
+    /** Leave a block about to be cached in the lazy checksum mode to be verified by its first reader. It is called before
+     * the block is added, so no reader without the latch can find the block before its checksum. Must be called under the latch.
+     * @return `false` if the index is full and the block fails the verification done instead; the block must not be cached then.
     */
-    void insertDataBlockToDB(const DataBlock& dblock, const size_t block_hash);
+    bool deferChecksum(const size_t block_hash, const char* data, const size_t data_size, const uint32_t checksum) noexcept;
+
+    // Stop the background loader, dropping the requests it has not started yet.
+    void stopPrefetcher() noexcept;
+
+    // Body of the background writer thread: writes dirty blocks in batches, one transaction per batch.
+    void flushDirtyBlocks();
+
+    // Stop the background writer after it has written all dirty blocks.
+    void stopFlusher() noexcept;
 
 private:
+    static constexpr size_t WRITE_BACK_BATCH_SIZE = 256;                   /* Blocks written in one transaction */
+    static constexpr std::chrono::milliseconds WRITE_BACK_INTERVAL{100};   /* Longest time a block waits for an idle writer */
+    static constexpr size_t DEFAULT_READ_AHEAD_BLOCKS = 16;
+    static constexpr size_t SEQUENTIAL_READS_BEFORE_READ_AHEAD = 2;
+    static constexpr size_t OPTIMISTIC_READ_ATTEMPTS = 4;                  /* Retries of a cache hit racing a change of its frame */
+    static constexpr size_t STREAM_BATCH_BLOCKS = 64;                      /* Blocks of a streaming write deduplicated and stored at once */
+    static constexpr size_t STREAM_WINDOW_SIZE = STREAM_BATCH_BLOCKS * MAX_DATA_BLOCK_SIZE;  /* Bytes of a streaming write read at once */
+    static constexpr size_t PARALLEL_WRITE_MIN_SIZE = 1u << 20;            /* Smaller writes are not worth waking the workers */
+
+    mutable std::mutex latch_;                          /* Guards the buffer and the write-back state below; cache hits
+                                                           are copied without it, see `readCachedBlock()`. It is not split
+                                                           by shard: a write checks the dedup index, reserves its blocks
+                                                           and caches them as one step */
     mutable BufferManager buff_manager_;
 
-    std::unique_ptr<duckdb::Connection> conn_db_;
+    std::unique_ptr<BlockStore> store_;                 /* Replaced only while the background threads are stopped */
+    std::atomic<bool> mapped_store_{false};             /* Blocks are read from the storage's mapping, the buffer keeps only dirty ones */
+
+    std::thread flusher_;                               /* Background writer of the write-back mode */
+    std::deque<std::pair<size_t, uint64_t>> dirty_blocks_;  /* Hashes and sequence numbers of unwritten blocks, oldest first */
+    size_t flushing_blocks_count_ = 0;                  /* Blocks of the batch being written right now */
+    size_t storing_writes_count_ = 0;                   /* Write-through batches the storage is writing without the latch */
+    bool write_back_enabled_ = false;
+    ChunkingParameters chunking_parameters_;            /* Chunk sizes of the content-defined writes */
+    size_t write_threads_count_ = 1;                    /* Threads fingerprinting the blocks of large writes */
+    bool stop_flusher_ = false;
+    bool flush_requested_ = false;
+    std::string flush_error_;                           /* Error of the last failed batch, reported by `flush()` */
+    std::condition_variable flusher_wakeup_;
+    std::condition_variable batch_flushed_;
+
+    uint64_t next_seq_no_ = 0;                          /* Write sequence number of the next new block */
+    HashIndex<uint64_t> stored_blocks_;                 /* Dedup index: the keys of the stored and the dirty blocks, cached or not,
+                                                           with the high halves of their fingerprints */
+    std::unordered_set<size_t> storing_blocks_;         /* Keys of the new blocks a writer is storing; others wait for them */
+    HashIndex<uint64_t> seq_no_hints_;                  /* Sequence numbers of recently cached blocks; reset when full */
+    std::atomic<uint64_t> last_read_seq_no_{0};         /* The read-ahead state is updated by readers without the latch */
+    std::atomic<size_t> sequential_reads_count_{0};
+    std::atomic<size_t> read_ahead_blocks_{DEFAULT_READ_AHEAD_BLOCKS};
+    std::atomic<uint64_t> read_ahead_end_seq_no_{0};    /* End of the last scheduled read-ahead window */
+
+    std::thread prefetcher_;                            /* Background loader of prefetches and read-ahead */
+    std::deque<PrefetchRequest> prefetch_requests_;
+    size_t loading_requests_count_ = 0;                 /* Requests taken by the loader and not cached yet */
+    bool stop_prefetcher_ = false;
+    std::condition_variable prefetcher_wakeup_;
+    std::condition_variable prefetch_loaded_;
+    size_t prefetched_blocks_count_ = 0;
+    size_t removals_count_ = 0;                         /* Lets a background load which has raced a removal drop its blocks */
+
+    bool lazy_checksums_enabled_ = false;
+    HashIndex<uint32_t> unverified_checksums_;          /* Checksums of cached blocks nobody has read yet, in the lazy mode */
+    HashIndex<uint32_t> verified_views_;                /* Checksums of verified blocks of a mapped storage; reset when full */
+    size_t checksum_failures_count_ = 0;
 
-    size_t written_blocks_count_;
-    size_t read_blocks_count_;
+    size_t written_blocks_count_ = 0;
+    std::atomic<size_t> read_blocks_count_{0};          /* Counted by readers without the latch as well */
 };
\ No newline at end of file
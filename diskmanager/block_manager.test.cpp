@@ -3,6 +3,15 @@
 
 #include "include/duckdb.hpp"
 #include "block_manager.hpp"
+#include "raw_file_block_store.hpp"
+#include "mapped_file_block_store.hpp"
+
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std::filesystem;
 using namespace std::string_literals;
@@ -84,6 +93,65 @@ DataBlock BlockManagerFilesystemTests::test_block2_;
 DataBlock BlockManagerFilesystemTests::test_block3_;
 DataBlock BlockManagerFilesystemTests::test_block4_;
 
+namespace{
+    /* Counts the storage accesses of a BlockManager, passing the calls on to a storage of its own. */
+    class CountingBlockStore : public BlockStore{
+    public:
+        explicit CountingBlockStore(std::unique_ptr<BlockStore> store) : store_(std::move(store)){
+        }
+
+        void writeBlocks(const std::vector<StoredDataBlock>& dblocks) override{
+            {
+                // BlockManager writes without its latch, so batches may come in concurrently
+                std::lock_guard<std::mutex> guard(counters_latch_);
+                ++accesses_count;
+                written_blocks_count += dblocks.size();
+                if (fail_writes){
+                    throw std::runtime_error("Failed to write the blocks: the storage is broken"s);
+                }
+            }
+            std::this_thread::sleep_for(write_delay);
+            store_->writeBlocks(dblocks);
+        }
+
+        std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) override{
+            ++accesses_count;
+            return store_->readBlocks(block_hashes);
+        }
+
+        std::vector<StoredDataBlock> readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no) override{
+            ++accesses_count;
+            return store_->readBlockRange(first_seq_no, last_seq_no);
+        }
+
+        uint64_t getNextSeqNo() override{
+            return store_->getNextSeqNo();
+        }
+
+        std::vector<StoredBlockKey> listBlockKeys() override{
+            return store_->listBlockKeys();
+        }
+
+        size_t removeBlocks(const std::vector<size_t>& block_hashes) override{
+            ++accesses_count;
+            return store_->removeBlocks(block_hashes);
+        }
+
+        void sync() override{
+            store_->sync();
+        }
+
+        size_t accesses_count = 0;
+        size_t written_blocks_count = 0;
+        bool fail_writes = false;
+        std::chrono::milliseconds write_delay{0};           /* keeps a batch in flight, so other writers run into it */
+
+    private:
+        std::unique_ptr<BlockStore> store_;
+        std::mutex counters_latch_;
+    };
+}
+
 TEST_F(BlockManagerFilesystemTests, BlockManagerInitStateTest){
     duckdb::DuckDB db(test_db_file_path1_.generic_string());
     BlockManager bmanager(db);
@@ -136,4 +204,658 @@ TEST_F(BlockManagerFilesystemTests, BlockManagerReadBlockTest){
     EXPECT_TRUE(bmanager.readBlock(test_block2_.Hash(), read_block2));
     EXPECT_EQ(bmanager.getTotalReadBlocksCount(), static_cast<size_t>(2));
     EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(2));
-}
\ No newline at end of file
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerWriteBackTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    BlockManager bmanager(db, BufferManager::getMemoryBudgetForBlocks(2));
+    bmanager.setWriteBackEnabled(true);
+    EXPECT_TRUE(bmanager.isWriteBackEnabled());
+
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+    bmanager.writeBlock(test_block2_.data, test_block2_.data_size);
+    DataBlock read_block;
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block1_);
+
+    // a buffer full of dirty blocks waits for the writer instead of dropping them
+    bmanager.writeBlock(test_block3_.data, test_block3_.data_size);
+    bmanager.flush();
+    EXPECT_EQ(bmanager.getDirtyBlocksCount(), static_cast<size_t>(0));
+
+    duckdb::Connection conn(db);
+    auto res = conn.Query("SELECT COUNT(*) FROM blocks;");
+    ASSERT_FALSE(res->HasError());
+    EXPECT_EQ(res->GetValue(0, 0).GetValue<int64_t>(), 3);
+
+    bmanager.setWriteBackEnabled(false);
+    EXPECT_FALSE(bmanager.isWriteBackEnabled());
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerPrefetchTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    {
+        BlockManager writer(db);
+        for (const DataBlock* dblock : {&test_block1_, &test_block2_, &test_block3_, &test_block4_}){
+            writer.writeBlock(dblock->data, dblock->data_size);
+        }
+    }
+
+    // a new manager starts with an empty buffer
+    BlockManager bmanager(db);
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(0));
+    DataBlock read_block;
+
+    const size_t block_hashes[] = {test_block1_.Hash(), test_block2_.Hash(), test_block3_.Hash(), 321331};
+    bmanager.prefetch(block_hashes, 3);
+    bmanager.waitForPrefetches();
+    EXPECT_EQ(bmanager.getPrefetchedBlocksCount(), static_cast<size_t>(3));
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(3));
+
+    // reading the blocks in the order they have been written pulls in the following ones
+    for (const size_t block_hash : {test_block1_.Hash(), test_block2_.Hash(), test_block3_.Hash()}){
+        EXPECT_TRUE(bmanager.readBlock(block_hash, read_block));
+    }
+    bmanager.waitForPrefetches();
+    EXPECT_EQ(bmanager.getPrefetchedBlocksCount(), static_cast<size_t>(4));
+    EXPECT_TRUE(bmanager.readBlock(test_block4_.Hash(), read_block));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerZeroCopyReadTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    BlockManager bmanager(db);
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+
+    {
+        const BlockHandle view = bmanager.readBlockView(test_block1_.Hash());
+        ASSERT_TRUE(view.isValid());
+        EXPECT_EQ(view.getDataSize(), test_block1_.data_size);
+        EXPECT_EQ(std::memcmp(view.getData(), test_block1_.data, test_block1_.data_size), 0);
+    }
+    EXPECT_FALSE(bmanager.readBlockView(321331).isValid());
+
+    char buffer[64];
+    size_t data_size = 0;
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), buffer, sizeof(buffer), data_size));
+    EXPECT_EQ(data_size, test_block1_.data_size);
+    EXPECT_EQ(std::memcmp(buffer, test_block1_.data, data_size), 0);
+
+    // a buffer smaller than the payload is rejected
+    EXPECT_FALSE(bmanager.readBlock(test_block1_.Hash(), buffer, 4, data_size));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerBulkWriteTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    BlockManager bmanager(db);
+
+    // quotes used to break the SQL built from the payload
+    const std::string quoted("it's a 'quoted' block");
+    bmanager.writeBlock(quoted.data(), quoted.size());
+
+    // a write of many blocks is appended in bulk; the repeated block is stored once
+    std::vector<char> data(10 * MAX_DATA_BLOCK_SIZE);
+    for (size_t i = 0; i < data.size(); ++i){
+        data[i] = static_cast<char>('a' + (i / MAX_DATA_BLOCK_SIZE) % 9);
+    }
+    bmanager.writeBlock(data.data(), data.size());
+
+    duckdb::Connection conn(db);
+    auto res = conn.Query("SELECT COUNT(*) FROM blocks;");
+    ASSERT_FALSE(res->HasError());
+    EXPECT_EQ(res->GetValue(0, 0).GetValue<int64_t>(), 10);
+
+    DataBlock read_block;
+    EXPECT_TRUE(bmanager.readBlock(BlockManager::createDataBlocks(data.data(), MAX_DATA_BLOCK_SIZE)[0].Hash(), read_block));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerSchemaMigrationTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    {
+        // a file written with the old padded VARCHAR schema
+        duckdb::Connection conn(db);
+        ASSERT_FALSE(conn.Query("CREATE TABLE blocks (block_id UBIGINT, data VARCHAR, PRIMARY KEY(block_id));")->HasError());
+        ASSERT_FALSE(conn.Query("INSERT INTO blocks VALUES ("s + std::to_string(test_block1_.Hash()) + ", '"s
+                                + std::string(test_block1_.data, test_block1_.data_size) + "');"s)->HasError());
+    }
+
+    BlockManager bmanager(db);
+    duckdb::Connection conn(db);
+    auto res = conn.Query("SELECT data_type FROM information_schema.columns WHERE table_name = 'blocks' AND column_name = 'data';");
+    ASSERT_FALSE(res->HasError());
+    EXPECT_EQ(res->GetValue(0, 0).ToString(), "BLOB");
+
+    // the migrated block keeps its payload and gets its size back
+    const size_t block_hash = test_block1_.Hash();
+    bmanager.prefetch(&block_hash, 1);
+    bmanager.waitForPrefetches();
+    DataBlock read_block;
+    EXPECT_TRUE(bmanager.readBlock(block_hash, read_block));
+    EXPECT_EQ(read_block, test_block1_);
+
+    // binary payloads round-trip now
+    const char binary_data[] = {'\0', '\'', '\xff', '\0', 'x'};
+    bmanager.writeBlock(binary_data, sizeof(binary_data));
+    res = conn.Query("SELECT data_size, octet_length(data) FROM blocks WHERE data_size = 5;");
+    ASSERT_FALSE(res->HasError());
+    ASSERT_EQ(res->RowCount(), static_cast<duckdb::idx_t>(1));
+    EXPECT_EQ(res->GetValue(1, 0).GetValue<int64_t>(), 5);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerReadThroughTest){
+    duckdb::DuckDB db(test_db_file_path1_.generic_string());
+    BlockManager bmanager(db, BufferManager::getMemoryBudgetForBlocks(2));
+    for (const DataBlock* dblock : {&test_block1_, &test_block2_, &test_block3_, &test_block4_}){
+        bmanager.writeBlock(dblock->data, dblock->data_size);
+    }
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(2));
+
+    // evicted blocks are read from the database and cached again
+    DataBlock read_block;
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block1_);
+    EXPECT_FALSE(bmanager.readBlock(321331, read_block));
+    EXPECT_EQ(read_block, test_block1_);
+
+    // a batch fetches all misses at once and leaves unknown blocks untouched
+    const size_t block_hashes[] = {test_block2_.Hash(), 321331, test_block3_.Hash(), test_block4_.Hash()};
+    DataBlock read_blocks[4];
+    EXPECT_EQ(bmanager.readBlocks(block_hashes, 4, read_blocks), static_cast<size_t>(3));
+    EXPECT_EQ(read_blocks[0], test_block2_);
+    EXPECT_EQ(read_blocks[1].data_size, static_cast<size_t>(0));
+    EXPECT_EQ(read_blocks[2], test_block3_);
+    EXPECT_EQ(read_blocks[3], test_block4_);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerRawFileStoreTest){
+    const path raw_file_path = test_dir_path_ / "test_blocks.raw"_p;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(raw_file_path), BufferManager::getMemoryBudgetForBlocks(2));
+        bmanager.setWriteBackEnabled(true);
+        for (const DataBlock* dblock : {&test_block1_, &test_block2_, &test_block3_}){
+            bmanager.writeBlock(dblock->data, dblock->data_size);
+        }
+        bmanager.flush();
+    }
+
+    // a new manager finds the blocks in the file and continues the write order after them
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(raw_file_path), BufferManager::getMemoryBudgetForBlocks(2));
+    bmanager.writeBlock(test_block4_.data, test_block4_.data_size);
+    const size_t block_hashes[] = {test_block1_.Hash(), test_block2_.Hash(), test_block3_.Hash(), test_block4_.Hash()};
+    DataBlock read_blocks[4];
+    EXPECT_EQ(bmanager.readBlocks(block_hashes, 4, read_blocks), static_cast<size_t>(4));
+    EXPECT_EQ(read_blocks[0], test_block1_);
+    EXPECT_EQ(read_blocks[1], test_block2_);
+    EXPECT_EQ(read_blocks[2], test_block3_);
+    EXPECT_EQ(read_blocks[3], test_block4_);
+
+    EXPECT_THROW(BlockManager(std::unique_ptr<BlockStore>()), std::invalid_argument);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerIoEngineTest){
+    const path raw_file_path = test_dir_path_ / "test_blocks.raw"_p;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(raw_file_path, true));
+        for (const DataBlock* dblock : {&test_block1_, &test_block2_, &test_block3_, &test_block4_}){
+            bmanager.writeBlock(dblock->data, dblock->data_size);
+        }
+    }
+
+    // misses are read straight into the frames, the ones which do not fit are read next to them
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(raw_file_path, true, RawFileBlockStore::DEFAULT_PREALLOCATED_SLOTS,
+                                                              IoEngine::create()),
+                          BufferManager::getMemoryBudgetForBlocks(2), BufferManager::getMemoryBudgetForBlocks(4));
+    const size_t block_hashes[] = {test_block1_.Hash(), test_block2_.Hash(), test_block3_.Hash(), 321331};
+    DataBlock read_blocks[4];
+    EXPECT_EQ(bmanager.readBlocks(block_hashes, 4, read_blocks), static_cast<size_t>(3));
+    EXPECT_EQ(read_blocks[0], test_block1_);
+    EXPECT_EQ(read_blocks[1], test_block2_);
+    EXPECT_EQ(read_blocks[2], test_block3_);
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(2));
+
+    const BlockHandle block_view = bmanager.readBlockView(test_block4_.Hash());
+    ASSERT_TRUE(block_view.isValid());
+    EXPECT_EQ(std::memcmp(block_view.getData(), test_block4_.data, test_block4_.data_size), 0);
+
+    // a prefetch fills a frame in the background
+    bmanager.setBufferMemoryBudget(BufferManager::getMemoryBudgetForBlocks(4));
+    bmanager.prefetch(block_hashes, 3);
+    bmanager.waitForPrefetches();
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(4));
+    char buffer[MAX_DATA_BLOCK_SIZE];
+    size_t data_size = 0;
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), buffer, sizeof(buffer), data_size));
+    EXPECT_EQ(data_size, test_block1_.data_size);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerMappedStoreTest){
+    const path raw_file_path = test_dir_path_ / "test_blocks.raw"_p;
+    BlockManager bmanager(std::make_unique<MappedFileBlockStore>(raw_file_path), BufferManager::getMemoryBudgetForBlocks(2));
+    for (const DataBlock* dblock : {&test_block1_, &test_block2_, &test_block3_}){
+        bmanager.writeBlock(dblock->data, dblock->data_size);
+    }
+    // the blocks are kept by the page cache, not by the buffer
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(0));
+
+    DataBlock read_block;
+    EXPECT_TRUE(bmanager.readBlock(test_block2_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block2_);
+    char buffer[MAX_DATA_BLOCK_SIZE];
+    size_t data_size = 0;
+    EXPECT_TRUE(bmanager.readBlock(test_block3_.Hash(), buffer, sizeof(buffer), data_size));
+    EXPECT_EQ(std::string(buffer, data_size), std::string(test_block3_.data, test_block3_.data_size));
+    EXPECT_FALSE(bmanager.readBlock(321331, read_block));
+
+    // views point into the mapping; the buffer only counts their pins, so more blocks than frames can be viewed one by one
+    {
+        const BlockHandle first_view = bmanager.readBlockView(test_block1_.Hash());
+        const BlockHandle second_view = bmanager.readBlockView(test_block2_.Hash());
+        ASSERT_TRUE(first_view.isValid());
+        ASSERT_TRUE(second_view.isValid());
+        EXPECT_EQ(std::memcmp(first_view.getData(), test_block1_.data, test_block1_.data_size), 0);
+        EXPECT_FALSE(bmanager.readBlockView(test_block3_.Hash()).isValid());
+        EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(0));
+
+        // the mapping cannot go away while it is viewed
+        EXPECT_THROW(bmanager.setBlockStore(std::make_unique<RawFileBlockStore>(test_dir_path_ / "other_blocks.raw"_p)), std::runtime_error);
+    }
+    EXPECT_TRUE(bmanager.readBlockView(test_block3_.Hash()).isValid());
+
+    const size_t block_hashes[] = {test_block1_.Hash(), test_block3_.Hash()};
+    bmanager.prefetch(block_hashes, 2);
+    bmanager.waitForPrefetches();
+    EXPECT_EQ(bmanager.getPrefetchedBlocksCount(), static_cast<size_t>(0));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerRemoveBlockTest){
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(test_dir_path_ / "removed_blocks.raw"_p));
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+    bmanager.writeBlock(test_block2_.data, test_block2_.data_size);
+
+    // a viewed block cannot be removed
+    {
+        const BlockHandle block_view = bmanager.readBlockView(test_block1_.Hash());
+        ASSERT_TRUE(block_view.isValid());
+        EXPECT_FALSE(bmanager.removeBlock(test_block1_.Hash()));
+    }
+    EXPECT_TRUE(bmanager.removeBlock(test_block1_.Hash()));
+    EXPECT_FALSE(bmanager.removeBlock(test_block1_.Hash()));
+    DataBlock read_block;
+    EXPECT_FALSE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_TRUE(bmanager.readBlock(test_block2_.Hash(), read_block));
+
+    // a dirty block is dropped before it is written
+    bmanager.setWriteBackEnabled(true);
+    bmanager.writeBlock(test_block3_.data, test_block3_.data_size);
+    EXPECT_TRUE(bmanager.removeBlock(test_block3_.Hash()));
+    bmanager.flush();
+    EXPECT_EQ(bmanager.getDirtyBlocksCount(), static_cast<size_t>(0));
+    EXPECT_FALSE(bmanager.readBlock(test_block3_.Hash(), read_block));
+
+    // a removed block can be written again
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+    bmanager.flush();
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block1_);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerChecksumTest){
+    const path file_path = test_dir_path_ / "corrupted_blocks.raw"_p;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path));
+        bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+        bmanager.writeBlock(test_block2_.data, test_block2_.data_size);
+        bmanager.flush();
+    }
+    // the payload of the first block is damaged on the disk, its slot record is not
+    {
+        std::fstream data_file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+        data_file.seekp(3);
+        data_file.put('X');
+    }
+
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path));
+    DataBlock read_block;
+    EXPECT_FALSE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(bmanager.getChecksumFailuresCount(), static_cast<size_t>(1));
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(0));
+    EXPECT_THROW(bmanager.readBlockChecked(test_block1_.Hash(), read_block), BlockChecksumError);
+    EXPECT_FALSE(bmanager.readBlockChecked(42, read_block));
+    ASSERT_TRUE(bmanager.readBlockChecked(test_block2_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block2_);
+    EXPECT_EQ(bmanager.getChecksumFailuresCount(), static_cast<size_t>(2));
+
+    // in the lazy mode a prefetched block is cached as it is read and verified by its first reader
+    bmanager.setLazyChecksumVerificationEnabled(true);
+    const size_t block_hash = test_block1_.Hash();
+    bmanager.prefetch(&block_hash, 1);
+    bmanager.waitForPrefetches();
+    EXPECT_EQ(bmanager.getPrefetchedBlocksCount(), static_cast<size_t>(1));
+    EXPECT_EQ(bmanager.getChecksumFailuresCount(), static_cast<size_t>(2));
+    EXPECT_THROW(bmanager.readBlockChecked(test_block1_.Hash(), read_block), BlockChecksumError);
+    EXPECT_GT(bmanager.getChecksumFailuresCount(), static_cast<size_t>(2));
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(1));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerContentDefinedChunkingTest){
+    const path file_path = test_dir_path_ / "chunked_blocks.raw"_p;
+    std::string data;
+    for (size_t i = 0; data.size() < 256 * 1024; ++i){
+        data += "Line "s + std::to_string(i * i % 7919) + " of the object that is uploaded twice\n"s;
+    }
+    const std::string edited_data = "#"s + data;
+    size_t cached_blocks_count = 0;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path));
+        EXPECT_THROW(bmanager.setChunkingParameters(ChunkingParameters{1024, 2048, 2 * MAX_DATA_BLOCK_SIZE}), std::invalid_argument);
+        bmanager.writeBlock(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED);
+        const size_t first_upload_blocks_count = bmanager.getBufferSize();
+        bmanager.writeBlock(edited_data.data(), edited_data.size(), ChunkingMode::CONTENT_DEFINED);
+        // only the block with the inserted byte is new
+        EXPECT_LE(bmanager.getBufferSize(), first_upload_blocks_count + 2);
+
+        const std::vector<DataBlock> dblocks = BlockManager::createDataBlocks(edited_data.data(), edited_data.size(), ChunkingMode::CONTENT_DEFINED);
+        std::string read_data;
+        for (const DataBlock& dblock : dblocks){
+            DataBlock read_block;
+            ASSERT_TRUE(bmanager.readBlock(dblock.Hash(), read_block));
+            read_data.append(read_block.data, read_block.data_size);
+        }
+        EXPECT_EQ(read_data, edited_data);
+        cached_blocks_count = bmanager.getBufferSize();
+    }
+    // the shared blocks have been stored once
+    RawFileBlockStore store(file_path);
+    EXPECT_EQ(store.getBlocksCount(), cached_blocks_count);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerStreamingWriteTest){
+    std::string data(3 * 1024 * 1024 + 123, '\0');
+    std::mt19937 generator(42);
+    for (char& byte : data){
+        byte = static_cast<char>(generator());
+    }
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(test_dir_path_ / "streamed_blocks.raw"_p));
+
+    // blocks of the stream are the blocks of the same data written at once
+    std::istringstream input(data);
+    EXPECT_EQ(bmanager.writeStream(input), data.size());
+    const std::vector<DataBlock> fixed_blocks = BlockManager::createDataBlocks(data.data(), data.size());
+    EXPECT_EQ(bmanager.getBufferSize(), fixed_blocks.size());
+    for (const DataBlock& dblock : fixed_blocks){
+        DataBlock read_block;
+        ASSERT_TRUE(bmanager.readBlock(dblock.Hash(), read_block));
+        ASSERT_EQ(read_block, dblock);
+    }
+
+    // the source is never asked for more than a window, however much data there is
+    size_t offset = 0;
+    size_t max_capacity = 0;
+    const size_t written_bytes = bmanager.writeStream([&](char* buffer, const size_t capacity){
+        max_capacity = std::max(max_capacity, capacity);
+        const size_t piece_size = std::min({capacity, data.size() - offset, static_cast<size_t>(1000)});
+        std::memcpy(buffer, data.data() + offset, piece_size);
+        offset += piece_size;
+        return piece_size;
+    }, ChunkingMode::CONTENT_DEFINED);
+    EXPECT_EQ(written_bytes, data.size());
+    EXPECT_LE(max_capacity, 64 * static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+    const std::vector<DataBlock> content_defined_blocks = BlockManager::createDataBlocks(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED);
+    for (const DataBlock& dblock : content_defined_blocks){
+        DataBlock read_block;
+        ASSERT_TRUE(bmanager.readBlock(dblock.Hash(), read_block));
+        ASSERT_EQ(read_block, dblock);
+    }
+
+    // a file with the same content adds no blocks
+    const size_t cached_blocks_count = bmanager.getBufferSize();
+    const path data_file_path = test_dir_path_ / "streamed_data.bin"_p;
+    std::ofstream(data_file_path, std::ios::binary) << data;
+    const int fd = ::open(data_file_path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(bmanager.writeFile(fd), data.size());
+    ::close(fd);
+    EXPECT_EQ(bmanager.getBufferSize(), cached_blocks_count);
+    EXPECT_THROW(bmanager.writeFile(-1), std::runtime_error);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerParallelWriteTest){
+    std::string data(8 * 1024 * 1024 + 5, '\0');
+    std::mt19937 generator(7);
+    for (char& byte : data){
+        byte = static_cast<char>(generator());
+    }
+    const std::vector<DataBlock> dblocks = BlockManager::createDataBlocks(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED);
+
+    const path file_path = test_dir_path_ / "parallel_blocks.raw"_p;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path));
+        bmanager.setWriteThreadsCount(4);
+        std::istringstream input(data);
+        std::vector<size_t> block_hashes;
+        EXPECT_EQ(bmanager.writeStream(input, ChunkingMode::CONTENT_DEFINED, &block_hashes), data.size());
+
+        // the hashes come back in the order of the data
+        ASSERT_EQ(block_hashes.size(), dblocks.size());
+        for (size_t i = 0; i < dblocks.size(); ++i){
+            ASSERT_EQ(block_hashes[i], dblocks[i].Hash());
+        }
+
+        // a large buffer goes through the workers as well; its blocks are all known by now
+        bmanager.writeBlock(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED);
+        EXPECT_EQ(bmanager.getBufferSize(), dblocks.size());
+    }
+
+    // the blocks are numbered in the order of the data
+    RawFileBlockStore store(file_path);
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlockRange(0, dblocks.size());
+    ASSERT_EQ(loaded_blocks.size(), dblocks.size());
+    for (size_t i = 0; i < dblocks.size(); ++i){
+        ASSERT_EQ(loaded_blocks[i].dblock, dblocks[i]);
+    }
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerRepeatedBlocksTest){
+    const path file_path = test_dir_path_ / "repeated_blocks.raw"_p;
+    {
+        BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path));
+        // a zero-filled buffer is cut into the same block twice, and both go into one batch
+        const std::string zeros(2 * MAX_DATA_BLOCK_SIZE, '\0');
+        bmanager.writeBlock(zeros.data(), zeros.size());
+        EXPECT_EQ(bmanager.getTotalWrittenBlocksCount(), static_cast<size_t>(1));
+        EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(1));
+
+        bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+        EXPECT_EQ(bmanager.getTotalWrittenBlocksCount(), static_cast<size_t>(2));
+    }
+
+    // the sequence numbers have no gap, so a range read finds both blocks
+    RawFileBlockStore store(file_path);
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(2));
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlockRange(0, 2);
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(2));
+    EXPECT_EQ(loaded_blocks[0].dblock.data_size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+    EXPECT_EQ(loaded_blocks[1].dblock, test_block1_);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerUnknownBlockReadTest){
+    auto counting_store = std::make_unique<CountingBlockStore>(std::make_unique<RawFileBlockStore>(test_dir_path_ / "unknown_blocks.raw"_p));
+    CountingBlockStore& store = *counting_store;
+    BlockManager bmanager(std::move(counting_store), BufferManager::getMemoryBudgetForBlocks(1));
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+    bmanager.writeBlock(test_block2_.data, test_block2_.data_size);
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(1));
+
+    // unknown blocks are not looked up in the storage and do not evict the cached block
+    const size_t accesses_count = store.accesses_count;
+    DataBlock read_block;
+    EXPECT_FALSE(bmanager.readBlock(321331, read_block));
+    const size_t block_hashes[] = {321331, 321332};
+    DataBlock read_blocks[2];
+    EXPECT_EQ(bmanager.readBlocks(block_hashes, 2, read_blocks), static_cast<size_t>(0));
+    EXPECT_EQ(store.accesses_count, accesses_count);
+    EXPECT_TRUE(bmanager.readBlock(test_block2_.Hash(), read_block));
+    EXPECT_EQ(store.accesses_count, accesses_count);
+
+    // a found block takes the place of the cached one
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block1_);
+    EXPECT_EQ(store.accesses_count, accesses_count + 1);
+    EXPECT_EQ(bmanager.getBufferSize(), static_cast<size_t>(1));
+    EXPECT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(store.accesses_count, accesses_count + 1);
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerConcurrentWritersTest){
+    auto counting_store = std::make_unique<CountingBlockStore>(std::make_unique<RawFileBlockStore>(test_dir_path_ / "concurrent_blocks.raw"_p));
+    CountingBlockStore& store = *counting_store;
+    store.write_delay = std::chrono::milliseconds(20);
+    BlockManager bmanager(std::move(counting_store));
+
+    // the writers which find a block in flight wait for it instead of storing it again
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < 4; ++i){
+        writers.emplace_back([&bmanager](){
+            EXPECT_NO_THROW(bmanager.writeBlock(test_block1_.data, test_block1_.data_size));
+        });
+    }
+    for (std::thread& writer : writers){
+        writer.join();
+    }
+    EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(1));
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(1));
+
+    // a failed write gives the reservation back, so the block is written again
+    store.write_delay = std::chrono::milliseconds(0);
+    store.fail_writes = true;
+    EXPECT_THROW(bmanager.writeBlock(test_block2_.data, test_block2_.data_size), std::runtime_error);
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(1));
+    store.fail_writes = false;
+    bmanager.writeBlock(test_block2_.data, test_block2_.data_size);
+    EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(3));
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(2));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerConcurrentReadersTest){
+    const DataBlock* const dblocks[] = {&test_block1_, &test_block2_, &test_block3_, &test_block4_};
+    BlockManager bmanager(std::make_unique<RawFileBlockStore>(test_dir_path_ / "concurrent_reads.raw"_p), BufferManager::getMemoryBudgetForBlocks(2));
+    for (const DataBlock* dblock : dblocks){
+        bmanager.writeBlock(dblock->data, dblock->data_size);
+    }
+    const size_t reads_count = bmanager.getTotalReadBlocksCount();
+
+    // hits are copied without the latch while the misses of the other readers evict their frames
+    constexpr size_t READERS_COUNT = 4;
+    constexpr size_t ROUNDS_COUNT = 200;
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < READERS_COUNT; ++i){
+        readers.emplace_back([&bmanager, &dblocks, i](){
+            DataBlock read_block;
+            char buffer[MAX_DATA_BLOCK_SIZE];
+            for (size_t round = 0; round < ROUNDS_COUNT; ++round){
+                const DataBlock& dblock = *dblocks[(round + i) % 4];
+                ASSERT_TRUE(bmanager.readBlock(dblock.Hash(), read_block));
+                EXPECT_EQ(read_block, dblock);
+                size_t data_size = 0;
+                ASSERT_TRUE(bmanager.readBlock(dblock.Hash(), buffer, dblock.data_size, data_size));
+                EXPECT_EQ(std::string(buffer, data_size), std::string(dblock.data, dblock.data_size));
+            }
+        });
+    }
+    for (std::thread& reader : readers){
+        reader.join();
+    }
+    EXPECT_EQ(bmanager.getTotalReadBlocksCount(), reads_count + READERS_COUNT * ROUNDS_COUNT * 2);
+    EXPECT_LE(bmanager.getBufferSize(), static_cast<size_t>(2));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerDedupIndexTest){
+    const path file_path = test_dir_path_ / "dedup_blocks.raw"_p;
+    const DataBlock* const dblocks[] = {&test_block1_, &test_block2_, &test_block3_, &test_block4_};
+    {
+        auto counting_store = std::make_unique<CountingBlockStore>(std::make_unique<RawFileBlockStore>(file_path));
+        CountingBlockStore& store = *counting_store;
+        // the buffer keeps two blocks, so the first ones are evicted by the last ones
+        BlockManager bmanager(std::move(counting_store), BufferManager::getMemoryBudgetForBlocks(2));
+        for (const DataBlock* dblock : dblocks){
+            bmanager.writeBlock(dblock->data, dblock->data_size);
+        }
+        EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(4));
+        EXPECT_LE(bmanager.getBufferSize(), static_cast<size_t>(2));
+
+        // the evicted blocks are still known to be stored, so writing them again touches no storage
+        const size_t accesses_count = store.accesses_count;
+        for (const DataBlock* dblock : dblocks){
+            EXPECT_NO_THROW(bmanager.writeBlock(dblock->data, dblock->data_size));
+        }
+        EXPECT_EQ(store.accesses_count, accesses_count);
+        EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(4));
+
+        // a removed block is written again
+        EXPECT_TRUE(bmanager.removeBlock(test_block1_.Hash()));
+        EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(3));
+        bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+        EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(5));
+
+        // so are the dirty blocks of the write-back mode, which are not in the storage yet
+        bmanager.setWriteBackEnabled(true);
+        std::string data(MAX_DATA_BLOCK_SIZE * 3, 'd');
+        for (size_t i = 0; i < data.size(); ++i){
+            data[i] = static_cast<char>(i % 251);
+        }
+        bmanager.writeBlock(data.data(), data.size());
+        bmanager.writeBlock(data.data(), data.size());
+        bmanager.flush();
+        EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(7));
+        EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(8));
+    }
+
+    // a new manager rebuilds the index from the storage
+    auto counting_store = std::make_unique<CountingBlockStore>(std::make_unique<RawFileBlockStore>(file_path));
+    CountingBlockStore& store = *counting_store;
+    BlockManager bmanager(std::move(counting_store), BufferManager::getMemoryBudgetForBlocks(2));
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(7));
+    for (const DataBlock* dblock : dblocks){
+        bmanager.writeBlock(dblock->data, dblock->data_size);
+    }
+    EXPECT_EQ(store.accesses_count, static_cast<size_t>(0));
+
+    // and so does a change of the storage, which waits until no cached block is viewed
+    {
+        const BlockHandle view = bmanager.readBlockView(test_block4_.Hash());
+        ASSERT_TRUE(view.isValid());
+        EXPECT_THROW(bmanager.setBlockStore(std::make_unique<RawFileBlockStore>(test_dir_path_ / "dedup_blocks_2.raw"_p)), std::runtime_error);
+    }
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(7));
+    bmanager.setBlockStore(std::make_unique<RawFileBlockStore>(test_dir_path_ / "dedup_blocks_2.raw"_p));
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(0));
+    bmanager.writeBlock(test_block1_.data, test_block1_.data_size);
+    EXPECT_EQ(bmanager.getStoredBlocksCount(), static_cast<size_t>(1));
+}
+
+TEST_F(BlockManagerFilesystemTests, BlockManagerStoredKeyCollisionTest){
+    const path file_path = test_dir_path_ / "collision_blocks.raw"_p;
+    {
+        // a different block stored under the key of the first one, and a block an older storage has kept without the high half
+        RawFileBlockStore store(file_path);
+        StoredDataBlock other_block;
+        other_block.block_hash = test_block1_.Hash();
+        other_block.fingerprint_high = ~test_block1_.Fingerprint().high;
+        other_block.dblock = test_block3_;
+        StoredDataBlock old_block;
+        old_block.block_hash = test_block2_.Hash();
+        old_block.seq_no = 1;
+        old_block.dblock = test_block2_;
+        store.writeBlocks({other_block, old_block});
+    }
+
+    auto counting_store = std::make_unique<CountingBlockStore>(std::make_unique<RawFileBlockStore>(file_path));
+    CountingBlockStore& store = *counting_store;
+    BlockManager bmanager(std::move(counting_store));
+    // the block is neither taken for the stored one nor written over it
+    EXPECT_THROW(bmanager.writeBlock(test_block1_.data, test_block1_.data_size), std::runtime_error);
+    EXPECT_NO_THROW(bmanager.writeBlock(test_block2_.data, test_block2_.data_size));
+    EXPECT_EQ(store.written_blocks_count, static_cast<size_t>(0));
+    DataBlock read_block;
+    ASSERT_TRUE(bmanager.readBlock(test_block1_.Hash(), read_block));
+    EXPECT_EQ(read_block, test_block3_);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "crc32c.hpp"
+#include "io_engine.hpp"
+
+/* A data block together with the keys it is stored under. */
+struct StoredDataBlock{
+    size_t block_hash = 0;                              /* low 64 bits of the fingerprint, see `DataBlock::Hash()` */
+    uint64_t fingerprint_high = 0;                      /* high 64 bits of the fingerprint; kept on write, not set on read */
+    uint64_t seq_no = 0;                                /* write sequence number, increases in the order blocks are written */
+    uint32_t checksum = 0;                              /* CRC32C the storage keeps for the block; set on read, ignored on write */
+    DataBlock dblock;
+};
+
+/* The keys of a stored block, listed to rebuild an index of the stored blocks. */
+struct StoredBlockKey{
+    size_t block_hash = 0;
+    uint64_t fingerprint_high = 0;                      /* 0 for a block stored without it, e.g. by an older version of the storage */
+};
+
+/* Destination of a block read straight into caller memory, e.g. a frame of the buffer pool. */
+struct BlockReadTarget{
+    size_t block_hash = 0;
+    char* buffer = nullptr;                             /* `MAX_DATA_BLOCK_SIZE` bytes aligned to `DATA_BLOCK_ALIGNMENT` */
+    size_t data_size = 0;                               /* size of the block once it is read, stays 0 if it is not stored */
+    uint64_t seq_no = 0;
+    uint32_t checksum = 0;
+};
+
+/** Compute the checksum a storage keeps for a block: the CRC32C of its meaningful bytes.
+ * A checksum of `0` stands for a block stored without one, e.g. by an older version of the storage, and is never verified.
+*/
+inline uint32_t computeBlockChecksum(const char* data, const size_t data_size) noexcept{
+    return computeCrc32c(data, data_size);
+}
+
+// Check a block read from a storage against the checksum stored with it.
+inline bool isBlockChecksumValid(const char* data, const size_t data_size, const uint32_t checksum) noexcept{
+    return checksum == 0 || computeBlockChecksum(data, data_size) == checksum;
+}
+
+/* A block read from a storage does not match its checksum: the device or the file has corrupted or torn it. */
+class BlockChecksumError : public std::runtime_error{
+public:
+    explicit BlockChecksumError(const size_t block_hash)
+        : std::runtime_error("Data block " + std::to_string(block_hash) + " does not match its checksum"), block_hash_(block_hash){
+    }
+
+    size_t getBlockHash() const noexcept{
+        return block_hash_;
+    }
+
+private:
+    size_t block_hash_;
+};
+
+/* Persistent storage of data blocks used by the BlockManager. Blocks are addressed by their hashes; the write sequence
+   numbers let blocks written one after another be read back with one range request.
+   A storage keeps the high half of the fingerprint next to every key and lists it with the key, so two blocks with the
+   same key can be told apart without reading them back.
+   A storage computes the checksum of every block it writes and returns it with every read; the reader verifies it.
+   Implementations must allow calls from several threads at once (the writer and the loader of the BlockManager). */
+class BlockStore{
+public:
+    virtual ~BlockStore() = default;
+
+public:
+    /** Store new data blocks. Blocks which are already stored are skipped.
+     * @param[in] dblocks blocks to store; a batch may carry the same block twice
+     * @throw `std::runtime_error` on fail to write the blocks; a failed batch leaves nothing behind where the backend allows it.
+    */
+    virtual void writeBlocks(const std::vector<StoredDataBlock>& dblocks) = 0;
+
+    /** Load data blocks by their hashes.
+     * @return the blocks which have been found, in no particular order.
+     * @throw `std::runtime_error` on fail to read the storage.
+    */
+    virtual std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) = 0;
+
+    /** Load data blocks straight into the given buffers. The default implementation copies the results of `readBlocks()`.
+     * @param[in,out] targets hashes of the blocks to load and their destinations
+     * @throw `std::runtime_error` on fail to read the storage.
+    */
+    virtual void readBlocksInto(BlockReadTarget* targets, const size_t count){
+        std::vector<size_t> block_hashes(count);
+        for (size_t i = 0; i < count; ++i){
+            block_hashes[i] = targets[i].block_hash;
+        }
+        for (const StoredDataBlock& loaded_block : readBlocks(block_hashes)){
+            for (size_t i = 0; i < count; ++i){
+                if (targets[i].block_hash == loaded_block.block_hash){
+                    targets[i].data_size = loaded_block.dblock.data_size;
+                    targets[i].seq_no = loaded_block.seq_no;
+                    targets[i].checksum = loaded_block.checksum;
+                    std::memcpy(targets[i].buffer, loaded_block.dblock.data, MAX_DATA_BLOCK_SIZE);
+                }
+            }
+        }
+    }
+
+    /** Load the data blocks written with sequence numbers in `[first_seq_no, last_seq_no)`.
+     * @throw `std::runtime_error` on fail to read the storage.
+    */
+    virtual std::vector<StoredDataBlock> readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no) = 0;
+
+    // Get the sequence number following the last stored block.
+    virtual uint64_t getNextSeqNo() = 0;
+
+    /** Get the keys of every stored block, in no particular order and possibly more than once, e.g. to rebuild an index
+     * of them on open.
+     * @throw `std::runtime_error` on fail to read the storage.
+    */
+    virtual std::vector<StoredBlockKey> listBlockKeys() = 0;
+
+    /** Remove data blocks, so the space they take can be reused by new blocks. Blocks which are not stored are skipped.
+     * @return number of removed blocks.
+     * @throw `std::runtime_error` on fail to update the storage; the blocks stay stored then.
+    */
+    virtual size_t removeBlocks(const std::vector<size_t>& block_hashes) = 0;
+
+    /** Make every stored block durable.
+     * @throw `std::runtime_error` on fail to sync the storage.
+    */
+    virtual void sync() = 0;
+
+    // Get the engine running the storage I/O, so the caller can register the memory it reads into; `nullptr` if there is none.
+    virtual IoEngine* getIoEngine() const noexcept{
+        return nullptr;
+    }
+
+    // Check whether the storage maps its blocks into memory, so they can be read through `viewBlock()` instead of being cached.
+    virtual bool isMapped() const noexcept{
+        return false;
+    }
+
+    /** Get a stored block straight from the memory the storage has mapped, without copying it.
+     * The memory stays valid as long as the storage does.
+     * @param[out] data_size number of meaningful bytes of the block
+     * @param[out] checksum the checksum stored with the block
+     * @return `nullptr` if the block is not stored or the storage is not mapped.
+    */
+    virtual const char* viewBlock(const size_t, size_t&, uint32_t&) noexcept{
+        return nullptr;
+    }
+
+    // Hint that the blocks are going to be read soon, so a mapped storage can have the kernel read them ahead.
+    virtual void adviseWillNeed(const std::vector<size_t>&) noexcept{
+    }
+};
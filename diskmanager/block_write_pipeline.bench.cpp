@@ -0,0 +1,61 @@
+#include "block_manager.hpp"
+#include "raw_file_block_store.hpp"
+#include "bench_common.hpp"
+
+#include <thread>
+
+/* Measures how streaming ingest scales with the write threads, in MB/s of written data: for every thread count
+   distinct data is streamed through `BlockManager::writeStream()` into a new RawFileBlockStore, cut at fixed offsets
+   and by content. One thread runs every stage on the writing thread; more add that many fingerprinting workers and a
+   store thread. The block file is written to `directory`, which should be on the device to measure.
+   Usage: BlockWritePipelineBenchmark [directory = temp] [data_mb = 512] [max_threads = hardware threads] */
+
+using namespace std::string_literals;
+
+namespace{
+    double measureIngest(const std::filesystem::path& file_path, const size_t data_size, const size_t threads_count,
+                         const ChunkingMode chunking_mode){
+        double mb_per_s = 0.0;
+        {
+            // a small buffer, so the store sees every block
+            BlockManager bmanager(std::make_unique<RawFileBlockStore>(file_path), BufferManager::getMemoryBudgetForBlocks(1'024));
+            bmanager.setWriteThreadsCount(threads_count);
+            std::mt19937_64 rng(threads_count);
+            size_t produced_bytes = 0;
+            const double ns = measureNsPerOp(1, [&](size_t){
+                bmanager.writeStream([&](char* buffer, const size_t capacity){
+                    const size_t piece_size = std::min(capacity, data_size - produced_bytes);
+                    for (size_t i = 0; i < piece_size; i += sizeof(uint64_t)){
+                        const uint64_t value = rng();
+                        std::memcpy(buffer + i, &value, std::min(sizeof(value), piece_size - i));
+                    }
+                    produced_bytes += piece_size;
+                    return piece_size;
+                }, chunking_mode);
+                bmanager.flush();
+            });
+            mb_per_s = static_cast<double>(data_size) / (1 << 20) / (ns / 1e9);
+        }
+        std::filesystem::remove(file_path);
+        std::filesystem::path table_path = file_path;
+        table_path += ".slots";
+        std::filesystem::remove(table_path);
+        return mb_per_s;
+    }
+}
+
+int main(int argc, char** argv){
+    const std::filesystem::path directory = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::temp_directory_path();
+    const size_t data_size = readSizeArgument(argc, argv, 2, 512) << 20;
+    const size_t max_threads_count = std::max(readSizeArgument(argc, argv, 3, std::thread::hardware_concurrency()), static_cast<size_t>(1));
+    const std::filesystem::path file_path = directory / "block_write_pipeline_bench.raw"s;
+
+    std::cout << "data: " << (data_size >> 20) << " MB" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(18) << "fixed MB/s" << std::setw(18) << "content MB/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    for (size_t threads_count = 1; threads_count <= max_threads_count; threads_count *= 2){
+        const double fixed_rate = measureIngest(file_path, data_size, threads_count, ChunkingMode::FIXED_SIZE);
+        const double content_defined_rate = measureIngest(file_path, data_size, threads_count, ChunkingMode::CONTENT_DEFINED);
+        std::cout << std::setw(10) << threads_count << std::setw(18) << fixed_rate << std::setw(18) << content_defined_rate << std::endl;
+    }
+}
@@ -0,0 +1,152 @@
+#include "block_write_pipeline.hpp"
+
+BlockWritePipeline::BlockWritePipeline(const size_t hash_threads_count, const size_t batch_blocks_count, StoreBatch store_batch)
+    : store_batch_(std::move(store_batch)),
+      // one batch being cut and one being stored besides one per worker keep every stage busy
+      batches_(hash_threads_count == 0 ? 1 : hash_threads_count + 2){
+    for (Batch& batch : batches_){
+        batch.dblocks.resize(std::max(batch_blocks_count, static_cast<size_t>(1)));
+        batch.fingerprints.resize(batch.dblocks.size());
+        free_batches_.push_back(&batch);
+    }
+    if (hash_threads_count == 0){
+        return;
+    }
+    for (size_t i = 0; i < hash_threads_count; ++i){
+        hash_threads_.emplace_back(&BlockWritePipeline::hashBatches, this);
+    }
+    store_thread_ = std::thread(&BlockWritePipeline::storeBatches, this);
+}
+
+BlockWritePipeline::~BlockWritePipeline(){
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stopping_ = true;
+    }
+    batch_submitted_.notify_all();
+    batch_hashed_.notify_all();
+    for (std::thread& hash_thread : hash_threads_){
+        hash_thread.join();
+    }
+    if (store_thread_.joinable()){
+        store_thread_.join();
+    }
+}
+
+DataBlock& BlockWritePipeline::nextBlock(){
+    if (filling_batch_ && filling_batch_->dblocks_count == filling_batch_->dblocks.size()){
+        submitBatch();
+    }
+    if (!filling_batch_){
+        std::unique_lock<std::mutex> lock(latch_);
+        batch_freed_.wait(lock, [this](){ return !free_batches_.empty() || failure_; });
+        checkFailure();
+        filling_batch_ = free_batches_.front();
+        free_batches_.pop_front();
+        filling_batch_->dblocks_count = 0;
+        filling_batch_->hashed = false;
+    }
+    return filling_batch_->dblocks[filling_batch_->dblocks_count++];
+}
+
+void BlockWritePipeline::finish(){
+    if (filling_batch_ && filling_batch_->dblocks_count > 0){
+        submitBatch();
+    }
+    std::unique_lock<std::mutex> lock(latch_);
+    if (filling_batch_){
+        free_batches_.push_back(filling_batch_);
+        filling_batch_ = nullptr;
+    }
+    batch_freed_.wait(lock, [this](){ return free_batches_.size() == batches_.size(); });
+    checkFailure();
+}
+
+void BlockWritePipeline::hashBatch(Batch& batch) noexcept{
+    for (size_t i = 0; i < batch.dblocks_count; ++i){
+        batch.fingerprints[i] = batch.dblocks[i].Fingerprint();
+    }
+}
+
+void BlockWritePipeline::submitBatch(){
+    Batch* batch = filling_batch_;
+    filling_batch_ = nullptr;
+    if (hash_threads_.empty()){
+        hashBatch(*batch);
+        store_batch_(batch->dblocks.data(), batch->fingerprints.data(), batch->dblocks_count);
+        std::lock_guard<std::mutex> guard(latch_);
+        free_batches_.push_back(batch);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        hash_queue_.push_back(batch);
+        store_queue_.push_back(batch);
+    }
+    batch_submitted_.notify_one();
+}
+
+void BlockWritePipeline::hashBatches(){
+    while (true){
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(latch_);
+            batch_submitted_.wait(lock, [this](){ return stopping_ || !hash_queue_.empty(); });
+            if (stopping_){
+                return;
+            }
+            batch = hash_queue_.front();
+            hash_queue_.pop_front();
+        }
+
+        hashBatch(*batch);
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            batch->hashed = true;
+        }
+        batch_hashed_.notify_one();
+    }
+}
+
+void BlockWritePipeline::storeBatches(){
+    while (true){
+        Batch* batch = nullptr;
+        bool failed = false;
+        {
+            std::unique_lock<std::mutex> lock(latch_);
+            // the batches are stored in the order they have been cut, whichever worker finishes first
+            batch_hashed_.wait(lock, [this](){ return stopping_ || (!store_queue_.empty() && store_queue_.front()->hashed); });
+            if (stopping_){
+                return;
+            }
+            batch = store_queue_.front();
+            store_queue_.pop_front();
+            failed = static_cast<bool>(failure_);
+        }
+
+        // after a failure the batches are only recycled, so the writing thread wakes up and sees it
+        std::exception_ptr failure;
+        if (!failed){
+            try{
+                store_batch_(batch->dblocks.data(), batch->fingerprints.data(), batch->dblocks_count);
+            } catch (...){
+                failure = std::current_exception();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            if (failure){
+                failure_ = failure;
+            }
+            free_batches_.push_back(batch);
+        }
+        batch_freed_.notify_all();
+    }
+}
+
+void BlockWritePipeline::checkFailure() const{
+    if (failure_){
+        std::rethrow_exception(failure_);
+    }
+}
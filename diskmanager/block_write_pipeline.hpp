@@ -0,0 +1,91 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Carries the blocks of a write from chunking to storage in batches:
+
+       chunking (the writing thread) -> fingerprinting (worker threads) -> dedup lookup and store (one thread, in order)
+
+   The writing thread cuts chunks into the blocks handed out by `nextBlock()`. A full batch is fingerprinted by the first
+   free worker, so fingerprinting scales with the workers, and the batches are passed to `StoreBatch` one at a time in
+   the order they have been cut, so blocks are stored, and their sequence numbers given, in the order of the data.
+   The batches are recycled from a fixed pool: once all of them are in flight the writing thread waits for the store to
+   free one. That bounds both queues and keeps the memory used constant however much data is written.
+   Without workers everything runs on the writing thread, one batch at a time. */
+class BlockWritePipeline{
+public:
+    /* Dedups and stores a batch of blocks with their fingerprints, in the order the blocks have been cut. */
+    using StoreBatch = std::function<void(const DataBlock* dblocks, const BlockFingerprint* fingerprints, const size_t dblocks_count)>;
+
+    /** Create a pipeline and start its threads.
+     * @param[in] hash_threads_count number of fingerprinting workers; `0` runs every stage on the writing thread
+     * @param[in] batch_blocks_count number of blocks stored at once
+     * @param[in] store_batch called for every batch, from the store thread if there are workers
+    */
+    BlockWritePipeline(const size_t hash_threads_count, const size_t batch_blocks_count, StoreBatch store_batch);
+
+    // Stop the threads. Batches which have not been stored by then are dropped.
+    ~BlockWritePipeline();
+
+    BlockWritePipeline(const BlockWritePipeline&) = delete;
+    BlockWritePipeline& operator=(const BlockWritePipeline&) = delete;
+
+public:
+    /** Get an empty block for the next chunk. It is sent down the pipeline with the next call or with `finish()`.
+     * @throw the exception a batch has failed to store with, if any.
+    */
+    DataBlock& nextBlock();
+
+    /** Send the last blocks and wait until every batch is stored.
+     * @throw the exception a batch has failed to store with, if any.
+    */
+    void finish();
+
+private:
+    struct Batch{
+        std::vector<DataBlock> dblocks;
+        std::vector<BlockFingerprint> fingerprints;
+        size_t dblocks_count = 0;
+        bool hashed = false;
+    };
+
+    static void hashBatch(Batch& batch) noexcept;
+
+    // Pass the batch being filled on to the workers, or hash and store it right away without workers.
+    void submitBatch();
+
+    // Body of a fingerprinting worker: hashes batches until the pipeline stops.
+    void hashBatches();
+
+    // Body of the store thread: stores hashed batches in order until the pipeline stops.
+    void storeBatches();
+
+    // Rethrow the error of the store, if any. Expects the latch to be held.
+    void checkFailure() const;
+
+private:
+    StoreBatch store_batch_;
+    std::vector<Batch> batches_;                /* Every batch, allocated once */
+    Batch* filling_batch_ = nullptr;            /* Batch the writing thread is cutting chunks into */
+
+    std::mutex latch_;                          /* Guards the queues and the state below */
+    std::deque<Batch*> free_batches_;
+    std::deque<Batch*> hash_queue_;             /* Full batches waiting for a worker */
+    std::deque<Batch*> store_queue_;            /* Full batches in the order they have been cut, hashed or not */
+    bool stopping_ = false;
+    std::exception_ptr failure_;                /* First error of the store; the pipeline stops storing after it */
+    std::condition_variable batch_freed_;
+    std::condition_variable batch_submitted_;
+    std::condition_variable batch_hashed_;
+
+    std::vector<std::thread> hash_threads_;
+    std::thread store_thread_;
+};
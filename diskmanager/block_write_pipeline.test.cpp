@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#include "block_write_pipeline.hpp"
+
+using namespace std::string_literals;
+
+namespace{
+    void cutBlock(BlockWritePipeline& pipeline, const size_t block_number){
+        DataBlock& dblock = pipeline.nextBlock();
+        const std::string data = "Block number "s + std::to_string(block_number);
+        std::memset(dblock.data, 0x00, MAX_DATA_BLOCK_SIZE);
+        std::memcpy(dblock.data, data.data(), data.size());
+        dblock.data_size = data.size();
+    }
+}
+
+TEST(BlockWritePipelineHappyTests, InputOrderTest){
+    constexpr size_t BLOCKS_COUNT = 10'001;
+    for (const size_t hash_threads_count : {size_t{0}, size_t{1}, size_t{8}}){
+        std::vector<size_t> stored_hashes;
+        std::vector<size_t> batch_sizes;
+        BlockWritePipeline pipeline(hash_threads_count, 16, [&](const DataBlock* dblocks, const BlockFingerprint* fingerprints, const size_t dblocks_count){
+            for (size_t i = 0; i < dblocks_count; ++i){
+                ASSERT_TRUE(fingerprints[i] == dblocks[i].Fingerprint());
+                stored_hashes.push_back(static_cast<size_t>(fingerprints[i].low));
+            }
+            batch_sizes.push_back(dblocks_count);
+        });
+        for (size_t block = 0; block < BLOCKS_COUNT; ++block){
+            cutBlock(pipeline, block);
+        }
+        pipeline.finish();
+
+        // whichever worker has hashed a batch first, the batches are stored in the order they have been cut
+        ASSERT_EQ(stored_hashes.size(), BLOCKS_COUNT);
+        for (size_t block = 0; block < BLOCKS_COUNT; ++block){
+            DataBlock dblock;
+            const std::string data = "Block number "s + std::to_string(block);
+            std::memcpy(dblock.data, data.data(), data.size());
+            dblock.data_size = data.size();
+            ASSERT_EQ(stored_hashes[block], dblock.Hash());
+        }
+        EXPECT_EQ(batch_sizes.size(), (BLOCKS_COUNT + 15) / 16);
+        EXPECT_EQ(batch_sizes.back(), BLOCKS_COUNT % 16);
+        // nothing is left to store
+        pipeline.finish();
+    }
+}
+
+TEST(BlockWritePipelineFailureTests, StoreFailureTest){
+    for (const size_t hash_threads_count : {size_t{0}, size_t{4}}){
+        size_t stored_batches_count = 0;
+        BlockWritePipeline pipeline(hash_threads_count, 4, [&](const DataBlock*, const BlockFingerprint*, const size_t){
+            if (++stored_batches_count == 3){
+                throw std::runtime_error("Failed to store the third batch"s);
+            }
+        });
+        // the error reaches the writing thread at one of its next blocks, or at the latest when it finishes
+        EXPECT_THROW({
+            for (size_t block = 0; block < 1'000; ++block){
+                cutBlock(pipeline, block);
+            }
+            pipeline.finish();
+        }, std::runtime_error);
+        EXPECT_EQ(stored_batches_count, static_cast<size_t>(3));
+    }
+}
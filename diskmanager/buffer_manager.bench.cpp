@@ -0,0 +1,46 @@
+#include "buffer_manager.hpp"
+#include "bench_common.hpp"
+
+/* Measures per-operation latency of the BufferManager for a growing number of cached blocks.
+   Usage: BufferManagerBenchmark [max_cached_blocks = 1000000] [ops_per_run = 1000000] */
+
+int main(int argc, char** argv){
+    const size_t max_cache_size = readSizeArgument(argc, argv, 1, 1'000'000);
+    const size_t ops_count = readSizeArgument(argc, argv, 2, 1'000'000);
+
+    DataBlock block;
+    block.data_size = MAX_DATA_BLOCK_SIZE;
+
+    std::cout << std::setw(12) << "blocks" << std::setw(14) << "hit ns/op"
+              << std::setw(20) << "insert+evict ns/op" << std::setw(18) << "remove+add ns/op" << std::endl;
+
+    for (const size_t cache_size : std::vector<size_t>{50, 1'000, 10'000, 100'000, 1'000'000}){
+        if (cache_size > max_cache_size){
+            break;
+        }
+        BufferManager manager(BufferManager::getMemoryBudgetForBlocks(cache_size));
+        for (size_t hash = 0; hash < cache_size; ++hash){
+            manager.addDataBlock(block, hash);
+        }
+
+        const std::vector<size_t> indexes = makeRandomIndexes(ops_count, cache_size);
+
+        const double hit_ns = measureNsPerOp(ops_count, [&](const size_t i){
+            doNotOptimize(manager.getDataBlock(indexes[i]).getData());
+        });
+
+        // every insert of an unseen hash evicts the least recently used block
+        const double insert_ns = measureNsPerOp(ops_count, [&](const size_t i){
+            manager.addDataBlock(block, cache_size + i);
+        });
+
+        const double remove_ns = measureNsPerOp(ops_count, [&](const size_t i){
+            const size_t hash = cache_size + ops_count - 1 - (i % cache_size);
+            manager.removeDataBlock(hash);
+            manager.addDataBlock(block, hash);
+        });
+
+        std::cout << std::setw(12) << cache_size << std::setw(14) << std::fixed << std::setprecision(1) << hit_ns
+                  << std::setw(20) << insert_ns << std::setw(18) << remove_ns << std::endl;
+    }
+}
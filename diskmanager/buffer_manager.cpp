@@ -1,68 +1,648 @@
 #include "buffer_manager.hpp"
 
-std::optional<std::reference_wrapper<const DataBlock>> BufferManager::getDataBlock(const size_t block_hash) noexcept{
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define BUFFER_MANAGER_USE_MMAP
+#endif
+
+namespace{
+    // Reserve `size` bytes of address space for the frame pool. Pages get physical memory on the first touch.
+    char* reserveFramesMemory(const size_t size){
+#ifdef BUFFER_MANAGER_USE_MMAP
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (memory == MAP_FAILED){
+            throw std::bad_alloc();
+        }
+        return static_cast<char*>(memory);
+#else
+        return allocateAlignedBuffer(size).release();
+#endif
+    }
+
+    /* Copy the payload of a frame word by word with relaxed atomic accesses, so an optimistic reader copying it while it
+       is written reads torn words at worst, which its version check rejects, instead of racing with a plain copy.
+       Frames are aligned to `DATA_BLOCK_ALIGNMENT` and hold whole words. */
+    void storeFrameWords(char* frame_data, const char* data, const size_t size) noexcept{
+#if defined(__GNUC__)
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t)){
+            uint64_t word = 0;
+            std::memcpy(&word, data + offset, sizeof(word));
+            __atomic_store_n(reinterpret_cast<uint64_t*>(frame_data + offset), word, __ATOMIC_RELAXED);
+        }
+#else
+        std::memcpy(frame_data, data, size);
+#endif
+    }
+
+    // Only `size` bytes of `buffer` are written, which need not be whole words.
+    void loadFrameWords(char* buffer, const char* frame_data, const size_t size) noexcept{
+#if defined(__GNUC__)
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t)){
+            const uint64_t word = __atomic_load_n(reinterpret_cast<const uint64_t*>(frame_data + offset), __ATOMIC_RELAXED);
+            std::memcpy(buffer + offset, &word, std::min(sizeof(word), size - offset));
+        }
+#else
+        std::memcpy(buffer, frame_data, size);
+#endif
+    }
+
+    void freeFramesMemory(char* memory, const size_t size) noexcept{
+#ifdef BUFFER_MANAGER_USE_MMAP
+        munmap(memory, size);
+#else
+        (void)size;
+        AlignedBufferDeleter{}(memory);
+#endif
+    }
+}
+
+BufferManager::BufferManager(const size_t memory_budget, const size_t max_memory_budget, const ReplacementPolicyType policy_type)
+    : memory_budget_(memory_budget),
+      max_cached_blocks_(std::max(memory_budget / getBytesPerFrame(), static_cast<size_t>(1))),
+      max_frames_(std::max(max_cached_blocks_, max_memory_budget / getBytesPerFrame())),
+      frames_data_(reserveFramesMemory(max_frames_ * MAX_DATA_BLOCK_SIZE)),
+      frames_(max_frames_),
+      frame_versions_(new FrameVersion[max_frames_]),
+      blockhash_to_frame_(max_frames_),
+      policy_(ReplacementPolicy::create(policy_type, max_frames_, max_cached_blocks_)),
+      is_evictable_([this](const frame_id_t frame_id){
+          return frames_[frame_id].in_use && frames_[frame_id].pin_count == 0 && !frames_[frame_id].dirty;
+      }){
+    free_frames_.reserve(max_frames_);
+    // hand out low frame ids first
+    for (size_t frame_id = max_cached_blocks_; frame_id > 0; --frame_id){
+        free_frames_.push_back(frame_id - 1);
+    }
+}
+
+BufferManager::~BufferManager(){
+    freeFramesMemory(frames_data_, max_frames_ * MAX_DATA_BLOCK_SIZE);
+}
+
+size_t BufferManager::getMemoryBudgetForBlocks(const size_t blocks_count) noexcept{
+    return blocks_count * getBytesPerFrame();
+}
+
+size_t BufferManager::getBytesPerFrame() noexcept{
+    return MAX_DATA_BLOCK_SIZE + sizeof(Frame) + sizeof(FrameVersion) + sizeof(frame_id_t) + HashIndex<frame_id_t>::getBytesPerEntry();
+}
+
+BlockHandle BufferManager::pinBlock(const size_t block_hash) noexcept{
+    if (admission_filter_){
+        admission_filter_->recordAccess(block_hash);
+    }
+
     // Check if the block exists in cache
-    auto found_block_it = blockhash_to_data_.find(block_hash);
-    if (found_block_it == blockhash_to_data_.end()){
-        return std::nullopt;
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    if (frame_id == nullptr){
+        return BlockHandle();
     }
 
-    pinBlock(block_hash);
+    Frame& frame = frames_[*frame_id];
+    touchBlock(*frame_id);
+    ++frame.pin_count;
 
-    return found_block_it->second;
+    return BlockHandle(this, *frame_id, block_hash, getFrameData(*frame_id), frame.data_size);
 }
 
-void BufferManager::removeDataBlock(const size_t block_hash) noexcept{
-    blockhash_to_data_.erase(block_hash);
-    blockhashes_order_.remove(block_hash);
+BlockHandle BufferManager::getDataBlock(const size_t block_hash) noexcept{
+    return pinBlock(block_hash);
 }
 
-void BufferManager::addDataBlock(const DataBlock& data_block, const size_t data_hash) noexcept{
-    // if the block already exists in memory, just pin it in the cache
-    if (blockhash_to_data_.count(data_hash)){
-        pinBlock(data_hash);
-        return;
+BlockHandle BufferManager::pinExternalBlock(const size_t block_hash, const char* data, const size_t data_size) noexcept{
+    size_t* pin_count = external_pins_.find(block_hash);
+    if (pin_count != nullptr){
+        ++*pin_count;
+    } else{
+        if (external_pins_.size() >= max_frames_){
+            return BlockHandle();
+        }
+        if (external_pins_.size() >= external_pins_.capacity()){
+            try{
+                external_pins_.reserve(max_frames_);
+            } catch (const std::bad_alloc&){
+                return BlockHandle();
+            }
+        }
+        if (!external_pins_.insert(block_hash, 1)){
+            return BlockHandle();
+        }
+    }
+    ++external_pins_count_;
+    return BlockHandle(this, EXTERNAL_FRAME_ID, block_hash, data, data_size);
+}
+
+bool BufferManager::removeDataBlock(const size_t block_hash) noexcept{
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    if (frame_id == nullptr){
+        return true;
+    }
+    if (frames_[*frame_id].pin_count > 0 || frames_[*frame_id].dirty){
+        return false;
+    }
+    eraseFrame(*frame_id);
+    return true;
+}
+
+bool BufferManager::addDataBlock(const DataBlock& data_block, const size_t data_hash, const bool dirty) noexcept{
+    // if the block already exists in memory, just move it to the top of the cache
+    const frame_id_t* found_frame_id = blockhash_to_frame_.find(data_hash);
+    if (found_frame_id != nullptr){
+        touchBlock(*found_frame_id);
+        return true;
+    }
+
+    const frame_id_t frame_id = takeFreeFrame(data_hash, dirty);
+    if (frame_id == INVALID_FRAME_ID){
+        return false;
+    }
+
+    Frame& frame = frames_[frame_id];
+    beginFrameWrite(frame_id);
+    frame.block_hash.store(data_hash, std::memory_order_relaxed);
+    frame.in_use.store(true, std::memory_order_relaxed);
+    frame.dirty = dirty;
+    frame.data_size.store(data_block.data_size, std::memory_order_relaxed);
+    frame.pin_count = 0;
+    storeFrameWords(getFrameData(frame_id), data_block.data, MAX_DATA_BLOCK_SIZE);
+    frame_versions_[frame_id].referenced.store(false, std::memory_order_relaxed);
+    endFrameWrite(frame_id);
+
+    blockhash_to_frame_.insert(data_hash, frame_id);
+    policy_->recordInsert(frame_id, data_hash);
+    dirty_blocks_count_ += dirty ? 1 : 0;
+    return true;
+}
+
+frame_id_t BufferManager::beginBlockLoad(const size_t block_hash, char*& data, const bool evict) noexcept{
+    if (blockhash_to_frame_.find(block_hash) != nullptr || (!evict && free_frames_.empty())){
+        return INVALID_FRAME_ID;
+    }
+    const frame_id_t frame_id = takeFreeFrame(block_hash, false);
+    if (frame_id == INVALID_FRAME_ID){
+        return INVALID_FRAME_ID;
+    }
+
+    // the frame counts as used and pinned, so neither eviction nor a shrinking budget touches it while it is being filled;
+    // its version stays odd until the load completes
+    Frame& frame = frames_[frame_id];
+    beginFrameWrite(frame_id);
+    frame.block_hash.store(block_hash, std::memory_order_relaxed);
+    frame.in_use.store(true, std::memory_order_relaxed);
+    frame.dirty = false;
+    frame.data_size.store(0, std::memory_order_relaxed);
+    frame.pin_count = 1;
+    data = getFrameData(frame_id);
+    return frame_id;
+}
+
+bool BufferManager::completeBlockLoad(const frame_id_t frame_id, const size_t data_size) noexcept{
+    Frame& frame = frames_[frame_id];
+    // the block may have been added by another path while the frame was being filled
+    if (data_size == 0 || blockhash_to_frame_.find(frame.block_hash) != nullptr){
+        frame = Frame();
+        endFrameWrite(frame_id);
+        if (frame_id < max_cached_blocks_){
+            free_frames_.push_back(frame_id);
+        } else{
+            releaseFrames(frame_id, frame_id + 1);
+        }
+        return data_size != 0;
+    }
+
+    frame.data_size.store(std::min(data_size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE)), std::memory_order_relaxed);
+    frame.pin_count = 0;
+    frame_versions_[frame_id].referenced.store(false, std::memory_order_relaxed);
+    endFrameWrite(frame_id);
+
+    blockhash_to_frame_.insert(frame.block_hash, frame_id);
+    policy_->recordInsert(frame_id, frame.block_hash);
+    relocateReleasedFrame(frame_id);
+    return true;
+}
+
+bool BufferManager::markBlockClean(const size_t block_hash) noexcept{
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    if (frame_id == nullptr){
+        return false;
+    }
+    Frame& frame = frames_[*frame_id];
+    if (frame.dirty){
+        frame.dirty = false;
+        --dirty_blocks_count_;
+        if (frame.pin_count == 0){
+            policy_->recordEvictable(*frame_id);
+        }
+        relocateReleasedFrame(*frame_id);
+    }
+    return true;
+}
+
+std::list<size_t> BufferManager::getBlockOrder() const{
+    std::list<size_t> block_order;
+    for (const frame_id_t frame_id : policy_->getOrder()){
+        block_order.push_back(frames_[frame_id].block_hash);
     }
-    blockhash_to_data_[data_hash] = data_block;
-    pinBlock(data_hash);
+    return block_order;
 }
 
-const std::list<size_t>& BufferManager::getBlockOrder() const noexcept{
-    return blockhashes_order_;
+ReplacementPolicyType BufferManager::getReplacementPolicyType() const noexcept{
+    return policy_->getType();
 }
 
-const std::unordered_map<size_t, DataBlock>& BufferManager::getCacheDump() const noexcept{
-    return blockhash_to_data_;
+std::unordered_map<size_t, DataBlock> BufferManager::getCacheDump() const{
+    std::unordered_map<size_t, DataBlock> cache_dump;
+    cache_dump.reserve(blockhash_to_frame_.size());
+    blockhash_to_frame_.forEach([&](const size_t block_hash, const frame_id_t frame_id){
+        DataBlock& dblock = cache_dump[block_hash];
+        dblock.data_size = frames_[frame_id].data_size;
+        std::memcpy(dblock.data, getFrameData(frame_id), MAX_DATA_BLOCK_SIZE);
+    });
+    return cache_dump;
 }
 
 size_t BufferManager::getCacheSize() const noexcept{
-    return blockhash_to_data_.size();
+    return blockhash_to_frame_.size();
+}
+
+size_t BufferManager::getMaxCacheSize() const noexcept{
+    return max_cached_blocks_;
+}
+
+size_t BufferManager::getMemoryBudget() const noexcept{
+    return memory_budget_;
+}
+
+size_t BufferManager::getResidentBytes() const noexcept{
+    return getCacheSize() * MAX_DATA_BLOCK_SIZE
+         + frames_.capacity() * sizeof(Frame)
+         + max_frames_ * sizeof(FrameVersion)
+         + free_frames_.capacity() * sizeof(frame_id_t)
+         + blockhash_to_frame_.getMemoryUsage()
+         + external_pins_.getMemoryUsage()
+         + (admission_filter_ ? admission_filter_->getMemoryUsage() : 0);
+}
+
+void BufferManager::setAdmissionFilterEnabled(const bool enabled){
+    if (!enabled){
+        admission_filter_.reset();
+    } else if (!admission_filter_){
+        // sized for the largest budget, so resizing the cache does not lose the collected statistics
+        admission_filter_ = std::make_unique<TinyLfuFilter>(max_frames_);
+    }
+}
+
+bool BufferManager::isAdmissionFilterEnabled() const noexcept{
+    return admission_filter_ != nullptr;
 }
 
-void BufferManager::pinBlock(const size_t block_hash) noexcept{
-    // if the hash does not exist in the cache, we just add it
-    if (blockhashes_order_.size() >= MAX_CACHED_BLOCKS_NUMBER){
-        deleteLeastRecentlyUsedBlock();
+OptimisticReadStatus BufferManager::readBlockOptimistic(const size_t block_hash, char* buffer, size_t& data_size) const noexcept{
+    frame_id_t frame_id = INVALID_FRAME_ID;
+    const uint64_t index_version = blockhash_to_frame_.getVersion();
+    if (!blockhash_to_frame_.findUnsynchronized(block_hash, frame_id)){
+        // an erase shifting entries meanwhile may have hidden the block from the probe
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const bool index_stable = index_version % 2 == 0 && blockhash_to_frame_.getVersion() == index_version;
+        return index_stable ? OptimisticReadStatus::NOT_CACHED : OptimisticReadStatus::CONFLICT;
+    }
+    if (frame_id >= max_frames_){
+        return OptimisticReadStatus::CONFLICT;
+    }
+
+    FrameVersion& frame_version = frame_versions_[frame_id];
+    const uint64_t version_before = frame_version.version.load(std::memory_order_acquire);
+    if (version_before % 2 != 0){
+        return OptimisticReadStatus::CONFLICT;
+    }
+
+    // everything read between the two version loads may be torn, so nothing is trusted before the validation
+    const Frame& frame = frames_[frame_id];
+    const bool in_use = frame.in_use.load(std::memory_order_relaxed);
+    const size_t stored_hash = frame.block_hash.load(std::memory_order_relaxed);
+    const size_t stored_data_size = std::min(frame.data_size.load(std::memory_order_relaxed), static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+    loadFrameWords(buffer, getFrameData(frame_id), stored_data_size);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (frame_version.version.load(std::memory_order_relaxed) != version_before || !in_use || stored_hash != block_hash){
+        return OptimisticReadStatus::CONFLICT;
     }
 
-    blockhashes_order_.remove(block_hash);
-    blockhashes_order_.push_front(block_hash);
+    // a hot block keeps its bit set, so readers do not keep writing to the shared cache line
+    if (!frame_version.referenced.load(std::memory_order_relaxed)){
+        frame_version.referenced.store(true, std::memory_order_relaxed);
+    }
+    data_size = stored_data_size;
+    return OptimisticReadStatus::SUCCESS;
+}
+
+bool BufferManager::isBlockCached(const size_t block_hash) const noexcept{
+    return blockhash_to_frame_.find(block_hash) != nullptr;
 }
 
-void BufferManager::unpinBlock(const size_t block_hash) noexcept{
-    blockhashes_order_.remove(block_hash);
-    blockhash_to_data_.erase(block_hash);
+bool BufferManager::isBlockDirty(const size_t block_hash) const noexcept{
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    return frame_id != nullptr && frames_[*frame_id].dirty;
 }
 
-void BufferManager::deleteLeastRecentlyUsedBlock() noexcept{
-    if (!blockhashes_order_.empty()){
-        size_t lru_hash = blockhashes_order_.back();
-        blockhashes_order_.pop_back();
-        blockhash_to_data_.erase(lru_hash);
+bool BufferManager::copyDataBlock(const size_t block_hash, DataBlock& out_block) const noexcept{
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    if (frame_id == nullptr){
+        return false;
     }
+    out_block.data_size = frames_[*frame_id].data_size;
+    std::memcpy(out_block.data, getFrameData(*frame_id), MAX_DATA_BLOCK_SIZE);
+    return true;
+}
+
+size_t BufferManager::getDirtyBlocksCount() const noexcept{
+    return dirty_blocks_count_;
+}
+
+size_t BufferManager::getRejectedBlocksCount() const noexcept{
+    return rejected_blocks_count_;
+}
+
+std::pair<char*, size_t> BufferManager::getFramesMemory() const noexcept{
+    return {frames_data_, max_cached_blocks_ * MAX_DATA_BLOCK_SIZE};
+}
+
+bool BufferManager::setMemoryBudget(const size_t memory_budget) noexcept{
+    const size_t requested_blocks = std::max(memory_budget / getBytesPerFrame(), static_cast<size_t>(1));
+    const size_t new_max_cached_blocks = std::min(requested_blocks, max_frames_);
+    const size_t old_max_cached_blocks = max_cached_blocks_;
+
+    memory_budget_ = std::min(memory_budget, getMemoryBudgetForBlocks(max_frames_));
+    max_cached_blocks_ = new_max_cached_blocks;
+    policy_->setCapacity(new_max_cached_blocks);
+
+    if (new_max_cached_blocks > old_max_cached_blocks){
+        for (frame_id_t frame_id = new_max_cached_blocks; frame_id > old_max_cached_blocks; --frame_id){
+            free_frames_.push_back(frame_id - 1);
+        }
+        return requested_blocks == new_max_cached_blocks;
+    }
+
+    // frames beyond the new capacity must not be handed out anymore
+    free_frames_.erase(std::remove_if(free_frames_.begin(), free_frames_.end(), [&](const frame_id_t frame_id){
+        return frame_id >= new_max_cached_blocks;
+    }), free_frames_.end());
+
+    // evict only as many blocks as needed to fit into the new budget
+    while (getCacheSize() > new_max_cached_blocks && evictBlock()){
+    }
+
+    // pinned blocks stay where they are until unpinned, everything around them is given back to the OS
+    frame_id_t released_run_begin = new_max_cached_blocks;
+    for (frame_id_t frame_id = new_max_cached_blocks; frame_id < old_max_cached_blocks; ++frame_id){
+        if (frames_[frame_id].in_use && frames_[frame_id].pin_count == 0){
+            relocateFrame(frame_id);
+        }
+        if (frames_[frame_id].in_use){
+            releaseFrames(released_run_begin, frame_id);
+            released_run_begin = frame_id + 1;
+        }
+    }
+    releaseFrames(released_run_begin, old_max_cached_blocks);
+    return true;
+}
+
+size_t BufferManager::getPinCount(const size_t block_hash) const noexcept{
+    const frame_id_t* frame_id = blockhash_to_frame_.find(block_hash);
+    const size_t* external_pin_count = external_pins_.find(block_hash);
+    return (frame_id == nullptr ? 0 : frames_[*frame_id].pin_count) + (external_pin_count == nullptr ? 0 : *external_pin_count);
+}
+
+size_t BufferManager::getExternalPinsCount() const noexcept{
+    return external_pins_count_;
+}
+
+size_t BufferManager::getPinnedFramesCount() const noexcept{
+    return static_cast<size_t>(std::count_if(frames_.begin(), frames_.end(), [](const Frame& frame){
+        return frame.pin_count != 0;
+    }));
+}
+
+char* BufferManager::getFrameData(const frame_id_t frame_id) const noexcept{
+    return frames_data_ + frame_id * MAX_DATA_BLOCK_SIZE;
+}
+
+void BufferManager::beginFrameWrite(const frame_id_t frame_id) noexcept{
+    std::atomic<uint64_t>& version = frame_versions_[frame_id].version;
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // the odd version must become visible before any change of the frame
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BufferManager::endFrameWrite(const frame_id_t frame_id) noexcept{
+    std::atomic<uint64_t>& version = frame_versions_[frame_id].version;
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+frame_id_t BufferManager::takeFreeFrame(const size_t block_hash, const bool dirty) noexcept{
+    // the cache holds the only copy of a dirty block, so it cannot be turned away
+    if (admission_filter_ && !dirty && free_frames_.empty()){
+        const frame_id_t victim_frame_id = policy_->pickVictim(is_evictable_);
+        if (victim_frame_id != INVALID_FRAME_ID && !admission_filter_->shouldAdmit(block_hash, frames_[victim_frame_id].block_hash)){
+            ++rejected_blocks_count_;
+            return INVALID_FRAME_ID;
+        }
+    }
+
+    // blocks evicted from beyond a shrunk capacity do not free a usable frame, so evict until one appears
+    while (free_frames_.empty()){
+        if (!evictBlock()){
+            return INVALID_FRAME_ID;
+        }
+    }
+
+    const frame_id_t frame_id = free_frames_.back();
+    free_frames_.pop_back();
+    return frame_id;
+}
+
+void BufferManager::touchBlock(const frame_id_t frame_id) noexcept{
+    policy_->recordAccess(frame_id);
+}
+
+void BufferManager::unpinBlock(const frame_id_t frame_id, const size_t block_hash) noexcept{
+    if (frame_id == EXTERNAL_FRAME_ID){
+        size_t* pin_count = external_pins_.find(block_hash);
+        if (pin_count != nullptr){
+            --external_pins_count_;
+            if (--*pin_count == 0){
+                external_pins_.erase(block_hash);
+            }
+        }
+        return;
+    }
+
+    Frame& frame = frames_[frame_id];
+    if (frame.pin_count > 0){
+        --frame.pin_count;
+    }
+    if (frame.in_use && frame.pin_count == 0 && !frame.dirty){
+        policy_->recordEvictable(frame_id);
+    }
+    relocateReleasedFrame(frame_id);
+}
+
+void BufferManager::eraseFrame(const frame_id_t frame_id, const bool evicted) noexcept{
+    Frame& frame = frames_[frame_id];
+    policy_->recordRemove(frame_id, evicted);
+    blockhash_to_frame_.erase(frame.block_hash);
+    beginFrameWrite(frame_id);
+    frame.in_use.store(false, std::memory_order_relaxed);
+    endFrameWrite(frame_id);
+    if (frame_id < max_cached_blocks_){
+        free_frames_.push_back(frame_id);
+    }
+}
+
+void BufferManager::relocateFrame(const frame_id_t frame_id) noexcept{
+    if (free_frames_.empty()){
+        if (!frames_[frame_id].dirty){
+            eraseFrame(frame_id);
+        }
+        return;
+    }
+
+    const frame_id_t new_frame_id = free_frames_.back();
+    free_frames_.pop_back();
+
+    Frame& old_frame = frames_[frame_id];
+    Frame& new_frame = frames_[new_frame_id];
+    beginFrameWrite(new_frame_id);
+    new_frame = old_frame;
+    storeFrameWords(getFrameData(new_frame_id), getFrameData(frame_id), MAX_DATA_BLOCK_SIZE);
+    frame_versions_[new_frame_id].referenced.store(frame_versions_[frame_id].referenced.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    endFrameWrite(new_frame_id);
+
+    // the new frame takes the place of the old one in the replacement policy
+    policy_->recordMove(frame_id, new_frame_id);
+    blockhash_to_frame_.update(new_frame.block_hash, new_frame_id);
+    beginFrameWrite(frame_id);
+    old_frame = Frame();
+    endFrameWrite(frame_id);
+}
+
+void BufferManager::relocateReleasedFrame(const frame_id_t frame_id) noexcept{
+    // the budget has shrunk while the block was pinned or dirty, so it is moved out of the released part of the pool now
+    const Frame& frame = frames_[frame_id];
+    if (frame.in_use && frame.pin_count == 0 && frame_id >= max_cached_blocks_){
+        relocateFrame(frame_id);
+        if (!frames_[frame_id].in_use){
+            releaseFrames(frame_id, frame_id + 1);
+        }
+    }
+}
+
+void BufferManager::releaseFrames(const frame_id_t first_frame_id, const frame_id_t last_frame_id) noexcept{
+#ifdef BUFFER_MANAGER_USE_MMAP
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(getFrameData(first_frame_id));
+    const uintptr_t end = reinterpret_cast<uintptr_t>(getFrameData(last_frame_id));
+    const uintptr_t aligned_begin = (begin + page_size - 1) / page_size * page_size;
+    const uintptr_t aligned_end = end / page_size * page_size;
+    if (aligned_begin < aligned_end){
+        madvise(reinterpret_cast<void*>(aligned_begin), aligned_end - aligned_begin, MADV_DONTNEED);
+    }
+#else
+    (void)first_frame_id;
+    (void)last_frame_id;
+#endif
+}
+
+bool BufferManager::evictBlock() noexcept{
+    // pinned blocks are skipped by the policy, so the victim is always a block nobody references
+    frame_id_t victim_frame_id = policy_->pickVictim(is_evictable_);
+
+    // hits of optimistic readers are applied lazily: a referenced victim gets its access recorded and a second chance
+    for (size_t retries = 0; victim_frame_id != INVALID_FRAME_ID && retries < max_cached_blocks_; ++retries){
+        if (!frame_versions_[victim_frame_id].referenced.exchange(false, std::memory_order_relaxed)){
+            break;
+        }
+        policy_->recordAccess(victim_frame_id);
+        victim_frame_id = policy_->pickVictim(is_evictable_);
+    }
+    if (victim_frame_id == INVALID_FRAME_ID){
+        return false;
+    }
+    eraseFrame(victim_frame_id, true);
+    return true;
 }
 
 void BufferManager::clearBuffer() noexcept{
-    blockhashes_order_.clear();
-    blockhash_to_data_.clear();
-}
\ No newline at end of file
+    for (frame_id_t frame_id = 0; frame_id < max_frames_; ++frame_id){
+        if (frames_[frame_id].in_use && frames_[frame_id].pin_count == 0 && !frames_[frame_id].dirty){
+            eraseFrame(frame_id);
+        }
+    }
+}
+
+
+BlockHandle::BlockHandle(BufferManager* owner, const frame_id_t frame_id, const size_t block_hash, const char* data, const size_t data_size) noexcept
+    : owner_(owner), frame_id_(frame_id), block_hash_(block_hash), data_(data), data_size_(data_size){
+}
+
+BlockHandle::BlockHandle(BlockHandle&& other) noexcept
+    : owner_(std::exchange(other.owner_, nullptr)),
+      owner_latch_(std::exchange(other.owner_latch_, nullptr)),
+      frame_id_(other.frame_id_),
+      block_hash_(other.block_hash_),
+      data_(std::exchange(other.data_, nullptr)),
+      data_size_(other.data_size_){
+}
+
+BlockHandle& BlockHandle::operator=(BlockHandle&& other) noexcept{
+    if (this != &other){
+        release();
+        owner_ = std::exchange(other.owner_, nullptr);
+        owner_latch_ = std::exchange(other.owner_latch_, nullptr);
+        frame_id_ = other.frame_id_;
+        block_hash_ = other.block_hash_;
+        data_ = std::exchange(other.data_, nullptr);
+        data_size_ = other.data_size_;
+    }
+    return *this;
+}
+
+BlockHandle::~BlockHandle(){
+    release();
+}
+
+bool BlockHandle::isValid() const noexcept{
+    return data_ != nullptr;
+}
+
+BlockHandle::operator bool() const noexcept{
+    return isValid();
+}
+
+const char* BlockHandle::getData() const noexcept{
+    return data_;
+}
+
+size_t BlockHandle::getDataSize() const noexcept{
+    return data_size_;
+}
+
+size_t BlockHandle::getBlockHash() const noexcept{
+    return block_hash_;
+}
+
+void BlockHandle::release() noexcept{
+    if (owner_ != nullptr && owner_latch_ != nullptr){
+        std::lock_guard<std::mutex> guard(*owner_latch_);
+        owner_->unpinBlock(frame_id_, block_hash_);
+    } else if (owner_ != nullptr){
+        owner_->unpinBlock(frame_id_, block_hash_);
+    }
+    owner_ = nullptr;
+    owner_latch_ = nullptr;
+    data_ = nullptr;
+}
@@ -8,9 +8,15 @@
 #include <functional>
 #include <optional>
 #include <list>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
 
 #include "include/duckdb.hpp"
 #include "common.hpp"
+#include "hash_index.hpp"
+#include "replacement_policy.hpp"
+#include "tiny_lfu.hpp"
 
 /*
 Тестовое задание: Разработка Buffer Manager и Block Manager для работы с диском
@@ -56,46 +62,308 @@ Referenses:
     https://github.com/duckdb/duckdb
 */
 
+class BufferManager;
+
+/* Result of a read that has not taken the cache latch. */
+enum class OptimisticReadStatus{
+    SUCCESS,        /* the copied block is consistent */
+    NOT_CACHED,     /* the block has not been found, and no erase has moved the index entries during the lookup */
+    CONFLICT        /* the frame has been modified during the read; retry or fall back to a latched read */
+};
+
+/* A pinned reference to a cached data block. While the handle is alive the block cannot be evicted,
+   so the data it points to stays valid. The block is unpinned when the handle is destroyed or released.
+   A handle must not outlive the BufferManager it has been obtained from. */
+class BlockHandle{
+public:
+    BlockHandle() noexcept = default;
+    BlockHandle(BlockHandle&& other) noexcept;
+    BlockHandle& operator=(BlockHandle&& other) noexcept;
+
+    BlockHandle(const BlockHandle&) = delete;
+    BlockHandle& operator=(const BlockHandle&) = delete;
+
+    ~BlockHandle();
+
+public:
+    // Check whether the handle refers to a cached data block.
+    bool isValid() const noexcept;
+
+    explicit operator bool() const noexcept;
+
+    // Get a pointer to the block data. Must only be called on a valid handle.
+    const char* getData() const noexcept;
+
+    // Get a number of meaningful bytes in the block. Must only be called on a valid handle.
+    size_t getDataSize() const noexcept;
+
+    size_t getBlockHash() const noexcept;
+
+    // Unpin the block before the handle goes out of scope.
+    void release() noexcept;
+
+private:
+    friend class BufferManager;
+    friend class ShardedBufferManager;
+    friend class BlockManager;
+
+    BlockHandle(BufferManager* owner, const frame_id_t frame_id, const size_t block_hash, const char* data, const size_t data_size) noexcept;
+
+private:
+    BufferManager* owner_ = nullptr;
+    std::mutex* owner_latch_ = nullptr;     /* taken to unpin the block if the owner is shared between threads */
+    frame_id_t frame_id_ = 0;
+    size_t block_hash_ = 0;
+    const char* data_ = nullptr;
+    size_t data_size_ = 0;
+};
+
 class BufferManager{
 public:
-    BufferManager() noexcept = default;
+    /** Create an empty cache. Address space for the largest allowed pool is reserved up front as one contiguous
+     * buffer, while physical memory is only used by the frames within the current budget.
+     * @param[in] memory_budget number of bytes the cache may use, including the per-frame bookkeeping
+     * @param[in] max_memory_budget upper limit for later `setMemoryBudget()` calls; `0` means `memory_budget`
+     * @param[in] policy_type algorithm choosing which block to evict when the cache is full
+     * @throw `std::bad_alloc` if the frame pool cannot be allocated.
+    */
+    explicit BufferManager(const size_t memory_budget = DEFAULT_BUFFER_MEMORY_BUDGET, const size_t max_memory_budget = 0,
+                           const ReplacementPolicyType policy_type = ReplacementPolicyType::LRU);
+
+    ~BufferManager();
+
+    BufferManager(const BufferManager&) = delete;
+    BufferManager& operator=(const BufferManager&) = delete;
+
+    // Get the memory budget needed to cache `blocks_count` data blocks.
+    static size_t getMemoryBudgetForBlocks(const size_t blocks_count) noexcept;
+
+    // Get a number of bytes a single cached block costs: the data frame plus its bookkeeping.
+    static size_t getBytesPerFrame() noexcept;
 
 public:
-    // Get a block of data by its hash. If none is found, the method returns `std::nullopt`.
-    std::optional<std::reference_wrapper<const DataBlock>> getDataBlock(const size_t block_hash) noexcept;
+    /** Pin a cached data block so it cannot be evicted and mark it as the most recently used one.
+     * @param[in] block_hash hash of the data block to pin
+     * @return a valid `BlockHandle` if the block is cached, an empty handle otherwise.
+    */
+    BlockHandle pinBlock(const size_t block_hash) noexcept;
+
+    // Get a block of data by its hash. Same as `pinBlock()`: the block stays pinned while the returned handle is alive.
+    BlockHandle getDataBlock(const size_t block_hash) noexcept;
 
-    // Removes the data block, identifiable by its `block_hash`, from the cache.
-    void removeDataBlock(const size_t block_hash) noexcept;
+    /** Track a pin of a block which lives outside the pool, e.g. in a mapped block file. The block is not cached and
+     * takes no frame; the cache only counts the alive handles, so the owner of the memory knows when it may be dropped.
+     * @param[in] data the block data, valid while the handle is alive
+     * @return an empty handle if as many blocks as the pool has frames are pinned already.
+    */
+    BlockHandle pinExternalBlock(const size_t block_hash, const char* data, const size_t data_size) noexcept;
+
+    /** Removes the data block, identifiable by its `block_hash`, from the cache.
+     * @return `false` if the block is pinned or dirty and cannot be removed, `true` otherwise.
+    */
+    bool removeDataBlock(const size_t block_hash) noexcept;
 
-    /** Add a new data block to the cache.
+    /** Add a new data block to the cache. Pinned and dirty blocks are never evicted to make space for it.
+     * With the admission filter enabled, a full cache takes the block only if it has been requested
+     * more often than the block it would evict.
      * @param[in] data_block DataBlock object
      * @param[in] data_hash hash of the new data block
+     * @param[in] dirty `true` if the cache holds the only copy of the block until it is written to the storage;
+     * such a block bypasses the admission filter and stays cached until `markBlockClean()` is called
+     * @return `true` if the block is in the cache, `false` if the cache is full and every block is pinned or dirty,
+     * or the admission filter has rejected the block.
+    */
+    bool addDataBlock(const DataBlock& data_block, const size_t data_hash, const bool dirty = false) noexcept;
+
+    /** Take a frame for a block which is read from the storage straight into the pool, e.g. by an IoEngine.
+     * Until `completeBlockLoad()` the frame is pinned and the block cannot be found, so the frame may be filled without the latch.
+     * A full cache evicts a block to make space; the admission filter decides as for `addDataBlock()`.
+     * @param[in] block_hash hash of the block to load
+     * @param[out] data the frame's data buffer of `MAX_DATA_BLOCK_SIZE` bytes, aligned to `DATA_BLOCK_ALIGNMENT`
+     * @param[in] evict `false` to take a free frame only, so a load which finds nothing costs no cached block
+     * @return the frame id, or `INVALID_FRAME_ID` if the block is cached already or no frame can be taken for it.
     */
-    void addDataBlock(const DataBlock& data_block, const size_t data_hash) noexcept;
+    frame_id_t beginBlockLoad(const size_t block_hash, char*& data, const bool evict = true) noexcept;
 
+    /** Publish a block loaded into a frame taken by `beginBlockLoad()`.
+     * @param[in] data_size number of meaningful bytes loaded; `0` abandons the load and frees the frame
+     * @return `false` if the load has been abandoned.
+    */
+    bool completeBlockLoad(const frame_id_t frame_id, const size_t data_size) noexcept;
+
+    /** Mark a dirty block as written to the storage, so it may be evicted again.
+     * @return `false` if the block is not cached.
+    */
+    bool markBlockClean(const size_t block_hash) noexcept;
+
+    // Remove all blocks that are neither pinned nor dirty from the cache.
     void clearBuffer() noexcept;
 
+    /** Change the memory budget of the cache. When it shrinks, the least recently used blocks are evicted
+     * and blocks from the released part of the pool are moved to the remaining frames. Pinned blocks are
+     * moved once they are unpinned, dirty blocks that find no free frame are moved once they are clean.
+     * @param[in] memory_budget new number of bytes the cache may use
+     * @return `false` if the budget exceeds the maximum set at construction (the maximum is used instead).
+    */
+    bool setMemoryBudget(const size_t memory_budget) noexcept;
+
+    /** Turn the TinyLFU admission filter on or off. Block requests are counted by `pinBlock()`/`getDataBlock()`,
+     * so a block should be looked up before it is added, as a read-through cache does.
+     * @param[in] enabled `true` to filter new blocks, `false` to cache every added block
+    */
+    void setAdmissionFilterEnabled(const bool enabled);
+
+    bool isAdmissionFilterEnabled() const noexcept;
+
+    /** Copy a cached block without pinning it and without modifying any shared bookkeeping, so the call may run
+     * concurrently with one thread changing the cache (e.g. under the latch of a ShardedBufferManager shard).
+     * The copy is validated against the frame version, and the hit is recorded by setting the frame's reference bit,
+     * which the replacement policy takes into account on the next eviction. Such hits are not counted by the admission filter.
+     * @param[out] buffer at least `MAX_DATA_BLOCK_SIZE` bytes; only `data_size` bytes are written
+     * @param[out] data_size number of meaningful bytes in the block
+    */
+    OptimisticReadStatus readBlockOptimistic(const size_t block_hash, char* buffer, size_t& data_size) const noexcept;
+
 public:
-    // Return a list where the data blocks are stored in the use-recency order.
-    const std::list<size_t>& getBlockOrder() const noexcept;
+    /* Return hashes of the cached data blocks ordered by the replacement policy, from the block it would keep
+       the longest to the next victim. For LRU it is the use-recency order (most recently used first). */
+    std::list<size_t> getBlockOrder() const;
+
+    ReplacementPolicyType getReplacementPolicyType() const noexcept;
 
-    // Return all cached data blocks.
-    const std::unordered_map<size_t, DataBlock>& getCacheDump() const noexcept;
+    // Return a copy of all cached data blocks.
+    std::unordered_map<size_t, DataBlock> getCacheDump() const;
 
     size_t getCacheSize() const noexcept;
 
+    // Get a number of blocks the cache can hold within the current memory budget.
+    size_t getMaxCacheSize() const noexcept;
+
+    size_t getMemoryBudget() const noexcept;
+
+    // Get a number of bytes used by the cached blocks and all bookkeeping structures of the cache.
+    size_t getResidentBytes() const noexcept;
+
+    // Get a number of alive handles pinning the block, including the ones of `pinExternalBlock()`.
+    size_t getPinCount(const size_t block_hash) const noexcept;
+
+    // Get a number of alive handles of `pinExternalBlock()`.
+    size_t getExternalPinsCount() const noexcept;
+
+    // Get a number of frames pinned by alive handles or by loads in progress. Walks the whole pool.
+    size_t getPinnedFramesCount() const noexcept;
+
+    // Check whether the block is cached without recording an access.
+    bool isBlockCached(const size_t block_hash) const noexcept;
+
+    bool isBlockDirty(const size_t block_hash) const noexcept;
+
+    /** Copy a cached block without recording an access, e.g. to write a dirty block back to the storage.
+     * @return `false` if the block is not cached.
+    */
+    bool copyDataBlock(const size_t block_hash, DataBlock& out_block) const noexcept;
+
+    // Get a number of cached blocks which have not been written to the storage yet.
+    size_t getDirtyBlocksCount() const noexcept;
+
+    // Get a number of blocks the admission filter has kept out of the cache.
+    size_t getRejectedBlocksCount() const noexcept;
+
+    /* Get the address and the size of the data of the frames the current budget allows, e.g. to register them as fixed
+       buffers of an IoEngine. A registration has to be renewed once the budget changes. */
+    std::pair<char*, size_t> getFramesMemory() const noexcept;
+
 private:
-    // Puts the data block to the top of the block order list by its data hash.
-    void pinBlock(const size_t block_hash) noexcept;
-    
-    // Removes the block from the cache by its data hash.
-    void unpinBlock(const size_t block_hash) noexcept;
+    friend class BlockHandle;
+
+    /* Metadata of a single frame. The fields `readBlockOptimistic()` reads without the latch are atomic; they are
+       changed under the latch only, between `beginFrameWrite()` and `endFrameWrite()`, so relaxed accesses do. */
+    struct Frame{
+        Frame() noexcept = default;
+
+        Frame& operator=(const Frame& other) noexcept{
+            block_hash.store(other.block_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            data_size.store(other.data_size.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            pin_count = other.pin_count;
+            in_use.store(other.in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            dirty = other.dirty;
+            return *this;
+        }
+
+        std::atomic<size_t> block_hash{0};
+        std::atomic<size_t> data_size{0};
+        size_t pin_count = 0;                   /* number of alive handles referencing the block */
+        std::atomic<bool> in_use{false};        /* the frame holds a cached block */
+        bool dirty = false;                     /* the block has not been written to the storage yet */
+    };
 
-    // Remove the least recently used block from the cache.
-    void deleteLeastRecentlyUsedBlock() noexcept;
+    /* Seqlock of a frame for the readers which do not take the latch. */
+    struct FrameVersion{
+        std::atomic<uint64_t> version{0};       /* odd while the frame or its block is being modified */
+        std::atomic<bool> referenced{false};    /* set by optimistic hits, applied to the policy on eviction */
+    };
+
+    // Get a pointer to the frame's data buffer.
+    char* getFrameData(const frame_id_t frame_id) const noexcept;
+
+    // Make the frame odd-versioned, so optimistic readers retry until `endFrameWrite()`.
+    void beginFrameWrite(const frame_id_t frame_id) noexcept;
+
+    void endFrameWrite(const frame_id_t frame_id) noexcept;
+
+    /** Take a free frame for a new block, evicting one if the cache is full.
+     * @param[in] dirty `true` to bypass the admission filter
+     * @return `INVALID_FRAME_ID` if every cached block is pinned or dirty, or the admission filter has rejected the block.
+    */
+    frame_id_t takeFreeFrame(const size_t block_hash, const bool dirty) noexcept;
+
+    // Puts the data block to the top of the block order list.
+    void touchBlock(const frame_id_t frame_id) noexcept;
+
+    // Releases one pin of the frame, or of the block outside the pool for `EXTERNAL_FRAME_ID`. Called by `BlockHandle`.
+    void unpinBlock(const frame_id_t frame_id, const size_t block_hash) noexcept;
+
+    /** Drops the block held by the frame from the cache and returns the frame to the free list.
+     * @param[in] evicted `true` if the block is dropped to make space rather than removed explicitly
+    */
+    void eraseFrame(const frame_id_t frame_id, const bool evicted = false) noexcept;
+
+    /** Moves an unpinned block from a frame beyond the current capacity to a free frame within it.
+     * Without a free frame a clean block is dropped and a dirty one stays where it is.
+    */
+    void relocateFrame(const frame_id_t frame_id) noexcept;
+
+    // Moves the block out of the released part of the pool once nothing keeps it there anymore.
+    void relocateReleasedFrame(const frame_id_t frame_id) noexcept;
+
+    // Returns physical memory of the frames in [first_frame_id, last_frame_id) to the OS.
+    void releaseFrames(const frame_id_t first_frame_id, const frame_id_t last_frame_id) noexcept;
+
+    /** Remove the unpinned block chosen by the replacement policy from the cache.
+     * @return `false` if every cached block is pinned.
+    */
+    bool evictBlock() noexcept;
 
 private:
+    static constexpr frame_id_t EXTERNAL_FRAME_ID = INVALID_FRAME_ID;      /* Frame of the handles of `pinExternalBlock()` */
+
+    size_t memory_budget_;
+    size_t max_cached_blocks_;                      /* Frames usable within the current memory budget */
+    size_t max_frames_;                             /* Frames reserved for the largest allowed memory budget */
+
+    char* frames_data_ = nullptr;                   /* Contiguous aligned buffer with `max_frames_` data frames */
+    std::vector<Frame> frames_;                     /* Metadata for every frame of the pool */
+    std::unique_ptr<FrameVersion[]> frame_versions_;    /* Seqlock of every frame of the pool */
+    std::vector<frame_id_t> free_frames_;           /* Ids of the frames which hold no data block */
+    HashIndex<frame_id_t> blockhash_to_frame_;      /* Maps hashes of the cached blocks to their frames */
+
+    std::unique_ptr<ReplacementPolicy> policy_;     /* Decides which block to evict */
+    ReplacementPolicy::EvictablePredicate is_evictable_;
+
+    std::unique_ptr<TinyLfuFilter> admission_filter_;   /* Decides whether a new block may evict a cached one */
+    size_t rejected_blocks_count_ = 0;
+    size_t dirty_blocks_count_ = 0;
 
-    std::list<size_t> blockhashes_order_;                       /* Keeps the used recency order for data blocks */
-    std::unordered_map<size_t, DataBlock> blockhash_to_data_;   /* Stores hashes-to-datablock key pairs */
+    HashIndex<size_t> external_pins_;               /* Pin counts of the blocks outside the pool; grows to `max_frames_` on demand */
+    size_t external_pins_count_ = 0;
 };
\ No newline at end of file
@@ -8,7 +8,7 @@ TEST(BufferManagerHappyTests, InitStatTest){
     EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
     EXPECT_TRUE(manager.getBlockOrder().empty());
     EXPECT_TRUE(manager.getCacheDump().empty());
-    EXPECT_FALSE(manager.getDataBlock(231).has_value());
+    EXPECT_FALSE(manager.getDataBlock(231).isValid());
 }
 
 TEST(BufferManagerHappyTests, AddDataBlockTest){
@@ -20,7 +20,7 @@ TEST(BufferManagerHappyTests, AddDataBlockTest){
         EXPECT_NE(manager.getCacheSize(), static_cast<size_t>(0));
         EXPECT_EQ(manager.getBlockOrder(), std::list<size_t>{0});
         EXPECT_EQ(manager.getCacheDump(), (std::unordered_map<size_t, DataBlock>{{0, block}}));
-        EXPECT_TRUE(manager.getDataBlock(0).has_value());
+        EXPECT_TRUE(manager.getDataBlock(0).isValid());
     }
 
     { // Add multiple blocks
@@ -48,8 +48,8 @@ TEST(BufferManagerHappyTests, AddDataBlockTest){
 
         manager.addDataBlock(block1, block1_hash);
         EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(1));
-        EXPECT_TRUE(manager.getDataBlock(block1_hash).has_value());
-        EXPECT_FALSE(manager.getDataBlock(block2_hash).has_value());
+        EXPECT_TRUE(manager.getDataBlock(block1_hash).isValid());
+        EXPECT_FALSE(manager.getDataBlock(block2_hash).isValid());
         
         manager.addDataBlock(block2, block2_hash);
         EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{block2_hash, block1_hash}));
@@ -94,11 +94,11 @@ TEST(BufferManagerHappyTests, RemoveDataBlockTest){
     EXPECT_EQ(manager.getCacheDump(), (std::unordered_map<size_t, DataBlock>{{block1_hash, block1}, {block3_hash, block3}}));
 
     manager.removeDataBlock(block1_hash);
-    EXPECT_FALSE(manager.getDataBlock(block1_hash).has_value());
-    EXPECT_FALSE(manager.getDataBlock(block2_hash).has_value());
-    EXPECT_TRUE(manager.getDataBlock(block3_hash).has_value());
+    EXPECT_FALSE(manager.getDataBlock(block1_hash).isValid());
+    EXPECT_FALSE(manager.getDataBlock(block2_hash).isValid());
+    EXPECT_TRUE(manager.getDataBlock(block3_hash).isValid());
     manager.removeDataBlock(block3_hash);
-    EXPECT_FALSE(manager.getDataBlock(block3_hash).has_value());
+    EXPECT_FALSE(manager.getDataBlock(block3_hash).isValid());
 
     EXPECT_TRUE(manager.getBlockOrder().empty());
     EXPECT_TRUE(manager.getCacheDump().empty());
@@ -117,9 +117,420 @@ TEST(BufferManagerUnhappyTests, RemoveDataBlockOnEmptyBufferTest){
     EXPECT_TRUE(manager.getBlockOrder().empty());
 
     manager.addDataBlock(test_block, test_block_hash);
-    EXPECT_TRUE(manager.getDataBlock(test_block_hash).has_value());
+    EXPECT_TRUE(manager.getDataBlock(test_block_hash).isValid());
 
     EXPECT_NO_THROW(manager.removeDataBlock(test_block_hash));
     EXPECT_TRUE(manager.getBlockOrder().empty());
 }
 
+
+
+TEST(BufferManagerHappyTests, EvictLeastRecentlyUsedBlockTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(3));
+    DataBlock block;
+    block.data_size = 1;
+
+    manager.addDataBlock(block, 1);
+    manager.addDataBlock(block, 2);
+    manager.addDataBlock(block, 3);
+    EXPECT_EQ(manager.getMaxCacheSize(), static_cast<size_t>(3));
+
+    // a cache hit on a full buffer must not evict anything
+    EXPECT_TRUE(manager.getDataBlock(1).isValid());
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(3));
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{1, 3, 2}));
+
+    manager.addDataBlock(block, 4);
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(3));
+    EXPECT_FALSE(manager.getDataBlock(2).isValid());
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{4, 1, 3}));
+
+    manager.removeDataBlock(1);
+    manager.addDataBlock(block, 5);
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{5, 4, 3}));
+
+    manager.clearBuffer();
+    EXPECT_TRUE(manager.getBlockOrder().empty());
+    manager.addDataBlock(block, 6);
+    EXPECT_EQ(manager.getBlockOrder(), std::list<size_t>{6});
+}
+
+
+TEST(BufferManagerHappyTests, PinnedBlockIsNotEvictedTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2));
+    DataBlock block1, block2;
+    block1.data_size = 1;
+    block1.data[0] = 'a';
+    block2.data_size = 1;
+    block2.data[0] = 'b';
+
+    manager.addDataBlock(block1, 1);
+    manager.addDataBlock(block2, 2);
+    {
+        BlockHandle handle = manager.pinBlock(1);
+        ASSERT_TRUE(handle.isValid());
+        EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(1));
+        EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{1, 2}));
+
+        // block 2 is unpinned, so it is evicted even though it is more recently used
+        manager.addDataBlock(block2, 2);
+        EXPECT_TRUE(manager.addDataBlock(block2, 3));
+        EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{3, 1}));
+
+        BlockHandle moved_handle = std::move(handle);
+        EXPECT_FALSE(handle.isValid());
+        EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(1));
+        EXPECT_EQ(moved_handle.getDataSize(), static_cast<size_t>(1));
+        EXPECT_EQ(moved_handle.getData()[0], 'a');
+
+        EXPECT_FALSE(manager.removeDataBlock(1));
+        manager.clearBuffer();
+        EXPECT_EQ(manager.getBlockOrder(), std::list<size_t>{1});
+    }
+    EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(0));
+    EXPECT_TRUE(manager.removeDataBlock(1));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
+}
+
+TEST(BufferManagerUnhappyTests, AddDataBlockToFullyPinnedBufferTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(1));
+    DataBlock block;
+    block.data_size = 1;
+
+    manager.addDataBlock(block, 1);
+    BlockHandle handle = manager.getDataBlock(1);
+    EXPECT_FALSE(manager.addDataBlock(block, 2));
+    EXPECT_FALSE(manager.getDataBlock(2).isValid());
+
+    handle.release();
+    EXPECT_FALSE(handle.isValid());
+    EXPECT_TRUE(manager.addDataBlock(block, 2));
+    EXPECT_FALSE(manager.getDataBlock(1).isValid());
+}
+
+TEST(BufferManagerHappyTests, MemoryBudgetTest){
+    const size_t blocks_count = 10;
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(blocks_count / 2), BufferManager::getMemoryBudgetForBlocks(blocks_count));
+    DataBlock block;
+    block.data_size = 4;
+
+    EXPECT_EQ(manager.getMaxCacheSize(), blocks_count / 2);
+    EXPECT_EQ(manager.getMemoryBudget(), BufferManager::getMemoryBudgetForBlocks(blocks_count / 2));
+    const size_t empty_resident_bytes = manager.getResidentBytes();
+    EXPECT_GT(empty_resident_bytes, static_cast<size_t>(0));
+
+    // grow up to the maximum
+    EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(blocks_count)));
+    EXPECT_EQ(manager.getMaxCacheSize(), blocks_count);
+    for (size_t hash = 0; hash < blocks_count; ++hash){
+        std::memcpy(block.data, &hash, sizeof(hash));
+        EXPECT_TRUE(manager.addDataBlock(block, hash));
+    }
+    EXPECT_EQ(manager.getCacheSize(), blocks_count);
+    EXPECT_EQ(manager.getResidentBytes(), empty_resident_bytes + blocks_count * MAX_DATA_BLOCK_SIZE);
+
+    // shrink: the least recently used blocks are evicted, the rest are kept intact
+    BlockHandle pinned_handle = manager.pinBlock(blocks_count - 1);
+    EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(3)));
+    EXPECT_EQ(manager.getMaxCacheSize(), static_cast<size_t>(3));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(3));
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{blocks_count - 1, blocks_count - 2, blocks_count - 3}));
+    const size_t pinned_hash = pinned_handle.getBlockHash();
+    EXPECT_EQ(std::memcmp(pinned_handle.getData(), &pinned_hash, sizeof(pinned_hash)), 0);
+    pinned_handle.release();
+
+    for (const auto& [hash, dblock] : manager.getCacheDump()){
+        EXPECT_EQ(std::memcmp(dblock.data, &hash, sizeof(hash)), 0);
+    }
+
+    // the budget cannot exceed the maximum given at construction
+    EXPECT_FALSE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(blocks_count * 2)));
+    EXPECT_EQ(manager.getMaxCacheSize(), blocks_count);
+}
+
+TEST(BufferManagerHappyTests, ScanResistantReplacementPoliciesTest){
+    const size_t cache_size = 8;
+    const std::vector<size_t> hot_hashes{1, 2, 3, 4};
+
+    for (const ReplacementPolicyType policy_type : {ReplacementPolicyType::LRU, ReplacementPolicyType::CLOCK,
+                                                    ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC}){
+        BufferManager manager(BufferManager::getMemoryBudgetForBlocks(cache_size), 0, policy_type);
+        EXPECT_EQ(manager.getReplacementPolicyType(), policy_type);
+        DataBlock block;
+        block.data_size = 1;
+
+        // read the block through the cache, loading it on a miss
+        const auto access = [&](const size_t hash){
+            if (!manager.getDataBlock(hash).isValid()){
+                EXPECT_TRUE(manager.addDataBlock(block, hash));
+            }
+        };
+
+        size_t cold_hash = 1000;
+        for (size_t round = 0; round < 20; ++round){
+            for (const size_t hash : hot_hashes){
+                access(hash);
+            }
+            access(cold_hash++);
+        }
+
+        // a one-time sequential scan as large as the whole cache
+        for (size_t scan_hash = 2000; scan_hash < 2000 + cache_size; ++scan_hash){
+            access(scan_hash);
+        }
+
+        const std::unordered_map<size_t, DataBlock> cache_dump = manager.getCacheDump();
+        size_t surviving_hot_blocks = 0;
+        for (const size_t hash : hot_hashes){
+            surviving_hot_blocks += cache_dump.count(hash);
+        }
+        EXPECT_EQ(manager.getCacheSize(), cache_size);
+        if (policy_type == ReplacementPolicyType::LRU){
+            EXPECT_EQ(surviving_hot_blocks, static_cast<size_t>(0));
+        } else{
+            EXPECT_EQ(surviving_hot_blocks, hot_hashes.size()) << "policy #" << static_cast<int>(policy_type);
+        }
+    }
+}
+
+TEST(BufferManagerUnhappyTests, PinnedBlocksWithEveryPolicyTest){
+    for (const ReplacementPolicyType policy_type : {ReplacementPolicyType::LRU, ReplacementPolicyType::CLOCK,
+                                                    ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC}){
+        BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2), BufferManager::getMemoryBudgetForBlocks(4), policy_type);
+        DataBlock block;
+        block.data_size = 1;
+
+        manager.addDataBlock(block, 1);
+        manager.addDataBlock(block, 2);
+        BlockHandle handle1 = manager.pinBlock(1);
+        BlockHandle handle2 = manager.pinBlock(2);
+        EXPECT_FALSE(manager.addDataBlock(block, 3));
+
+        handle2.release();
+        EXPECT_TRUE(manager.addDataBlock(block, 3));
+        EXPECT_TRUE(manager.getDataBlock(1).isValid());
+        EXPECT_FALSE(manager.getDataBlock(2).isValid());
+
+        // growing and shrinking keeps the policy consistent with the cache contents
+        EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(4)));
+        manager.addDataBlock(block, 4);
+        manager.addDataBlock(block, 5);
+        EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(1)));
+        EXPECT_EQ(manager.getBlockOrder(), std::list<size_t>{1});
+        handle1.release();
+        EXPECT_TRUE(manager.addDataBlock(block, 6));
+        EXPECT_EQ(manager.getBlockOrder(), std::list<size_t>{6});
+    }
+}
+
+TEST(BufferManagerHappyTests, UnevictableFramesAreSetAsideTest){
+    for (const ReplacementPolicyType policy_type : {ReplacementPolicyType::LRU, ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC}){
+        const std::unique_ptr<ReplacementPolicy> policy = ReplacementPolicy::create(policy_type, 100, 100);
+        for (frame_id_t frame_id = 0; frame_id < 100; ++frame_id){
+            policy->recordInsert(frame_id, frame_id + 1);
+        }
+        // the 90 coldest frames are pinned or dirty
+        std::vector<bool> evictable(100, false);
+        std::fill(evictable.begin() + 90, evictable.end(), true);
+        size_t checks_count = 0;
+        const ReplacementPolicy::EvictablePredicate is_evictable = [&evictable, &checks_count](const frame_id_t frame_id){
+            ++checks_count;
+            return static_cast<bool>(evictable[frame_id]);
+        };
+
+        EXPECT_EQ(policy->pickVictim(is_evictable), frame_id_t{90}) << "policy #" << static_cast<int>(policy_type);
+        EXPECT_EQ(checks_count, static_cast<size_t>(91));
+        policy->recordRemove(90, true);
+        EXPECT_EQ(policy->getOrder().size(), static_cast<size_t>(99));
+
+        // later evictions do not walk past them again
+        checks_count = 0;
+        for (frame_id_t frame_id = 91; frame_id < 100; ++frame_id){
+            EXPECT_EQ(policy->pickVictim(is_evictable), frame_id);
+            policy->recordRemove(frame_id, true);
+        }
+        EXPECT_EQ(policy->pickVictim(is_evictable), INVALID_FRAME_ID);
+        EXPECT_EQ(checks_count, static_cast<size_t>(9));
+
+        // an unpinned frame is a candidate again
+        evictable[5] = true;
+        policy->recordEvictable(5);
+        EXPECT_EQ(policy->pickVictim(is_evictable), frame_id_t{5});
+        EXPECT_EQ(policy->getOrder().size(), static_cast<size_t>(90));
+    }
+}
+
+TEST(BufferManagerHappyTests, AdmissionFilterTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2));
+    EXPECT_FALSE(manager.isAdmissionFilterEnabled());
+    manager.setAdmissionFilterEnabled(true);
+    EXPECT_TRUE(manager.isAdmissionFilterEnabled());
+
+    DataBlock block;
+    block.data_size = 1;
+
+    // free frames are always handed out
+    for (const size_t hash : {1, 2}){
+        EXPECT_FALSE(manager.getDataBlock(hash).isValid());
+        EXPECT_TRUE(manager.addDataBlock(block, hash));
+    }
+    for (size_t i = 0; i < 3; ++i){
+        EXPECT_TRUE(manager.getDataBlock(1).isValid());
+        EXPECT_TRUE(manager.getDataBlock(2).isValid());
+    }
+
+    // a block requested once does not displace blocks requested many times
+    for (size_t hash = 100; hash < 110; ++hash){
+        EXPECT_FALSE(manager.getDataBlock(hash).isValid());
+        EXPECT_FALSE(manager.addDataBlock(block, hash));
+    }
+    EXPECT_EQ(manager.getRejectedBlocksCount(), static_cast<size_t>(10));
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{2, 1}));
+
+    // a block requested more often than the victim gets in
+    for (size_t i = 0; i < 6; ++i){
+        EXPECT_FALSE(manager.getDataBlock(7).isValid());
+    }
+    EXPECT_TRUE(manager.addDataBlock(block, 7));
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{7, 2}));
+
+    manager.setAdmissionFilterEnabled(false);
+    EXPECT_TRUE(manager.addDataBlock(block, 200));
+}
+
+TEST(BufferManagerHappyTests, OptimisticReadTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(3));
+
+    DataBlock block;
+    block.data_size = 5;
+    std::memcpy(block.data, "block", 5);
+
+    char buffer[MAX_DATA_BLOCK_SIZE];
+    size_t data_size = 0;
+    EXPECT_EQ(manager.readBlockOptimistic(1, buffer, data_size), OptimisticReadStatus::NOT_CACHED);
+
+    for (const size_t hash : {1, 2, 3}){
+        manager.addDataBlock(block, hash);
+    }
+    ASSERT_EQ(manager.readBlockOptimistic(1, buffer, data_size), OptimisticReadStatus::SUCCESS);
+    EXPECT_EQ(data_size, static_cast<size_t>(5));
+    EXPECT_EQ(std::memcmp(buffer, "block", 5), 0);
+
+    // the optimistic hit does not touch the policy right away...
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{3, 2, 1}));
+    EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(0));
+
+    // ...but saves the block from the next eviction
+    manager.addDataBlock(block, 4);
+    EXPECT_EQ(manager.getBlockOrder(), (std::list<size_t>{4, 1, 3}));
+
+    EXPECT_TRUE(manager.removeDataBlock(1));
+    EXPECT_EQ(manager.readBlockOptimistic(1, buffer, data_size), OptimisticReadStatus::NOT_CACHED);
+}
+
+TEST(BufferManagerHappyTests, DirtyBlocksTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2), BufferManager::getMemoryBudgetForBlocks(2));
+    manager.setAdmissionFilterEnabled(true);
+
+    DataBlock block;
+    block.data_size = 1;
+
+    // dirty blocks bypass the admission filter and are never evicted or removed
+    EXPECT_TRUE(manager.addDataBlock(block, 1, true));
+    EXPECT_TRUE(manager.addDataBlock(block, 2, true));
+    EXPECT_EQ(manager.getDirtyBlocksCount(), static_cast<size_t>(2));
+    EXPECT_TRUE(manager.isBlockDirty(1));
+    EXPECT_FALSE(manager.addDataBlock(block, 3));
+    EXPECT_FALSE(manager.removeDataBlock(1));
+    manager.clearBuffer();
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(2));
+
+    DataBlock copied_block;
+    EXPECT_TRUE(manager.copyDataBlock(2, copied_block));
+    EXPECT_EQ(copied_block, block);
+    EXPECT_FALSE(manager.copyDataBlock(3, copied_block));
+
+    // a dirty block beyond a shrunk capacity stays in place until it is clean
+    EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(1)));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(2));
+
+    EXPECT_TRUE(manager.markBlockClean(1));
+    EXPECT_FALSE(manager.isBlockDirty(1));
+    EXPECT_FALSE(manager.markBlockClean(3));
+    EXPECT_TRUE(manager.markBlockClean(2));
+    EXPECT_EQ(manager.getDirtyBlocksCount(), static_cast<size_t>(0));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(1));
+    EXPECT_TRUE(manager.removeDataBlock(1) && manager.removeDataBlock(2));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
+}
+
+TEST(BufferManagerHappyTests, BlockLoadTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2));
+    DataBlock block;
+    block.data_size = 5;
+    std::memcpy(block.data, "block", 5);
+    EXPECT_TRUE(manager.addDataBlock(block, 1));
+
+    // a frame being loaded is pinned and invisible until the load completes
+    char* data = nullptr;
+    const frame_id_t frame_id = manager.beginBlockLoad(2, data);
+    ASSERT_NE(frame_id, INVALID_FRAME_ID);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % DATA_BLOCK_ALIGNMENT, static_cast<uintptr_t>(0));
+    EXPECT_EQ(manager.beginBlockLoad(1, data), INVALID_FRAME_ID);
+    EXPECT_FALSE(manager.isBlockCached(2));
+    char* other_data = nullptr;
+    EXPECT_EQ(manager.beginBlockLoad(3, other_data), frame_id_t{0});     // evicts block 1, the loading frame is kept
+    EXPECT_FALSE(manager.completeBlockLoad(0, 0));
+    EXPECT_FALSE(manager.isBlockCached(1));
+
+    std::memcpy(data, "loaded", 6);
+    EXPECT_TRUE(manager.completeBlockLoad(frame_id, 6));
+    BlockHandle handle = manager.pinBlock(2);
+    ASSERT_TRUE(handle.isValid());
+    EXPECT_EQ(handle.getDataSize(), static_cast<size_t>(6));
+    EXPECT_EQ(std::string(handle.getData(), 6), "loaded");
+    handle.release();
+
+    // a block added while its load was in flight wins, the loaded frame is dropped
+    const frame_id_t late_frame_id = manager.beginBlockLoad(4, data);
+    ASSERT_NE(late_frame_id, INVALID_FRAME_ID);
+    EXPECT_TRUE(manager.addDataBlock(block, 4));
+    EXPECT_TRUE(manager.completeBlockLoad(late_frame_id, 6));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(1));
+    DataBlock cached_block;
+    EXPECT_TRUE(manager.copyDataBlock(4, cached_block));
+    EXPECT_EQ(cached_block, block);
+
+    const auto [frames_memory, frames_size] = manager.getFramesMemory();
+    EXPECT_EQ(frames_size, 2 * static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+    EXPECT_TRUE(data >= frames_memory && data < frames_memory + frames_size);
+}
+
+TEST(BufferManagerHappyTests, ExternalPinTest){
+    BufferManager manager(BufferManager::getMemoryBudgetForBlocks(2));
+    const char mapped_data[] = "mapped block";
+
+    // external blocks take no frames, only their handles are counted
+    BlockHandle first_handle = manager.pinExternalBlock(1, mapped_data, sizeof(mapped_data));
+    BlockHandle second_handle = manager.pinExternalBlock(1, mapped_data, sizeof(mapped_data));
+    ASSERT_TRUE(first_handle.isValid());
+    EXPECT_EQ(first_handle.getData(), mapped_data);
+    EXPECT_EQ(first_handle.getDataSize(), sizeof(mapped_data));
+    EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(2));
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
+    EXPECT_FALSE(manager.isBlockCached(1));
+
+    // as many external blocks as frames may be pinned at once
+    BlockHandle other_handle = manager.pinExternalBlock(2, mapped_data, sizeof(mapped_data));
+    EXPECT_TRUE(other_handle.isValid());
+    EXPECT_FALSE(manager.pinExternalBlock(3, mapped_data, sizeof(mapped_data)).isValid());
+    EXPECT_EQ(manager.getExternalPinsCount(), static_cast<size_t>(3));
+
+    first_handle.release();
+    EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(1));
+    second_handle.release();
+    other_handle.release();
+    EXPECT_EQ(manager.getPinCount(1), static_cast<size_t>(0));
+    EXPECT_EQ(manager.getExternalPinsCount(), static_cast<size_t>(0));
+    EXPECT_TRUE(manager.pinExternalBlock(3, mapped_data, sizeof(mapped_data)).isValid());
+}
@@ -0,0 +1,78 @@
+#include "block_manager.hpp"
+#include "bench_common.hpp"
+
+#include <unordered_set>
+
+/* Compares splitting data into blocks at fixed offsets with content-defined chunking (FastCDC), on a single core:
+   - throughput of finding the boundaries alone, and of `BlockManager::createDataBlocks()`, which also copies the data
+     into blocks, in GB/s;
+   - the share of new blocks in a re-upload of the data with one byte inserted at the front, which is what has to be
+     stored again when the blocks are deduplicated by content.
+   Usage: ChunkingBenchmark [data_mb = 256] [repetitions = 5] */
+
+namespace{
+    // Run `op` `repetitions` times over `bytes_count` bytes and return the best throughput in GB/s.
+    template <typename Operation>
+    double measureThroughput(const size_t bytes_count, const size_t repetitions, Operation&& op){
+        double best_ns = 0.0;
+        for (size_t repetition = 0; repetition < repetitions; ++repetition){
+            const double ns = measureNsPerOp(1, op);
+            best_ns = repetition == 0 ? ns : std::min(best_ns, ns);
+        }
+        return static_cast<double>(bytes_count) / best_ns;
+    }
+
+    double measureNewBlocksShare(const std::vector<char>& data, const ChunkingMode chunking_mode){
+        std::unordered_set<size_t> stored_blocks;
+        for (const DataBlock& dblock : BlockManager::createDataBlocks(data.data(), data.size(), chunking_mode)){
+            stored_blocks.insert(dblock.Hash());
+        }
+        std::vector<char> edited_data;
+        edited_data.reserve(data.size() + 1);
+        edited_data.push_back('#');
+        edited_data.insert(edited_data.end(), data.begin(), data.end());
+
+        const std::vector<DataBlock> dblocks = BlockManager::createDataBlocks(edited_data.data(), edited_data.size(), chunking_mode);
+        size_t new_blocks_count = 0;
+        for (const DataBlock& dblock : dblocks){
+            new_blocks_count += stored_blocks.count(dblock.Hash()) == 0 ? 1 : 0;
+        }
+        return 100.0 * static_cast<double>(new_blocks_count) / static_cast<double>(dblocks.size());
+    }
+}
+
+int main(int argc, char** argv){
+    const size_t data_size = readSizeArgument(argc, argv, 1, 256) << 20;
+    const size_t repetitions = std::max(readSizeArgument(argc, argv, 2, 5), static_cast<size_t>(1));
+    std::vector<char> data(data_size);
+    std::mt19937_64 rng(42);
+    for (char& byte : data){
+        byte = static_cast<char>(rng());
+    }
+    const ChunkingParameters parameters;
+
+    std::cout << "data: " << (data_size >> 20) << " MB, content-defined chunks: " << parameters.min_size << " / "
+              << parameters.avg_size << " / " << parameters.max_size << " bytes" << std::endl;
+    std::cout << std::setw(18) << "mode" << std::setw(18) << "boundaries GB/s" << std::setw(16) << "blocks GB/s"
+              << std::setw(14) << "avg bytes" << std::setw(20) << "new after edit, %" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const ChunkingMode chunking_mode : {ChunkingMode::FIXED_SIZE, ChunkingMode::CONTENT_DEFINED}){
+        const bool content_defined = chunking_mode == ChunkingMode::CONTENT_DEFINED;
+        size_t chunks_count = 0;
+        const double boundaries_rate = measureThroughput(data_size, repetitions, [&](size_t){
+            chunks_count = 0;
+            for (size_t offset = 0; offset < data_size; ++chunks_count){
+                offset += content_defined ? findChunkBoundary(data.data() + offset, data_size - offset, parameters)
+                                          : std::min(data_size - offset, static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+            }
+            doNotOptimize(chunks_count);
+        });
+        const double blocks_rate = measureThroughput(data_size, repetitions, [&](size_t){
+            doNotOptimize(BlockManager::createDataBlocks(data.data(), data_size, chunking_mode).size());
+        });
+        std::cout << std::setw(18) << (content_defined ? "content-defined" : "fixed-size") << std::setw(18) << boundaries_rate
+                  << std::setw(16) << blocks_rate << std::setw(14) << data_size / chunks_count
+                  << std::setw(20) << measureNewBlocksShare(data, chunking_mode) << std::endl;
+    }
+}
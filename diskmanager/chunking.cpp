@@ -0,0 +1,122 @@
+#include "chunking.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+namespace{
+    constexpr uint64_t GEAR_SEED = 0x6a09e667f3bcc908ull;
+
+    /* Random 64-bit values for every byte. The rolling hash is `hash = (hash << 1) + gear[byte]`, so a bit `k` of it
+       depends on the last `k + 1` bytes only. The shifted copy lets two bytes be rolled per step. */
+    struct GearTables{
+        GearTables() noexcept{
+            // splitmix64, so the table is the same everywhere without being spelled out
+            uint64_t state = GEAR_SEED;
+            for (size_t byte = 0; byte < 256; ++byte){
+                state += 0x9e3779b97f4a7c15ull;
+                uint64_t value = state;
+                value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+                value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+                gear[byte] = value ^ (value >> 31);
+                shifted_gear[byte] = gear[byte] << 1;
+            }
+        }
+
+        uint64_t gear[256];
+        uint64_t shifted_gear[256];
+    };
+
+    const GearTables& getGearTables() noexcept{
+        static const GearTables gear_tables;
+        return gear_tables;
+    }
+
+    // Get a mask of `bits_count` ones right below the top bit, which depend on the most bytes and survive a shift by one.
+    uint64_t makeBoundaryMask(const size_t bits_count) noexcept{
+        return ((uint64_t{1} << bits_count) - 1) << (63 - bits_count);
+    }
+
+    size_t floorLog2(size_t value) noexcept{
+        size_t result = 0;
+        while (value > 1){
+            value >>= 1;
+            ++result;
+        }
+        return result;
+    }
+
+    /* Roll the hash over [position, end) and stop after the first byte that makes it match the mask.
+       Every step rolls two bytes: the first is added shifted and tested against the shifted mask, which gives the
+       same answer as rolling it alone because the mask never uses the top bit.
+       Returns `true` with `position` at the end of the chunk, or `false` with `position` at `end` if no byte matches. */
+    bool rollUntilBoundary(const unsigned char* bytes, size_t& position, const size_t end, uint64_t& hash, const uint64_t mask,
+                           const GearTables& tables) noexcept{
+        const uint64_t shifted_mask = mask << 1;
+        for (; position + 1 < end; position += 2){
+            hash = (hash << 2) + tables.shifted_gear[bytes[position]];
+            if ((hash & shifted_mask) == 0){
+                position += 1;
+                return true;
+            }
+            hash += tables.gear[bytes[position + 1]];
+            if ((hash & mask) == 0){
+                position += 2;
+                return true;
+            }
+        }
+        if (position < end){
+            hash = (hash << 1) + tables.gear[bytes[position]];
+            ++position;
+            if ((hash & mask) == 0){
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void checkChunkingParameters(const ChunkingParameters& parameters){
+    if (parameters.min_size == 0 || parameters.min_size > parameters.avg_size || parameters.avg_size > parameters.max_size
+        || parameters.max_size > MAX_DATA_BLOCK_SIZE){
+        throw std::invalid_argument("Invalid chunk sizes: "s + std::to_string(parameters.min_size) + ", "s
+                                    + std::to_string(parameters.avg_size) + ", "s + std::to_string(parameters.max_size));
+    }
+    if ((parameters.avg_size & (parameters.avg_size - 1)) != 0){
+        throw std::invalid_argument("Invalid average chunk size: "s + std::to_string(parameters.avg_size) + " is not a power of two"s);
+    }
+}
+
+size_t findChunkBoundary(const char* data, const size_t size, const ChunkingParameters& parameters) noexcept{
+    if (size <= parameters.min_size){
+        return size;
+    }
+
+    // normalized chunking: a boundary is four times less likely before the average size and four times more likely after it
+    const size_t average_bits = floorLog2(parameters.avg_size);
+    const uint64_t small_chunk_mask = makeBoundaryMask(average_bits + 2);
+    const uint64_t large_chunk_mask = makeBoundaryMask(average_bits > 2 ? average_bits - 2 : 1);
+    const size_t normal_end = std::min(parameters.avg_size, size);
+    const size_t end = std::min(parameters.max_size, size);
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    const GearTables& tables = getGearTables();
+    uint64_t hash = 0;
+    size_t position = parameters.min_size;
+    if (!rollUntilBoundary(bytes, position, normal_end, hash, small_chunk_mask, tables)){
+        rollUntilBoundary(bytes, position, end, hash, large_chunk_mask, tables);
+    }
+    return position;
+}
+
+size_t findChunkSize(const char* data, const size_t size, const ChunkingMode chunking_mode, const ChunkingParameters& parameters) noexcept{
+    if (chunking_mode == ChunkingMode::CONTENT_DEFINED){
+        return findChunkBoundary(data, size, parameters);
+    }
+    return std::min(size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+}
+
+size_t getMaxChunkSize(const ChunkingMode chunking_mode, const ChunkingParameters& parameters) noexcept{
+    return chunking_mode == ChunkingMode::CONTENT_DEFINED ? parameters.max_size : MAX_DATA_BLOCK_SIZE;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/* Splitting of written data into data blocks.
+
+   - FIXED_SIZE cuts the data every `MAX_DATA_BLOCK_SIZE` bytes. It is the fastest, but inserting or removing a byte
+     moves every following boundary, so none of the following blocks match the blocks stored before the edit.
+   - CONTENT_DEFINED (FastCDC) cuts where a Gear rolling hash of the last bytes matches a mask. The boundaries depend on
+     the content around them only, so after an edit they fall back in step with the old ones within a block or two,
+     and the rest of the blocks are deduplicated. Chunks are `min_size` to `max_size` bytes, `avg_size` on average;
+     normalized chunking (a harder mask before `avg_size`, an easier one after it) keeps the sizes close to the average.
+   The Gear table is a fixed function of the byte values, so the same data is chunked the same way on every machine. */
+
+enum class ChunkingMode{
+    FIXED_SIZE,         /* every block but the last has MAX_DATA_BLOCK_SIZE bytes */
+    CONTENT_DEFINED     /* block boundaries are chosen by the content (FastCDC) */
+};
+
+struct ChunkingParameters{
+    size_t min_size = 1024;                 /* no boundary is looked for before this many bytes */
+    size_t avg_size = 2048;                 /* expected chunk size, a power of two */
+    size_t max_size = MAX_DATA_BLOCK_SIZE;  /* a chunk is cut here if no boundary has been found */
+};
+
+/** Check that chunks of the given sizes fit into data blocks.
+ * @throw `std::invalid_argument` unless `0 < min_size <= avg_size <= max_size <= MAX_DATA_BLOCK_SIZE`
+ * and `avg_size` is a power of two.
+*/
+void checkChunkingParameters(const ChunkingParameters& parameters);
+
+/** Find where the first content-defined chunk of a buffer ends.
+ * @param[in] parameters chunk sizes, which must have passed `checkChunkingParameters()`
+ * @return the size of the chunk, between `min(size, min_size)` and `min(size, max_size)`.
+*/
+size_t findChunkBoundary(const char* data, const size_t size, const ChunkingParameters& parameters) noexcept;
+
+/** Find where the first chunk of a buffer ends.
+ * @param[in] chunking_mode cut at `MAX_DATA_BLOCK_SIZE` or where `findChunkBoundary()` finds a boundary
+ * @return the size of the chunk, at most `size`.
+*/
+size_t findChunkSize(const char* data, const size_t size, const ChunkingMode chunking_mode, const ChunkingParameters& parameters) noexcept;
+
+// Get the number of bytes a chunk can have at most, so a buffer holding fewer is not cut before the end of the data.
+size_t getMaxChunkSize(const ChunkingMode chunking_mode, const ChunkingParameters& parameters) noexcept;
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "block_manager.hpp"
+#include "chunking.hpp"
+
+namespace{
+    std::vector<char> makeRandomData(const size_t size, const unsigned seed = 42){
+        std::vector<char> data(size);
+        std::mt19937 generator(seed);
+        for (char& byte : data){
+            byte = static_cast<char>(generator());
+        }
+        return data;
+    }
+
+    // Count the blocks of `data` which are not among `known_blocks`.
+    size_t countNewBlocks(const std::vector<char>& data, const ChunkingMode chunking_mode, const std::set<size_t>& known_blocks){
+        size_t new_blocks_count = 0;
+        for (const DataBlock& dblock : BlockManager::createDataBlocks(data.data(), data.size(), chunking_mode)){
+            new_blocks_count += known_blocks.count(dblock.Hash()) == 0 ? 1 : 0;
+        }
+        return new_blocks_count;
+    }
+
+    std::set<size_t> collectBlocks(const std::vector<char>& data, const ChunkingMode chunking_mode){
+        std::set<size_t> block_hashes;
+        for (const DataBlock& dblock : BlockManager::createDataBlocks(data.data(), data.size(), chunking_mode)){
+            block_hashes.insert(dblock.Hash());
+        }
+        return block_hashes;
+    }
+}
+
+TEST(ChunkingHappyTests, ChunkSizesTest){
+    const std::vector<char> data = makeRandomData(1u << 20);
+    const ChunkingParameters parameters;
+    const std::vector<DataBlock> dblocks = BlockManager::createDataBlocks(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < dblocks.size(); ++i){
+        EXPECT_LE(dblocks[i].data_size, parameters.max_size);
+        if (i + 1 < dblocks.size()){
+            EXPECT_GE(dblocks[i].data_size, parameters.min_size);
+        }
+        ASSERT_EQ(std::memcmp(dblocks[i].data, data.data() + offset, dblocks[i].data_size), 0);
+        offset += dblocks[i].data_size;
+    }
+    EXPECT_EQ(offset, data.size());
+
+    // normalized chunking keeps the average close to the expected one
+    const size_t average_size = data.size() / dblocks.size();
+    EXPECT_GT(average_size, parameters.avg_size * 3 / 4);
+    EXPECT_LT(average_size, parameters.avg_size * 3 / 2);
+
+    // the boundaries only depend on the content
+    EXPECT_EQ(BlockManager::createDataBlocks(data.data(), data.size(), ChunkingMode::CONTENT_DEFINED).size(), dblocks.size());
+    EXPECT_EQ(findChunkBoundary(data.data(), 100, parameters), static_cast<size_t>(100));
+}
+
+TEST(ChunkingHappyTests, EditedDataDedupTest){
+    const std::vector<char> data = makeRandomData(1u << 20);
+    std::vector<char> edited_data = data;
+    edited_data.insert(edited_data.begin(), 'x');
+    edited_data[edited_data.size() / 2] ^= 0x01;
+    edited_data.erase(edited_data.begin() + 3 * edited_data.size() / 4, edited_data.begin() + 3 * edited_data.size() / 4 + 100);
+
+    // fixed offsets move after the inserted byte, so nothing is shared
+    const std::set<size_t> fixed_blocks = collectBlocks(data, ChunkingMode::FIXED_SIZE);
+    EXPECT_GT(countNewBlocks(edited_data, ChunkingMode::FIXED_SIZE, fixed_blocks), fixed_blocks.size() - 2);
+
+    // content-defined boundaries resynchronize right after every edit
+    const std::set<size_t> content_defined_blocks = collectBlocks(data, ChunkingMode::CONTENT_DEFINED);
+    EXPECT_LE(countNewBlocks(edited_data, ChunkingMode::CONTENT_DEFINED, content_defined_blocks), static_cast<size_t>(9));
+}
+
+TEST(ChunkingFailureTests, InvalidParametersTest){
+    EXPECT_NO_THROW(checkChunkingParameters(ChunkingParameters()));
+    EXPECT_THROW(checkChunkingParameters(ChunkingParameters{0, 2048, 4096}), std::invalid_argument);
+    EXPECT_THROW(checkChunkingParameters(ChunkingParameters{1024, 3000, 4096}), std::invalid_argument);
+    EXPECT_THROW(checkChunkingParameters(ChunkingParameters{1024, 512, 4096}), std::invalid_argument);
+    EXPECT_THROW(checkChunkingParameters(ChunkingParameters{1024, 2048, MAX_DATA_BLOCK_SIZE + 1}), std::invalid_argument);
+}
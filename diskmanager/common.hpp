@@ -6,24 +6,76 @@
 #include <string_view>
 #include <cstring>
 #include <utility>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 
-#define MAX_CACHED_BLOCKS_NUMBER 50          /* limit of cached data blocks */
+#include "fingerprint.hpp"
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#define DEFAULT_BUFFER_MEMORY_BUDGET (64u << 20) /* default number of bytes the block cache may use */
 #define MAX_DATA_BLOCK_SIZE 4096             /* maximum number of bytes a data block can have */
+#define DATA_BLOCK_ALIGNMENT 4096            /* alignment of block buffers, suitable for O_DIRECT I/O */
+
+struct AlignedBufferDeleter{
+    void operator()(char* buffer) const noexcept{
+#ifdef _MSC_VER
+        _aligned_free(buffer);
+#else
+        std::free(buffer);
+#endif
+    }
+};
+
+// A heap buffer aligned to `DATA_BLOCK_ALIGNMENT`.
+using AlignedBuffer = std::unique_ptr<char[], AlignedBufferDeleter>;
+
+/** Allocate a zero-initialized buffer aligned to `DATA_BLOCK_ALIGNMENT`.
+ * @param[in] size number of bytes to allocate, rounded up to a multiple of the alignment
+ * @throw `std::bad_alloc` if the memory cannot be allocated.
+*/
+static inline AlignedBuffer allocateAlignedBuffer(const size_t size){
+    const size_t aligned_size = std::max<size_t>((size + DATA_BLOCK_ALIGNMENT - 1) / DATA_BLOCK_ALIGNMENT, 1) * DATA_BLOCK_ALIGNMENT;
+#ifdef _MSC_VER
+    char* buffer = static_cast<char*>(_aligned_malloc(aligned_size, DATA_BLOCK_ALIGNMENT));
+#else
+    char* buffer = static_cast<char*>(std::aligned_alloc(DATA_BLOCK_ALIGNMENT, aligned_size));
+#endif
+    if (!buffer){
+        throw std::bad_alloc();
+    }
+    std::memset(buffer, 0x00, aligned_size);
+    return AlignedBuffer(buffer);
+}
 
 struct DataBlock{
-    DataBlock() noexcept{
+    DataBlock() noexcept : data_size(0){
         // clear the buffer
         std::memset(data, 0x00, MAX_DATA_BLOCK_SIZE);
     }
 
+    DataBlock(const DataBlock& other) noexcept : data_size(other.data_size){
+        std::memcpy(data, other.data, MAX_DATA_BLOCK_SIZE);
+    }
+
     DataBlock& operator=(const DataBlock& other){
         this->data_size = other.data_size;
         std::memcpy(this->data, other.data, MAX_DATA_BLOCK_SIZE);
         return *this;
     }
 
+    // Get the 128-bit fingerprint of the first `data_size` bytes; its high half is stored next to the key, see `Hash()`.
+    BlockFingerprint Fingerprint() const noexcept{
+        return computeFingerprint(data, data_size);
+    }
+
+    /* Get the 64-bit key the block is stored, cached and deduplicated under: the low 64 bits of its fingerprint.
+       The high bits are kept next to the key, so two blocks with the same key are told apart on a dedup hit. */
     size_t Hash() const noexcept{
-        return std::hash<std::string_view>{}(data);
+        return static_cast<size_t>(Fingerprint().low);
     }
 
     size_t data_size;
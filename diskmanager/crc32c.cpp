@@ -0,0 +1,137 @@
+#include "crc32c.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM_CRC32
+#endif
+
+namespace{
+    constexpr uint32_t CRC32C_POLYNOMIAL = 0x82f63b78;  /* Castagnoli, bit-reversed */
+
+    /* Table `k` gives the CRC of a byte followed by `k` zero bytes, so 8 bytes are folded with 8 lookups. */
+    struct SlicingTables{
+        SlicingTables() noexcept{
+            for (uint32_t byte = 0; byte < 256; ++byte){
+                uint32_t crc = byte;
+                for (int bit = 0; bit < 8; ++bit){
+                    crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32C_POLYNOMIAL : 0);
+                }
+                tables[0][byte] = crc;
+            }
+            for (size_t k = 1; k < 8; ++k){
+                for (size_t byte = 0; byte < 256; ++byte){
+                    tables[k][byte] = (tables[k - 1][byte] >> 8) ^ tables[0][tables[k - 1][byte] & 0xff];
+                }
+            }
+        }
+
+        uint32_t tables[8][256];
+    };
+
+    const SlicingTables& getSlicingTables() noexcept{
+        static const SlicingTables slicing_tables;
+        return slicing_tables;
+    }
+
+    // Read 4 bytes as a little-endian number, whatever the byte order of the CPU.
+    uint32_t loadLittleEndian32(const unsigned char* bytes) noexcept{
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16
+            | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+#ifdef CRC32C_X86_SSE42
+    __attribute__((target("sse4.2"))) uint32_t computeCrc32cSse42(const char* data, size_t size, uint32_t crc) noexcept{
+        // x86 is little-endian, so the words are fed in the byte order of the buffer
+        uint64_t wide_crc = crc;
+        while (size >= sizeof(uint64_t)){
+            uint64_t word = 0;
+            std::memcpy(&word, data, sizeof(word));
+            wide_crc = _mm_crc32_u64(wide_crc, word);
+            data += sizeof(word);
+            size -= sizeof(word);
+        }
+        crc = static_cast<uint32_t>(wide_crc);
+        while (size > 0){
+            crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data));
+            ++data;
+            --size;
+        }
+        return crc;
+    }
+
+    bool hasCrc32cInstructions() noexcept{
+        return __builtin_cpu_supports("sse4.2");
+    }
+#elif defined(CRC32C_ARM_CRC32)
+    uint32_t computeCrc32cArm(const char* data, size_t size, uint32_t crc) noexcept{
+        while (size >= sizeof(uint64_t)){
+            uint64_t word = 0;
+            std::memcpy(&word, data, sizeof(word));
+            crc = __crc32cd(crc, word);
+            data += sizeof(word);
+            size -= sizeof(word);
+        }
+        while (size > 0){
+            crc = __crc32cb(crc, static_cast<uint8_t>(*data));
+            ++data;
+            --size;
+        }
+        return crc;
+    }
+#endif
+
+    // Both ends of the CRC are inverted outside of the kernels, so they chain the same way.
+    using Crc32cKernel = uint32_t (*)(const char*, size_t, uint32_t) noexcept;
+
+    uint32_t computeCrc32cSlicing(const char* data, size_t size, uint32_t crc) noexcept{
+        const auto& tables = getSlicingTables().tables;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+        while (size >= 8){
+            const uint32_t low = loadLittleEndian32(bytes) ^ crc;
+            const uint32_t high = loadLittleEndian32(bytes + 4);
+            crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^ tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24]
+                ^ tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff] ^ tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+            bytes += 8;
+            size -= 8;
+        }
+        while (size > 0){
+            crc = (crc >> 8) ^ tables[0][(crc ^ *bytes) & 0xff];
+            ++bytes;
+            --size;
+        }
+        return crc;
+    }
+
+    Crc32cKernel selectCrc32cKernel() noexcept{
+#ifdef CRC32C_X86_SSE42
+        if (hasCrc32cInstructions()){
+            return computeCrc32cSse42;
+        }
+#elif defined(CRC32C_ARM_CRC32)
+        return computeCrc32cArm;
+#endif
+        return computeCrc32cSlicing;
+    }
+
+    Crc32cKernel getCrc32cKernel() noexcept{
+        static const Crc32cKernel kernel = selectCrc32cKernel();
+        return kernel;
+    }
+}
+
+uint32_t computeCrc32c(const char* data, const size_t size, const uint32_t crc) noexcept{
+    return ~getCrc32cKernel()(data, size, ~crc);
+}
+
+uint32_t computeCrc32cPortable(const char* data, const size_t size, const uint32_t crc) noexcept{
+    return ~computeCrc32cSlicing(data, size, ~crc);
+}
+
+bool isCrc32cHardwareAccelerated() noexcept{
+    return getCrc32cKernel() != computeCrc32cSlicing;
+}
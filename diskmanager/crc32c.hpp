@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* CRC32C (Castagnoli) checksums of data blocks.
+
+   - On x86-64 CPUs with SSE4.2 the `crc32` instruction checksums 8 bytes per instruction; the CPU is checked once at runtime.
+   - On ARMv8 the CRC32 extension is used when the compiler targets it (e.g. `-march=armv8-a+crc`, every Apple CPU).
+   - Everywhere else a table-driven slicing-by-8 version is used, which processes 8 bytes per step as well.
+   All versions give the same results, so checksums stored on one machine are verified on any other. */
+
+/** Compute the CRC32C of a buffer.
+ * @param[in] crc the CRC32C of the preceding bytes, so a checksum can be computed piece by piece; `0` to start a new one
+ * @return the CRC32C of the preceding bytes followed by the buffer.
+*/
+uint32_t computeCrc32c(const char* data, const size_t size, const uint32_t crc = 0) noexcept;
+
+// The slicing-by-8 version `computeCrc32c()` falls back to if the CPU has no CRC32C instructions.
+uint32_t computeCrc32cPortable(const char* data, const size_t size, const uint32_t crc = 0) noexcept;
+
+// Check whether `computeCrc32c()` uses the CRC32C instructions of the CPU.
+bool isCrc32cHardwareAccelerated() noexcept;
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "crc32c.hpp"
+
+using namespace std::string_literals;
+
+TEST(Crc32cHappyTests, KnownValuesTest){
+    // check values of RFC 3720 (iSCSI), which uses CRC32C
+    const std::string digits = "123456789"s;
+    EXPECT_EQ(computeCrc32c(digits.data(), digits.size()), 0xe3069283u);
+    EXPECT_EQ(computeCrc32cPortable(digits.data(), digits.size()), 0xe3069283u);
+
+    const std::vector<char> zeros(32, 0);
+    EXPECT_EQ(computeCrc32c(zeros.data(), zeros.size()), 0x8a9136aau);
+    const std::vector<char> ones(32, static_cast<char>(0xff));
+    EXPECT_EQ(computeCrc32c(ones.data(), ones.size()), 0x62a8ab43u);
+    EXPECT_EQ(computeCrc32c(nullptr, 0), 0u);
+}
+
+TEST(Crc32cHappyTests, PortableMatchesAcceleratedTest){
+    std::vector<char> data(3 * 4096 + 13);
+    std::mt19937 generator(42);
+    for (char& byte : data){
+        byte = static_cast<char>(generator());
+    }
+
+    // every alignment and length of the tail goes through the word loop and the byte loop
+    for (size_t offset = 0; offset < 16; ++offset){
+        for (const size_t size : {size_t{0}, size_t{1}, size_t{7}, size_t{8}, size_t{9}, size_t{4096}, data.size() - offset}){
+            EXPECT_EQ(computeCrc32c(data.data() + offset, size), computeCrc32cPortable(data.data() + offset, size));
+        }
+    }
+
+    // a checksum computed piece by piece is the checksum of the whole buffer
+    const uint32_t whole_crc = computeCrc32c(data.data(), data.size());
+    const uint32_t head_crc = computeCrc32c(data.data(), 1000);
+    EXPECT_EQ(computeCrc32c(data.data() + 1000, data.size() - 1000, head_crc), whole_crc);
+    EXPECT_EQ(computeCrc32cPortable(data.data() + 1000, data.size() - 1000, head_crc), whole_crc);
+
+    // a flipped bit changes it
+    data[2000] ^= 0x10;
+    EXPECT_NE(computeCrc32c(data.data(), data.size()), whole_crc);
+}
@@ -0,0 +1,294 @@
+#include "duckdb_block_store.hpp"
+
+#include <unordered_set>
+
+using namespace std::string_literals;
+
+DuckDBBlockStore::DuckDBBlockStore(duckdb::DuckDB& db_obj)
+    : db_(db_obj){
+    duckdb::Connection conn(db_);
+    // seq_no keeps the write order; blocks are appended in that order, so range scans over it are cheap
+    auto res = conn.Query("CREATE TABLE IF NOT EXISTS blocks (block_id UBIGINT, data BLOB, data_size UINTEGER, seq_no UBIGINT, "
+                          "checksum UINTEGER, fingerprint_high UBIGINT, PRIMARY KEY(block_id));");
+    if (res->HasError()){
+        throw std::runtime_error("Failed to create the blocks table: "s + res->GetError());
+    }
+    migrateBlocksTable(conn);
+    // the first connection is opened now, so a broken schema is reported by the constructor
+    releaseConnection(acquireConnection());
+}
+
+void DuckDBBlockStore::writeBlocks(const std::vector<StoredDataBlock>& dblocks){
+    if (dblocks.empty()){
+        return;
+    }
+
+    ConnectionLease lease(*this);
+    if (dblocks.size() == 1){
+        persistDataBlock(*lease->insert_statement, dblocks.front());
+        return;
+    }
+
+    try{
+        lease->conn->BeginTransaction();
+        if (dblocks.size() < BULK_INSERT_MIN_BLOCKS){
+            for (const StoredDataBlock& stored_block : dblocks){
+                persistDataBlock(*lease->insert_statement, stored_block);
+            }
+        } else{
+            persistDataBlocks(*lease->conn, dblocks);
+        }
+        lease->conn->Commit();
+    } catch (const std::exception&){
+        if (lease->conn->HasActiveTransaction()){
+            lease->conn->Rollback();
+        }
+        throw;
+    }
+}
+
+std::vector<StoredDataBlock> DuckDBBlockStore::readBlocks(const std::vector<size_t>& block_hashes){
+    if (block_hashes.empty()){
+        return {};
+    }
+
+    std::string condition = "block_id IN ("s;
+    for (size_t i = 0; i < block_hashes.size(); ++i){
+        if (i != 0){
+            condition += ", "s;
+        }
+        condition += std::to_string(block_hashes[i]);
+    }
+    ConnectionLease lease(*this);
+    return fetchDataBlocks(*lease->conn, condition + ")"s);
+}
+
+std::vector<StoredDataBlock> DuckDBBlockStore::readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no){
+    if (first_seq_no >= last_seq_no){
+        return {};
+    }
+
+    ConnectionLease lease(*this);
+    return fetchDataBlocks(*lease->conn, "seq_no >= "s + std::to_string(first_seq_no) + " AND seq_no < "s + std::to_string(last_seq_no));
+}
+
+uint64_t DuckDBBlockStore::getNextSeqNo(){
+    ConnectionLease lease(*this);
+    auto res = lease->conn->Query("SELECT COALESCE(MAX(seq_no) + 1, 0) FROM blocks;");
+    return res->HasError() ? 0 : res->GetValue(0, 0).GetValue<uint64_t>();
+}
+
+std::vector<StoredBlockKey> DuckDBBlockStore::listBlockKeys(){
+    ConnectionLease lease(*this);
+    auto res = lease->conn->Query("SELECT block_id, fingerprint_high FROM blocks;");
+    if (res->HasError()){
+        throw std::runtime_error("Failed to list data blocks of the database file: "s + res->GetError());
+    }
+    std::vector<StoredBlockKey> block_keys(res->RowCount());
+    for (size_t row = 0; row < res->RowCount(); ++row){
+        block_keys[row].block_hash = res->GetValue(0, row).GetValue<uint64_t>();
+        block_keys[row].fingerprint_high = res->GetValue(1, row).IsNull() ? 0 : res->GetValue(1, row).GetValue<uint64_t>();
+    }
+    return block_keys;
+}
+
+size_t DuckDBBlockStore::removeBlocks(const std::vector<size_t>& block_hashes){
+    if (block_hashes.empty()){
+        return 0;
+    }
+
+    std::string query = "DELETE FROM blocks WHERE block_id IN ("s;
+    for (size_t i = 0; i < block_hashes.size(); ++i){
+        if (i != 0){
+            query += ", "s;
+        }
+        query += std::to_string(block_hashes[i]);
+    }
+    ConnectionLease lease(*this);
+    auto res = lease->conn->Query(query + ");"s);
+    if (res->HasError()){
+        throw std::runtime_error("Failed to remove data blocks from the database file: "s + res->GetError());
+    }
+    // DELETE reports the number of deleted rows
+    return static_cast<size_t>(res->GetValue(0, 0).GetValue<int64_t>());
+}
+
+void DuckDBBlockStore::sync(){
+}
+
+DuckDBBlockStore::ConnectionLease::ConnectionLease(DuckDBBlockStore& store)
+    : store_(store), pooled_conn_(store.acquireConnection()){
+}
+
+DuckDBBlockStore::ConnectionLease::~ConnectionLease(){
+    store_.releaseConnection(std::move(pooled_conn_));
+}
+
+std::unique_ptr<DuckDBBlockStore::PooledConnection> DuckDBBlockStore::acquireConnection(){
+    {
+        std::lock_guard<std::mutex> guard(pool_latch_);
+        if (!idle_connections_.empty()){
+            std::unique_ptr<PooledConnection> pooled_conn = std::move(idle_connections_.back());
+            idle_connections_.pop_back();
+            return pooled_conn;
+        }
+    }
+
+    auto pooled_conn = std::make_unique<PooledConnection>();
+    pooled_conn->conn = std::make_unique<duckdb::Connection>(db_);
+    pooled_conn->insert_statement = prepareInsertStatement(*pooled_conn->conn);
+    return pooled_conn;
+}
+
+void DuckDBBlockStore::releaseConnection(std::unique_ptr<PooledConnection> pooled_conn) noexcept{
+    if (!pooled_conn){
+        return;
+    }
+    std::lock_guard<std::mutex> guard(pool_latch_);
+    try{
+        idle_connections_.push_back(std::move(pooled_conn));
+    } catch (const std::exception&){
+        // the connection is closed instead of being kept
+    }
+}
+
+void DuckDBBlockStore::migrateBlocksTable(duckdb::Connection& conn){
+    auto res = conn.Query("SELECT data_type FROM information_schema.columns WHERE table_name = 'blocks' AND column_name = 'data';");
+    if (res->HasError() || res->RowCount() == 0 || res->GetValue(0, 0).ToString() == "BLOB"){
+        addMissingColumns(conn);
+        return;
+    }
+
+    // older files keep the payload padded to the full block in a VARCHAR and have no size (nor, the oldest ones, a seq_no);
+    // the padding is stripped and the rows are rewritten in the write order. The padding cannot be told from NUL bytes
+    // the data ended with, so those are lost: the migration is lossy for such rows
+    const std::string migration_steps[] = {
+        "BEGIN TRANSACTION;",
+        "ALTER TABLE blocks ADD COLUMN IF NOT EXISTS seq_no UBIGINT;",
+        "CREATE TABLE blocks_migrated (block_id UBIGINT, data BLOB, data_size UINTEGER, seq_no UBIGINT, PRIMARY KEY(block_id));",
+        "INSERT INTO blocks_migrated SELECT block_id::UBIGINT, encode(rtrim(data, chr(0))), octet_length(encode(rtrim(data, chr(0)))), seq_no "
+        "FROM blocks ORDER BY seq_no;",
+        "DROP TABLE blocks;",
+        "ALTER TABLE blocks_migrated RENAME TO blocks;",
+        "COMMIT;"
+    };
+    for (const std::string& step : migration_steps){
+        res = conn.Query(step);
+        if (res->HasError()){
+            const std::string error = res->GetError();
+            if (conn.HasActiveTransaction()){
+                conn.Rollback();
+            }
+            throw std::runtime_error("Failed to migrate the blocks table to the BLOB schema: "s + error);
+        }
+    }
+    addMissingColumns(conn);
+}
+
+void DuckDBBlockStore::addMissingColumns(duckdb::Connection& conn){
+    // the rows written before have a NULL checksum, which is read as 0 and never verified
+    auto res = conn.Query("ALTER TABLE blocks ADD COLUMN IF NOT EXISTS checksum UINTEGER;");
+    if (res->HasError()){
+        throw std::runtime_error("Failed to add the checksum column to the blocks table: "s + res->GetError());
+    }
+    // and a NULL high half of the fingerprint, which is listed as 0 and never compared
+    res = conn.Query("ALTER TABLE blocks ADD COLUMN IF NOT EXISTS fingerprint_high UBIGINT;");
+    if (res->HasError()){
+        throw std::runtime_error("Failed to add the fingerprint_high column to the blocks table: "s + res->GetError());
+    }
+}
+
+duckdb::Value DuckDBBlockStore::makeBlobValue(const DataBlock& dblock){
+    // only the meaningful bytes are stored, the padding is restored from data_size on read
+    return duckdb::Value::BLOB(reinterpret_cast<duckdb::const_data_ptr_t>(dblock.data), std::min(dblock.data_size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE)));
+}
+
+uint32_t DuckDBBlockStore::makeChecksum(const DataBlock& dblock) noexcept{
+    return computeBlockChecksum(dblock.data, std::min(dblock.data_size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE)));
+}
+
+duckdb::unique_ptr<duckdb::PreparedStatement> DuckDBBlockStore::prepareInsertStatement(duckdb::Connection& conn){
+    // blocks are addressed by their contents, so a block which is already stored is the same block
+    auto statement = conn.Prepare("INSERT OR IGNORE INTO blocks (block_id, data, data_size, seq_no, checksum, fingerprint_high) "
+                                  "VALUES ($1, $2, $3, $4, $5, $6);");
+    if (statement->HasError()){
+        throw std::runtime_error("Failed to prepare the data block INSERT: "s + statement->GetError());
+    }
+    return statement;
+}
+
+void DuckDBBlockStore::persistDataBlock(duckdb::PreparedStatement& insert_statement, const StoredDataBlock& stored_block){
+    auto res = insert_statement.Execute(duckdb::Value::UBIGINT(stored_block.block_hash), makeBlobValue(stored_block.dblock),
+                                        duckdb::Value::UINTEGER(static_cast<uint32_t>(stored_block.dblock.data_size)),
+                                        duckdb::Value::UBIGINT(stored_block.seq_no), duckdb::Value::UINTEGER(makeChecksum(stored_block.dblock)),
+                                        duckdb::Value::UBIGINT(stored_block.fingerprint_high));
+    if (res->HasError()){
+        throw std::runtime_error("Failed to insert data block to the database file: "s + res->GetError());
+    }
+}
+
+void DuckDBBlockStore::persistDataBlocks(duckdb::Connection& conn, const std::vector<StoredDataBlock>& dblocks){
+    if (dblocks.empty()){
+        return;
+    }
+
+    // the Appender cannot skip conflicting rows, so the blocks which are already stored are filtered out first
+    std::string query = "SELECT block_id FROM blocks WHERE block_id IN ("s;
+    for (size_t i = 0; i < dblocks.size(); ++i){
+        if (i != 0){
+            query += ", "s;
+        }
+        query += std::to_string(dblocks[i].block_hash);
+    }
+    auto res = conn.Query(query + ");"s);
+    if (res->HasError()){
+        throw std::runtime_error("Failed to insert data blocks to the database file: "s + res->GetError());
+    }
+    std::unordered_set<size_t> skipped_hashes;
+    for (size_t row = 0; row < res->RowCount(); ++row){
+        skipped_hashes.insert(res->GetValue(0, row).GetValue<uint64_t>());
+    }
+
+    try{
+        duckdb::Appender appender(conn, "blocks");
+        for (const StoredDataBlock& stored_block : dblocks){
+            // a batch may carry the same block twice
+            if (!skipped_hashes.insert(stored_block.block_hash).second){
+                continue;
+            }
+            appender.BeginRow();
+            appender.Append<uint64_t>(stored_block.block_hash);
+            appender.Append<duckdb::Value>(makeBlobValue(stored_block.dblock));
+            appender.Append<uint32_t>(static_cast<uint32_t>(stored_block.dblock.data_size));
+            appender.Append<uint64_t>(stored_block.seq_no);
+            appender.Append<uint32_t>(makeChecksum(stored_block.dblock));
+            appender.Append<uint64_t>(stored_block.fingerprint_high);
+            appender.EndRow();
+        }
+        appender.Close();
+    } catch (const std::exception& e){
+        throw std::runtime_error("Failed to insert data blocks to the database file: "s + e.what());
+    }
+}
+
+std::vector<StoredDataBlock> DuckDBBlockStore::fetchDataBlocks(duckdb::Connection& conn, const std::string& condition){
+    auto res = conn.Query("SELECT block_id, seq_no, data, data_size, checksum FROM blocks WHERE "s + condition + ";"s);
+    if (res->HasError()){
+        throw std::runtime_error("Failed to read data blocks from the database file: "s + res->GetError());
+    }
+
+    std::vector<StoredDataBlock> loaded_blocks(res->RowCount());
+    for (size_t row = 0; row < res->RowCount(); ++row){
+        StoredDataBlock& loaded_block = loaded_blocks[row];
+        loaded_block.block_hash = res->GetValue(0, row).GetValue<uint64_t>();
+        loaded_block.seq_no = res->GetValue(1, row).IsNull() ? 0 : res->GetValue(1, row).GetValue<uint64_t>();
+        loaded_block.checksum = res->GetValue(4, row).IsNull() ? 0 : res->GetValue(4, row).GetValue<uint32_t>();
+        // the string lives in the value, so the value is kept alive while it is copied
+        const duckdb::Value data_value = res->GetValue(2, row);
+        const std::string& data = duckdb::StringValue::Get(data_value);
+        loaded_block.dblock.data_size = std::min({data.size(), static_cast<size_t>(MAX_DATA_BLOCK_SIZE),
+                                                  static_cast<size_t>(res->GetValue(3, row).GetValue<uint32_t>())});
+        std::memcpy(loaded_block.dblock.data, data.data(), loaded_block.dblock.data_size);
+    }
+    return loaded_blocks;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "include/duckdb.hpp"
+#include "block_store.hpp"
+
+/* Block storage in a `blocks` table of a DuckDB database:
+   `blocks (block_id UBIGINT, data BLOB, data_size UINTEGER, seq_no UBIGINT, PRIMARY KEY(block_id))`.
+   Connections must not be shared between threads, so every call borrows one from a small pool. */
+class DuckDBBlockStore : public BlockStore{
+public:
+    /** Open the block storage in the database. A blocks table of the old VARCHAR schema is migrated, see `migrateBlocksTable()`.
+     * @param[in] db_obj a reference to the database object; it must outlive the store
+     * @throw `std::runtime_error` if the blocks table cannot be created or migrated.
+    */
+    explicit DuckDBBlockStore(duckdb::DuckDB& db_obj);
+
+    DuckDBBlockStore(const DuckDBBlockStore&) = delete;
+    DuckDBBlockStore& operator=(const DuckDBBlockStore&) = delete;
+
+public:
+    // Writes the batch in one transaction. Small batches go through the prepared INSERT, larger ones through an Appender.
+    void writeBlocks(const std::vector<StoredDataBlock>& dblocks) override;
+
+    std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) override;
+
+    std::vector<StoredDataBlock> readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no) override;
+
+    uint64_t getNextSeqNo() override;
+
+    // Reads only the key columns.
+    std::vector<StoredBlockKey> listBlockKeys() override;
+
+    // DuckDB reuses the space of deleted rows once it checkpoints.
+    size_t removeBlocks(const std::vector<size_t>& block_hashes) override;
+
+    // Every committed transaction is in the database's WAL already, so there is nothing to do.
+    void sync() override;
+
+private:
+    /* A connection together with the statements prepared on it. */
+    struct PooledConnection{
+        std::unique_ptr<duckdb::Connection> conn;
+        duckdb::unique_ptr<duckdb::PreparedStatement> insert_statement;
+    };
+
+    /* Returns the borrowed connection to the pool when it goes out of scope. */
+    class ConnectionLease{
+    public:
+        explicit ConnectionLease(DuckDBBlockStore& store);
+        ~ConnectionLease();
+
+        PooledConnection* operator->() noexcept{ return pooled_conn_.get(); }
+
+    private:
+        DuckDBBlockStore& store_;
+        std::unique_ptr<PooledConnection> pooled_conn_;
+    };
+
+    /** Take an idle connection from the pool or open a new one.
+     * @throw `std::runtime_error` if the INSERT cannot be prepared on a new connection.
+    */
+    std::unique_ptr<PooledConnection> acquireConnection();
+
+    void releaseConnection(std::unique_ptr<PooledConnection> pooled_conn) noexcept;
+
+    /** Converts a blocks table of the old schema (padded VARCHAR payloads) to BLOB payloads with an explicit size,
+     * and adds the columns it lacks with `addMissingColumns()`.
+     * The old rows have no size, so it is taken to end at the last non-NUL byte. This is lossy: a payload which ended
+     * with NUL bytes is shortened, and its fingerprint no longer matches its key.
+     * @throw `std::runtime_error` if the migration fails; the table is left unchanged then.
+    */
+    static void migrateBlocksTable(duckdb::Connection& conn);
+
+    /** Adds the checksum and the fingerprint_high columns to a blocks table created before they were stored.
+     * @throw `std::runtime_error` if a column cannot be added.
+    */
+    static void addMissingColumns(duckdb::Connection& conn);
+
+    // Get the meaningful bytes of a block as a BLOB parameter.
+    static duckdb::Value makeBlobValue(const DataBlock& dblock);
+
+    // Get the checksum stored with a block.
+    static uint32_t makeChecksum(const DataBlock& dblock) noexcept;
+
+    /** Prepares the INSERT of a single data block once per connection.
+     * @throw `std::runtime_error` if the statement cannot be prepared.
+    */
+    static duckdb::unique_ptr<duckdb::PreparedStatement> prepareInsertStatement(duckdb::Connection& conn);
+
+    /** Runs the prepared INSERT of a data block.
+     * @throw `std::runtime_error` on fail to insert the data to the database.
+    */
+    static void persistDataBlock(duckdb::PreparedStatement& insert_statement, const StoredDataBlock& stored_block);
+
+    /** Bulk-loads data blocks through an Appender. Blocks which are already stored are skipped.
+     * Should run inside a transaction, so a failed batch leaves nothing behind.
+     * @throw `std::runtime_error` on fail to insert the data to the database.
+    */
+    static void persistDataBlocks(duckdb::Connection& conn, const std::vector<StoredDataBlock>& dblocks);
+
+    /** Runs one SELECT of blocks and collects the rows.
+     * @param[in] condition the WHERE clause
+     * @throw `std::runtime_error` on fail to read the database.
+    */
+    static std::vector<StoredDataBlock> fetchDataBlocks(duckdb::Connection& conn, const std::string& condition);
+
+private:
+    static constexpr size_t BULK_INSERT_MIN_BLOCKS = 8;                   /* Smaller batches use the prepared INSERT */
+
+    duckdb::DuckDB& db_;
+    std::mutex pool_latch_;
+    std::vector<std::unique_ptr<PooledConnection>> idle_connections_;
+};
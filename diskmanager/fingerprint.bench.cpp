@@ -0,0 +1,61 @@
+#include "common.hpp"
+#include "fingerprint.hpp"
+#include "crc32c.hpp"
+#include "bench_common.hpp"
+
+#include <functional>
+#include <string_view>
+
+/* Measures hashing throughput on a single core, in GB/s, for inputs from a few bytes up to many blocks:
+   - the block fingerprint with the instruction set the CPU supports and with the scalar fallback;
+   - `std::hash<std::string_view>`, which the block keys were computed with before;
+   - CRC32C, which every stored block is checksummed with.
+   Every size hashes `total_mb` of data, cycling through a buffer that fits in the L2 cache.
+   Usage: FingerprintBenchmark [total_mb = 1024] */
+
+namespace{
+    constexpr size_t BUFFER_SIZE = 256u << 10;
+
+    // Hash `total_bytes` in pieces of `input_size` bytes and return the throughput in GB/s.
+    template <typename HashFunction>
+    double measureThroughput(const std::vector<char>& buffer, const size_t input_size, const size_t total_bytes, HashFunction&& hash){
+        const size_t inputs_per_buffer = buffer.size() / input_size;
+        const size_t inputs_count = std::max(total_bytes / input_size, static_cast<size_t>(1));
+        const double ns_per_input = measureNsPerOp(inputs_count, [&](const size_t i){
+            doNotOptimize(hash(buffer.data() + (i % inputs_per_buffer) * input_size, input_size));
+        });
+        return static_cast<double>(input_size) / ns_per_input;
+    }
+}
+
+int main(int argc, char** argv){
+    const size_t total_bytes = readSizeArgument(argc, argv, 1, 1'024) << 20;
+    std::vector<char> buffer(BUFFER_SIZE);
+    std::mt19937 generator(42);
+    for (char& byte : buffer){
+        byte = static_cast<char>(generator());
+    }
+
+    std::cout << "fingerprint instruction set: " << getFingerprintInstructionSet()
+              << ", CRC32C instructions: " << (isCrc32cHardwareAccelerated() ? "yes" : "no") << std::endl;
+    std::cout << std::setw(10) << "bytes" << std::setw(16) << "xxh3-128 GB/s" << std::setw(16) << "scalar GB/s"
+              << std::setw(16) << "std::hash GB/s" << std::setw(16) << "crc32c GB/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const size_t input_size : {size_t{16}, size_t{64}, size_t{240}, size_t{1'024}, size_t{MAX_DATA_BLOCK_SIZE}, size_t{64u << 10}}){
+        const double fingerprint_rate = measureThroughput(buffer, input_size, total_bytes, [](const char* data, const size_t size){
+            return computeFingerprint(data, size).low;
+        });
+        const double portable_rate = measureThroughput(buffer, input_size, total_bytes, [](const char* data, const size_t size){
+            return computeFingerprintPortable(data, size).low;
+        });
+        const double std_hash_rate = measureThroughput(buffer, input_size, total_bytes, [](const char* data, const size_t size){
+            return std::hash<std::string_view>{}(std::string_view(data, size));
+        });
+        const double crc_rate = measureThroughput(buffer, input_size, total_bytes, [](const char* data, const size_t size){
+            return computeCrc32c(data, size);
+        });
+        std::cout << std::setw(10) << input_size << std::setw(16) << fingerprint_rate << std::setw(16) << portable_rate
+                  << std::setw(16) << std_hash_rate << std::setw(16) << crc_rate << std::endl;
+    }
+}
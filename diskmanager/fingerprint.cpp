@@ -0,0 +1,385 @@
+#include "fingerprint.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FINGERPRINT_X86_SIMD
+#endif
+
+namespace{
+    constexpr uint32_t PRIME32_1 = 0x9e3779b1u;
+    constexpr uint32_t PRIME32_2 = 0x85ebca77u;
+    constexpr uint32_t PRIME32_3 = 0xc2b2ae3du;
+    constexpr uint64_t PRIME64_1 = 0x9e3779b185ebca87ull;
+    constexpr uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+    constexpr uint64_t PRIME64_3 = 0x165667b19e3779f9ull;
+    constexpr uint64_t PRIME64_4 = 0x85ebca77c2b2ae63ull;
+    constexpr uint64_t PRIME64_5 = 0x27d4eb2f165667c5ull;
+    constexpr uint64_t PRIME_MX1 = 0x165667919e3779f9ull;
+    constexpr uint64_t PRIME_MX2 = 0x9fb21c651e98df25ull;
+
+    constexpr size_t SECRET_SIZE = 192;
+    constexpr size_t STRIPE_LENGTH = 64;         /* bytes folded into the accumulators at once */
+    constexpr size_t SECRET_CONSUME_RATE = 8;    /* secret bytes the next stripe is shifted by */
+    constexpr size_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_LENGTH) / SECRET_CONSUME_RATE;
+    constexpr size_t HASH_BLOCK_LENGTH = STRIPE_LENGTH * STRIPES_PER_BLOCK;  /* bytes between two scrambles */
+    constexpr size_t SECRET_LAST_STRIPE_START = 7;
+    constexpr size_t SECRET_MERGE_START = 11;
+    constexpr size_t MIDSIZE_START_OFFSET = 3;
+    constexpr size_t MIDSIZE_LAST_OFFSET = 17;
+    constexpr size_t SECRET_SIZE_MIN = 136;
+    constexpr size_t MIDSIZE_MAX = 240;          /* longer inputs are hashed in stripes */
+
+    // The default secret of XXH3, taken from FARSH.
+    alignas(64) constexpr unsigned char SECRET[SECRET_SIZE] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+        0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+        0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+        0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+        0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+        0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+        0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+        0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+        0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+        0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+        0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+        0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+    };
+
+    // Read 4 bytes as a little-endian number, whatever the byte order of the CPU.
+    uint32_t loadLittleEndian32(const unsigned char* bytes) noexcept{
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16
+            | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+    uint64_t loadLittleEndian64(const unsigned char* bytes) noexcept{
+        return static_cast<uint64_t>(loadLittleEndian32(bytes)) | static_cast<uint64_t>(loadLittleEndian32(bytes + 4)) << 32;
+    }
+
+    uint32_t swapBytes32(const uint32_t value) noexcept{
+        return (value << 24) | ((value << 8) & 0x00ff0000u) | ((value >> 8) & 0x0000ff00u) | (value >> 24);
+    }
+
+    uint64_t swapBytes64(const uint64_t value) noexcept{
+        return static_cast<uint64_t>(swapBytes32(static_cast<uint32_t>(value))) << 32 | swapBytes32(static_cast<uint32_t>(value >> 32));
+    }
+
+    uint32_t rotateLeft32(const uint32_t value, const int shift) noexcept{
+        return (value << shift) | (value >> (32 - shift));
+    }
+
+    uint64_t multiply32To64(const uint64_t lhs, const uint64_t rhs) noexcept{
+        return static_cast<uint64_t>(static_cast<uint32_t>(lhs)) * static_cast<uint64_t>(static_cast<uint32_t>(rhs));
+    }
+
+    BlockFingerprint multiply64To128(const uint64_t lhs, const uint64_t rhs) noexcept{
+#ifdef __SIZEOF_INT128__
+        const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+        return BlockFingerprint{static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+        const uint64_t lo_lo = multiply32To64(lhs, rhs);
+        const uint64_t hi_lo = multiply32To64(lhs >> 32, rhs);
+        const uint64_t lo_hi = multiply32To64(lhs, rhs >> 32);
+        const uint64_t hi_hi = multiply32To64(lhs >> 32, rhs >> 32);
+        const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffu) + lo_hi;
+        return BlockFingerprint{(cross << 32) | (lo_lo & 0xffffffffu), (hi_lo >> 32) + (cross >> 32) + hi_hi};
+#endif
+    }
+
+    uint64_t multiplyFold64(const uint64_t lhs, const uint64_t rhs) noexcept{
+        const BlockFingerprint product = multiply64To128(lhs, rhs);
+        return product.low ^ product.high;
+    }
+
+    uint64_t avalancheXxh64(uint64_t hash) noexcept{
+        hash ^= hash >> 33;
+        hash *= PRIME64_2;
+        hash ^= hash >> 29;
+        hash *= PRIME64_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    uint64_t avalanche(uint64_t hash) noexcept{
+        hash ^= hash >> 37;
+        hash *= PRIME_MX1;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    /* Inputs of up to 240 bytes. */
+
+    BlockFingerprint hash1To3(const unsigned char* input, const size_t size) noexcept{
+        const uint32_t combined_low = static_cast<uint32_t>(input[0]) << 16 | static_cast<uint32_t>(input[size >> 1]) << 24
+            | static_cast<uint32_t>(input[size - 1]) | static_cast<uint32_t>(size) << 8;
+        const uint32_t combined_high = rotateLeft32(swapBytes32(combined_low), 13);
+        const uint64_t bitflip_low = loadLittleEndian32(SECRET) ^ loadLittleEndian32(SECRET + 4);
+        const uint64_t bitflip_high = loadLittleEndian32(SECRET + 8) ^ loadLittleEndian32(SECRET + 12);
+        return BlockFingerprint{avalancheXxh64(combined_low ^ bitflip_low), avalancheXxh64(combined_high ^ bitflip_high)};
+    }
+
+    BlockFingerprint hash4To8(const unsigned char* input, const size_t size) noexcept{
+        const uint64_t input_64 = loadLittleEndian32(input) + (static_cast<uint64_t>(loadLittleEndian32(input + size - 4)) << 32);
+        const uint64_t bitflip = loadLittleEndian64(SECRET + 16) ^ loadLittleEndian64(SECRET + 24);
+        // the length is shifted to keep the multiplier odd
+        BlockFingerprint product = multiply64To128(input_64 ^ bitflip, PRIME64_1 + (size << 2));
+        product.high += product.low << 1;
+        product.low ^= product.high >> 3;
+        product.low ^= product.low >> 35;
+        product.low *= PRIME_MX2;
+        product.low ^= product.low >> 28;
+        product.high = avalanche(product.high);
+        return product;
+    }
+
+    BlockFingerprint hash9To16(const unsigned char* input, const size_t size) noexcept{
+        const uint64_t bitflip_low = loadLittleEndian64(SECRET + 32) ^ loadLittleEndian64(SECRET + 40);
+        const uint64_t bitflip_high = loadLittleEndian64(SECRET + 48) ^ loadLittleEndian64(SECRET + 56);
+        const uint64_t input_low = loadLittleEndian64(input);
+        const uint64_t input_high = loadLittleEndian64(input + size - 8) ^ bitflip_high;
+        BlockFingerprint mixed = multiply64To128(input_low ^ loadLittleEndian64(input + size - 8) ^ bitflip_low, PRIME64_1);
+        mixed.low += static_cast<uint64_t>(size - 1) << 54;
+        mixed.high += input_high + multiply32To64(input_high, PRIME32_2 - 1);
+        mixed.low ^= swapBytes64(mixed.high);
+
+        BlockFingerprint hash = multiply64To128(mixed.low, PRIME64_2);
+        hash.high += mixed.high * PRIME64_2;
+        return BlockFingerprint{avalanche(hash.low), avalanche(hash.high)};
+    }
+
+    uint64_t mix16Bytes(const unsigned char* input, const unsigned char* secret) noexcept{
+        return multiplyFold64(loadLittleEndian64(input) ^ loadLittleEndian64(secret),
+                              loadLittleEndian64(input + 8) ^ loadLittleEndian64(secret + 8));
+    }
+
+    void mix32Bytes(BlockFingerprint& accumulator, const unsigned char* first_input, const unsigned char* second_input,
+                    const unsigned char* secret) noexcept{
+        accumulator.low += mix16Bytes(first_input, secret);
+        accumulator.low ^= loadLittleEndian64(second_input) + loadLittleEndian64(second_input + 8);
+        accumulator.high += mix16Bytes(second_input, secret + 16);
+        accumulator.high ^= loadLittleEndian64(first_input) + loadLittleEndian64(first_input + 8);
+    }
+
+    BlockFingerprint finishMidsize(const BlockFingerprint& accumulator, const size_t size) noexcept{
+        const uint64_t low = accumulator.low + accumulator.high;
+        const uint64_t high = accumulator.low * PRIME64_1 + accumulator.high * PRIME64_4 + static_cast<uint64_t>(size) * PRIME64_2;
+        return BlockFingerprint{avalanche(low), 0 - avalanche(high)};
+    }
+
+    BlockFingerprint hash17To128(const unsigned char* input, const size_t size) noexcept{
+        BlockFingerprint accumulator{static_cast<uint64_t>(size) * PRIME64_1, 0};
+        if (size > 32){
+            if (size > 64){
+                if (size > 96){
+                    mix32Bytes(accumulator, input + 48, input + size - 64, SECRET + 96);
+                }
+                mix32Bytes(accumulator, input + 32, input + size - 48, SECRET + 64);
+            }
+            mix32Bytes(accumulator, input + 16, input + size - 32, SECRET + 32);
+        }
+        mix32Bytes(accumulator, input, input + size - 16, SECRET);
+        return finishMidsize(accumulator, size);
+    }
+
+    BlockFingerprint hash129To240(const unsigned char* input, const size_t size) noexcept{
+        BlockFingerprint accumulator{static_cast<uint64_t>(size) * PRIME64_1, 0};
+        for (size_t i = 32; i < 160; i += 32){
+            mix32Bytes(accumulator, input + i - 32, input + i - 16, SECRET + i - 32);
+        }
+        accumulator.low = avalanche(accumulator.low);
+        accumulator.high = avalanche(accumulator.high);
+        for (size_t i = 160; i <= size; i += 32){
+            mix32Bytes(accumulator, input + i - 32, input + i - 16, SECRET + MIDSIZE_START_OFFSET + i - 160);
+        }
+        mix32Bytes(accumulator, input + size - 16, input + size - 32, SECRET + SECRET_SIZE_MIN - MIDSIZE_LAST_OFFSET - 16);
+        return finishMidsize(accumulator, size);
+    }
+
+    BlockFingerprint hashShort(const unsigned char* input, const size_t size) noexcept{
+        if (size > 128){
+            return hash129To240(input, size);
+        }
+        if (size > 16){
+            return hash17To128(input, size);
+        }
+        if (size > 8){
+            return hash9To16(input, size);
+        }
+        if (size >= 4){
+            return hash4To8(input, size);
+        }
+        if (size > 0){
+            return hash1To3(input, size);
+        }
+        return BlockFingerprint{avalancheXxh64(loadLittleEndian64(SECRET + 64) ^ loadLittleEndian64(SECRET + 72)),
+                                avalancheXxh64(loadLittleEndian64(SECRET + 80) ^ loadLittleEndian64(SECRET + 88))};
+    }
+
+    /* Inputs longer than 240 bytes: 8 accumulators, fed one 64-byte stripe at a time and scrambled every 1 KB.
+       The stripe kernels are the only part that differs between the instruction sets. */
+
+    // Fold `stripes_count` stripes into the accumulators, shifting the secret by 8 bytes per stripe.
+    using AccumulateKernel = void (*)(uint64_t* accumulators, const unsigned char* input, const unsigned char* secret,
+                                      const size_t stripes_count) noexcept;
+    using ScrambleKernel = void (*)(uint64_t* accumulators, const unsigned char* secret) noexcept;
+
+    void accumulateScalar(uint64_t* accumulators, const unsigned char* input, const unsigned char* secret, const size_t stripes_count) noexcept{
+        for (size_t stripe = 0; stripe < stripes_count; ++stripe){
+            const unsigned char* stripe_input = input + stripe * STRIPE_LENGTH;
+            const unsigned char* stripe_secret = secret + stripe * SECRET_CONSUME_RATE;
+            for (size_t lane = 0; lane < 8; ++lane){
+                const uint64_t data_value = loadLittleEndian64(stripe_input + lane * 8);
+                const uint64_t data_key = data_value ^ loadLittleEndian64(stripe_secret + lane * 8);
+                accumulators[lane ^ 1] += data_value;  // the neighbouring lane gets the raw data
+                accumulators[lane] += multiply32To64(data_key, data_key >> 32);
+            }
+        }
+    }
+
+    void scrambleScalar(uint64_t* accumulators, const unsigned char* secret) noexcept{
+        for (size_t lane = 0; lane < 8; ++lane){
+            uint64_t accumulator = accumulators[lane];
+            accumulator ^= accumulator >> 47;
+            accumulator ^= loadLittleEndian64(secret + lane * 8);
+            accumulator *= PRIME32_1;
+            accumulators[lane] = accumulator;
+        }
+    }
+
+#ifdef FINGERPRINT_X86_SIMD
+    // SSE2 is part of x86-64, so it needs no check. The vector loads are unaligned: the blocks are only 1-byte aligned.
+    void accumulateSse2(uint64_t* accumulators, const unsigned char* input, const unsigned char* secret, const size_t stripes_count) noexcept{
+        __m128i* vector_accumulators = reinterpret_cast<__m128i*>(accumulators);
+        for (size_t stripe = 0; stripe < stripes_count; ++stripe){
+            const __m128i* stripe_input = reinterpret_cast<const __m128i*>(input + stripe * STRIPE_LENGTH);
+            const __m128i* stripe_secret = reinterpret_cast<const __m128i*>(secret + stripe * SECRET_CONSUME_RATE);
+            for (size_t i = 0; i < STRIPE_LENGTH / sizeof(__m128i); ++i){
+                const __m128i data_vector = _mm_loadu_si128(stripe_input + i);
+                const __m128i data_key = _mm_xor_si128(data_vector, _mm_loadu_si128(stripe_secret + i));
+                // multiply the low 32 bits of each 64-bit lane by its high 32 bits
+                const __m128i product = _mm_mul_epu32(data_key, _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)));
+                const __m128i swapped_data = _mm_shuffle_epi32(data_vector, _MM_SHUFFLE(1, 0, 3, 2));
+                vector_accumulators[i] = _mm_add_epi64(product, _mm_add_epi64(vector_accumulators[i], swapped_data));
+            }
+        }
+    }
+
+    void scrambleSse2(uint64_t* accumulators, const unsigned char* secret) noexcept{
+        __m128i* vector_accumulators = reinterpret_cast<__m128i*>(accumulators);
+        const __m128i* vector_secret = reinterpret_cast<const __m128i*>(secret);
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(PRIME32_1));
+        for (size_t i = 0; i < STRIPE_LENGTH / sizeof(__m128i); ++i){
+            const __m128i accumulator = vector_accumulators[i];
+            const __m128i data_key = _mm_xor_si128(_mm_xor_si128(accumulator, _mm_srli_epi64(accumulator, 47)),
+                                                   _mm_loadu_si128(vector_secret + i));
+            // a 64 x 32-bit multiply out of two 32 x 32-bit ones
+            const __m128i product_low = _mm_mul_epu32(data_key, prime);
+            const __m128i product_high = _mm_mul_epu32(_mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+            vector_accumulators[i] = _mm_add_epi64(product_low, _mm_slli_epi64(product_high, 32));
+        }
+    }
+
+    __attribute__((target("avx2"))) void accumulateAvx2(uint64_t* accumulators, const unsigned char* input, const unsigned char* secret,
+                                                        const size_t stripes_count) noexcept{
+        __m256i* vector_accumulators = reinterpret_cast<__m256i*>(accumulators);
+        for (size_t stripe = 0; stripe < stripes_count; ++stripe){
+            const __m256i* stripe_input = reinterpret_cast<const __m256i*>(input + stripe * STRIPE_LENGTH);
+            const __m256i* stripe_secret = reinterpret_cast<const __m256i*>(secret + stripe * SECRET_CONSUME_RATE);
+            for (size_t i = 0; i < STRIPE_LENGTH / sizeof(__m256i); ++i){
+                const __m256i data_vector = _mm256_loadu_si256(stripe_input + i);
+                const __m256i data_key = _mm256_xor_si256(data_vector, _mm256_loadu_si256(stripe_secret + i));
+                const __m256i product = _mm256_mul_epu32(data_key, _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)));
+                const __m256i swapped_data = _mm256_shuffle_epi32(data_vector, _MM_SHUFFLE(1, 0, 3, 2));
+                vector_accumulators[i] = _mm256_add_epi64(product, _mm256_add_epi64(vector_accumulators[i], swapped_data));
+            }
+        }
+    }
+
+    __attribute__((target("avx2"))) void scrambleAvx2(uint64_t* accumulators, const unsigned char* secret) noexcept{
+        __m256i* vector_accumulators = reinterpret_cast<__m256i*>(accumulators);
+        const __m256i* vector_secret = reinterpret_cast<const __m256i*>(secret);
+        const __m256i prime = _mm256_set1_epi32(static_cast<int>(PRIME32_1));
+        for (size_t i = 0; i < STRIPE_LENGTH / sizeof(__m256i); ++i){
+            const __m256i accumulator = vector_accumulators[i];
+            const __m256i data_key = _mm256_xor_si256(_mm256_xor_si256(accumulator, _mm256_srli_epi64(accumulator, 47)),
+                                                      _mm256_loadu_si256(vector_secret + i));
+            const __m256i product_low = _mm256_mul_epu32(data_key, prime);
+            const __m256i product_high = _mm256_mul_epu32(_mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+            vector_accumulators[i] = _mm256_add_epi64(product_low, _mm256_slli_epi64(product_high, 32));
+        }
+    }
+
+    bool hasAvx2Instructions() noexcept{
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+
+    struct StripeKernels{
+        AccumulateKernel accumulate;
+        ScrambleKernel scramble;
+        const char* instruction_set;
+    };
+
+    constexpr StripeKernels SCALAR_KERNELS{accumulateScalar, scrambleScalar, "scalar"};
+
+    StripeKernels selectStripeKernels() noexcept{
+#ifdef FINGERPRINT_X86_SIMD
+        if (hasAvx2Instructions()){
+            return StripeKernels{accumulateAvx2, scrambleAvx2, "avx2"};
+        }
+        return StripeKernels{accumulateSse2, scrambleSse2, "sse2"};
+#else
+        return SCALAR_KERNELS;
+#endif
+    }
+
+    const StripeKernels& getStripeKernels() noexcept{
+        static const StripeKernels kernels = selectStripeKernels();
+        return kernels;
+    }
+
+    uint64_t mergeAccumulators(const uint64_t* accumulators, const unsigned char* secret, const uint64_t start) noexcept{
+        uint64_t result = start;
+        for (size_t i = 0; i < 4; ++i){
+            result += multiplyFold64(accumulators[2 * i] ^ loadLittleEndian64(secret + 16 * i),
+                                     accumulators[2 * i + 1] ^ loadLittleEndian64(secret + 16 * i + 8));
+        }
+        return avalanche(result);
+    }
+
+    BlockFingerprint hashLong(const unsigned char* input, const size_t size, const StripeKernels& kernels) noexcept{
+        alignas(32) uint64_t accumulators[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+        const size_t blocks_count = (size - 1) / HASH_BLOCK_LENGTH;
+        for (size_t block = 0; block < blocks_count; ++block){
+            kernels.accumulate(accumulators, input + block * HASH_BLOCK_LENGTH, SECRET, STRIPES_PER_BLOCK);
+            kernels.scramble(accumulators, SECRET + SECRET_SIZE - STRIPE_LENGTH);
+        }
+        // the last stripe ends at the last byte, so it may overlap the stripes before it
+        const size_t last_stripes_count = ((size - 1) - blocks_count * HASH_BLOCK_LENGTH) / STRIPE_LENGTH;
+        kernels.accumulate(accumulators, input + blocks_count * HASH_BLOCK_LENGTH, SECRET, last_stripes_count);
+        kernels.accumulate(accumulators, input + size - STRIPE_LENGTH, SECRET + SECRET_SIZE - STRIPE_LENGTH - SECRET_LAST_STRIPE_START, 1);
+
+        return BlockFingerprint{mergeAccumulators(accumulators, SECRET + SECRET_MERGE_START, static_cast<uint64_t>(size) * PRIME64_1),
+                                mergeAccumulators(accumulators, SECRET + SECRET_SIZE - sizeof(accumulators) - SECRET_MERGE_START,
+                                                  ~(static_cast<uint64_t>(size) * PRIME64_2))};
+    }
+}
+
+BlockFingerprint computeFingerprint(const char* data, const size_t size) noexcept{
+    const auto* input = reinterpret_cast<const unsigned char*>(data);
+    if (size <= MIDSIZE_MAX){
+        return hashShort(input, size);
+    }
+    return hashLong(input, size, getStripeKernels());
+}
+
+BlockFingerprint computeFingerprintPortable(const char* data, const size_t size) noexcept{
+    const auto* input = reinterpret_cast<const unsigned char*>(data);
+    if (size <= MIDSIZE_MAX){
+        return hashShort(input, size);
+    }
+    return hashLong(input, size, SCALAR_KERNELS);
+}
+
+const char* getFingerprintInstructionSet() noexcept{
+    return getStripeKernels().instruction_set;
+}
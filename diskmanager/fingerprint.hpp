@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* 128-bit content fingerprints of data blocks, computed with XXH3-128 (seed 0, default secret).
+
+   - Blocks longer than 240 bytes are hashed in 64-byte stripes. On x86-64 the stripes are processed with SSE2, which every
+     x86-64 CPU has, or with AVX2 when the CPU supports it; the CPU is checked once at runtime.
+   - Everywhere else, and for shorter blocks, a scalar version is used.
+   All versions give the same results as the reference XXH3_128bits(), so keys stored on one machine match those
+   computed on any other.
+   Blocks are keyed by the low 64 bits, the high 64 bits are stored next to the key, see `DataBlock::Hash()`. */
+
+struct BlockFingerprint{
+    uint64_t low;   /* low 64 bits of the XXH3-128 hash */
+    uint64_t high;  /* high 64 bits of the XXH3-128 hash */
+};
+
+static inline bool operator==(const BlockFingerprint& lhs, const BlockFingerprint& rhs) noexcept{
+    return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+static inline bool operator!=(const BlockFingerprint& lhs, const BlockFingerprint& rhs) noexcept{
+    return !(lhs == rhs);
+}
+
+/** Compute the fingerprint of exactly `size` bytes of a buffer; NUL bytes are hashed like any other byte.
+ * @param[in] data the bytes to hash, may be `nullptr` if `size` is `0`
+ * @return the XXH3-128 hash of the bytes.
+*/
+BlockFingerprint computeFingerprint(const char* data, const size_t size) noexcept;
+
+// The scalar version `computeFingerprint()` falls back to if the CPU has no vector instructions.
+BlockFingerprint computeFingerprintPortable(const char* data, const size_t size) noexcept;
+
+// Get the name of the instruction set `computeFingerprint()` uses for long blocks: "avx2", "sse2" or "scalar".
+const char* getFingerprintInstructionSet() noexcept;
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "fingerprint.hpp"
+
+using namespace std::string_literals;
+
+namespace{
+    BlockFingerprint makeFingerprint(const uint64_t high, const uint64_t low){
+        return BlockFingerprint{low, high};
+    }
+}
+
+TEST(FingerprintHappyTests, KnownValuesTest){
+    // check values of the reference XXH3_128bits(), one per length class
+    EXPECT_EQ(computeFingerprint(nullptr, 0), makeFingerprint(0x99aa06d3014798d8ull, 0x6001c324468d497full));
+    EXPECT_EQ(computeFingerprint("a", 1), makeFingerprint(0xa96faf705af16834ull, 0xe6c632b61e964e1full));
+    EXPECT_EQ(computeFingerprint("abc", 3), makeFingerprint(0x06b05ab6733a6185ull, 0x78af5f94892f3950ull));
+    EXPECT_EQ(computeFingerprint("12345678", 8), makeFingerprint(0x155c340ccffd12dcull, 0x2b3f7d2855dc91fcull));
+    EXPECT_EQ(computeFingerprint("123456789", 9), makeFingerprint(0x33119477ede5dcd5ull, 0xe9716427681d5860ull));
+    const std::string sentence = "The quick brown fox jumps over the lazy dog"s;
+    EXPECT_EQ(computeFingerprint(sentence.data(), sentence.size()), makeFingerprint(0xddd650205ca3e7faull, 0x24a1cc2e3a8a7651ull));
+
+    const std::vector<char> zeros(MAX_DATA_BLOCK_SIZE, 0);
+    EXPECT_EQ(computeFingerprint(zeros.data(), zeros.size()), makeFingerprint(0x3ee8dc4f9e7ee495ull, 0x93d76fe148c689baull));
+    std::vector<char> pattern(MAX_DATA_BLOCK_SIZE);
+    for (size_t i = 0; i < pattern.size(); ++i){
+        pattern[i] = static_cast<char>(i * 7 + 3);
+    }
+    EXPECT_EQ(computeFingerprint(pattern.data(), pattern.size()), makeFingerprint(0x1546867423105cd5ull, 0xd7428746842be37eull));
+}
+
+TEST(FingerprintHappyTests, PortableMatchesVectorizedTest){
+    std::vector<char> data(3 * MAX_DATA_BLOCK_SIZE + 13);
+    std::mt19937 generator(42);
+    for (char& byte : data){
+        byte = static_cast<char>(generator());
+    }
+
+    // every length class, every partial stripe and every alignment of the input
+    for (size_t offset = 0; offset < 8; ++offset){
+        for (size_t size = 0; size <= 1'100; ++size){
+            EXPECT_EQ(computeFingerprint(data.data() + offset, size), computeFingerprintPortable(data.data() + offset, size));
+        }
+        EXPECT_EQ(computeFingerprint(data.data() + offset, data.size() - offset),
+                  computeFingerprintPortable(data.data() + offset, data.size() - offset));
+    }
+}
+
+TEST(FingerprintHappyTests, DataBlockIdentityTest){
+    // blocks differing only after a NUL byte, or only in length, are different blocks
+    DataBlock block1;
+    DataBlock block2;
+    block1.data_size = block2.data_size = 16;
+    block1.data[8] = 'x';
+    block2.data[8] = 'y';
+    EXPECT_NE(block1.Fingerprint(), block2.Fingerprint());
+    EXPECT_NE(block1.Hash(), block2.Hash());
+
+    block2.data[8] = 'x';
+    EXPECT_EQ(block1.Hash(), block2.Hash());
+    block2.data_size = 17;
+    EXPECT_NE(block1.Hash(), block2.Hash());
+
+    // the bytes after `data_size` are not a part of the block
+    block2.data_size = 16;
+    block2.data[100] = 'z';
+    EXPECT_EQ(block1.Fingerprint(), block2.Fingerprint());
+    EXPECT_EQ(block1.Hash(), static_cast<size_t>(computeFingerprint(block1.data, 16).low));
+}
@@ -0,0 +1,239 @@
+#include "free_space_map.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace{
+    // Number of zero bits below the lowest set bit; the word must not be zero.
+    size_t countTrailingZeros(const uint64_t word) noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctzll(word));
+#else
+        size_t zeros = 0;
+        while (((word >> zeros) & 1) == 0){
+            ++zeros;
+        }
+        return zeros;
+#endif
+    }
+
+    // Number of zero bits above the highest set bit; the word must not be zero.
+    size_t countLeadingZeros(const uint64_t word) noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_clzll(word));
+#else
+        size_t zeros = 0;
+        while (((word << zeros) >> 63) == 0){
+            ++zeros;
+        }
+        return zeros;
+#endif
+    }
+
+    size_t countSetBits(const uint64_t word) noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_popcountll(word));
+#else
+        size_t bits = 0;
+        for (uint64_t rest = word; rest != 0; rest &= rest - 1){
+            ++bits;
+        }
+        return bits;
+#endif
+    }
+
+    // Mask of the bits `[first_bit, first_bit + count)` of a word; `count` is at most 64.
+    uint64_t makeBitMask(const size_t first_bit, const size_t count) noexcept{
+        const uint64_t low_bits = count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+        return low_bits << first_bit;
+    }
+}
+
+FreeSpaceMap::FreeSpaceMap(const size_t slots_count)
+    : summaries_(2){
+    grow(slots_count);
+}
+
+bool FreeSpaceMap::allocate(const size_t count, size_t& first_slot) noexcept{
+    if (count == 0 || count > getLongestFreeRun()){
+        return false;
+    }
+
+    // go down to the leftmost subtree holding the run; a run crossing the middle of a node is found from the suffix of its left half
+    size_t node = 1;
+    size_t node_begin = 0;
+    uint64_t node_slots = static_cast<uint64_t>(leaves_count_) * SLOTS_PER_WORD;
+    while (node < leaves_count_){
+        const uint64_t child_slots = node_slots / 2;
+        const RunSummary& left = summaries_[2 * node];
+        const RunSummary& right = summaries_[2 * node + 1];
+        if (left.longest_free_run >= count){
+            node = 2 * node;
+        } else if (static_cast<size_t>(left.free_suffix) + right.free_prefix >= count){
+            first_slot = node_begin + static_cast<size_t>(child_slots) - left.free_suffix;
+            setSlots(first_slot, count, true);
+            return true;
+        } else{
+            node = 2 * node + 1;
+            node_begin += static_cast<size_t>(child_slots);
+        }
+        node_slots = child_slots;
+    }
+
+    first_slot = node_begin + findRunInWord(words_[node - leaves_count_], count);
+    setSlots(first_slot, count, true);
+    return true;
+}
+
+void FreeSpaceMap::markUsed(const size_t first_slot, const size_t count) noexcept{
+    setSlots(first_slot, count, true);
+}
+
+void FreeSpaceMap::release(const size_t first_slot, const size_t count) noexcept{
+    setSlots(first_slot, count, false);
+}
+
+void FreeSpaceMap::grow(const size_t slots_count){
+    if (slots_count <= slots_count_){
+        return;
+    }
+    if (slots_count > UINT32_MAX){
+        throw std::length_error("The free space map cannot track more than 2^32 - 1 slots");
+    }
+
+    // the bits past the last slot are kept set, so the summaries never count them as free
+    const size_t old_slots_count = slots_count_;
+    words_.resize((slots_count + SLOTS_PER_WORD - 1) / SLOTS_PER_WORD, ~uint64_t{0});
+    slots_count_ = slots_count;
+    size_t leaves_count = leaves_count_;
+    while (leaves_count < words_.size()){
+        leaves_count *= 2;
+    }
+    const bool tree_grown = leaves_count != leaves_count_;
+    if (tree_grown){
+        leaves_count_ = leaves_count;
+        summaries_.assign(2 * leaves_count_, RunSummary{});
+    }
+
+    setSlots(old_slots_count, slots_count - old_slots_count, false);
+    if (tree_grown){
+        rebuildSummaries();
+    }
+}
+
+bool FreeSpaceMap::isFree(const size_t slot) const noexcept{
+    return slot < slots_count_ && ((words_[slot / SLOTS_PER_WORD] >> (slot % SLOTS_PER_WORD)) & 1) == 0;
+}
+
+size_t FreeSpaceMap::getSlotsCount() const noexcept{
+    return slots_count_;
+}
+
+size_t FreeSpaceMap::getFreeSlotsCount() const noexcept{
+    return free_slots_count_;
+}
+
+size_t FreeSpaceMap::getLongestFreeRun() const noexcept{
+    return summaries_[1].longest_free_run;
+}
+
+size_t FreeSpaceMap::getTrailingFreeSlotsCount() const noexcept{
+    size_t trailing_slots = 0;
+    size_t slot = slots_count_;
+    // the last word is looked at bit by bit, the bits past the last slot are set
+    while (slot > 0 && slot % SLOTS_PER_WORD != 0 && isFree(slot - 1)){
+        ++trailing_slots;
+        --slot;
+    }
+    if (slot % SLOTS_PER_WORD != 0){
+        return trailing_slots;
+    }
+    for (size_t word = slot / SLOTS_PER_WORD; word > 0; --word){
+        if (words_[word - 1] != 0){
+            return trailing_slots + countLeadingZeros(words_[word - 1]);
+        }
+        trailing_slots += SLOTS_PER_WORD;
+    }
+    return trailing_slots;
+}
+
+void FreeSpaceMap::setSlots(const size_t first_slot, const size_t count, const bool used) noexcept{
+    const size_t last_slot = std::min(first_slot + count, slots_count_);
+    if (first_slot >= last_slot){
+        return;
+    }
+
+    const size_t first_word = first_slot / SLOTS_PER_WORD;
+    const size_t last_word = (last_slot - 1) / SLOTS_PER_WORD;
+    for (size_t word = first_word; word <= last_word; ++word){
+        const size_t word_begin = word * SLOTS_PER_WORD;
+        const size_t bits_begin = std::max(first_slot, word_begin) - word_begin;
+        const size_t bits_end = std::min(last_slot, word_begin + SLOTS_PER_WORD) - word_begin;
+        const uint64_t mask = makeBitMask(bits_begin, bits_end - bits_begin);
+        const size_t used_before = countSetBits(words_[word] & mask);
+        if (used){
+            words_[word] |= mask;
+            free_slots_count_ -= countSetBits(mask) - used_before;
+        } else{
+            words_[word] &= ~mask;
+            free_slots_count_ += used_before;
+        }
+    }
+    updateSummaries(first_word, last_word);
+}
+
+void FreeSpaceMap::updateSummaries(const size_t first_leaf, const size_t last_leaf) noexcept{
+    for (size_t leaf = first_leaf; leaf <= last_leaf; ++leaf){
+        summaries_[leaves_count_ + leaf] = leaf < words_.size() ? summarizeWord(words_[leaf]) : RunSummary{};
+    }
+
+    size_t first_node = (leaves_count_ + first_leaf) / 2;
+    size_t last_node = (leaves_count_ + last_leaf) / 2;
+    uint64_t child_slots = SLOTS_PER_WORD;
+    while (first_node >= 1){
+        for (size_t node = first_node; node <= last_node; ++node){
+            summaries_[node] = mergeSummaries(summaries_[2 * node], summaries_[2 * node + 1], child_slots);
+        }
+        first_node /= 2;
+        last_node /= 2;
+        child_slots *= 2;
+    }
+}
+
+void FreeSpaceMap::rebuildSummaries() noexcept{
+    updateSummaries(0, leaves_count_ - 1);
+}
+
+FreeSpaceMap::RunSummary FreeSpaceMap::summarizeWord(const uint64_t word) noexcept{
+    RunSummary summary;
+    if (word == 0){
+        summary.free_prefix = summary.free_suffix = summary.longest_free_run = SLOTS_PER_WORD;
+        return summary;
+    }
+    summary.free_prefix = static_cast<uint32_t>(countTrailingZeros(word));
+    summary.free_suffix = static_cast<uint32_t>(countLeadingZeros(word));
+    // every step shortens each run of free bits by one, so the longest run is gone after as many steps as it is long
+    for (uint64_t free_bits = ~word; free_bits != 0; free_bits &= free_bits >> 1){
+        ++summary.longest_free_run;
+    }
+    return summary;
+}
+
+FreeSpaceMap::RunSummary FreeSpaceMap::mergeSummaries(const RunSummary& left, const RunSummary& right, const uint64_t child_slots) noexcept{
+    RunSummary summary;
+    summary.free_prefix = left.free_prefix == child_slots ? static_cast<uint32_t>(child_slots + right.free_prefix) : left.free_prefix;
+    summary.free_suffix = right.free_suffix == child_slots ? static_cast<uint32_t>(child_slots + left.free_suffix) : right.free_suffix;
+    summary.longest_free_run = std::max({left.longest_free_run, right.longest_free_run, left.free_suffix + right.free_prefix});
+    return summary;
+}
+
+size_t FreeSpaceMap::findRunInWord(const uint64_t word, const size_t count) noexcept{
+    // bit `i` of `run_starts` stays set while the slots `[i, i + count)` are all free
+    const uint64_t free_bits = ~word;
+    uint64_t run_starts = free_bits;
+    for (size_t shift = 1; shift < count; ++shift){
+        run_starts &= free_bits >> shift;
+    }
+    return countTrailingZeros(run_starts);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Map of free and used slots of a block file, used to allocate contiguous runs of slots (extents).
+
+   - The slots are kept in a bitmap, one bit per slot, set for a used slot.
+   - A summary tree over the 64-bit words of the bitmap keeps for every subtree the length of its free prefix, of its free
+     suffix and of its longest free run, so the first run of `n` free slots is found in O(log n) and the bits of an
+     extent are updated in O(extent / 64 + log n).
+   - Allocation is first fit: the extent starts at the lowest slot where `n` free slots follow each other, so freed slots
+     at the start of the file are reused before the free tail and the file stays compact. */
+class FreeSpaceMap{
+public:
+    /** Create a map with every slot free.
+     * @param[in] slots_count number of slots of the file
+    */
+    explicit FreeSpaceMap(const size_t slots_count = 0);
+
+public:
+    /** Allocate `count` contiguous free slots, the lowest ones available.
+     * @param[out] first_slot the first slot of the extent
+     * @return `false` if there is no run of `count` free slots.
+    */
+    bool allocate(const size_t count, size_t& first_slot) noexcept;
+
+    // Mark `count` slots starting at `first_slot` as used, e.g. the slots of blocks found on open.
+    void markUsed(const size_t first_slot, const size_t count) noexcept;
+
+    // Mark `count` slots starting at `first_slot` as free, so they can be allocated again.
+    void release(const size_t first_slot, const size_t count) noexcept;
+
+    // Add free slots at the end of the map. A smaller count is ignored.
+    void grow(const size_t slots_count);
+
+    bool isFree(const size_t slot) const noexcept;
+
+    size_t getSlotsCount() const noexcept;
+
+    size_t getFreeSlotsCount() const noexcept;
+
+    // Get the length of the longest run of free slots, i.e. the largest extent `allocate()` can succeed with.
+    size_t getLongestFreeRun() const noexcept;
+
+    // Get a number of free slots at the end of the map, which an extent allocated after `grow()` starts with.
+    size_t getTrailingFreeSlotsCount() const noexcept;
+
+private:
+    static constexpr size_t SLOTS_PER_WORD = 64;
+
+    /* Free runs of a subtree; lengths are in slots. */
+    struct RunSummary{
+        uint32_t free_prefix = 0;
+        uint32_t free_suffix = 0;
+        uint32_t longest_free_run = 0;
+    };
+
+    // Set or clear the bits of `count` slots starting at `first_slot` and update the summaries above them.
+    void setSlots(const size_t first_slot, const size_t count, const bool used) noexcept;
+
+    // Recompute the summaries of the leaves `[first_leaf, last_leaf]` and of every node above them.
+    void updateSummaries(const size_t first_leaf, const size_t last_leaf) noexcept;
+
+    // Rebuild the whole tree, e.g. after the number of leaves has changed.
+    void rebuildSummaries() noexcept;
+
+    static RunSummary summarizeWord(const uint64_t word) noexcept;
+
+    // Merge the summaries of two neighbouring subtrees of `child_slots` slots each.
+    static RunSummary mergeSummaries(const RunSummary& left, const RunSummary& right, const uint64_t child_slots) noexcept;
+
+    // Find the first run of `count` free slots inside one word; the word must have such a run.
+    static size_t findRunInWord(const uint64_t word, const size_t count) noexcept;
+
+private:
+    size_t slots_count_ = 0;
+    size_t free_slots_count_ = 0;
+    std::vector<uint64_t> words_;                       /* Bit `i % 64` of word `i / 64` is set if slot `i` is used */
+    size_t leaves_count_ = 1;                           /* Words covered by the tree, a power of two; missing words count as used */
+    std::vector<RunSummary> summaries_;                 /* Implicit binary tree, node `i` has children `2i` and `2i + 1`, leaves from `leaves_count_` */
+};
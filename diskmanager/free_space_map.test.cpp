@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "free_space_map.hpp"
+
+TEST(FreeSpaceMapHappyTests, AllocateAndReleaseTest){
+    FreeSpaceMap free_space(1000);
+    EXPECT_EQ(free_space.getSlotsCount(), static_cast<size_t>(1000));
+    EXPECT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(1000));
+    EXPECT_EQ(free_space.getLongestFreeRun(), static_cast<size_t>(1000));
+
+    // extents are laid out one after another from the start of the file
+    size_t first_slot = 0;
+    ASSERT_TRUE(free_space.allocate(10, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(0));
+    ASSERT_TRUE(free_space.allocate(100, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(10));
+    ASSERT_TRUE(free_space.allocate(1, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(110));
+    EXPECT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(889));
+    EXPECT_FALSE(free_space.isFree(50));
+    EXPECT_TRUE(free_space.isFree(111));
+
+    // a freed extent is reused by the first request which fits into it
+    free_space.release(10, 100);
+    EXPECT_TRUE(free_space.isFree(50));
+    ASSERT_TRUE(free_space.allocate(200, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(111));
+    ASSERT_TRUE(free_space.allocate(70, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(10));
+    ASSERT_TRUE(free_space.allocate(30, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(80));
+
+    EXPECT_FALSE(free_space.allocate(690, first_slot));
+    EXPECT_EQ(free_space.getLongestFreeRun(), static_cast<size_t>(689));
+    EXPECT_EQ(free_space.getTrailingFreeSlotsCount(), static_cast<size_t>(689));
+    EXPECT_FALSE(free_space.allocate(0, first_slot));
+}
+
+TEST(FreeSpaceMapHappyTests, RunAcrossWordsTest){
+    FreeSpaceMap free_space(512);
+    free_space.markUsed(0, 512);
+    EXPECT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(0));
+
+    // a short hole inside a word is skipped by a run which only fits across the words following it
+    free_space.release(3, 5);
+    free_space.release(100, 150);
+    size_t first_slot = 0;
+    ASSERT_TRUE(free_space.allocate(120, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(100));
+    ASSERT_TRUE(free_space.allocate(5, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(3));
+    EXPECT_FALSE(free_space.allocate(31, first_slot));
+    ASSERT_TRUE(free_space.allocate(30, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(220));
+    EXPECT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(0));
+}
+
+TEST(FreeSpaceMapHappyTests, GrowTest){
+    FreeSpaceMap free_space(100);
+    size_t first_slot = 0;
+    ASSERT_TRUE(free_space.allocate(90, first_slot));
+    EXPECT_EQ(free_space.getTrailingFreeSlotsCount(), static_cast<size_t>(10));
+    EXPECT_FALSE(free_space.allocate(50, first_slot));
+
+    // the new slots continue the free tail, so the extent starts inside the old part of the map
+    free_space.grow(1000);
+    EXPECT_EQ(free_space.getSlotsCount(), static_cast<size_t>(1000));
+    EXPECT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(910));
+    ASSERT_TRUE(free_space.allocate(50, first_slot));
+    EXPECT_EQ(first_slot, static_cast<size_t>(90));
+    EXPECT_TRUE(free_space.isFree(999));
+    EXPECT_FALSE(free_space.isFree(1000));
+
+    free_space.grow(10);
+    EXPECT_EQ(free_space.getSlotsCount(), static_cast<size_t>(1000));
+}
+
+TEST(FreeSpaceMapHappyTests, RandomChurnTest){
+    // the map is checked against a plain first fit scan of a vector of flags
+    constexpr size_t SLOTS_COUNT = 5000;
+    FreeSpaceMap free_space(SLOTS_COUNT);
+    std::vector<bool> used(SLOTS_COUNT, false);
+    std::vector<std::pair<size_t, size_t>> extents;
+    std::mt19937 generator(42);
+
+    for (size_t step = 0; step < 3000; ++step){
+        if (!extents.empty() && generator() % 3 == 0){
+            const size_t extent = generator() % extents.size();
+            free_space.release(extents[extent].first, extents[extent].second);
+            std::fill_n(used.begin() + extents[extent].first, extents[extent].second, false);
+            extents.erase(extents.begin() + extent);
+            continue;
+        }
+
+        const size_t count = 1 + generator() % 150;
+        size_t expected_slot = SLOTS_COUNT;
+        for (size_t slot = 0, run = 0; slot < SLOTS_COUNT; ++slot){
+            run = used[slot] ? 0 : run + 1;
+            if (run == count){
+                expected_slot = slot + 1 - count;
+                break;
+            }
+        }
+        size_t first_slot = 0;
+        ASSERT_EQ(free_space.allocate(count, first_slot), expected_slot != SLOTS_COUNT);
+        if (expected_slot != SLOTS_COUNT){
+            ASSERT_EQ(first_slot, expected_slot);
+            std::fill_n(used.begin() + first_slot, count, true);
+            extents.emplace_back(first_slot, count);
+        }
+        ASSERT_EQ(free_space.getFreeSlotsCount(), static_cast<size_t>(std::count(used.begin(), used.end(), false)));
+    }
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/* An open-addressing hash table mapping block hashes to small values (frame ids, slots, etc.).
+   All memory is allocated at construction or by `reserve()`, so inserts and erases never touch the allocator;
+   an index which has to hold any number of keys grows with `reserve()` once it is full.
+   Collisions are resolved with linear probing; erase uses backward-shift deletion, so no tombstones pile up.
+   The keys and occupancy flags of the slots are atomics and the values are moved with relaxed atomic accesses, and every
+   erase is bracketed by a version counter (odd while entries are shifted), so `findUnsynchronized()` may run alongside
+   one modifying thread. Values changed through `find()` pointers must use `update()` instead while such probes run. */
+template <typename Value>
+class HashIndex{
+public:
+    /** Create an empty index.
+     * @param[in] max_entries maximum number of keys the index has to hold at once
+    */
+    explicit HashIndex(const size_t max_entries = 0){
+        size_t slots_count = 8;
+        // keep the load factor at or below 1/2 so probe sequences stay short
+        while (slots_count < max_entries * 2){
+            slots_count <<= 1;
+        }
+        slots_.resize(slots_count);
+        mask_ = slots_count - 1;
+        max_entries_ = slots_count / 2;
+    }
+
+    HashIndex(HashIndex&& other) noexcept{
+        *this = std::move(other);
+    }
+
+    HashIndex& operator=(HashIndex&& other) noexcept{
+        slots_ = std::move(other.slots_);
+        mask_ = other.mask_;
+        size_ = other.size_;
+        max_entries_ = other.max_entries_;
+        version_.store(other.version_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+public:
+    // Get a pointer to the value stored for the `key`, or `nullptr` if there is none.
+    Value* find(const size_t key) noexcept{
+        for (size_t pos = bucketOf(key); slots_[pos].isOccupied(); pos = (pos + 1) & mask_){
+            if (slots_[pos].getKey() == key){
+                return &slots_[pos].value;
+            }
+        }
+        return nullptr;
+    }
+
+    const Value* find(const size_t key) const noexcept{
+        return const_cast<HashIndex*>(this)->find(key);
+    }
+
+    /** Look the key up while another thread may be modifying the index. The slots are never reallocated and the probe
+     * visits every slot at most once, so the lookup is memory-safe and terminates, but its result may be stale:
+     * the caller has to validate a found value against the data it points to, and a miss with `getVersion()`.
+     * @param[out] value copy of the value found for the `key`
+     * @return `false` if the key has not been found.
+    */
+    bool findUnsynchronized(const size_t key, Value& value) const noexcept{
+        size_t pos = bucketOf(key);
+        for (size_t probes = 0; probes <= mask_ && slots_[pos].isOccupied(); ++probes, pos = (pos + 1) & mask_){
+            if (slots_[pos].getKey() == key){
+                value = loadRelaxed(slots_[pos].value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Get the version of the index for the validation of `findUnsynchronized()` misses, seqlock-style: a miss is
+     * trusted if the version has been even and the same before and after the lookup. An erase shifting the entries
+     * of a probe chain back may hide a present key from a concurrent probe, so it makes the version odd meanwhile.
+    */
+    uint64_t getVersion() const noexcept{
+        return version_.load(std::memory_order_acquire);
+    }
+
+    /** Grow the index, so it holds at least `max_entries` keys. The entries are rehashed into a new table, so unlike
+     * the other calls it allocates, and it must not run alongside `findUnsynchronized()`.
+     * @throw `std::bad_alloc` if the new table cannot be allocated; the index stays as it has been then.
+    */
+    void reserve(const size_t max_entries){
+        if (max_entries <= max_entries_){
+            return;
+        }
+        HashIndex larger_index(max_entries);
+        forEach([&larger_index](const size_t key, const Value& value){
+            larger_index.insert(key, value);
+        });
+        const uint64_t version = version_.load(std::memory_order_relaxed);
+        *this = std::move(larger_index);
+        version_.store(version, std::memory_order_relaxed);
+    }
+
+    /** Insert a new key-value pair.
+     * @return `false` if the key already exists or the index is full.
+    */
+    bool insert(const size_t key, const Value& value) noexcept{
+        if (size_ >= max_entries_){
+            return false;
+        }
+        size_t pos = bucketOf(key);
+        for (; slots_[pos].isOccupied(); pos = (pos + 1) & mask_){
+            if (slots_[pos].getKey() == key){
+                return false;
+            }
+        }
+        slots_[pos].key.store(key, std::memory_order_relaxed);
+        storeRelaxed(slots_[pos].value, value);
+        slots_[pos].occupied.store(true, std::memory_order_relaxed);
+        ++size_;
+        return true;
+    }
+
+    /** Replace the value of a key, so a concurrent `findUnsynchronized()` gets either the old or the new one.
+     * @return `false` if the key has not been found.
+    */
+    bool update(const size_t key, const Value& value) noexcept{
+        Value* stored_value = find(key);
+        if (stored_value == nullptr){
+            return false;
+        }
+        storeRelaxed(*stored_value, value);
+        return true;
+    }
+
+    /** Remove the key from the index.
+     * @return `false` if the key has not been found.
+    */
+    bool erase(const size_t key) noexcept{
+        size_t hole = bucketOf(key);
+        for (; slots_[hole].isOccupied(); hole = (hole + 1) & mask_){
+            if (slots_[hole].getKey() == key){
+                break;
+            }
+        }
+        if (!slots_[hole].isOccupied()){
+            return false;
+        }
+
+        // the version is odd before any entry moves, as the version of a frame is (see `BufferManager::beginFrameWrite()`)
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        // shift back the following entries of the probe chain which would become unreachable otherwise
+        for (size_t pos = (hole + 1) & mask_; slots_[pos].isOccupied(); pos = (pos + 1) & mask_){
+            const size_t home = bucketOf(slots_[pos].getKey());
+            const bool home_between = hole <= pos ? (hole < home && home <= pos) : (hole < home || home <= pos);
+            if (!home_between){
+                slots_[hole] = slots_[pos];
+                hole = pos;
+            }
+        }
+        slots_[hole].occupied.store(false, std::memory_order_relaxed);
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        --size_;
+        return true;
+    }
+
+    void clear() noexcept{
+        // a probe running alongside would miss the keys which are still there, so the version is odd meanwhile, as for an erase
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (Slot& slot : slots_){
+            slot.occupied.store(false, std::memory_order_relaxed);
+        }
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        size_ = 0;
+    }
+
+    // Call `func(key, value)` for every stored pair.
+    template <typename Func>
+    void forEach(Func&& func) const{
+        for (const Slot& slot : slots_){
+            if (slot.isOccupied()){
+                func(slot.getKey(), slot.value);
+            }
+        }
+    }
+
+    size_t size() const noexcept{
+        return size_;
+    }
+
+    // Get a maximum number of keys the index can hold.
+    size_t capacity() const noexcept{
+        return max_entries_;
+    }
+
+    // Get a number of bytes used by the index.
+    size_t getMemoryUsage() const noexcept{
+        return slots_.capacity() * sizeof(Slot);
+    }
+
+    // Get a number of bytes a single entry costs at the maximum load factor.
+    static constexpr size_t getBytesPerEntry() noexcept{
+        return 2 * sizeof(Slot);
+    }
+
+private:
+    /* The key and the flag are read by unsynchronized probes, so they are atomics; relaxed accesses compile to
+       plain loads and stores. The value stays a plain field, so `find()` can hand out a pointer to it. */
+    struct Slot{
+        Slot() noexcept = default;
+
+        Slot(const Slot& other) noexcept{
+            *this = other;
+        }
+
+        Slot& operator=(const Slot& other) noexcept{
+            key.store(other.getKey(), std::memory_order_relaxed);
+            storeRelaxed(value, other.value);
+            occupied.store(other.isOccupied(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        size_t getKey() const noexcept{
+            return key.load(std::memory_order_relaxed);
+        }
+
+        bool isOccupied() const noexcept{
+            return occupied.load(std::memory_order_relaxed);
+        }
+
+        std::atomic<size_t> key{0};
+        Value value{};
+        std::atomic<bool> occupied{false};
+    };
+
+    // Access a value a probe may read while it is written. Aligned word-sized stores do not tear on the other compilers.
+    static Value loadRelaxed(const Value& value) noexcept{
+#if defined(__GNUC__)
+        Value loaded_value;
+        __atomic_load(&value, &loaded_value, __ATOMIC_RELAXED);
+        return loaded_value;
+#else
+        return value;
+#endif
+    }
+
+    static void storeRelaxed(Value& value, const Value& new_value) noexcept{
+#if defined(__GNUC__)
+        __atomic_store(&value, &new_value, __ATOMIC_RELAXED);
+#else
+        value = new_value;
+#endif
+    }
+
+    // Spread the key over the table. Block hashes may be sequential ids, so they are mixed first (splitmix64 finalizer).
+    size_t bucketOf(size_t key) const noexcept{
+        uint64_t mixed = static_cast<uint64_t>(key);
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+        mixed ^= mixed >> 31;
+        return static_cast<size_t>(mixed) & mask_;
+    }
+
+private:
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    size_t max_entries_ = 0;
+    std::atomic<uint64_t> version_{0};                  /* Odd while an erase shifts entries */
+};
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <unordered_map>
+#include <random>
+
+#include "hash_index.hpp"
+
+TEST(HashIndexHappyTests, InsertFindEraseTest){
+    HashIndex<size_t> index(4);
+    EXPECT_EQ(index.size(), static_cast<size_t>(0));
+    EXPECT_GE(index.capacity(), static_cast<size_t>(4));
+    EXPECT_EQ(index.find(1), nullptr);
+
+    EXPECT_TRUE(index.insert(1, 10));
+    EXPECT_TRUE(index.insert(2, 20));
+    EXPECT_FALSE(index.insert(1, 30)); // the key already exists
+    ASSERT_NE(index.find(1), nullptr);
+    EXPECT_EQ(*index.find(1), static_cast<size_t>(10));
+    EXPECT_EQ(index.size(), static_cast<size_t>(2));
+
+    // an erase moves the version by two, so it is even again once the erase is done
+    const uint64_t version = index.getVersion();
+    EXPECT_TRUE(index.erase(1));
+    EXPECT_FALSE(index.erase(1));
+    EXPECT_EQ(index.getVersion(), version + 2);
+    EXPECT_EQ(index.find(1), nullptr);
+    EXPECT_EQ(*index.find(2), static_cast<size_t>(20));
+
+    index.clear();
+    EXPECT_EQ(index.size(), static_cast<size_t>(0));
+    EXPECT_EQ(index.find(2), nullptr);
+}
+
+TEST(HashIndexHappyTests, MatchesUnorderedMapUnderChurnTest){
+    const size_t max_entries = 1000;
+    HashIndex<size_t> index(max_entries);
+    std::unordered_map<size_t, size_t> reference;
+    std::mt19937_64 rng(7);
+
+    for (size_t i = 0; i < 100000; ++i){
+        const size_t key = rng() % (max_entries * 2);
+        if (reference.count(key)){
+            EXPECT_TRUE(index.erase(key));
+            reference.erase(key);
+        } else if (reference.size() < max_entries){
+            EXPECT_TRUE(index.insert(key, i));
+            reference[key] = i;
+        }
+    }
+
+    EXPECT_EQ(index.size(), reference.size());
+    for (const auto& [key, value] : reference){
+        ASSERT_NE(index.find(key), nullptr);
+        EXPECT_EQ(*index.find(key), value);
+    }
+}
+
+TEST(HashIndexHappyTests, ReserveTest){
+    HashIndex<size_t> index(4);
+    // sequential keys, like the ids of a test, and random ones, like fingerprints
+    std::mt19937_64 rng(7);
+    std::unordered_map<size_t, size_t> reference;
+    for (size_t i = 0; i < 100'000; ++i){
+        const size_t key = i % 2 == 0 ? i : static_cast<size_t>(rng());
+        if (index.size() >= index.capacity()){
+            const size_t capacity = index.capacity();
+            index.reserve(capacity * 2);
+            ASSERT_GE(index.capacity(), capacity * 2);
+        }
+        ASSERT_TRUE(index.insert(key, i));
+        reference[key] = i;
+    }
+
+    // the entries survive every rehash
+    EXPECT_EQ(index.size(), reference.size());
+    for (const auto& [key, value] : reference){
+        ASSERT_NE(index.find(key), nullptr);
+        EXPECT_EQ(*index.find(key), value);
+    }
+
+    // a smaller reservation keeps the table
+    const size_t memory_usage = index.getMemoryUsage();
+    index.reserve(10);
+    EXPECT_EQ(index.getMemoryUsage(), memory_usage);
+}
+
+TEST(HashIndexUnhappyTests, InsertToFullIndexTest){
+    HashIndex<int> index(0);
+    size_t inserted = 0;
+    while (index.insert(inserted, 0)){
+        ++inserted;
+    }
+    EXPECT_EQ(inserted, index.capacity());
+    EXPECT_TRUE(index.erase(0));
+    EXPECT_TRUE(index.insert(inserted, 0));
+}
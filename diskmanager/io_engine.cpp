@@ -0,0 +1,371 @@
+#include "io_engine.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define IO_ENGINE_HAS_PREAD
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define IO_ENGINE_HAS_IO_URING
+#endif
+#endif
+
+using namespace std::string_literals;
+
+std::unique_ptr<IoEngine> IoEngine::create(const size_t queue_depth){
+#ifdef IO_ENGINE_HAS_IO_URING
+    try{
+        return std::make_unique<IoUringEngine>(queue_depth);
+    } catch (const std::exception&){
+        // the kernel is too old or io_uring is disabled, the thread pool does the same work with blocking calls
+    }
+#endif
+    return std::make_unique<ThreadPoolIoEngine>(std::min(queue_depth, ThreadPoolIoEngine::DEFAULT_THREADS_COUNT));
+}
+
+#ifdef IO_ENGINE_HAS_IO_URING
+namespace{
+    constexpr size_t MAX_FIXED_BUFFER_SIZE = size_t{1} << 30;
+
+    int ioUringSetup(const unsigned entries, io_uring_params& params) noexcept{
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    }
+
+    int ioUringEnter(const int ring_fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags) noexcept{
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int ioUringRegister(const int ring_fd, const unsigned opcode, const void* arg, const unsigned nr_args) noexcept{
+        return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+    }
+
+    // The ring indexes are shared with the kernel, so they are accessed with acquire/release semantics.
+    uint32_t loadAcquire(const uint32_t* index) noexcept{
+        return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+    }
+
+    void storeRelease(uint32_t* index, const uint32_t value) noexcept{
+        __atomic_store_n(index, value, __ATOMIC_RELEASE);
+    }
+
+    template <typename T>
+    T* ringPointer(void* ring, const uint32_t offset) noexcept{
+        return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+    }
+}
+
+IoUringEngine::IoUringEngine(const size_t queue_depth){
+    io_uring_params params{};
+    ring_fd_ = ioUringSetup(static_cast<unsigned>(std::max<size_t>(queue_depth, 1)), params);
+    if (ring_fd_ < 0){
+        throw std::runtime_error("Failed to set up an io_uring: "s + std::strerror(errno));
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP){
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED){
+        sq_ring_ = nullptr;
+    } else if (params.features & IORING_FEAT_SINGLE_MMAP){
+        cq_ring_ = sq_ring_;
+    } else{
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        cq_ring_ = cq_ring_ == MAP_FAILED ? nullptr : cq_ring_;
+    }
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    sqes_ = sqes_ == MAP_FAILED ? nullptr : sqes_;
+    if (!sq_ring_ || !cq_ring_ || !sqes_){
+        const std::string error = std::strerror(errno);
+        unmapRing();
+        throw std::runtime_error("Failed to map the io_uring queues: "s + error);
+    }
+
+    sq_head_ = ringPointer<uint32_t>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ringPointer<uint32_t>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *ringPointer<uint32_t>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = ringPointer<uint32_t>(sq_ring_, params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    cq_head_ = ringPointer<uint32_t>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ringPointer<uint32_t>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *ringPointer<uint32_t>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = ringPointer<void>(cq_ring_, params.cq_off.cqes);
+
+    // kernels before 5.6 set up rings but cannot run plain reads and writes
+    std::vector<char> probe_memory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probe_memory.data());
+    const bool probed = ioUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, 256) == 0;
+    const auto is_supported = [probe](const unsigned opcode){
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    };
+    if (!probed || !is_supported(IORING_OP_READ) || !is_supported(IORING_OP_WRITE)){
+        unmapRing();
+        throw std::runtime_error("Failed to set up an io_uring: the kernel does not support IORING_OP_READ/WRITE"s);
+    }
+}
+
+IoUringEngine::~IoUringEngine(){
+    unmapRing();
+}
+
+bool IoUringEngine::registerBuffers(const std::vector<std::pair<char*, size_t>>& buffers) noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!registered_buffers_.empty()){
+        ioUringRegister(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        registered_buffers_.clear();
+    }
+
+    try{
+        std::vector<std::pair<char*, size_t>> pieces;
+        for (const auto& [buffer, size] : buffers){
+            for (size_t offset = 0; offset < size; offset += MAX_FIXED_BUFFER_SIZE){
+                pieces.emplace_back(buffer + offset, std::min(size - offset, MAX_FIXED_BUFFER_SIZE));
+            }
+        }
+        if (pieces.empty()){
+            return true;
+        }
+
+        std::vector<iovec> iovecs(pieces.size());
+        for (size_t i = 0; i < pieces.size(); ++i){
+            iovecs[i].iov_base = pieces[i].first;
+            iovecs[i].iov_len = pieces[i].second;
+        }
+        // the kernel pins every page of the buffers, which may exceed RLIMIT_MEMLOCK
+        if (ioUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(iovecs.size())) != 0){
+            return false;
+        }
+        registered_buffers_ = std::move(pieces);
+        return true;
+    } catch (const std::exception&){
+        return false;
+    }
+}
+
+void IoUringEngine::execute(const IoRequest* requests, const size_t count, int64_t* results){
+    std::lock_guard<std::mutex> guard(latch_);
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+    const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+
+    size_t submitted_count = 0;
+    size_t completed_count = 0;
+    while (completed_count < count){
+        // fill the free part of the submission queue; the queue depth bounds the requests in flight,
+        // so the completion queue (twice as large) never overflows
+        uint32_t tail = *sq_tail_;
+        while (submitted_count < count && submitted_count - completed_count < sq_entries_){
+            const IoRequest& request = requests[submitted_count];
+            const uint32_t sqe_index = tail & sq_mask_;
+            io_uring_sqe& sqe = sqes[sqe_index];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            const int buffer_index = findRegisteredBuffer(request.buffer, request.size);
+            if (request.operation == IoOperation::READ){
+                sqe.opcode = buffer_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            } else{
+                sqe.opcode = buffer_index >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            }
+            sqe.fd = request.fd;
+            sqe.off = request.offset;
+            sqe.addr = reinterpret_cast<uint64_t>(request.buffer);
+            sqe.len = static_cast<uint32_t>(request.size);
+            sqe.buf_index = static_cast<uint16_t>(std::max(buffer_index, 0));
+            sqe.user_data = submitted_count;
+
+            sq_array_[sqe_index] = sqe_index;
+            ++tail;
+            ++submitted_count;
+        }
+        storeRelease(sq_tail_, tail);
+
+        enterRing();
+
+        uint32_t head = *cq_head_;
+        const uint32_t cq_tail = loadAcquire(cq_tail_);
+        for (; head != cq_tail; ++head){
+            const io_uring_cqe& cqe = cqes[head & cq_mask_];
+            results[cqe.user_data] = cqe.res;
+            ++completed_count;
+        }
+        storeRelease(cq_head_, head);
+    }
+}
+
+const char* IoUringEngine::getName() const noexcept{
+    return "io_uring";
+}
+
+int IoUringEngine::findRegisteredBuffer(const char* buffer, const size_t size) const noexcept{
+    for (size_t i = 0; i < registered_buffers_.size(); ++i){
+        const char* begin = registered_buffers_[i].first;
+        if (buffer >= begin && buffer + size <= begin + registered_buffers_[i].second){
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void IoUringEngine::enterRing(){
+    while (true){
+        // entries the kernel has not consumed yet are submitted again
+        const uint32_t to_submit = *sq_tail_ - loadAcquire(sq_head_);
+        if (ioUringEnter(ring_fd_, to_submit, 1, IORING_ENTER_GETEVENTS) >= 0){
+            return;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY){
+            throw std::runtime_error("Failed to submit I/O requests to the io_uring: "s + std::strerror(errno));
+        }
+    }
+}
+
+void IoUringEngine::unmapRing() noexcept{
+    if (sqes_){
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_){
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_){
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    sqes_ = sq_ring_ = cq_ring_ = nullptr;
+    if (ring_fd_ >= 0){
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+}
+
+#else
+
+IoUringEngine::IoUringEngine(const size_t){
+    throw std::runtime_error("Failed to set up an io_uring: not supported on this platform"s);
+}
+
+IoUringEngine::~IoUringEngine() = default;
+
+bool IoUringEngine::registerBuffers(const std::vector<std::pair<char*, size_t>>&) noexcept{
+    return false;
+}
+
+void IoUringEngine::execute(const IoRequest*, const size_t, int64_t*){
+}
+
+const char* IoUringEngine::getName() const noexcept{
+    return "io_uring";
+}
+
+#endif
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(const size_t threads_count){
+    workers_.reserve(threads_count);
+    for (size_t i = 0; i < threads_count; ++i){
+        workers_.emplace_back(&ThreadPoolIoEngine::runTasks, this);
+    }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine(){
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stop_ = true;
+    }
+    task_available_.notify_all();
+    for (std::thread& worker : workers_){
+        worker.join();
+    }
+}
+
+bool ThreadPoolIoEngine::registerBuffers(const std::vector<std::pair<char*, size_t>>&) noexcept{
+    return false;
+}
+
+void ThreadPoolIoEngine::execute(const IoRequest* requests, const size_t count, int64_t* results){
+    if (count == 0){
+        return;
+    }
+
+    Batch batch;
+    batch.pending_count = count;
+    std::unique_lock<std::mutex> lock(latch_);
+    for (size_t i = 0; i < count; ++i){
+        tasks_.push_back({&requests[i], &results[i], &batch});
+    }
+    task_available_.notify_all();
+
+    // the submitting thread works through the queue as well instead of only waiting for the workers
+    while (batch.pending_count > 0){
+        if (tasks_.empty()){
+            batch.completed.wait(lock, [&batch, this](){ return batch.pending_count == 0 || !tasks_.empty(); });
+            continue;
+        }
+        const Task task = tasks_.front();
+        tasks_.pop_front();
+        lock.unlock();
+        *task.result = runRequest(*task.request);
+        lock.lock();
+        if (--task.batch->pending_count == 0 && task.batch != &batch){
+            task.batch->completed.notify_one();
+        }
+    }
+}
+
+const char* ThreadPoolIoEngine::getName() const noexcept{
+    return "thread pool";
+}
+
+int64_t ThreadPoolIoEngine::runRequest(const IoRequest& request) noexcept{
+#ifdef IO_ENGINE_HAS_PREAD
+    size_t transferred = 0;
+    while (transferred < request.size){
+        const off_t offset = static_cast<off_t>(request.offset + transferred);
+        const ssize_t res = request.operation == IoOperation::READ
+                          ? ::pread(request.fd, request.buffer + transferred, request.size - transferred, offset)
+                          : ::pwrite(request.fd, request.buffer + transferred, request.size - transferred, offset);
+        if (res < 0 && errno == EINTR){
+            continue;
+        }
+        if (res < 0){
+            return -static_cast<int64_t>(errno);
+        }
+        if (res == 0){
+            break;
+        }
+        transferred += static_cast<size_t>(res);
+    }
+    return static_cast<int64_t>(transferred);
+#else
+    (void)request;
+    return -static_cast<int64_t>(ENOSYS);
+#endif
+}
+
+void ThreadPoolIoEngine::runTasks(){
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true){
+        task_available_.wait(lock, [this](){ return stop_ || !tasks_.empty(); });
+        if (stop_){
+            return;
+        }
+        const Task task = tasks_.front();
+        tasks_.pop_front();
+        lock.unlock();
+        *task.result = runRequest(*task.request);
+        lock.lock();
+        if (--task.batch->pending_count == 0){
+            task.batch->completed.notify_one();
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+enum class IoOperation{
+    READ,
+    WRITE
+};
+
+/* A single positioned read or write of an IoEngine batch. */
+struct IoRequest{
+    IoOperation operation = IoOperation::READ;
+    int fd = -1;
+    char* buffer = nullptr;                 /* aligned to `DATA_BLOCK_ALIGNMENT` if the file is opened with O_DIRECT */
+    size_t size = 0;
+    uint64_t offset = 0;
+};
+
+/* Runs batches of block reads and writes. A batch is handed to the device at once, so its requests are served in parallel
+   instead of one after another; a single thread keeps the device queue full.
+
+   - `IoEngine::create()` returns an io_uring engine on Linux kernels which provide it and falls back to a pool of threads
+     doing `pread`/`pwrite` everywhere else (older kernels, io_uring disabled by the administrator or a seccomp filter).
+   - Memory registered with `registerBuffers()` is pinned once and transferred without per-request page mapping
+     (io_uring fixed buffers). The thread pool ignores the registration.
+   - Engines may be shared between threads; each batch completes independently. */
+class IoEngine{
+public:
+    virtual ~IoEngine() = default;
+
+    /** Create the fastest engine the system supports.
+     * @param[in] queue_depth number of requests in flight at once
+     * @throw `std::runtime_error` if no engine can be started.
+    */
+    static std::unique_ptr<IoEngine> create(const size_t queue_depth = DEFAULT_QUEUE_DEPTH);
+
+public:
+    /** Register memory ranges the requests will transfer to and from, e.g. the frame pool of a BufferManager.
+     * Requests whose buffer lies inside a registered range use it automatically. Replaces the previous registration.
+     * @return `false` if the engine does not support registration or the memory cannot be pinned; requests still work then.
+    */
+    virtual bool registerBuffers(const std::vector<std::pair<char*, size_t>>& buffers) noexcept = 0;
+
+    /** Run a batch of requests and wait until all of them have completed.
+     * @param[in] requests requests of the batch, executed in no particular order
+     * @param[in] count number of requests
+     * @param[out] results `count` values: the number of transferred bytes of every request or `-errno` if it has failed
+     * @throw `std::runtime_error` if the batch cannot be submitted.
+    */
+    virtual void execute(const IoRequest* requests, const size_t count, int64_t* results) = 0;
+
+    // Get a short name of the engine for logs and benchmarks.
+    virtual const char* getName() const noexcept = 0;
+
+    static constexpr size_t DEFAULT_QUEUE_DEPTH = 128;
+};
+
+/* io_uring engine driven through raw system calls (no liburing). A batch is written to the submission queue and handed to
+   the kernel with one `io_uring_enter()`; its completions are reaped by the same call. Batches of several threads take
+   turns on the ring. Requires Linux 5.6 (IORING_OP_READ/WRITE). */
+class IoUringEngine : public IoEngine{
+public:
+    /** Set up a ring.
+     * @param[in] queue_depth number of submission queue entries, rounded up to a power of two by the kernel
+     * @throw `std::runtime_error` if the kernel does not provide io_uring or lacks the needed operations.
+    */
+    explicit IoUringEngine(const size_t queue_depth = DEFAULT_QUEUE_DEPTH);
+
+    ~IoUringEngine() override;
+
+    IoUringEngine(const IoUringEngine&) = delete;
+    IoUringEngine& operator=(const IoUringEngine&) = delete;
+
+public:
+    // Registers the ranges as fixed buffers, split into pieces of at most 1 GB (the kernel limit).
+    bool registerBuffers(const std::vector<std::pair<char*, size_t>>& buffers) noexcept override;
+
+    void execute(const IoRequest* requests, const size_t count, int64_t* results) override;
+
+    const char* getName() const noexcept override;
+
+private:
+    // Get the index of the registered buffer holding the whole transfer, or `-1`.
+    int findRegisteredBuffer(const char* buffer, const size_t size) const noexcept;
+
+    // Submit the queued entries and wait for at least one completion.
+    void enterRing();
+
+    void unmapRing() noexcept;
+
+private:
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;                           /* same mapping as `sq_ring_` on kernels with IORING_FEAT_SINGLE_MMAP */
+    size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    uint32_t* sq_head_ = nullptr;
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t* sq_array_ = nullptr;
+    uint32_t sq_entries_ = 0;
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    uint32_t cq_mask_ = 0;
+    void* cqes_ = nullptr;
+
+    std::mutex latch_;                                  /* The ring has a single producer and a single consumer */
+    std::vector<std::pair<char*, size_t>> registered_buffers_;
+};
+
+/* Fallback engine: a pool of threads doing `pread`/`pwrite`. The submitting thread executes requests of its batch as well,
+   so a batch of one never waits for a context switch. */
+class ThreadPoolIoEngine : public IoEngine{
+public:
+    /** Start the worker threads.
+     * @param[in] threads_count number of workers besides the submitting thread
+    */
+    explicit ThreadPoolIoEngine(const size_t threads_count = DEFAULT_THREADS_COUNT);
+
+    ~ThreadPoolIoEngine() override;
+
+    ThreadPoolIoEngine(const ThreadPoolIoEngine&) = delete;
+    ThreadPoolIoEngine& operator=(const ThreadPoolIoEngine&) = delete;
+
+public:
+    // The pool reads into any memory, so there is nothing to register.
+    bool registerBuffers(const std::vector<std::pair<char*, size_t>>& buffers) noexcept override;
+
+    void execute(const IoRequest* requests, const size_t count, int64_t* results) override;
+
+    const char* getName() const noexcept override;
+
+    static constexpr size_t DEFAULT_THREADS_COUNT = 8;
+
+private:
+    /* Requests of one `execute()` call which have not completed yet. */
+    struct Batch{
+        size_t pending_count = 0;
+        std::condition_variable completed;
+    };
+
+    struct Task{
+        const IoRequest* request = nullptr;
+        int64_t* result = nullptr;
+        Batch* batch = nullptr;
+    };
+
+    // Run one request to the end, retrying interrupted and partial transfers.
+    static int64_t runRequest(const IoRequest& request) noexcept;
+
+    // Body of a worker thread.
+    void runTasks();
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex latch_;                                  /* Guards the tasks and the batches */
+    std::condition_variable task_available_;
+    std::deque<Task> tasks_;
+    bool stop_ = false;
+};
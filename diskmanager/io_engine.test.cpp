@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cerrno>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io_engine.hpp"
+
+namespace{
+    // Write `blocks_count` numbered blocks with the engine, read them back into a registered buffer and compare.
+    void checkEngineRoundTrip(IoEngine& engine){
+        const std::filesystem::path file_path = std::filesystem::temp_directory_path() / std::filesystem::path("io_engine_test_file");
+        const int fd = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+
+        constexpr size_t blocks_count = 300;            /* more than the queue depth used by the tests */
+        AlignedBuffer written_data = allocateAlignedBuffer(blocks_count * MAX_DATA_BLOCK_SIZE);
+        AlignedBuffer read_data = allocateAlignedBuffer(blocks_count * MAX_DATA_BLOCK_SIZE);
+        engine.registerBuffers({{read_data.get(), blocks_count * MAX_DATA_BLOCK_SIZE}});
+
+        std::vector<IoRequest> requests(blocks_count);
+        std::vector<int64_t> results(blocks_count, 0);
+        for (size_t i = 0; i < blocks_count; ++i){
+            std::memset(written_data.get() + i * MAX_DATA_BLOCK_SIZE, static_cast<int>('a' + i % 26), MAX_DATA_BLOCK_SIZE);
+            requests[i].operation = IoOperation::WRITE;
+            requests[i].fd = fd;
+            requests[i].buffer = written_data.get() + i * MAX_DATA_BLOCK_SIZE;
+            requests[i].size = MAX_DATA_BLOCK_SIZE;
+            requests[i].offset = i * MAX_DATA_BLOCK_SIZE;
+        }
+        engine.execute(requests.data(), requests.size(), results.data());
+        for (const int64_t result : results){
+            EXPECT_EQ(result, static_cast<int64_t>(MAX_DATA_BLOCK_SIZE));
+        }
+
+        // the blocks are read back in reverse order, each into the place of its number
+        for (size_t i = 0; i < blocks_count; ++i){
+            requests[i].operation = IoOperation::READ;
+            requests[i].buffer = read_data.get() + (blocks_count - 1 - i) * MAX_DATA_BLOCK_SIZE;
+            requests[i].offset = (blocks_count - 1 - i) * MAX_DATA_BLOCK_SIZE;
+        }
+        engine.execute(requests.data(), requests.size(), results.data());
+        for (const int64_t result : results){
+            EXPECT_EQ(result, static_cast<int64_t>(MAX_DATA_BLOCK_SIZE));
+        }
+        EXPECT_EQ(std::memcmp(written_data.get(), read_data.get(), blocks_count * MAX_DATA_BLOCK_SIZE), 0);
+
+        // failures are reported per request, the rest of the batch completes
+        requests.resize(2);
+        requests[1].fd = -1;
+        engine.execute(requests.data(), requests.size(), results.data());
+        EXPECT_EQ(results[0], static_cast<int64_t>(MAX_DATA_BLOCK_SIZE));
+        EXPECT_EQ(results[1], -static_cast<int64_t>(EBADF));
+
+        ::close(fd);
+        std::filesystem::remove(file_path);
+    }
+}
+
+TEST(IoEngineHappyTests, DefaultEngineTest){
+    const std::unique_ptr<IoEngine> engine = IoEngine::create(64);
+    ASSERT_NE(engine, nullptr);
+    checkEngineRoundTrip(*engine);
+}
+
+TEST(IoEngineHappyTests, ThreadPoolEngineTest){
+    ThreadPoolIoEngine engine(4);
+    EXPECT_FALSE(engine.registerBuffers({}));
+    checkEngineRoundTrip(engine);
+}
+
+TEST(IoEngineHappyTests, IoUringEngineTest){
+    std::unique_ptr<IoUringEngine> engine;
+    try{
+        engine = std::make_unique<IoUringEngine>(64);
+    } catch (const std::runtime_error& e){
+        GTEST_SKIP() << e.what();
+    }
+    checkEngineRoundTrip(*engine);
+}
@@ -0,0 +1,131 @@
+#include "block_manager.hpp"
+#include "mapped_file_block_store.hpp"
+#include "bench_common.hpp"
+
+#include <numeric>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Compares reading blocks through the buffer pool (RawFileBlockStore, misses read with `pread` into BufferManager frames)
+   with reading them through the kernel page cache (MappedFileBlockStore, views straight into the mapping), in ns per block.
+   Both read the same block file with `readBlockView()`:
+   - a working set smaller than RAM, measured after a warm-up scan, so both serve it from memory;
+   - a working set larger than RAM, measured cold: pool misses turn into `pread` calls, mapping misses into page faults.
+   Every set is read with a sequential scan and with uniformly random reads.
+   The block file is written to `directory`, which should be on the device to measure rather than on tmpfs.
+   Usage: MappedFileBlockStoreBenchmark [directory = temp] [small_set_mb = 256] [large_set_mb = 5/4 of RAM] [pool_mb = 128] */
+
+using namespace std::string_literals;
+
+namespace{
+    size_t getPhysicalMemory(){
+        return static_cast<size_t>(::sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    // Get the indexes of all blocks in the order they are stored.
+    std::vector<size_t> makeScanOrder(const size_t blocks_count){
+        std::vector<size_t> scan_order(blocks_count);
+        std::iota(scan_order.begin(), scan_order.end(), 0);
+        return scan_order;
+    }
+
+    // Write `blocks_count` distinct blocks into a new block file and return their hashes in the order they are stored.
+    std::vector<size_t> writeBlockFile(const std::filesystem::path& file_path, const size_t blocks_count){
+        RawFileBlockStore store(file_path, false, blocks_count);
+        std::vector<size_t> block_hashes;
+        block_hashes.reserve(blocks_count);
+        std::vector<StoredDataBlock> batch(1'024);
+        for (size_t block = 0; block < blocks_count; block += batch.size()){
+            batch.resize(std::min(batch.size(), blocks_count - block));
+            for (size_t i = 0; i < batch.size(); ++i){
+                DataBlock& dblock = batch[i].dblock;
+                std::memset(dblock.data, static_cast<int>('a' + (block + i) % 26), MAX_DATA_BLOCK_SIZE);
+                const std::string block_number = std::to_string(block + i);
+                std::memcpy(dblock.data, block_number.data(), block_number.size());
+                dblock.data_size = MAX_DATA_BLOCK_SIZE;
+                batch[i].block_hash = dblock.Hash();
+                batch[i].seq_no = block + i;
+                block_hashes.push_back(batch[i].block_hash);
+            }
+            store.writeBlocks(batch);
+        }
+        store.sync();
+        return block_hashes;
+    }
+
+    // Drop the pages of the file from the page cache, so the next reads go to the device.
+    void dropPageCache(const std::filesystem::path& file_path){
+        const int fd = ::open(file_path.c_str(), O_RDONLY);
+        if (fd >= 0){
+#ifdef POSIX_FADV_DONTNEED
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+            ::close(fd);
+        }
+    }
+
+    double measureReads(BlockManager& bmanager, const std::vector<size_t>& block_hashes, const std::vector<size_t>& read_order){
+        return measureNsPerOp(read_order.size(), [&](const size_t i){
+            const BlockHandle block_view = bmanager.readBlockView(block_hashes[read_order[i]]);
+            if (block_view.isValid()){
+                doNotOptimize(block_view.getData()[MAX_DATA_BLOCK_SIZE - 1]);
+            }
+        });
+    }
+
+    // Measure one access pattern in both modes. Returns the ns per block of the pool and of the mapping.
+    std::pair<double, double> measureModes(const std::filesystem::path& file_path, const std::vector<size_t>& block_hashes,
+                                           const std::vector<size_t>& read_order, const size_t pool_memory_budget, const bool cold){
+        std::vector<double> results;
+        for (const bool mapped : {false, true}){
+            std::unique_ptr<BlockStore> store;
+            if (mapped){
+                store = std::make_unique<MappedFileBlockStore>(file_path);
+            } else{
+                store = std::make_unique<RawFileBlockStore>(file_path);
+            }
+            BlockManager bmanager(std::move(store), pool_memory_budget);
+            if (cold){
+                dropPageCache(file_path);
+            } else{
+                measureReads(bmanager, block_hashes, makeScanOrder(block_hashes.size()));
+            }
+            results.push_back(measureReads(bmanager, block_hashes, read_order));
+        }
+        return {results[0], results[1]};
+    }
+}
+
+int main(int argc, char** argv){
+    const std::filesystem::path directory = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::temp_directory_path();
+    const size_t small_set_bytes = readSizeArgument(argc, argv, 2, 256) << 20;
+    const size_t large_set_bytes = readSizeArgument(argc, argv, 3, getPhysicalMemory() / 4 * 5 >> 20) << 20;
+    const size_t pool_memory_budget = readSizeArgument(argc, argv, 4, 128) << 20;
+    const std::filesystem::path file_path = directory / "mapped_file_block_store_bench.raw"s;
+
+    std::cout << "RAM: " << (getPhysicalMemory() >> 20) << " MB, buffer pool: " << (pool_memory_budget >> 20) << " MB" << std::endl;
+    std::cout << std::setw(12) << "set, MB" << std::setw(12) << "pattern" << std::setw(16) << "pool ns/blk"
+              << std::setw(16) << "mmap ns/blk" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+
+    for (const size_t set_bytes : {small_set_bytes, large_set_bytes}){
+        const size_t blocks_count = std::max(set_bytes / MAX_DATA_BLOCK_SIZE, static_cast<size_t>(1));
+        const std::vector<size_t> block_hashes = writeBlockFile(file_path, blocks_count);
+        const bool cold = set_bytes > getPhysicalMemory();
+
+        const std::vector<size_t> scan_order = makeScanOrder(blocks_count);
+        const std::vector<size_t> random_order = makeRandomIndexes(std::min(blocks_count, static_cast<size_t>(200'000)), blocks_count);
+
+        for (const auto& [pattern, read_order] : {std::make_pair("sequential", &scan_order), std::make_pair("random", &random_order)}){
+            const auto [pool_ns, mapped_ns] = measureModes(file_path, block_hashes, *read_order, pool_memory_budget, cold);
+            std::cout << std::setw(12) << (set_bytes >> 20) << std::setw(12) << pattern << std::setw(16) << pool_ns
+                      << std::setw(16) << mapped_ns << std::endl;
+        }
+
+        std::filesystem::remove(file_path);
+        std::filesystem::path table_path = file_path;
+        table_path += ".slots";
+        std::filesystem::remove(table_path);
+    }
+}
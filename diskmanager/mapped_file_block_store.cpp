@@ -0,0 +1,235 @@
+#include "mapped_file_block_store.hpp"
+
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define MAPPED_FILE_BLOCK_STORE_SUPPORTED
+#endif
+
+using namespace std::string_literals;
+
+#ifdef MAPPED_FILE_BLOCK_STORE_SUPPORTED
+
+MappedFileBlockStore::MappedFileBlockStore(const std::filesystem::path& file_path, const size_t preallocated_slots)
+    : RawFileBlockStore(file_path, false, preallocated_slots),
+      chunks_((static_cast<size_t>(UINT32_MAX) + CHUNK_SLOTS - 1) / CHUNK_SLOTS, nullptr),
+      page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))){
+}
+
+MappedFileBlockStore::~MappedFileBlockStore(){
+    for (char* chunk : chunks_){
+        if (chunk != nullptr){
+            ::munmap(chunk, CHUNK_SLOTS * SLOT_SIZE);
+        }
+    }
+}
+
+std::vector<StoredDataBlock> MappedFileBlockStore::readBlocks(const std::vector<size_t>& block_hashes){
+    std::shared_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    std::vector<StoredDataBlock> loaded_blocks;
+    loaded_blocks.reserve(block_hashes.size());
+    for (const size_t block_hash : block_hashes){
+        uint32_t slot = 0;
+        size_t data_size = 0;
+        uint64_t seq_no = 0;
+        uint32_t checksum = 0;
+        if (!findSlot(block_hash, slot, data_size, seq_no, checksum)){
+            continue;
+        }
+        const char* slot_data = viewSlot(slot);
+        if (slot_data == nullptr){
+            throw std::runtime_error("Failed to map the block file"s);
+        }
+
+        StoredDataBlock& loaded_block = loaded_blocks.emplace_back();
+        loaded_block.block_hash = block_hash;
+        loaded_block.seq_no = seq_no;
+        loaded_block.checksum = checksum;
+        loaded_block.dblock.data_size = data_size;
+        std::memcpy(loaded_block.dblock.data, slot_data, data_size);
+    }
+    return loaded_blocks;
+}
+
+void MappedFileBlockStore::readBlocksInto(BlockReadTarget* targets, const size_t count){
+    std::shared_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    for (size_t i = 0; i < count; ++i){
+        uint32_t slot = 0;
+        targets[i].data_size = 0;
+        if (!findSlot(targets[i].block_hash, slot, targets[i].data_size, targets[i].seq_no, targets[i].checksum)){
+            continue;
+        }
+        const char* slot_data = viewSlot(slot);
+        if (slot_data == nullptr){
+            throw std::runtime_error("Failed to map the block file"s);
+        }
+        std::memcpy(targets[i].buffer, slot_data, SLOT_SIZE);
+    }
+}
+
+bool MappedFileBlockStore::isMapped() const noexcept{
+    return true;
+}
+
+const char* MappedFileBlockStore::viewBlock(const size_t block_hash, size_t& data_size, uint32_t& checksum) noexcept{
+    uint32_t slot = 0;
+    uint64_t seq_no = 0;
+    if (!findSlot(block_hash, slot, data_size, seq_no, checksum)){
+        return nullptr;
+    }
+    return viewSlot(slot);
+}
+
+void MappedFileBlockStore::adviseWillNeed(const std::vector<size_t>& block_hashes) noexcept{
+    for (const size_t block_hash : block_hashes){
+        uint32_t slot = 0;
+        size_t data_size = 0;
+        uint64_t seq_no = 0;
+        uint32_t checksum = 0;
+        if (!findSlot(block_hash, slot, data_size, seq_no, checksum)){
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(mapping_latch_);
+        const char* slot_data = getSlotData(slot);
+        if (slot_data != nullptr){
+            advise(slot_data, SLOT_SIZE, MADV_WILLNEED);
+        }
+    }
+}
+
+const char* MappedFileBlockStore::viewSlot(const uint32_t slot) noexcept{
+    std::lock_guard<std::mutex> guard(mapping_latch_);
+    const char* slot_data = getSlotData(slot);
+    if (slot_data != nullptr){
+        observeRead(slot);
+    }
+    return slot_data;
+}
+
+const char* MappedFileBlockStore::getSlotData(const uint32_t slot) noexcept{
+    const size_t chunk = slot / CHUNK_SLOTS;
+    if (chunks_[chunk] == nullptr){
+        // the chunk may reach past the end of the file; only written slots are ever touched
+        void* mapping = ::mmap(nullptr, CHUNK_SLOTS * SLOT_SIZE, PROT_READ, MAP_SHARED, getDataFile(),
+                               static_cast<off_t>(chunk * CHUNK_SLOTS * SLOT_SIZE));
+        if (mapping == MAP_FAILED){
+            return nullptr;
+        }
+        chunks_[chunk] = static_cast<char*>(mapping);
+
+        // a new chunk follows the hint of the others
+        const MappedAccessPattern access_pattern = access_pattern_.load(std::memory_order_relaxed);
+        if (access_pattern != MappedAccessPattern::NORMAL){
+            advise(chunks_[chunk], CHUNK_SLOTS * SLOT_SIZE, access_pattern == MappedAccessPattern::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+        }
+    }
+    return chunks_[chunk] + (slot % CHUNK_SLOTS) * SLOT_SIZE;
+}
+
+void MappedFileBlockStore::observeRead(const uint32_t slot) noexcept{
+    // a block read twice in a row says nothing about the order
+    if (slot == last_read_slot_ + 1){
+        ++sequential_reads_count_;
+        random_reads_count_ = 0;
+    } else if (slot != last_read_slot_){
+        ++random_reads_count_;
+        sequential_reads_count_ = 0;
+    }
+    last_read_slot_ = slot;
+
+    MappedAccessPattern access_pattern = access_pattern_.load(std::memory_order_relaxed);
+    int advice = -1;
+    if (sequential_reads_count_ >= SEQUENTIAL_READS_BEFORE_ADVICE && access_pattern != MappedAccessPattern::SEQUENTIAL){
+        access_pattern = MappedAccessPattern::SEQUENTIAL;
+        advice = MADV_SEQUENTIAL;
+        read_ahead_end_slot_ = 0;
+    } else if (random_reads_count_ >= RANDOM_READS_BEFORE_ADVICE && access_pattern != MappedAccessPattern::RANDOM){
+        access_pattern = MappedAccessPattern::RANDOM;
+        advice = MADV_RANDOM;
+    }
+    if (advice != -1){
+        access_pattern_.store(access_pattern, std::memory_order_relaxed);
+        for (const char* chunk : chunks_){
+            if (chunk != nullptr){
+                advise(chunk, CHUNK_SLOTS * SLOT_SIZE, advice);
+            }
+        }
+    }
+    if (access_pattern != MappedAccessPattern::SEQUENTIAL || sequential_reads_count_ == 0){
+        return;
+    }
+
+    // the next window is requested once the reader has consumed half of the current one
+    const uint64_t window_begin = std::max(static_cast<uint64_t>(slot) + 1, read_ahead_end_slot_);
+    const uint64_t window_end = std::min(static_cast<uint64_t>(slot) + 1 + READ_AHEAD_SLOTS, static_cast<uint64_t>(UINT32_MAX));
+    if (window_begin >= window_end || window_end - window_begin < READ_AHEAD_SLOTS / 2){
+        return;
+    }
+    for (uint64_t run_begin = window_begin; run_begin < window_end;){
+        // a window may cross the border of two chunks
+        const uint64_t run_end = std::min(window_end, (run_begin / CHUNK_SLOTS + 1) * CHUNK_SLOTS);
+        const char* run_data = getSlotData(static_cast<uint32_t>(run_begin));
+        if (run_data != nullptr){
+            advise(run_data, (run_end - run_begin) * SLOT_SIZE, MADV_WILLNEED);
+        }
+        run_begin = run_end;
+    }
+    read_ahead_end_slot_ = window_end;
+}
+
+void MappedFileBlockStore::advise(const char* address, const size_t size, const int advice) const noexcept{
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(address) & ~(static_cast<uintptr_t>(page_size_) - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(address) + size;
+    // a hint which is not taken only costs speed
+    ::madvise(reinterpret_cast<void*>(begin), static_cast<size_t>(end - begin), advice);
+}
+
+#else
+
+MappedFileBlockStore::MappedFileBlockStore(const std::filesystem::path& file_path, const size_t preallocated_slots)
+    : RawFileBlockStore(file_path, false, preallocated_slots){
+}
+
+MappedFileBlockStore::~MappedFileBlockStore() = default;
+
+std::vector<StoredDataBlock> MappedFileBlockStore::readBlocks(const std::vector<size_t>&){
+    return {};
+}
+
+void MappedFileBlockStore::readBlocksInto(BlockReadTarget*, const size_t){
+}
+
+bool MappedFileBlockStore::isMapped() const noexcept{
+    return false;
+}
+
+const char* MappedFileBlockStore::viewBlock(const size_t, size_t&, uint32_t&) noexcept{
+    return nullptr;
+}
+
+void MappedFileBlockStore::adviseWillNeed(const std::vector<size_t>&) noexcept{
+}
+
+const char* MappedFileBlockStore::viewSlot(const uint32_t) noexcept{
+    return nullptr;
+}
+
+const char* MappedFileBlockStore::getSlotData(const uint32_t) noexcept{
+    return nullptr;
+}
+
+void MappedFileBlockStore::observeRead(const uint32_t) noexcept{
+}
+
+void MappedFileBlockStore::advise(const char*, const size_t, const int) const noexcept{
+}
+
+#endif
+
+MappedAccessPattern MappedFileBlockStore::getAccessPattern() const noexcept{
+    return access_pattern_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#include "raw_file_block_store.hpp"
+
+enum class MappedAccessPattern{
+    NORMAL,                                             /* no hint, the kernel reads a little ahead of every fault */
+    SEQUENTIAL,                                         /* MADV_SEQUENTIAL, the next window is requested with MADV_WILLNEED */
+    RANDOM                                              /* MADV_RANDOM, faults read only the touched page */
+};
+
+/* Block file of the RawFileBlockStore format whose payloads are read through a shared read-only mapping, so the kernel
+   page cache does the caching instead of the buffer pool. Meant for read-mostly data sets.
+
+   - Blocks are written with `pwrite` as by RawFileBlockStore; the page cache keeps the mapping coherent with them.
+   - The file is mapped in chunks of 1 GB of address space, each on first use. Chunks are never moved or unmapped while the
+     store is open, so a view returned by `viewBlock()` stays valid as long as the store does, even while the file grows.
+     A removed block's slot may be reused by a later write, so the blocks must not be removed while views of them are in use.
+   - The order of the reads drives the `madvise` hints: a run of reads of neighbouring slots switches to SEQUENTIAL
+     and requests the following slots with WILLNEED, a run of scattered reads switches to RANDOM. */
+class MappedFileBlockStore : public RawFileBlockStore{
+public:
+    /** Open a block file, creating it if it does not exist.
+     * @param[in] file_path path of the data file; the slot table is kept next to it
+     * @param[in] preallocated_slots number of slots the data file is preallocated for
+     * @throw `std::runtime_error` if the files cannot be opened or the slot table cannot be read.
+    */
+    explicit MappedFileBlockStore(const std::filesystem::path& file_path, const size_t preallocated_slots = DEFAULT_PREALLOCATED_SLOTS);
+
+    ~MappedFileBlockStore() override;
+
+public:
+    // Copies the blocks out of the mapping.
+    std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) override;
+
+    void readBlocksInto(BlockReadTarget* targets, const size_t count) override;
+
+    bool isMapped() const noexcept override;
+
+    const char* viewBlock(const size_t block_hash, size_t& data_size, uint32_t& checksum) noexcept override;
+
+    void adviseWillNeed(const std::vector<size_t>& block_hashes) noexcept override;
+
+public:
+    // Get the hint the mapping is advised with at the moment.
+    MappedAccessPattern getAccessPattern() const noexcept;
+
+    static constexpr size_t CHUNK_SLOTS = size_t(1) << 18;                 /* 1 GB of address space per mapping */
+    static constexpr size_t READ_AHEAD_SLOTS = 64;                          /* Slots requested ahead of a sequential reader */
+    static constexpr size_t SEQUENTIAL_READS_BEFORE_ADVICE = 4;
+    static constexpr size_t RANDOM_READS_BEFORE_ADVICE = 16;
+
+private:
+    /** Get the address of the slot's payload for a read, mapping its chunk on first use.
+     * @return `nullptr` if the chunk cannot be mapped.
+    */
+    const char* viewSlot(const uint32_t slot) noexcept;
+
+    // Same as `viewSlot()` without following the read. Must be called under the mapping latch.
+    const char* getSlotData(const uint32_t slot) noexcept;
+
+    // Follow the order of the reads and switch the hint of the mapping once it changes. Must be called under the mapping latch.
+    void observeRead(const uint32_t slot) noexcept;
+
+    // Apply the hint to `size` bytes of the mapping at `address`, widened to whole pages.
+    void advise(const char* address, const size_t size, const int advice) const noexcept;
+
+private:
+    std::mutex mapping_latch_;                          /* Guards the chunks and the access pattern below */
+    std::vector<char*> chunks_;                         /* Mapping of every chunk, `nullptr` until first used */
+    size_t page_size_ = 0;
+
+    std::atomic<MappedAccessPattern> access_pattern_{MappedAccessPattern::NORMAL};
+    uint32_t last_read_slot_ = 0;
+    size_t sequential_reads_count_ = 0;
+    size_t random_reads_count_ = 0;
+    uint64_t read_ahead_end_slot_ = 0;                  /* End of the last window requested with WILLNEED */
+};
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mapped_file_block_store.hpp"
+
+using namespace std::filesystem;
+using namespace std::string_literals;
+
+class MappedFileBlockStoreTests : public testing::Test{
+protected:
+    void SetUp() override{
+        create_directory(test_dir_path_);
+        for (size_t i = 0; i < 64; ++i){
+            const std::string data = "Mapped block number "s + std::to_string(i);
+            StoredDataBlock& stored_block = stored_blocks_.emplace_back();
+            stored_block.dblock.data_size = data.size();
+            std::memcpy(stored_block.dblock.data, data.data(), data.size());
+            stored_block.block_hash = stored_block.dblock.Hash();
+            stored_block.seq_no = i;
+        }
+    }
+
+    void TearDown() override{
+        remove_all(test_dir_path_);
+    }
+
+    std::vector<StoredDataBlock> stored_blocks_;
+
+    static path test_dir_path_;
+    static path test_file_path_;
+};
+
+path MappedFileBlockStoreTests::test_dir_path_ = std::filesystem::temp_directory_path() / path("mapped_file_block_store_test_tmp_dir");
+path MappedFileBlockStoreTests::test_file_path_ = test_dir_path_ / path("blocks.raw");
+
+TEST_F(MappedFileBlockStoreTests, ViewTest){
+    MappedFileBlockStore store(test_file_path_, 8);
+    EXPECT_TRUE(store.isMapped());
+    store.writeBlocks({stored_blocks_[0]});
+
+    size_t data_size = 0;
+    uint32_t checksum = 0;
+    const char* first_view = store.viewBlock(stored_blocks_[0].block_hash, data_size, checksum);
+    ASSERT_NE(first_view, nullptr);
+    EXPECT_EQ(data_size, stored_blocks_[0].dblock.data_size);
+    EXPECT_EQ(std::memcmp(first_view, stored_blocks_[0].dblock.data, data_size), 0);
+    EXPECT_TRUE(isBlockChecksumValid(first_view, data_size, checksum));
+    EXPECT_NE(checksum, 0u);
+    EXPECT_EQ(store.viewBlock(42, data_size, checksum), nullptr);
+
+    // the file grows past its preallocated size, the view taken before stays where it is
+    store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks_.begin() + 1, stored_blocks_.end()));
+    EXPECT_EQ(std::memcmp(first_view, stored_blocks_[0].dblock.data, stored_blocks_[0].dblock.data_size), 0);
+    const char* last_view = store.viewBlock(stored_blocks_.back().block_hash, data_size, checksum);
+    ASSERT_NE(last_view, nullptr);
+    EXPECT_EQ(std::memcmp(last_view, stored_blocks_.back().dblock.data, data_size), 0);
+
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlocks({stored_blocks_[10].block_hash, 42});
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(1));
+    EXPECT_EQ(loaded_blocks.front().dblock, stored_blocks_[10].dblock);
+    EXPECT_EQ(loaded_blocks.front().seq_no, static_cast<uint64_t>(10));
+}
+
+TEST_F(MappedFileBlockStoreTests, ReopenTest){
+    {
+        RawFileBlockStore store(test_file_path_);
+        store.writeBlocks(stored_blocks_);
+    }
+
+    // the mapped store reads the files of the raw store
+    MappedFileBlockStore store(test_file_path_);
+    EXPECT_EQ(store.getBlocksCount(), stored_blocks_.size());
+    size_t data_size = 0;
+    uint32_t checksum = 0;
+    const char* view = store.viewBlock(stored_blocks_[20].block_hash, data_size, checksum);
+    ASSERT_NE(view, nullptr);
+    EXPECT_EQ(std::memcmp(view, stored_blocks_[20].dblock.data, data_size), 0);
+    store.adviseWillNeed({stored_blocks_[30].block_hash, 42});
+}
+
+TEST_F(MappedFileBlockStoreTests, AccessPatternTest){
+    MappedFileBlockStore store(test_file_path_);
+    store.writeBlocks(stored_blocks_);
+    EXPECT_EQ(store.getAccessPattern(), MappedAccessPattern::NORMAL);
+
+    size_t data_size = 0;
+    uint32_t checksum = 0;
+    for (size_t i = 0; i <= MappedFileBlockStore::SEQUENTIAL_READS_BEFORE_ADVICE; ++i){
+        store.viewBlock(stored_blocks_[i].block_hash, data_size, checksum);
+    }
+    EXPECT_EQ(store.getAccessPattern(), MappedAccessPattern::SEQUENTIAL);
+
+    // scattered reads turn the kernel read-ahead off
+    for (size_t i = 0; i < MappedFileBlockStore::RANDOM_READS_BEFORE_ADVICE; ++i){
+        store.viewBlock(stored_blocks_[(i * 37 + 11) % stored_blocks_.size()].block_hash, data_size, checksum);
+    }
+    EXPECT_EQ(store.getAccessPattern(), MappedAccessPattern::RANDOM);
+}
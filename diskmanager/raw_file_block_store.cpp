@@ -0,0 +1,606 @@
+#include "raw_file_block_store.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RAW_FILE_BLOCK_STORE_SUPPORTED
+#endif
+
+using namespace std::string_literals;
+
+#ifdef RAW_FILE_BLOCK_STORE_SUPPORTED
+namespace{
+    std::runtime_error makeIoError(const std::string& what){
+        return std::runtime_error(what + ": "s + std::strerror(errno));
+    }
+
+    /** Open a data file, falling back to buffered I/O if the file system rejects O_DIRECT.
+     * @param[in,out] direct_io whether the page cache is bypassed
+    */
+    int openDataFile(const std::filesystem::path& file_path, bool& direct_io){
+        const int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+#ifdef O_DIRECT
+        if (direct_io){
+            const int fd = ::open(file_path.c_str(), flags | O_DIRECT, 0644);
+            if (fd >= 0 || errno != EINVAL){
+                return fd;
+            }
+            // tmpfs and a few other file systems do not support O_DIRECT
+            direct_io = false;
+        }
+        return ::open(file_path.c_str(), flags, 0644);
+#else
+        const int fd = ::open(file_path.c_str(), flags, 0644);
+#ifdef F_NOCACHE
+        if (fd >= 0 && direct_io && ::fcntl(fd, F_NOCACHE, 1) != 0){
+            direct_io = false;
+        }
+#else
+        direct_io = false;
+#endif
+        return fd;
+#endif
+    }
+
+    void readFully(const int fd, char* buffer, size_t size, off_t offset){
+        while (size > 0){
+            const ssize_t read_bytes = ::pread(fd, buffer, size, offset);
+            if (read_bytes < 0){
+                if (errno == EINTR){
+                    continue;
+                }
+                throw makeIoError("Failed to read the block file"s);
+            }
+            if (read_bytes == 0){
+                throw std::runtime_error("Failed to read the block file: unexpected end of file"s);
+            }
+            buffer += read_bytes;
+            size -= static_cast<size_t>(read_bytes);
+            offset += read_bytes;
+        }
+    }
+
+    void writeFully(const int fd, const char* buffer, size_t size, off_t offset){
+        while (size > 0){
+            const ssize_t written_bytes = ::pwrite(fd, buffer, size, offset);
+            if (written_bytes < 0){
+                if (errno == EINTR){
+                    continue;
+                }
+                throw makeIoError("Failed to write the block file"s);
+            }
+            buffer += written_bytes;
+            size -= static_cast<size_t>(written_bytes);
+            offset += written_bytes;
+        }
+    }
+
+    void syncFile(const int fd){
+#ifdef __APPLE__
+        const int res = ::fsync(fd);
+#else
+        const int res = ::fdatasync(fd);
+#endif
+        if (res != 0){
+            throw makeIoError("Failed to sync the block file"s);
+        }
+    }
+}
+
+RawFileBlockStore::RawFileBlockStore(const std::filesystem::path& file_path, const bool direct_io, const size_t preallocated_slots,
+                                     std::shared_ptr<IoEngine> io_engine)
+    : direct_io_(direct_io), io_engine_(std::move(io_engine)){
+    data_fd_ = openDataFile(file_path, direct_io_);
+    if (data_fd_ < 0){
+        throw makeIoError("Failed to open the block file "s + file_path.string());
+    }
+    std::filesystem::path table_path = file_path;
+    table_path += ".slots";
+    table_fd_ = ::open(table_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (table_fd_ < 0){
+        const std::runtime_error error = makeIoError("Failed to open the slot table "s + table_path.string());
+        closeFiles();
+        throw error;
+    }
+
+    try{
+        loadSlotTable();
+        std::lock_guard<std::mutex> guard(latch_);
+        reserveSlots(std::max(preallocated_slots, slot_records_.size()));
+    } catch (const std::exception&){
+        closeFiles();
+        throw;
+    }
+}
+
+RawFileBlockStore::~RawFileBlockStore(){
+    closeFiles();
+}
+
+void RawFileBlockStore::writeBlocks(const std::vector<StoredDataBlock>& dblocks){
+    std::unique_lock<std::mutex> lock(latch_);
+    // a block another batch is writing is stored once that batch is done, so it is never given two slots
+    batch_written_.wait(lock, [this, &dblocks](){
+        return std::none_of(dblocks.begin(), dblocks.end(), [this](const StoredDataBlock& stored_block){
+            return writing_blocks_.count(stored_block.block_hash) != 0;
+        });
+    });
+    std::vector<const StoredDataBlock*> new_blocks;
+    std::unordered_set<size_t> batch_hashes;
+    for (const StoredDataBlock& stored_block : dblocks){
+        // a batch may carry the same block twice
+        if (slot_by_hash_.find(stored_block.block_hash) == nullptr && batch_hashes.insert(stored_block.block_hash).second){
+            new_blocks.push_back(&stored_block);
+        }
+    }
+    if (new_blocks.empty()){
+        return;
+    }
+
+    // the slots are taken under the latch and written without it, so reads are not held up by the device
+    const std::vector<SlotExtent> extents = allocateSlots(new_blocks.size());
+    try{
+        writing_blocks_.insert(batch_hashes.begin(), batch_hashes.end());
+    } catch (const std::exception&){
+        for (const SlotExtent& extent : extents){
+            free_space_.release(extent.first_slot, extent.slots_count);
+        }
+        throw;
+    }
+    lock.unlock();
+
+    std::vector<SlotRecord> records;
+    try{
+        AlignedBuffer slots_data = allocateAlignedBuffer(new_blocks.size() * SLOT_SIZE);
+        records.resize(new_blocks.size());
+        for (size_t i = 0; i < new_blocks.size(); ++i){
+            const DataBlock& dblock = new_blocks[i]->dblock;
+            records[i].block_hash = new_blocks[i]->block_hash;
+            records[i].fingerprint_high = new_blocks[i]->fingerprint_high;
+            records[i].seq_no = new_blocks[i]->seq_no;
+            records[i].data_size = static_cast<uint32_t>(std::min(dblock.data_size, SLOT_SIZE));
+            records[i].checksum = computeBlockChecksum(dblock.data, records[i].data_size);
+            std::memcpy(slots_data.get() + i * SLOT_SIZE, dblock.data, records[i].data_size);
+        }
+
+        // the blocks fill the extents in order, so every extent is a contiguous part of the buffer
+        std::vector<IoRequest> requests;
+        size_t extent_begin = 0;
+        for (const SlotExtent& extent : extents){
+            for (size_t i = 0; i < extent.slots_count; i += MAX_SLOTS_PER_REQUEST){
+                IoRequest request;
+                request.operation = IoOperation::WRITE;
+                request.fd = data_fd_;
+                request.buffer = slots_data.get() + (extent_begin + i) * SLOT_SIZE;
+                request.size = std::min(extent.slots_count - i, MAX_SLOTS_PER_REQUEST) * SLOT_SIZE;
+                request.offset = (static_cast<uint64_t>(extent.first_slot) + i) * SLOT_SIZE;
+                requests.push_back(request);
+            }
+            extent_begin += extent.slots_count;
+        }
+        runRequests(requests);
+
+        // the records go after the payloads, so a record never points at a slot which has not been written
+        extent_begin = 0;
+        for (const SlotExtent& extent : extents){
+            writeFully(table_fd_, reinterpret_cast<const char*>(records.data() + extent_begin), extent.slots_count * sizeof(SlotRecord),
+                       static_cast<off_t>(extent.first_slot * sizeof(SlotRecord)));
+            extent_begin += extent.slots_count;
+        }
+    } catch (const std::exception&){
+        // the slots of a failed batch are free again; a record written already is overwritten once its slot is reused
+        lock.lock();
+        for (const SlotExtent& extent : extents){
+            free_space_.release(extent.first_slot, extent.slots_count);
+        }
+        finishBatch(batch_hashes);
+        throw;
+    }
+
+    lock.lock();
+    size_t extent_begin = 0;
+    for (const SlotExtent& extent : extents){
+        for (size_t i = 0; i < extent.slots_count; ++i){
+            indexSlot(extent.first_slot + static_cast<uint32_t>(i), records[extent_begin + i]);
+        }
+        extent_begin += extent.slots_count;
+    }
+    finishBatch(batch_hashes);
+}
+
+std::vector<StoredDataBlock> RawFileBlockStore::readBlocks(const std::vector<size_t>& block_hashes){
+    std::shared_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    std::vector<LocatedSlot> located_slots;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        located_slots.reserve(block_hashes.size());
+        for (const size_t block_hash : block_hashes){
+            const uint32_t* slot = slot_by_hash_.find(block_hash);
+            if (slot != nullptr){
+                located_slots.push_back({*slot, slot_records_[*slot]});
+            }
+        }
+    }
+    // a found slot is not reused while the reuse latch is held, so the payloads are read without the latch
+    return readSlots(located_slots);
+}
+
+void RawFileBlockStore::readBlocksInto(BlockReadTarget* targets, const size_t count){
+    std::shared_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    std::vector<IoRequest> requests;
+    requests.reserve(count);
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (size_t i = 0; i < count; ++i){
+            const uint32_t* slot = slot_by_hash_.find(targets[i].block_hash);
+            if (slot == nullptr){
+                targets[i].data_size = 0;
+                continue;
+            }
+            targets[i].data_size = slot_records_[*slot].data_size;
+            targets[i].seq_no = slot_records_[*slot].seq_no;
+            targets[i].checksum = slot_records_[*slot].checksum;
+
+            IoRequest request;
+            request.fd = data_fd_;
+            request.buffer = targets[i].buffer;
+            request.size = SLOT_SIZE;
+            request.offset = static_cast<uint64_t>(*slot) * SLOT_SIZE;
+            requests.push_back(request);
+        }
+    }
+    runRequests(requests);
+}
+
+std::vector<StoredDataBlock> RawFileBlockStore::readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no){
+    std::shared_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    std::vector<LocatedSlot> located_slots;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (auto it = slot_by_seq_no_.lower_bound(first_seq_no); it != slot_by_seq_no_.end() && it->first < last_seq_no; ++it){
+            located_slots.push_back({it->second, slot_records_[it->second]});
+        }
+    }
+    return readSlots(located_slots);
+}
+
+uint64_t RawFileBlockStore::getNextSeqNo(){
+    std::lock_guard<std::mutex> guard(latch_);
+    return next_seq_no_;
+}
+
+std::vector<StoredBlockKey> RawFileBlockStore::listBlockKeys(){
+    std::lock_guard<std::mutex> guard(latch_);
+    std::vector<StoredBlockKey> block_keys;
+    block_keys.reserve(slot_by_hash_.size());
+    slot_by_hash_.forEach([this, &block_keys](const size_t block_hash, const uint32_t slot){
+        block_keys.push_back(StoredBlockKey{block_hash, slot_records_[slot].fingerprint_high});
+    });
+    return block_keys;
+}
+
+size_t RawFileBlockStore::removeBlocks(const std::vector<size_t>& block_hashes){
+    // the readers which have found one of the slots finish before it can be reused
+    std::unique_lock<std::shared_mutex> reuse_guard(slot_reuse_latch_);
+    std::lock_guard<std::mutex> guard(latch_);
+    std::vector<uint32_t> slots;
+    for (const size_t block_hash : block_hashes){
+        const uint32_t* slot = slot_by_hash_.find(block_hash);
+        if (slot != nullptr){
+            slots.push_back(*slot);
+        }
+    }
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    if (slots.empty()){
+        return 0;
+    }
+
+    // the records are cleared before the slots are freed, a run of neighbouring records with one write
+    const std::vector<SlotRecord> free_records(slots.size());
+    size_t run_begin = 0;
+    while (run_begin < slots.size()){
+        size_t run_end = run_begin + 1;
+        while (run_end < slots.size() && slots[run_end] == slots[run_end - 1] + 1){
+            ++run_end;
+        }
+        writeFully(table_fd_, reinterpret_cast<const char*>(free_records.data()), (run_end - run_begin) * sizeof(SlotRecord),
+                   static_cast<off_t>(slots[run_begin] * sizeof(SlotRecord)));
+        run_begin = run_end;
+    }
+
+    for (const uint32_t slot : slots){
+        slot_by_hash_.erase(static_cast<size_t>(slot_records_[slot].block_hash));
+        slot_by_seq_no_.erase(slot_records_[slot].seq_no);
+        slot_records_[slot] = SlotRecord{};
+        free_space_.release(slot, 1);
+    }
+    return slots.size();
+}
+
+void RawFileBlockStore::sync(){
+    syncFile(data_fd_);
+    syncFile(table_fd_);
+}
+
+IoEngine* RawFileBlockStore::getIoEngine() const noexcept{
+    return io_engine_.get();
+}
+
+void RawFileBlockStore::loadSlotTable(){
+    struct stat table_stat{};
+    struct stat data_stat{};
+    if (::fstat(table_fd_, &table_stat) != 0 || ::fstat(data_fd_, &data_stat) != 0){
+        throw makeIoError("Failed to read the slot table"s);
+    }
+    slots_count_ = std::min(static_cast<size_t>(data_stat.st_size) / SLOT_SIZE, static_cast<size_t>(UINT32_MAX));
+    slot_records_.assign(slots_count_, SlotRecord{});
+    free_space_ = FreeSpaceMap(slots_count_);
+
+    // a record without the slot it describes is dropped as well
+    const size_t records_count = std::min(static_cast<size_t>(table_stat.st_size) / sizeof(SlotRecord), slots_count_);
+    readFully(table_fd_, reinterpret_cast<char*>(slot_records_.data()), records_count * sizeof(SlotRecord), 0);
+
+    // a torn record at the end must not come back as a part of a record written there later
+    if (static_cast<size_t>(table_stat.st_size) != records_count * sizeof(SlotRecord)
+        && ::ftruncate(table_fd_, static_cast<off_t>(records_count * sizeof(SlotRecord))) != 0){
+        throw makeIoError("Failed to truncate the slot table"s);
+    }
+
+    size_t used_count = 0;
+    for (size_t slot = 0; slot < records_count; ++slot){
+        used_count += slot_records_[slot].data_size != 0 ? 1 : 0;
+    }
+    slot_by_hash_ = HashIndex<uint32_t>(std::max(used_count * 2, DEFAULT_PREALLOCATED_SLOTS));
+    size_t used_run_begin = 0;
+    for (size_t slot = 0; slot <= records_count; ++slot){
+        if (slot < records_count && slot_records_[slot].data_size != 0){
+            const SlotRecord record = slot_records_[slot];
+            // a torn record, or the old record of a block moved after a removal which has not reached the disk, frees its slot
+            if (record.data_size <= SLOT_SIZE && slot_by_hash_.find(static_cast<size_t>(record.block_hash)) == nullptr){
+                indexSlot(static_cast<uint32_t>(slot), record);
+                continue;
+            }
+            slot_records_[slot] = SlotRecord{};
+        }
+        // the used slots are marked a run at a time
+        free_space_.markUsed(used_run_begin, slot - used_run_begin);
+        used_run_begin = slot + 1;
+    }
+}
+
+void RawFileBlockStore::reserveSlots(const size_t slots_count){
+    if (slots_count <= slots_count_){
+        return;
+    }
+    if (slots_count > UINT32_MAX){
+        throw std::runtime_error("Failed to extend the block file: too many slots"s);
+    }
+
+    const size_t new_slots_count = std::min(std::max(slots_count, slots_count_ * 2), static_cast<size_t>(UINT32_MAX));
+    const off_t new_size = static_cast<off_t>(new_slots_count * SLOT_SIZE);
+#if defined(__linux__)
+    // the blocks are allocated up front, so later writes do not have to extend the file
+    int res = ::posix_fallocate(data_fd_, 0, new_size);
+    if (res == EOPNOTSUPP){
+        res = ::ftruncate(data_fd_, new_size) == 0 ? 0 : errno;
+    }
+    if (res != 0){
+        errno = res;
+        throw makeIoError("Failed to extend the block file"s);
+    }
+#else
+    if (::ftruncate(data_fd_, new_size) != 0){
+        throw makeIoError("Failed to extend the block file"s);
+    }
+#endif
+    free_space_.grow(new_slots_count);
+    slot_records_.resize(new_slots_count);
+    slots_count_ = new_slots_count;
+}
+
+std::vector<RawFileBlockStore::SlotExtent> RawFileBlockStore::allocateSlots(const size_t slots_count){
+    // a batch is usually one object, which is scanned fastest from neighbouring slots
+    size_t first_slot = 0;
+    if (free_space_.allocate(slots_count, first_slot)){
+        return {SlotExtent{static_cast<uint32_t>(first_slot), static_cast<uint32_t>(slots_count)}};
+    }
+
+    if (free_space_.getFreeSlotsCount() < slots_count){
+        // the new slots continue the free tail, so the batch still takes one extent
+        reserveSlots(slots_count_ + slots_count - free_space_.getTrailingFreeSlotsCount());
+        free_space_.allocate(slots_count, first_slot);
+        return {SlotExtent{static_cast<uint32_t>(first_slot), static_cast<uint32_t>(slots_count)}};
+    }
+
+    // the file does not grow while the freed slots are enough, the batch is split over the longest free runs instead
+    std::vector<SlotExtent> extents;
+    size_t left_slots = slots_count;
+    while (left_slots > 0){
+        const size_t run_slots = std::min(left_slots, free_space_.getLongestFreeRun());
+        free_space_.allocate(run_slots, first_slot);
+        extents.push_back(SlotExtent{static_cast<uint32_t>(first_slot), static_cast<uint32_t>(run_slots)});
+        left_slots -= run_slots;
+    }
+    return extents;
+}
+
+void RawFileBlockStore::indexSlot(const uint32_t slot, const SlotRecord& record){
+    if (slot_by_hash_.size() >= slot_by_hash_.capacity()){
+        slot_by_hash_.reserve(slot_by_hash_.capacity() * 2);
+    }
+    slot_by_hash_.insert(static_cast<size_t>(record.block_hash), slot);
+    slot_by_seq_no_.emplace(record.seq_no, slot);
+    slot_records_[slot] = record;
+    next_seq_no_ = std::max(next_seq_no_, record.seq_no + 1);
+}
+
+void RawFileBlockStore::finishBatch(const std::unordered_set<size_t>& batch_hashes) noexcept{
+    for (const size_t block_hash : batch_hashes){
+        writing_blocks_.erase(block_hash);
+    }
+    batch_written_.notify_all();
+}
+
+std::vector<StoredDataBlock> RawFileBlockStore::readSlots(std::vector<LocatedSlot>& located_slots) const{
+    std::vector<StoredDataBlock> loaded_blocks(located_slots.size());
+    if (located_slots.empty()){
+        return loaded_blocks;
+    }
+
+    std::sort(located_slots.begin(), located_slots.end(), [](const LocatedSlot& lhs, const LocatedSlot& rhs){
+        return lhs.slot < rhs.slot;
+    });
+    // every run of neighbouring slots is one request; the runs are read as one batch into consecutive parts of the buffer
+    AlignedBuffer slots_data = allocateAlignedBuffer(located_slots.size() * SLOT_SIZE);
+    std::vector<IoRequest> requests;
+    size_t run_begin = 0;
+    while (run_begin < located_slots.size()){
+        size_t run_end = run_begin + 1;
+        while (run_end < located_slots.size() && run_end - run_begin < MAX_SLOTS_PER_REQUEST
+               && located_slots[run_end].slot == located_slots[run_end - 1].slot + 1){
+            ++run_end;
+        }
+
+        IoRequest request;
+        request.fd = data_fd_;
+        request.buffer = slots_data.get() + run_begin * SLOT_SIZE;
+        request.size = (run_end - run_begin) * SLOT_SIZE;
+        request.offset = static_cast<uint64_t>(located_slots[run_begin].slot) * SLOT_SIZE;
+        requests.push_back(request);
+        run_begin = run_end;
+    }
+    runRequests(requests);
+
+    for (size_t i = 0; i < located_slots.size(); ++i){
+        StoredDataBlock& loaded_block = loaded_blocks[i];
+        loaded_block.block_hash = static_cast<size_t>(located_slots[i].record.block_hash);
+        loaded_block.seq_no = located_slots[i].record.seq_no;
+        loaded_block.checksum = located_slots[i].record.checksum;
+        loaded_block.dblock.data_size = located_slots[i].record.data_size;
+        std::memcpy(loaded_block.dblock.data, slots_data.get() + i * SLOT_SIZE, loaded_block.dblock.data_size);
+    }
+    return loaded_blocks;
+}
+
+void RawFileBlockStore::runRequests(const std::vector<IoRequest>& requests) const{
+    if (io_engine_ == nullptr){
+        for (const IoRequest& request : requests){
+            if (request.operation == IoOperation::READ){
+                readFully(request.fd, request.buffer, request.size, static_cast<off_t>(request.offset));
+            } else{
+                writeFully(request.fd, request.buffer, request.size, static_cast<off_t>(request.offset));
+            }
+        }
+        return;
+    }
+
+    std::vector<int64_t> results(requests.size(), 0);
+    io_engine_->execute(requests.data(), requests.size(), results.data());
+    for (size_t i = 0; i < requests.size(); ++i){
+        const std::string what = requests[i].operation == IoOperation::READ ? "Failed to read the block file"s : "Failed to write the block file"s;
+        if (results[i] < 0){
+            throw std::runtime_error(what + ": "s + std::strerror(static_cast<int>(-results[i])));
+        }
+        if (static_cast<size_t>(results[i]) != requests[i].size){
+            throw std::runtime_error(what + ": unexpected end of file"s);
+        }
+    }
+}
+
+void RawFileBlockStore::closeFiles() noexcept{
+    if (data_fd_ >= 0){
+        ::close(data_fd_);
+        data_fd_ = -1;
+    }
+    if (table_fd_ >= 0){
+        ::close(table_fd_);
+        table_fd_ = -1;
+    }
+}
+
+#else
+
+RawFileBlockStore::RawFileBlockStore(const std::filesystem::path&, const bool, const size_t, std::shared_ptr<IoEngine>){
+    throw std::runtime_error("The raw block file is not supported on this platform"s);
+}
+
+RawFileBlockStore::~RawFileBlockStore() = default;
+
+void RawFileBlockStore::writeBlocks(const std::vector<StoredDataBlock>&){
+}
+
+std::vector<StoredDataBlock> RawFileBlockStore::readBlocks(const std::vector<size_t>&){
+    return {};
+}
+
+void RawFileBlockStore::readBlocksInto(BlockReadTarget*, const size_t){
+}
+
+std::vector<StoredDataBlock> RawFileBlockStore::readBlockRange(const uint64_t, const uint64_t){
+    return {};
+}
+
+uint64_t RawFileBlockStore::getNextSeqNo(){
+    return 0;
+}
+
+std::vector<StoredBlockKey> RawFileBlockStore::listBlockKeys(){
+    return {};
+}
+
+size_t RawFileBlockStore::removeBlocks(const std::vector<size_t>&){
+    return 0;
+}
+
+void RawFileBlockStore::sync(){
+}
+
+IoEngine* RawFileBlockStore::getIoEngine() const noexcept{
+    return nullptr;
+}
+
+#endif
+
+bool RawFileBlockStore::findSlot(const size_t block_hash, uint32_t& slot, size_t& data_size, uint64_t& seq_no, uint32_t& checksum) const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    const uint32_t* found_slot = slot_by_hash_.find(block_hash);
+    if (found_slot == nullptr){
+        return false;
+    }
+    slot = *found_slot;
+    data_size = slot_records_[*found_slot].data_size;
+    seq_no = slot_records_[*found_slot].seq_no;
+    checksum = slot_records_[*found_slot].checksum;
+    return true;
+}
+
+int RawFileBlockStore::getDataFile() const noexcept{
+    return data_fd_;
+}
+
+bool RawFileBlockStore::isDirectIoEnabled() const noexcept{
+    return direct_io_;
+}
+
+size_t RawFileBlockStore::getBlocksCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return slot_by_hash_.size();
+}
+
+size_t RawFileBlockStore::getSlotsCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return slots_count_;
+}
+
+size_t RawFileBlockStore::getFreeSlotsCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return free_space_.getFreeSlotsCount();
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "block_store.hpp"
+#include "free_space_map.hpp"
+#include "hash_index.hpp"
+
+/* Block storage in a plain file of fixed 4 KB slots, without a query engine in the I/O path.
+
+   - `<path>` keeps the block payloads, slot `i` at offset `i * SLOT_SIZE`. The file is preallocated and grows by doubling.
+   - `<path>.slots` is the slot table: record `i` holds the hash, the high half of the fingerprint, the write sequence number,
+     the size and the CRC32C of the block in slot `i` (32 bytes per 4 KB block), a zero record marks a free slot. It is read
+     into memory on open and updated with one `pwrite` per extent.
+   - Slots are handed out by a FreeSpaceMap rebuilt from the slot table on open, so the table is the persistent free space map.
+     A batch takes one extent of neighbouring slots where there is a run long enough for it, so the blocks of an object are
+     laid out sequentially; otherwise it fills the free runs before the file grows, so the file stays bounded under churn.
+   - A batch writes its slots first and its records after that, so a record never points at a slot which has not been
+     written. A removed block has its record cleared before its slot is freed. A torn record is dropped on open.
+   - With direct I/O the payloads bypass the page cache (O_DIRECT, F_NOCACHE on macOS); all transfers are done through buffers
+     aligned to `DATA_BLOCK_ALIGNMENT`, so it works with and without it.
+   - With an IoEngine the slots of a batch are transferred by one batch of requests (io_uring or a thread pool) instead of
+     one blocking call after another. */
+class RawFileBlockStore : public BlockStore{
+public:
+    /** Open a block file, creating it if it does not exist.
+     * @param[in] file_path path of the data file; the slot table is kept next to it
+     * @param[in] direct_io `true` to bypass the page cache; ignored if the file system does not support it (see `isDirectIoEnabled()`)
+     * @param[in] preallocated_slots number of slots the data file is preallocated for
+     * @param[in] io_engine engine running the payload transfers; `nullptr` for blocking `pread`/`pwrite` calls
+     * @throw `std::runtime_error` if the files cannot be opened or the slot table cannot be read.
+    */
+    explicit RawFileBlockStore(const std::filesystem::path& file_path, const bool direct_io = false,
+                               const size_t preallocated_slots = DEFAULT_PREALLOCATED_SLOTS, std::shared_ptr<IoEngine> io_engine = nullptr);
+
+    ~RawFileBlockStore() override;
+
+    RawFileBlockStore(const RawFileBlockStore&) = delete;
+    RawFileBlockStore& operator=(const RawFileBlockStore&) = delete;
+
+public:
+    /* Writes the payloads of the batch first, then their slot records with one `pwrite` per extent. The latch is only held
+       to take the slots and to index them, so reads go on while a batch is written. */
+    void writeBlocks(const std::vector<StoredDataBlock>& dblocks) override;
+
+    // Neighbouring slots are read with one request.
+    std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) override;
+
+    // Every slot is read straight into its target with one request; all requests go out as one batch.
+    void readBlocksInto(BlockReadTarget* targets, const size_t count) override;
+
+    std::vector<StoredDataBlock> readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no) override;
+
+    uint64_t getNextSeqNo() override;
+
+    // Lists the in-memory slot index, without reading the files.
+    std::vector<StoredBlockKey> listBlockKeys() override;
+
+    // Clears the slot records of the blocks, then frees their slots for new blocks.
+    size_t removeBlocks(const std::vector<size_t>& block_hashes) override;
+
+    // Flushes the data file and the slot table to the device.
+    void sync() override;
+
+    IoEngine* getIoEngine() const noexcept override;
+
+public:
+    bool isDirectIoEnabled() const noexcept;
+
+    // Get a number of stored blocks.
+    size_t getBlocksCount() const noexcept;
+
+    // Get a number of slots the data file has been allocated for.
+    size_t getSlotsCount() const noexcept;
+
+    // Get a number of slots which can take new blocks without growing the data file.
+    size_t getFreeSlotsCount() const noexcept;
+
+    static constexpr size_t SLOT_SIZE = MAX_DATA_BLOCK_SIZE;
+    static constexpr size_t DEFAULT_PREALLOCATED_SLOTS = 1024;      /* 4 MB */
+
+protected:
+    /** Find the slot of a stored block.
+     * @param[out] slot the slot holding the block, its payload is at offset `slot * SLOT_SIZE` of the data file
+     * @param[out] data_size number of meaningful bytes of the block
+     * @param[out] seq_no write sequence number of the block
+     * @param[out] checksum checksum of the block, `0` if it has been written without one
+     * @return `false` if the block is not stored.
+    */
+    bool findSlot(const size_t block_hash, uint32_t& slot, size_t& data_size, uint64_t& seq_no, uint32_t& checksum) const noexcept;
+
+    // Get the descriptor of the data file.
+    int getDataFile() const noexcept;
+
+    /* Held shared while the payload of a found slot is read, exclusively while slots are freed, so a slot is never
+       reused under a reader. */
+    mutable std::shared_mutex slot_reuse_latch_;
+
+private:
+    /* Record `i` of the slot table describes slot `i` of the data file. */
+    struct SlotRecord{
+        uint64_t block_hash = 0;
+        uint64_t fingerprint_high = 0;
+        uint64_t seq_no = 0;
+        uint32_t data_size = 0;                         /* 0 marks a free slot */
+        uint32_t checksum = 0;                          /* CRC32C of the payload; 0 in tables written before checksums */
+    };
+    static_assert(sizeof(SlotRecord) == 32, "the slot table layout is part of the file format");
+
+    /* A slot to read together with its record. */
+    struct LocatedSlot{
+        uint32_t slot = 0;
+        SlotRecord record;
+    };
+
+    /* A run of neighbouring slots taken by a batch. */
+    struct SlotExtent{
+        uint32_t first_slot = 0;
+        uint32_t slots_count = 0;
+    };
+
+    /** Read the slot table into memory and mark the used slots, dropping torn records.
+     * @throw `std::runtime_error` on fail to read the table.
+    */
+    void loadSlotTable();
+
+    /** Make sure the data file has room for `slots_count` slots. Must be called under the latch.
+     * @throw `std::runtime_error` if the file cannot be extended.
+    */
+    void reserveSlots(const size_t slots_count);
+
+    /** Take free slots for `slots_count` new blocks: one extent if a free run is long enough, the free runs from the longest
+     * one on if the free slots are enough in total, and the free tail grown to the size of the batch otherwise.
+     * Must be called under the latch.
+     * @throw `std::runtime_error` if the file cannot be extended.
+    */
+    std::vector<SlotExtent> allocateSlots(const size_t slots_count);
+
+    // Index a used slot. Must be called under the latch.
+    void indexSlot(const uint32_t slot, const SlotRecord& record);
+
+    // Let the batches waiting for the blocks of a finished batch go on. Must be called under the latch.
+    void finishBatch(const std::unordered_set<size_t>& batch_hashes) noexcept;
+
+    /** Read the payloads of the slots; neighbouring slots are read with one request.
+     * @throw `std::runtime_error` on fail to read the data file.
+    */
+    std::vector<StoredDataBlock> readSlots(std::vector<LocatedSlot>& located_slots) const;
+
+    /** Run the requests on the engine, or one after another without it.
+     * @throw `std::runtime_error` if any of them fails or transfers less than requested.
+    */
+    void runRequests(const std::vector<IoRequest>& requests) const;
+
+    void closeFiles() noexcept;
+
+private:
+    static constexpr size_t MAX_SLOTS_PER_REQUEST = 64;             /* Longest run of slots transferred by one request */
+
+    int data_fd_ = -1;
+    int table_fd_ = -1;
+    bool direct_io_ = false;
+    std::shared_ptr<IoEngine> io_engine_;
+
+    mutable std::mutex latch_;                          /* Guards the slot bookkeeping below; payloads are read without it */
+    std::vector<SlotRecord> slot_records_;              /* In-memory copy of the slot table, one record per allocated slot */
+    HashIndex<uint32_t> slot_by_hash_;                  /* Rebuilt twice as large once it fills up */
+    std::map<uint64_t, uint32_t> slot_by_seq_no_;
+    FreeSpaceMap free_space_;
+    size_t slots_count_ = 0;                            /* Slots the data file has been allocated for */
+    uint64_t next_seq_no_ = 0;                          /* Kept past removed blocks, so sequence numbers are not handed out twice */
+    std::unordered_set<size_t> writing_blocks_;         /* Blocks of the batches being written without the latch */
+    std::condition_variable batch_written_;
+};
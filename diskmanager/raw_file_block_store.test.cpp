@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <thread>
+
+#include "raw_file_block_store.hpp"
+
+using namespace std::filesystem;
+using namespace std::string_literals;
+
+class RawFileBlockStoreTests : public testing::Test{
+protected:
+    void SetUp() override{
+        create_directory(test_dir_path_);
+    }
+
+    void TearDown() override{
+        remove_all(test_dir_path_);
+    }
+
+    static StoredDataBlock makeStoredBlock(const std::string& data, const uint64_t seq_no){
+        StoredDataBlock stored_block;
+        stored_block.dblock.data_size = data.size();
+        std::memcpy(stored_block.dblock.data, data.data(), data.size());
+        const BlockFingerprint fingerprint = stored_block.dblock.Fingerprint();
+        stored_block.block_hash = static_cast<size_t>(fingerprint.low);
+        stored_block.fingerprint_high = fingerprint.high;
+        stored_block.seq_no = seq_no;
+        return stored_block;
+    }
+
+    static path test_dir_path_;
+    static path test_file_path_;
+};
+
+path RawFileBlockStoreTests::test_dir_path_ = std::filesystem::temp_directory_path() / path("raw_file_block_store_test_tmp_dir");
+path RawFileBlockStoreTests::test_file_path_ = test_dir_path_ / path("blocks.raw");
+
+TEST_F(RawFileBlockStoreTests, WriteAndReadTest){
+    RawFileBlockStore store(test_file_path_, false, 4);
+    EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(0));
+    EXPECT_EQ(store.getSlotsCount(), static_cast<size_t>(4));
+    EXPECT_EQ(file_size(test_file_path_), 4 * RawFileBlockStore::SLOT_SIZE);
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(0));
+
+    const StoredDataBlock block1 = makeStoredBlock("This is test string number one"s, 0);
+    const StoredDataBlock block2 = makeStoredBlock(std::string(MAX_DATA_BLOCK_SIZE, 'x'), 1);
+    // a block stored already and a duplicate within the batch are skipped
+    store.writeBlocks({block1});
+    store.writeBlocks({block1, block2, block2});
+    EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(2));
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(2));
+
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlocks({block2.block_hash, 42, block1.block_hash});
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(2));
+    for (const StoredDataBlock& loaded_block : loaded_blocks){
+        const StoredDataBlock& expected_block = loaded_block.block_hash == block1.block_hash ? block1 : block2;
+        EXPECT_EQ(loaded_block.dblock, expected_block.dblock);
+        EXPECT_EQ(loaded_block.seq_no, expected_block.seq_no);
+    }
+    EXPECT_TRUE(store.readBlocks({42}).empty());
+}
+
+TEST_F(RawFileBlockStoreTests, GrowAndReopenTest){
+    std::vector<StoredDataBlock> stored_blocks;
+    for (size_t i = 0; i < 100; ++i){
+        stored_blocks.push_back(makeStoredBlock("Block number "s + std::to_string(i), i));
+    }
+    {
+        RawFileBlockStore store(test_file_path_, false, 8);
+        // one block, then a batch larger than the preallocated file
+        store.writeBlocks({stored_blocks.front()});
+        store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks.begin() + 1, stored_blocks.end()));
+        EXPECT_EQ(store.getBlocksCount(), stored_blocks.size());
+        EXPECT_GE(store.getSlotsCount(), stored_blocks.size());
+        store.sync();
+    }
+
+    RawFileBlockStore store(test_file_path_);
+    EXPECT_EQ(store.getBlocksCount(), stored_blocks.size());
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(stored_blocks.size()));
+    // the high half of the fingerprint is listed with the key
+    std::vector<std::pair<size_t, uint64_t>> listed_keys;
+    for (const StoredBlockKey& block_key : store.listBlockKeys()){
+        listed_keys.emplace_back(block_key.block_hash, block_key.fingerprint_high);
+    }
+    std::vector<std::pair<size_t, uint64_t>> expected_keys;
+    for (const StoredDataBlock& stored_block : stored_blocks){
+        expected_keys.emplace_back(stored_block.block_hash, stored_block.fingerprint_high);
+    }
+    EXPECT_THAT(listed_keys, testing::UnorderedElementsAreArray(expected_keys));
+
+    const std::vector<StoredDataBlock> range_blocks = store.readBlockRange(10, 20);
+    ASSERT_EQ(range_blocks.size(), static_cast<size_t>(10));
+    for (size_t i = 0; i < range_blocks.size(); ++i){
+        EXPECT_EQ(range_blocks[i].block_hash, stored_blocks[10 + i].block_hash);
+        EXPECT_EQ(range_blocks[i].dblock, stored_blocks[10 + i].dblock);
+    }
+    EXPECT_TRUE(store.readBlockRange(100, 200).empty());
+
+    // the reopened store keeps appending after the last slot
+    store.writeBlocks({makeStoredBlock("A block written after reopening"s, 100)});
+    EXPECT_EQ(store.getBlocksCount(), stored_blocks.size() + 1);
+    EXPECT_EQ(store.readBlocks({stored_blocks[50].block_hash}).front().dblock, stored_blocks[50].dblock);
+}
+
+TEST_F(RawFileBlockStoreTests, TornSlotTableTest){
+    const StoredDataBlock block1 = makeStoredBlock("The block which has been written"s, 0);
+    const StoredDataBlock block2 = makeStoredBlock("The block whose record is torn"s, 1);
+    {
+        RawFileBlockStore store(test_file_path_);
+        store.writeBlocks({block1, block2});
+    }
+
+    // a crash in the middle of the record write leaves a partial record at the end of the table
+    path table_path = test_file_path_;
+    table_path += ".slots";
+    resize_file(table_path, file_size(table_path) - 10);
+
+    RawFileBlockStore store(test_file_path_);
+    EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(1));
+    EXPECT_EQ(store.readBlocks({block1.block_hash}).size(), static_cast<size_t>(1));
+    EXPECT_TRUE(store.readBlocks({block2.block_hash}).empty());
+
+    store.writeBlocks({block2});
+    EXPECT_EQ(store.readBlocks({block2.block_hash}).front().dblock, block2.dblock);
+}
+
+TEST_F(RawFileBlockStoreTests, DirectIoTest){
+    // file systems without O_DIRECT fall back to buffered I/O, the store works the same
+    RawFileBlockStore store(test_file_path_, true);
+    const StoredDataBlock stored_block = makeStoredBlock("A block written around the page cache"s, 0);
+    store.writeBlocks({stored_block});
+
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlocks({stored_block.block_hash});
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(1));
+    EXPECT_EQ(loaded_blocks.front().dblock, stored_block.dblock);
+}
+
+TEST_F(RawFileBlockStoreTests, OpenFailureTest){
+    EXPECT_THROW(RawFileBlockStore(test_dir_path_ / path("missing_dir") / path("blocks.raw")), std::runtime_error);
+}
+
+TEST_F(RawFileBlockStoreTests, IoEngineTest){
+    std::vector<StoredDataBlock> stored_blocks;
+    for (size_t i = 0; i < 200; ++i){
+        stored_blocks.push_back(makeStoredBlock("Block transferred by the engine "s + std::to_string(i), i));
+    }
+    RawFileBlockStore store(test_file_path_, true, 8, IoEngine::create(16));
+    ASSERT_NE(store.getIoEngine(), nullptr);
+    // the batch is longer than one request and than the queue of the engine
+    store.writeBlocks(stored_blocks);
+    EXPECT_EQ(store.readBlockRange(0, 200).size(), stored_blocks.size());
+
+    // blocks are read straight into the targets, a missing one is reported by its size
+    AlignedBuffer buffers = allocateAlignedBuffer(3 * MAX_DATA_BLOCK_SIZE);
+    BlockReadTarget targets[3];
+    targets[0].block_hash = stored_blocks[150].block_hash;
+    targets[1].block_hash = 42;
+    targets[2].block_hash = stored_blocks[7].block_hash;
+    for (size_t i = 0; i < 3; ++i){
+        targets[i].buffer = buffers.get() + i * MAX_DATA_BLOCK_SIZE;
+    }
+    store.readBlocksInto(targets, 3);
+    EXPECT_EQ(targets[0].data_size, stored_blocks[150].dblock.data_size);
+    EXPECT_EQ(targets[0].seq_no, static_cast<uint64_t>(150));
+    EXPECT_EQ(std::memcmp(targets[0].buffer, stored_blocks[150].dblock.data, targets[0].data_size), 0);
+    EXPECT_EQ(targets[1].data_size, static_cast<size_t>(0));
+    EXPECT_EQ(targets[2].data_size, stored_blocks[7].dblock.data_size);
+    EXPECT_EQ(std::memcmp(targets[2].buffer, stored_blocks[7].dblock.data, targets[2].data_size), 0);
+}
+
+TEST_F(RawFileBlockStoreTests, RemoveAndReuseTest){
+    std::vector<StoredDataBlock> stored_blocks;
+    for (size_t i = 0; i < 40; ++i){
+        stored_blocks.push_back(makeStoredBlock("Block of an object "s + std::to_string(i), i));
+    }
+    {
+        RawFileBlockStore store(test_file_path_, false, 64);
+        // two objects of 20 blocks each, every one laid out in neighbouring slots
+        store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks.begin(), stored_blocks.begin() + 20));
+        store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks.begin() + 20, stored_blocks.end()));
+        EXPECT_EQ(store.getFreeSlotsCount(), static_cast<size_t>(24));
+
+        std::vector<size_t> removed_hashes;
+        for (size_t i = 0; i < 20; ++i){
+            removed_hashes.push_back(stored_blocks[i].block_hash);
+        }
+        removed_hashes.push_back(42);
+        EXPECT_EQ(store.removeBlocks(removed_hashes), static_cast<size_t>(20));
+        EXPECT_EQ(store.removeBlocks(removed_hashes), static_cast<size_t>(0));
+        EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(20));
+        EXPECT_EQ(store.getFreeSlotsCount(), static_cast<size_t>(44));
+        EXPECT_TRUE(store.readBlocks({stored_blocks[5].block_hash}).empty());
+        EXPECT_EQ(store.readBlockRange(0, 40).size(), static_cast<size_t>(20));
+        // sequence numbers of removed blocks are not handed out again
+        EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(40));
+        store.sync();
+    }
+
+    // the free slots are found again from the slot table
+    RawFileBlockStore store(test_file_path_, false, 64);
+    EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(20));
+    EXPECT_EQ(store.getFreeSlotsCount(), static_cast<size_t>(44));
+
+    // a new object takes the freed slots before the free tail, and the file does not grow under churn
+    for (size_t round = 0; round < 10; ++round){
+        std::vector<StoredDataBlock> new_blocks;
+        std::vector<size_t> new_hashes;
+        for (size_t i = 0; i < 30; ++i){
+            new_blocks.push_back(makeStoredBlock("Block of round "s + std::to_string(round) + " number "s + std::to_string(i), 40 + round * 30 + i));
+            new_hashes.push_back(new_blocks.back().block_hash);
+        }
+        store.writeBlocks(new_blocks);
+        EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(50));
+        const std::vector<StoredDataBlock> loaded_blocks = store.readBlocks(new_hashes);
+        ASSERT_EQ(loaded_blocks.size(), new_blocks.size());
+        for (const StoredDataBlock& loaded_block : loaded_blocks){
+            EXPECT_THAT(new_hashes, testing::Contains(loaded_block.block_hash));
+        }
+        EXPECT_EQ(store.removeBlocks(new_hashes), new_hashes.size());
+    }
+    EXPECT_EQ(store.getSlotsCount(), static_cast<size_t>(64));
+    EXPECT_EQ(file_size(test_file_path_), 64 * RawFileBlockStore::SLOT_SIZE);
+    EXPECT_EQ(store.readBlocks({stored_blocks[30].block_hash}).front().dblock, stored_blocks[30].dblock);
+
+    // a batch larger than the free slots grows the file and still takes one extent
+    std::vector<StoredDataBlock> large_object;
+    for (size_t i = 0; i < 100; ++i){
+        large_object.push_back(makeStoredBlock("Block of a large object "s + std::to_string(i), 1000 + i));
+    }
+    store.writeBlocks(large_object);
+    EXPECT_EQ(store.getBlocksCount(), static_cast<size_t>(120));
+    EXPECT_EQ(store.readBlockRange(1000, 1100).size(), large_object.size());
+}
+
+TEST_F(RawFileBlockStoreTests, ConcurrentWritesTest){
+    std::vector<StoredDataBlock> blocks;
+    for (uint64_t i = 0; i < 64; ++i){
+        blocks.push_back(makeStoredBlock("block number "s + std::to_string(i), i));
+    }
+    {
+        RawFileBlockStore store(test_file_path_, false, 16);
+        // every writer stores the same blocks, a reader looks them up while the batches are written
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; ++t){
+            threads.emplace_back([&store, &blocks](){
+                for (size_t i = 0; i < blocks.size(); i += 8){
+                    store.writeBlocks(std::vector<StoredDataBlock>(blocks.begin() + i, blocks.begin() + i + 8));
+                }
+            });
+        }
+        threads.emplace_back([&store, &blocks](){
+            for (const StoredDataBlock& block : blocks){
+                for (const StoredDataBlock& loaded_block : store.readBlocks({block.block_hash})){
+                    EXPECT_EQ(loaded_block.dblock, block.dblock);
+                }
+            }
+        });
+        for (std::thread& thread : threads){
+            thread.join();
+        }
+
+        // each block has taken one slot
+        EXPECT_EQ(store.getBlocksCount(), blocks.size());
+        EXPECT_EQ(store.getSlotsCount() - store.getFreeSlotsCount(), blocks.size());
+    }
+
+    RawFileBlockStore store(test_file_path_);
+    EXPECT_EQ(store.getBlocksCount(), blocks.size());
+    EXPECT_EQ(store.readBlockRange(0, blocks.size()).size(), blocks.size());
+}
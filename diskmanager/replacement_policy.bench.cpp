@@ -0,0 +1,82 @@
+#include "buffer_manager.hpp"
+#include "bench_common.hpp"
+
+/* Compares hit ratios of the replacement policies, with and without the TinyLFU admission filter,
+   on a Zipfian trace and on the same trace mixed with large scans.
+   Usage: ReplacementPolicyBenchmark [keys_count = 100000] [cache_blocks = 5000] [accesses = 2000000] */
+
+namespace{
+    struct TraceResult{
+        double hit_ratio;
+        double ns_per_access;
+    };
+
+    TraceResult runTrace(const ReplacementPolicyType policy_type, const bool use_admission_filter, const size_t cache_blocks,
+                         const std::vector<size_t>& trace){
+        BufferManager manager(BufferManager::getMemoryBudgetForBlocks(cache_blocks), 0, policy_type);
+        manager.setAdmissionFilterEnabled(use_admission_filter);
+        DataBlock block;
+        block.data_size = MAX_DATA_BLOCK_SIZE;
+
+        size_t hits = 0;
+        const double ns_per_access = measureNsPerOp(trace.size(), [&](const size_t i){
+            if (manager.getDataBlock(trace[i]).isValid()){
+                ++hits;
+            } else{
+                manager.addDataBlock(block, trace[i]);
+            }
+        });
+        return TraceResult{static_cast<double>(hits) / static_cast<double>(trace.size()), ns_per_access};
+    }
+
+    const char* getPolicyName(const ReplacementPolicyType policy_type){
+        switch (policy_type){
+            case ReplacementPolicyType::LRU: return "LRU";
+            case ReplacementPolicyType::CLOCK: return "CLOCK";
+            case ReplacementPolicyType::TWO_Q: return "2Q";
+            case ReplacementPolicyType::ARC: return "ARC";
+        }
+        return "?";
+    }
+}
+
+int main(int argc, char** argv){
+    const size_t keys_count = readSizeArgument(argc, argv, 1, 100'000);
+    const size_t cache_blocks = readSizeArgument(argc, argv, 2, 5'000);
+    const size_t accesses = readSizeArgument(argc, argv, 3, 2'000'000);
+
+    ZipfianGenerator zipf(keys_count, 0.99);
+    std::vector<size_t> zipf_trace(accesses);
+    for (size_t& key : zipf_trace){
+        key = zipf.next();
+    }
+
+    // every 50000 accesses a scan reads twice the cache size of never repeated blocks
+    std::vector<size_t> scan_trace;
+    scan_trace.reserve(accesses * 2);
+    size_t scan_key = keys_count;
+    for (size_t i = 0; i < accesses; ++i){
+        scan_trace.push_back(zipf_trace[i]);
+        if (i % 50'000 == 0){
+            for (size_t scanned = 0; scanned < cache_blocks * 2; ++scanned){
+                scan_trace.push_back(scan_key++);
+            }
+        }
+    }
+
+    std::cout << "keys: " << keys_count << ", cache blocks: " << cache_blocks << std::endl;
+    std::cout << std::setw(14) << "policy" << std::setw(14) << "zipf hit %" << std::setw(14) << "zipf ns/op"
+              << std::setw(14) << "scan hit %" << std::setw(14) << "scan ns/op" << std::endl;
+
+    for (const ReplacementPolicyType policy_type : {ReplacementPolicyType::LRU, ReplacementPolicyType::CLOCK,
+                                                    ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC}){
+        for (const bool use_admission_filter : {false, true}){
+            const TraceResult zipf_result = runTrace(policy_type, use_admission_filter, cache_blocks, zipf_trace);
+            const TraceResult scan_result = runTrace(policy_type, use_admission_filter, cache_blocks, scan_trace);
+            const std::string name = std::string(getPolicyName(policy_type)) + (use_admission_filter ? "+TinyLFU" : "");
+            std::cout << std::setw(14) << name << std::fixed << std::setprecision(2)
+                      << std::setw(14) << zipf_result.hit_ratio * 100 << std::setw(14) << zipf_result.ns_per_access
+                      << std::setw(14) << scan_result.hit_ratio * 100 << std::setw(14) << scan_result.ns_per_access << std::endl;
+        }
+    }
+}
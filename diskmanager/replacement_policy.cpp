@@ -0,0 +1,661 @@
+#include "replacement_policy.hpp"
+
+#include "hash_index.hpp"
+
+#include <cstdint>
+
+namespace{
+    constexpr uint8_t NO_LIST = 0;
+
+    struct FrameLink{
+        frame_id_t prev = INVALID_FRAME_ID;     /* neighbour closer to the front */
+        frame_id_t next = INVALID_FRAME_ID;     /* neighbour closer to the back */
+        uint8_t list_id = NO_LIST;              /* list the frame belongs to */
+    };
+
+    /* An intrusive doubly linked list of frame ids. Several lists share one array of links,
+       since a frame belongs to at most one list of a policy at a time. */
+    class FrameList{
+    public:
+        FrameList(std::vector<FrameLink>& links, const uint8_t list_id) noexcept
+            : links_(links), list_id_(list_id){
+        }
+
+        void pushFront(const frame_id_t frame_id) noexcept{
+            FrameLink& link = links_[frame_id];
+            link.prev = INVALID_FRAME_ID;
+            link.next = head_;
+            link.list_id = list_id_;
+            if (head_ != INVALID_FRAME_ID){
+                links_[head_].prev = frame_id;
+            }
+            head_ = frame_id;
+            if (tail_ == INVALID_FRAME_ID){
+                tail_ = frame_id;
+            }
+            ++size_;
+        }
+
+        void remove(const frame_id_t frame_id) noexcept{
+            FrameLink& link = links_[frame_id];
+            if (link.prev != INVALID_FRAME_ID){
+                links_[link.prev].next = link.next;
+            } else{
+                head_ = link.next;
+            }
+            if (link.next != INVALID_FRAME_ID){
+                links_[link.next].prev = link.prev;
+            } else{
+                tail_ = link.prev;
+            }
+            link = FrameLink();
+            --size_;
+        }
+
+        void moveToFront(const frame_id_t frame_id) noexcept{
+            if (head_ != frame_id){
+                remove(frame_id);
+                pushFront(frame_id);
+            }
+        }
+
+        // Put `to_frame_id` at the position of `from_frame_id`.
+        void replace(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept{
+            FrameLink& link = links_[to_frame_id];
+            link = links_[from_frame_id];
+            links_[from_frame_id] = FrameLink();
+            if (link.prev != INVALID_FRAME_ID){
+                links_[link.prev].next = to_frame_id;
+            } else{
+                head_ = to_frame_id;
+            }
+            if (link.next != INVALID_FRAME_ID){
+                links_[link.next].prev = to_frame_id;
+            } else{
+                tail_ = to_frame_id;
+            }
+        }
+
+        bool contains(const frame_id_t frame_id) const noexcept{
+            return links_[frame_id].list_id == list_id_;
+        }
+
+        frame_id_t back() const noexcept{
+            return tail_;
+        }
+
+        void appendTo(std::vector<frame_id_t>& frames) const{
+            for (frame_id_t frame_id = head_; frame_id != INVALID_FRAME_ID; frame_id = links_[frame_id].next){
+                frames.push_back(frame_id);
+            }
+        }
+
+        void clear() noexcept{
+            while (head_ != INVALID_FRAME_ID){
+                remove(head_);
+            }
+        }
+
+        size_t size() const noexcept{
+            return size_;
+        }
+
+    private:
+        std::vector<FrameLink>& links_;
+        const uint8_t list_id_;
+        frame_id_t head_ = INVALID_FRAME_ID;
+        frame_id_t tail_ = INVALID_FRAME_ID;
+        size_t size_ = 0;
+    };
+
+    /* The eviction candidates of a policy list, and the frames of the list which have been found pinned or dirty.
+       A frame found so is parked until it becomes evictable again and then comes back to the front, as after an access;
+       so an eviction walks past every unevictable frame at most once, rather than on every call. */
+    class CandidateList{
+    public:
+        CandidateList(std::vector<FrameLink>& links, const uint8_t list_id) noexcept
+            : links_(links), candidates_(links, list_id), parked_(links, list_id | PARKED_LIST_FLAG),
+              list_id_(list_id){
+        }
+
+        void pushFront(const frame_id_t frame_id) noexcept{
+            candidates_.pushFront(frame_id);
+        }
+
+        void remove(const frame_id_t frame_id) noexcept{
+            (candidates_.contains(frame_id) ? candidates_ : parked_).remove(frame_id);
+        }
+
+        void moveToFront(const frame_id_t frame_id) noexcept{
+            if (parked_.contains(frame_id)){
+                parked_.remove(frame_id);
+                candidates_.pushFront(frame_id);
+                return;
+            }
+            candidates_.moveToFront(frame_id);
+        }
+
+        void replace(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept{
+            (candidates_.contains(from_frame_id) ? candidates_ : parked_).replace(from_frame_id, to_frame_id);
+        }
+
+        bool contains(const frame_id_t frame_id) const noexcept{
+            return (links_[frame_id].list_id & ~PARKED_LIST_FLAG) == list_id_;
+        }
+
+        // Find the evictable frame closest to the back, parking the unevictable ones passed on the way.
+        frame_id_t findFromBack(const ReplacementPolicy::EvictablePredicate& predicate) noexcept{
+            frame_id_t frame_id = candidates_.back();
+            while (frame_id != INVALID_FRAME_ID && !predicate(frame_id)){
+                const frame_id_t prev_frame_id = links_[frame_id].prev;
+                candidates_.remove(frame_id);
+                parked_.pushFront(frame_id);
+                frame_id = prev_frame_id;
+            }
+            return frame_id;
+        }
+
+        // Return a parked frame to the candidates.
+        void unpark(const frame_id_t frame_id) noexcept{
+            if (parked_.contains(frame_id)){
+                parked_.remove(frame_id);
+                candidates_.pushFront(frame_id);
+            }
+        }
+
+        // Parked frames are listed last, where they have been found.
+        void appendTo(std::vector<frame_id_t>& frames) const{
+            candidates_.appendTo(frames);
+            parked_.appendTo(frames);
+        }
+
+        void clear() noexcept{
+            candidates_.clear();
+            parked_.clear();
+        }
+
+        size_t size() const noexcept{
+            return candidates_.size() + parked_.size();
+        }
+
+    private:
+        static constexpr uint8_t PARKED_LIST_FLAG = 0x80;
+
+        std::vector<FrameLink>& links_;
+        FrameList candidates_;
+        FrameList parked_;
+        const uint8_t list_id_;
+    };
+
+    /* A bounded LRU list of hashes of recently evicted blocks. All nodes are allocated at construction. */
+    class GhostList{
+    public:
+        explicit GhostList(const size_t max_entries)
+            : nodes_(std::max(max_entries, static_cast<size_t>(1))), hash_to_node_(nodes_.size()){
+            free_nodes_.reserve(nodes_.size());
+            for (size_t node_id = nodes_.size(); node_id > 0; --node_id){
+                free_nodes_.push_back(node_id - 1);
+            }
+        }
+
+        bool contains(const size_t block_hash) const noexcept{
+            return hash_to_node_.find(block_hash) != nullptr;
+        }
+
+        // Add the hash to the front, dropping the oldest entry if the list is full.
+        void pushFront(const size_t block_hash) noexcept{
+            if (contains(block_hash)){
+                remove(block_hash);
+            }
+            if (free_nodes_.empty()){
+                popBack();
+            }
+            const size_t node_id = free_nodes_.back();
+            free_nodes_.pop_back();
+
+            nodes_[node_id] = Node{block_hash, INVALID_NODE, head_};
+            if (head_ != INVALID_NODE){
+                nodes_[head_].prev = node_id;
+            }
+            head_ = node_id;
+            if (tail_ == INVALID_NODE){
+                tail_ = node_id;
+            }
+            hash_to_node_.insert(block_hash, node_id);
+        }
+
+        bool remove(const size_t block_hash) noexcept{
+            const size_t* node_id = hash_to_node_.find(block_hash);
+            if (node_id == nullptr){
+                return false;
+            }
+            unlink(*node_id);
+            return true;
+        }
+
+        void popBack() noexcept{
+            if (tail_ != INVALID_NODE){
+                unlink(tail_);
+            }
+        }
+
+        // Drop the oldest entries until at most `max_size` are left.
+        void trim(const size_t max_size) noexcept{
+            while (size() > max_size){
+                popBack();
+            }
+        }
+
+        void clear() noexcept{
+            while (tail_ != INVALID_NODE){
+                unlink(tail_);
+            }
+        }
+
+        size_t size() const noexcept{
+            return hash_to_node_.size();
+        }
+
+    private:
+        static constexpr size_t INVALID_NODE = static_cast<size_t>(-1);
+
+        struct Node{
+            size_t block_hash = 0;
+            size_t prev = INVALID_NODE;
+            size_t next = INVALID_NODE;
+        };
+
+        void unlink(const size_t node_id) noexcept{
+            const Node node = nodes_[node_id];
+            if (node.prev != INVALID_NODE){
+                nodes_[node.prev].next = node.next;
+            } else{
+                head_ = node.next;
+            }
+            if (node.next != INVALID_NODE){
+                nodes_[node.next].prev = node.prev;
+            } else{
+                tail_ = node.prev;
+            }
+            hash_to_node_.erase(node.block_hash);
+            free_nodes_.push_back(node_id);
+        }
+
+    private:
+        std::vector<Node> nodes_;
+        std::vector<size_t> free_nodes_;
+        HashIndex<size_t> hash_to_node_;
+        size_t head_ = INVALID_NODE;
+        size_t tail_ = INVALID_NODE;
+    };
+
+
+    class LruPolicy : public ReplacementPolicy{
+    public:
+        explicit LruPolicy(const size_t max_frames)
+            : links_(max_frames), recency_list_(links_, 1){
+        }
+
+        void recordInsert(const frame_id_t frame_id, const size_t) noexcept override{
+            recency_list_.pushFront(frame_id);
+        }
+
+        void recordAccess(const frame_id_t frame_id) noexcept override{
+            recency_list_.moveToFront(frame_id);
+        }
+
+        void recordRemove(const frame_id_t frame_id, const bool) noexcept override{
+            recency_list_.remove(frame_id);
+        }
+
+        void recordMove(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept override{
+            recency_list_.replace(from_frame_id, to_frame_id);
+        }
+
+        frame_id_t pickVictim(const EvictablePredicate& is_evictable) noexcept override{
+            return recency_list_.findFromBack(is_evictable);
+        }
+
+        void recordEvictable(const frame_id_t frame_id) noexcept override{
+            recency_list_.unpark(frame_id);
+        }
+
+        void setCapacity(const size_t) noexcept override{
+        }
+
+        void clear() noexcept override{
+            recency_list_.clear();
+        }
+
+        std::vector<frame_id_t> getOrder() const override{
+            std::vector<frame_id_t> order;
+            recency_list_.appendTo(order);
+            return order;
+        }
+
+        ReplacementPolicyType getType() const noexcept override{
+            return ReplacementPolicyType::LRU;
+        }
+
+    private:
+        std::vector<FrameLink> links_;
+        CandidateList recency_list_;            /* most recently used frame first */
+    };
+
+
+    /* CLOCK-sweep: every access bumps a small usage counter, and the clock hand decrements counters
+       until it meets an evictable frame with a zero counter. New blocks start with a zero counter,
+       so blocks touched once by a scan are the first to go. */
+    class ClockPolicy : public ReplacementPolicy{
+    public:
+        explicit ClockPolicy(const size_t max_frames)
+            : usage_counts_(max_frames, 0), tracked_(max_frames, false){
+        }
+
+        void recordInsert(const frame_id_t frame_id, const size_t) noexcept override{
+            tracked_[frame_id] = true;
+            usage_counts_[frame_id] = 0;
+            ++tracked_count_;
+        }
+
+        void recordAccess(const frame_id_t frame_id) noexcept override{
+            if (usage_counts_[frame_id] < MAX_USAGE_COUNT){
+                ++usage_counts_[frame_id];
+            }
+        }
+
+        void recordRemove(const frame_id_t frame_id, const bool) noexcept override{
+            tracked_[frame_id] = false;
+            usage_counts_[frame_id] = 0;
+            --tracked_count_;
+        }
+
+        void recordMove(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept override{
+            tracked_[to_frame_id] = true;
+            usage_counts_[to_frame_id] = usage_counts_[from_frame_id];
+            tracked_[from_frame_id] = false;
+            usage_counts_[from_frame_id] = 0;
+        }
+
+        frame_id_t pickVictim(const EvictablePredicate& is_evictable) noexcept override{
+            if (tracked_count_ == 0){
+                return INVALID_FRAME_ID;
+            }
+            // after MAX_USAGE_COUNT + 1 full turns every unpinned counter has dropped to zero
+            const size_t max_steps = (MAX_USAGE_COUNT + 1) * usage_counts_.size() + 1;
+            for (size_t step = 0; step < max_steps; ++step){
+                const frame_id_t frame_id = clock_hand_;
+                clock_hand_ = (clock_hand_ + 1) % usage_counts_.size();
+
+                if (!tracked_[frame_id] || !is_evictable(frame_id)){
+                    continue;
+                }
+                if (usage_counts_[frame_id] == 0){
+                    return frame_id;
+                }
+                --usage_counts_[frame_id];
+            }
+            return INVALID_FRAME_ID;
+        }
+
+        // the clock hand passes unevictable frames without touching their counters, so nothing is set aside
+        void recordEvictable(const frame_id_t) noexcept override{
+        }
+
+        void setCapacity(const size_t) noexcept override{
+        }
+
+        void clear() noexcept override{
+            std::fill(tracked_.begin(), tracked_.end(), false);
+            std::fill(usage_counts_.begin(), usage_counts_.end(), 0);
+            tracked_count_ = 0;
+        }
+
+        // Frames in the reverse order the clock hand would reach them.
+        std::vector<frame_id_t> getOrder() const override{
+            std::vector<frame_id_t> order;
+            for (size_t step = usage_counts_.size(); step > 0; --step){
+                const frame_id_t frame_id = (clock_hand_ + step - 1) % usage_counts_.size();
+                if (tracked_[frame_id]){
+                    order.push_back(frame_id);
+                }
+            }
+            return order;
+        }
+
+        ReplacementPolicyType getType() const noexcept override{
+            return ReplacementPolicyType::CLOCK;
+        }
+
+    private:
+        static constexpr uint8_t MAX_USAGE_COUNT = 3;
+
+        std::vector<uint8_t> usage_counts_;
+        std::vector<bool> tracked_;
+        size_t tracked_count_ = 0;
+        frame_id_t clock_hand_ = 0;
+    };
+
+
+    /* 2Q (Johnson & Shasha): new blocks enter a FIFO probation queue A1in. Blocks evicted from it are remembered
+       in the ghost queue A1out, and only a block that comes back while still remembered is promoted to the
+       protected LRU queue Am. A one-time scan therefore never displaces the blocks in Am. */
+    class TwoQueuePolicy : public ReplacementPolicy{
+    public:
+        TwoQueuePolicy(const size_t max_frames, const size_t capacity)
+            : links_(max_frames), frame_hashes_(max_frames), a1in_(links_, 1), am_(links_, 2), a1out_(max_frames){
+            setCapacity(capacity);
+        }
+
+        void recordInsert(const frame_id_t frame_id, const size_t block_hash) noexcept override{
+            frame_hashes_[frame_id] = block_hash;
+            if (a1out_.remove(block_hash)){
+                am_.pushFront(frame_id);
+            } else{
+                a1in_.pushFront(frame_id);
+            }
+        }
+
+        void recordAccess(const frame_id_t frame_id) noexcept override{
+            // hits in the probation queue do not change its FIFO order
+            if (am_.contains(frame_id)){
+                am_.moveToFront(frame_id);
+            }
+        }
+
+        void recordRemove(const frame_id_t frame_id, const bool evicted) noexcept override{
+            if (a1in_.contains(frame_id)){
+                a1in_.remove(frame_id);
+                if (evicted){
+                    a1out_.pushFront(frame_hashes_[frame_id]);
+                    a1out_.trim(kout_);
+                }
+            } else{
+                am_.remove(frame_id);
+            }
+        }
+
+        void recordMove(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept override{
+            CandidateList& list = a1in_.contains(from_frame_id) ? a1in_ : am_;
+            list.replace(from_frame_id, to_frame_id);
+            frame_hashes_[to_frame_id] = frame_hashes_[from_frame_id];
+        }
+
+        frame_id_t pickVictim(const EvictablePredicate& is_evictable) noexcept override{
+            const bool prefer_a1in = a1in_.size() > kin_ || am_.size() == 0;
+            CandidateList& preferred = prefer_a1in ? a1in_ : am_;
+            CandidateList& fallback = prefer_a1in ? am_ : a1in_;
+
+            const frame_id_t victim = preferred.findFromBack(is_evictable);
+            return victim != INVALID_FRAME_ID ? victim : fallback.findFromBack(is_evictable);
+        }
+
+        void recordEvictable(const frame_id_t frame_id) noexcept override{
+            a1in_.unpark(frame_id);
+            am_.unpark(frame_id);
+        }
+
+        void setCapacity(const size_t capacity) noexcept override{
+            // the sizes recommended by the paper: 25% of the cache for A1in, A1out remembers 50% of the cache
+            kin_ = std::max(capacity / 4, static_cast<size_t>(1));
+            kout_ = std::max(capacity / 2, static_cast<size_t>(1));
+            a1out_.trim(kout_);
+        }
+
+        void clear() noexcept override{
+            a1in_.clear();
+            am_.clear();
+            a1out_.clear();
+        }
+
+        std::vector<frame_id_t> getOrder() const override{
+            std::vector<frame_id_t> order;
+            am_.appendTo(order);
+            a1in_.appendTo(order);
+            return order;
+        }
+
+        ReplacementPolicyType getType() const noexcept override{
+            return ReplacementPolicyType::TWO_Q;
+        }
+
+    private:
+        std::vector<FrameLink> links_;
+        std::vector<size_t> frame_hashes_;
+        CandidateList a1in_;            /* probation FIFO, newest first */
+        CandidateList am_;              /* protected LRU, most recently used first */
+        GhostList a1out_;           /* hashes of blocks recently evicted from A1in */
+        size_t kin_ = 1;
+        size_t kout_ = 1;
+    };
+
+
+    /* ARC (Megiddo & Modha): T1 holds blocks seen once recently, T2 blocks seen at least twice. Ghost lists B1 and B2
+       remember blocks evicted from T1 and T2, and a hit in a ghost list shifts the target size `p` of T1 towards the
+       list that would have kept the block. Blocks touched once by a scan never reach T2.
+       The BufferManager evicts before it inserts, so the target is adapted when the block is inserted. */
+    class ArcPolicy : public ReplacementPolicy{
+    public:
+        ArcPolicy(const size_t max_frames, const size_t capacity)
+            : links_(max_frames), frame_hashes_(max_frames), t1_(links_, 1), t2_(links_, 2), b1_(max_frames), b2_(max_frames * 2){
+            setCapacity(capacity);
+        }
+
+        void recordInsert(const frame_id_t frame_id, const size_t block_hash) noexcept override{
+            frame_hashes_[frame_id] = block_hash;
+
+            if (b1_.contains(block_hash)){
+                // the block would have survived with a bigger T1
+                const size_t delta = b1_.size() >= b2_.size() ? 1 : b2_.size() / b1_.size();
+                target_t1_size_ = std::min(target_t1_size_ + delta, capacity_);
+                b1_.remove(block_hash);
+                t2_.pushFront(frame_id);
+                return;
+            }
+            if (b2_.contains(block_hash)){
+                // the block would have survived with a bigger T2
+                const size_t delta = b2_.size() >= b1_.size() ? 1 : b1_.size() / b2_.size();
+                target_t1_size_ = target_t1_size_ > delta ? target_t1_size_ - delta : 0;
+                b2_.remove(block_hash);
+                t2_.pushFront(frame_id);
+                return;
+            }
+
+            // a completely new block: keep |T1| + |B1| <= c and the whole directory <= 2c
+            while (b1_.size() > 0 && t1_.size() + b1_.size() >= capacity_){
+                b1_.popBack();
+            }
+            while (b2_.size() > 0 && t1_.size() + t2_.size() + b1_.size() + b2_.size() >= 2 * capacity_){
+                b2_.popBack();
+            }
+            t1_.pushFront(frame_id);
+        }
+
+        void recordAccess(const frame_id_t frame_id) noexcept override{
+            if (t1_.contains(frame_id)){
+                t1_.remove(frame_id);
+                t2_.pushFront(frame_id);
+            } else{
+                t2_.moveToFront(frame_id);
+            }
+        }
+
+        void recordRemove(const frame_id_t frame_id, const bool evicted) noexcept override{
+            const bool in_t1 = t1_.contains(frame_id);
+            (in_t1 ? t1_ : t2_).remove(frame_id);
+            if (evicted){
+                (in_t1 ? b1_ : b2_).pushFront(frame_hashes_[frame_id]);
+            }
+        }
+
+        void recordMove(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept override{
+            CandidateList& list = t1_.contains(from_frame_id) ? t1_ : t2_;
+            list.replace(from_frame_id, to_frame_id);
+            frame_hashes_[to_frame_id] = frame_hashes_[from_frame_id];
+        }
+
+        frame_id_t pickVictim(const EvictablePredicate& is_evictable) noexcept override{
+            const bool prefer_t1 = t1_.size() > 0 && (t1_.size() > target_t1_size_ || t2_.size() == 0);
+            CandidateList& preferred = prefer_t1 ? t1_ : t2_;
+            CandidateList& fallback = prefer_t1 ? t2_ : t1_;
+
+            const frame_id_t victim = preferred.findFromBack(is_evictable);
+            return victim != INVALID_FRAME_ID ? victim : fallback.findFromBack(is_evictable);
+        }
+
+        void recordEvictable(const frame_id_t frame_id) noexcept override{
+            t1_.unpark(frame_id);
+            t2_.unpark(frame_id);
+        }
+
+        void setCapacity(const size_t capacity) noexcept override{
+            capacity_ = std::max(capacity, static_cast<size_t>(1));
+            target_t1_size_ = std::min(target_t1_size_, capacity_);
+            b1_.trim(capacity_);
+            b2_.trim(2 * capacity_);
+        }
+
+        void clear() noexcept override{
+            t1_.clear();
+            t2_.clear();
+            b1_.clear();
+            b2_.clear();
+            target_t1_size_ = 0;
+        }
+
+        std::vector<frame_id_t> getOrder() const override{
+            std::vector<frame_id_t> order;
+            t2_.appendTo(order);
+            t1_.appendTo(order);
+            return order;
+        }
+
+        ReplacementPolicyType getType() const noexcept override{
+            return ReplacementPolicyType::ARC;
+        }
+
+    private:
+        std::vector<FrameLink> links_;
+        std::vector<size_t> frame_hashes_;
+        CandidateList t1_;              /* blocks seen once recently, most recent first */
+        CandidateList t2_;              /* blocks seen at least twice recently, most recent first */
+        GhostList b1_;              /* hashes of blocks evicted from T1 */
+        GhostList b2_;              /* hashes of blocks evicted from T2 */
+        size_t capacity_ = 1;       /* c */
+        size_t target_t1_size_ = 0; /* p */
+    };
+}
+
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::create(const ReplacementPolicyType type, const size_t max_frames, const size_t capacity){
+    switch (type){
+        case ReplacementPolicyType::CLOCK:
+            return std::make_unique<ClockPolicy>(max_frames);
+        case ReplacementPolicyType::TWO_Q:
+            return std::make_unique<TwoQueuePolicy>(max_frames, capacity);
+        case ReplacementPolicyType::ARC:
+            return std::make_unique<ArcPolicy>(max_frames, capacity);
+        case ReplacementPolicyType::LRU:
+        default:
+            return std::make_unique<LruPolicy>(max_frames);
+    }
+}
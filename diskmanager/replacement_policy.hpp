@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+
+using frame_id_t = size_t;                          /* index of a frame in the BufferManager frame pool */
+
+static constexpr frame_id_t INVALID_FRAME_ID = static_cast<frame_id_t>(-1);
+
+enum class ReplacementPolicyType{
+    LRU,        /* strict least recently used; not scan-resistant */
+    CLOCK,      /* CLOCK-sweep with saturating usage counters */
+    TWO_Q,      /* 2Q: a FIFO probation queue, a ghost queue and a protected LRU queue */
+    ARC         /* Adaptive Replacement Cache: balances recency and frequency lists using ghost hits */
+};
+
+/* Decides which cached block is evicted when the BufferManager runs out of frames.
+   The BufferManager owns the frames and reports every change of their contents to the policy;
+   the policy only keeps its own bookkeeping over frame ids (and hashes of recently evicted blocks). */
+class ReplacementPolicy{
+public:
+    // Tells whether a frame may be evicted right now (it holds a block and the block is not pinned).
+    using EvictablePredicate = std::function<bool(const frame_id_t)>;
+
+    virtual ~ReplacementPolicy() = default;
+
+    /** Create a policy.
+     * @param[in] type replacement algorithm
+     * @param[in] max_frames number of frames in the pool; frame ids are in [0, max_frames)
+     * @param[in] capacity number of frames currently usable by the cache
+    */
+    static std::unique_ptr<ReplacementPolicy> create(const ReplacementPolicyType type, const size_t max_frames, const size_t capacity);
+
+public:
+    // A new block with the `block_hash` has been placed into the frame.
+    virtual void recordInsert(const frame_id_t frame_id, const size_t block_hash) noexcept = 0;
+
+    // The block in the frame has been accessed.
+    virtual void recordAccess(const frame_id_t frame_id) noexcept = 0;
+
+    /** The block leaves the frame.
+     * @param[in] evicted `true` if the block is dropped to make space, `false` if it has been removed explicitly
+    */
+    virtual void recordRemove(const frame_id_t frame_id, const bool evicted) noexcept = 0;
+
+    // The block has been moved from one frame to another, keeping its position in the policy.
+    virtual void recordMove(const frame_id_t from_frame_id, const frame_id_t to_frame_id) noexcept = 0;
+
+    /** Choose the frame to evict. The victim keeps its place until `recordRemove()` is called for it; the frames which
+     * cannot be evicted may be set aside until `recordEvictable()`, so they are not searched again by every eviction.
+     * @return `INVALID_FRAME_ID` if no frame can be evicted.
+    */
+    virtual frame_id_t pickVictim(const EvictablePredicate& is_evictable) noexcept = 0;
+
+    // The block in the frame has been unpinned or written back and may be evicted again.
+    virtual void recordEvictable(const frame_id_t frame_id) noexcept = 0;
+
+    // The number of frames usable by the cache has changed.
+    virtual void setCapacity(const size_t capacity) noexcept = 0;
+
+    // Forget all tracked blocks, including the history of evicted ones.
+    virtual void clear() noexcept = 0;
+
+    // Get the tracked frames ordered from the most to the least valuable one (for diagnostics and tests).
+    virtual std::vector<frame_id_t> getOrder() const = 0;
+
+    virtual ReplacementPolicyType getType() const noexcept = 0;
+};
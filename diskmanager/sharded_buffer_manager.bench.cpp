@@ -0,0 +1,108 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "sharded_buffer_manager.hpp"
+#include "bench_common.hpp"
+
+/* Measures lookup throughput of the cache shared by 1 to 64 threads: a single BufferManager behind one global
+   latch, the ShardedBufferManager pinning blocks under shard latches and its latch-free `readBlock()` hit path.
+   Every thread reads random cached blocks (95%) and adds new ones (5%).
+   Usage: ShardedBufferManagerBenchmark [cached_blocks = 100000] [ops_per_thread = 1000000] [shards = 0 (auto)] */
+
+namespace{
+    template <typename Cache, typename ReadOperation>
+    double measureMopsPerSecond(Cache& cache, ReadOperation&& read, const size_t threads_count, const size_t ops_per_thread,
+                                const size_t keys_count){
+        DataBlock block;
+        block.data_size = MAX_DATA_BLOCK_SIZE;
+
+        std::atomic<bool> start{false};
+        std::vector<std::thread> workers;
+        for (size_t thread_id = 0; thread_id < threads_count; ++thread_id){
+            workers.emplace_back([&, thread_id](){
+                const std::vector<size_t> indexes = makeRandomIndexes(ops_per_thread, keys_count, static_cast<unsigned>(thread_id + 1));
+                while (!start.load(std::memory_order_acquire)){
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < ops_per_thread; ++i){
+                    if (i % 20 == 0){
+                        cache.addDataBlock(block, keys_count + thread_id * ops_per_thread + i);
+                    } else{
+                        doNotOptimize(read(indexes[i]));
+                    }
+                }
+            });
+        }
+
+        const auto started_at = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (std::thread& worker : workers){
+            worker.join();
+        }
+        const double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started_at).count();
+        return static_cast<double>(threads_count * ops_per_thread) / elapsed_us;
+    }
+
+    /* The baseline: the single-threaded BufferManager made thread-safe with one latch. */
+    class GloballyLatchedBufferManager{
+    public:
+        explicit GloballyLatchedBufferManager(const size_t memory_budget) : manager_(memory_budget){}
+
+        BlockHandle getDataBlock(const size_t block_hash){
+            std::lock_guard<std::mutex> guard(latch_);
+            BlockHandle handle = manager_.getDataBlock(block_hash);
+            handle.release();           // the handle would unpin the block without the latch
+            return handle;
+        }
+
+        bool addDataBlock(const DataBlock& data_block, const size_t data_hash){
+            std::lock_guard<std::mutex> guard(latch_);
+            return manager_.addDataBlock(data_block, data_hash);
+        }
+
+    private:
+        std::mutex latch_;
+        BufferManager manager_;
+    };
+}
+
+int main(int argc, char** argv){
+    const size_t keys_count = readSizeArgument(argc, argv, 1, 100'000);
+    const size_t ops_per_thread = readSizeArgument(argc, argv, 2, 1'000'000);
+    const size_t shards_count = readSizeArgument(argc, argv, 3, 0);
+    const size_t memory_budget = BufferManager::getMemoryBudgetForBlocks(keys_count);
+
+    DataBlock block;
+    block.data_size = MAX_DATA_BLOCK_SIZE;
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(20) << "global latch Mops/s" << std::setw(16) << "sharded Mops/s"
+              << std::setw(20) << "optimistic Mops/s" << std::endl;
+
+    for (size_t threads_count = 1; threads_count <= 64; threads_count *= 2){
+        GloballyLatchedBufferManager global_cache(memory_budget);
+        ShardedBufferManager sharded_cache(memory_budget, shards_count);
+        ShardedBufferManager optimistic_cache(memory_budget, shards_count);
+        for (size_t hash = 0; hash < keys_count; ++hash){
+            global_cache.addDataBlock(block, hash);
+            sharded_cache.addDataBlock(block, hash);
+            optimistic_cache.addDataBlock(block, hash);
+        }
+
+        const double global_mops = measureMopsPerSecond(global_cache, [&](const size_t hash){
+            return global_cache.getDataBlock(hash).isValid();
+        }, threads_count, ops_per_thread, keys_count);
+        const double sharded_mops = measureMopsPerSecond(sharded_cache, [&](const size_t hash){
+            return sharded_cache.getDataBlock(hash).isValid();
+        }, threads_count, ops_per_thread, keys_count);
+        const double optimistic_mops = measureMopsPerSecond(optimistic_cache, [&](const size_t hash){
+            thread_local char buffer[MAX_DATA_BLOCK_SIZE];
+            size_t data_size = 0;
+            return optimistic_cache.readBlock(hash, buffer, data_size);
+        }, threads_count, ops_per_thread, keys_count);
+
+        std::cout << std::setw(10) << threads_count << std::setw(20) << std::fixed << std::setprecision(2) << global_mops
+                  << std::setw(16) << sharded_mops << std::setw(20) << optimistic_mops << std::endl;
+    }
+}
@@ -0,0 +1,140 @@
+#include "sharded_buffer_manager.hpp"
+
+#include <thread>
+
+namespace{
+    constexpr size_t SHARDS_PER_HARDWARE_THREAD = 4;
+    constexpr size_t MAX_OPTIMISTIC_READ_ATTEMPTS = 4;
+
+    // Every shard gets an equal part of the budget, but at least one frame.
+    size_t getShardBudget(const size_t memory_budget, const size_t shards_count) noexcept{
+        return std::max(memory_budget / shards_count, BufferManager::getMemoryBudgetForBlocks(1));
+    }
+}
+
+ShardedBufferManager::ShardedBufferManager(const size_t memory_budget, const size_t shards_count, const size_t max_memory_budget,
+                                           const ReplacementPolicyType policy_type){
+    size_t actual_shards_count = shards_count;
+    if (actual_shards_count == 0){
+        actual_shards_count = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)) * SHARDS_PER_HARDWARE_THREAD;
+    }
+
+    const size_t shard_budget = getShardBudget(memory_budget, actual_shards_count);
+    const size_t shard_max_budget = max_memory_budget == 0 ? 0 : getShardBudget(max_memory_budget, actual_shards_count);
+
+    shards_.reserve(actual_shards_count);
+    for (size_t i = 0; i < actual_shards_count; ++i){
+        shards_.push_back(std::make_unique<Shard>(shard_budget, shard_max_budget, policy_type));
+    }
+}
+
+BlockHandle ShardedBufferManager::pinBlock(const size_t block_hash){
+    Shard& shard = getShard(block_hash);
+    std::lock_guard<std::mutex> guard(shard.latch);
+    BlockHandle handle = shard.manager.pinBlock(block_hash);
+    if (handle.isValid()){
+        handle.owner_latch_ = &shard.latch;
+    }
+    return handle;
+}
+
+BlockHandle ShardedBufferManager::getDataBlock(const size_t block_hash){
+    return pinBlock(block_hash);
+}
+
+bool ShardedBufferManager::readBlock(const size_t block_hash, char* buffer, size_t& data_size){
+    Shard& shard = getShard(block_hash);
+    for (size_t attempt = 0; attempt < MAX_OPTIMISTIC_READ_ATTEMPTS; ++attempt){
+        // a miss is reported as a conflict if the index has changed under it, so it is retried as well
+        const OptimisticReadStatus status = shard.manager.readBlockOptimistic(block_hash, buffer, data_size);
+        if (status != OptimisticReadStatus::CONFLICT){
+            return status == OptimisticReadStatus::SUCCESS;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(shard.latch);
+    const BlockHandle handle = shard.manager.pinBlock(block_hash);
+    if (!handle.isValid()){
+        return false;
+    }
+    data_size = handle.getDataSize();
+    std::memcpy(buffer, handle.getData(), data_size);
+    return true;
+}
+
+bool ShardedBufferManager::removeDataBlock(const size_t block_hash){
+    Shard& shard = getShard(block_hash);
+    std::lock_guard<std::mutex> guard(shard.latch);
+    return shard.manager.removeDataBlock(block_hash);
+}
+
+bool ShardedBufferManager::addDataBlock(const DataBlock& data_block, const size_t data_hash){
+    Shard& shard = getShard(data_hash);
+    std::lock_guard<std::mutex> guard(shard.latch);
+    return shard.manager.addDataBlock(data_block, data_hash);
+}
+
+void ShardedBufferManager::clearBuffer(){
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        shard->manager.clearBuffer();
+    }
+}
+
+bool ShardedBufferManager::setMemoryBudget(const size_t memory_budget){
+    const size_t shard_budget = getShardBudget(memory_budget, shards_.size());
+    bool fits_into_maximum = true;
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        fits_into_maximum = shard->manager.setMemoryBudget(shard_budget) && fits_into_maximum;
+    }
+    return fits_into_maximum;
+}
+
+void ShardedBufferManager::setAdmissionFilterEnabled(const bool enabled){
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        shard->manager.setAdmissionFilterEnabled(enabled);
+    }
+}
+
+size_t ShardedBufferManager::getCacheSize() const{
+    size_t cache_size = 0;
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        cache_size += shard->manager.getCacheSize();
+    }
+    return cache_size;
+}
+
+size_t ShardedBufferManager::getMaxCacheSize() const{
+    size_t max_cache_size = 0;
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        max_cache_size += shard->manager.getMaxCacheSize();
+    }
+    return max_cache_size;
+}
+
+size_t ShardedBufferManager::getResidentBytes() const{
+    size_t resident_bytes = shards_.capacity() * sizeof(std::unique_ptr<Shard>);
+    for (const std::unique_ptr<Shard>& shard : shards_){
+        std::lock_guard<std::mutex> guard(shard->latch);
+        resident_bytes += sizeof(Shard) + shard->manager.getResidentBytes();
+    }
+    return resident_bytes;
+}
+
+size_t ShardedBufferManager::getShardsCount() const noexcept{
+    return shards_.size();
+}
+
+size_t ShardedBufferManager::getShardIndex(const size_t block_hash) const noexcept{
+    // the high bits of a multiplicative hash are well mixed even for sequential block ids
+    const uint64_t mixed = static_cast<uint64_t>(block_hash) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>((mixed >> 32) % shards_.size());
+}
+
+ShardedBufferManager::Shard& ShardedBufferManager::getShard(const size_t block_hash) const noexcept{
+    return *shards_[getShardIndex(block_hash)];
+}
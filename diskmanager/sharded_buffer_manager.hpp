@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "buffer_manager.hpp"
+
+/* A thread-safe block cache. Blocks are partitioned into shards by their hash, and every shard is a separate
+   BufferManager with its own latch, index, frame pool and replacement policy. Threads working with blocks
+   of different shards never contend, so reads scale across cores.
+   Handles returned by the sharded cache take the shard latch when they unpin the block, so they may be
+   released from any thread.
+   `readBlock()` serves hits without the latch at all: frames are read under seqlock-style version validation and
+   recency is recorded with per-frame reference bits, so read-mostly workloads do not write to shared cache lines.
+   It is a standalone cache: the BlockManager keeps a single BufferManager, since its dirty blocks, dedup reservations and
+   read-ahead are ordered by one latch together with the buffer, and it copies its hits with the same optimistic read. */
+class ShardedBufferManager{
+public:
+    /** Create an empty cache.
+     * @param[in] memory_budget number of bytes the whole cache may use; it is split evenly between the shards
+     * @param[in] shards_count number of shards; `0` picks 4 shards per hardware thread
+     * @param[in] max_memory_budget upper limit for later `setMemoryBudget()` calls; `0` means `memory_budget`
+     * @param[in] policy_type replacement policy of every shard
+     * @throw `std::bad_alloc` if the frame pools cannot be allocated.
+    */
+    explicit ShardedBufferManager(const size_t memory_budget = DEFAULT_BUFFER_MEMORY_BUDGET, const size_t shards_count = 0,
+                                  const size_t max_memory_budget = 0,
+                                  const ReplacementPolicyType policy_type = ReplacementPolicyType::LRU);
+
+    ShardedBufferManager(const ShardedBufferManager&) = delete;
+    ShardedBufferManager& operator=(const ShardedBufferManager&) = delete;
+
+public:
+    // Pin a cached data block. Returns an empty handle if the block is not cached.
+    BlockHandle pinBlock(const size_t block_hash);
+
+    // Same as `pinBlock()`.
+    BlockHandle getDataBlock(const size_t block_hash);
+
+    /** Copy a cached data block into the buffer. The block is read optimistically without the shard latch;
+     * only if the frame keeps changing under the reader the copy is made under the latch.
+     * A miss is reported without taking the latch as well.
+     * @param[out] buffer at least `MAX_DATA_BLOCK_SIZE` bytes; only `data_size` bytes are written
+     * @param[out] data_size number of meaningful bytes in the block
+     * @return `false` if the block is not cached.
+    */
+    bool readBlock(const size_t block_hash, char* buffer, size_t& data_size);
+
+    /** Removes the data block from the cache.
+     * @return `false` if the block is pinned and cannot be removed, `true` otherwise.
+    */
+    bool removeDataBlock(const size_t block_hash);
+
+    /** Add a new data block to the cache.
+     * @return `true` if the block is in the cache, `false` if its shard is full of pinned blocks
+     * or the admission filter has rejected the block.
+    */
+    bool addDataBlock(const DataBlock& data_block, const size_t data_hash);
+
+    // Remove all blocks that are not pinned from the cache.
+    void clearBuffer();
+
+    /** Change the memory budget of the whole cache, splitting it evenly between the shards.
+     * @return `false` if the budget exceeds the maximum set at construction.
+    */
+    bool setMemoryBudget(const size_t memory_budget);
+
+    // Turn the TinyLFU admission filter of every shard on or off.
+    void setAdmissionFilterEnabled(const bool enabled);
+
+public:
+    size_t getCacheSize() const;
+
+    // Get a number of blocks the cache can hold within the current memory budget.
+    size_t getMaxCacheSize() const;
+
+    // Get a number of bytes used by the cached blocks and all bookkeeping structures of every shard.
+    size_t getResidentBytes() const;
+
+    size_t getShardsCount() const noexcept;
+
+    // Get the index of the shard the block belongs to.
+    size_t getShardIndex(const size_t block_hash) const noexcept;
+
+private:
+    /* A shard sits on its own cache lines, so latches of neighbouring shards do not share a line. */
+    struct alignas(64) Shard{
+        Shard(const size_t memory_budget, const size_t max_memory_budget, const ReplacementPolicyType policy_type)
+            : manager(memory_budget, max_memory_budget, policy_type){
+        }
+
+        mutable std::mutex latch;
+        BufferManager manager;
+    };
+
+    Shard& getShard(const size_t block_hash) const noexcept;
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <thread>
+
+#include "sharded_buffer_manager.hpp"
+
+namespace{
+    // A block whose payload is its own hash, so readers can check they got the right data.
+    DataBlock makeSelfDescribingBlock(const size_t hash){
+        DataBlock block;
+        block.data_size = sizeof(hash);
+        std::memcpy(block.data, &hash, sizeof(hash));
+        return block;
+    }
+}
+
+TEST(ShardedBufferManagerHappyTests, SingleThreadedOperationsTest){
+    const size_t shards_count = 4;
+    ShardedBufferManager manager(BufferManager::getMemoryBudgetForBlocks(8 * shards_count), shards_count);
+    EXPECT_EQ(manager.getShardsCount(), shards_count);
+    EXPECT_EQ(manager.getMaxCacheSize(), 8 * shards_count);
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
+    EXPECT_FALSE(manager.getDataBlock(1).isValid());
+
+    for (size_t hash = 0; hash < 16; ++hash){
+        EXPECT_TRUE(manager.addDataBlock(makeSelfDescribingBlock(hash), hash));
+        EXPECT_LT(manager.getShardIndex(hash), shards_count);
+    }
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(16));
+
+    {
+        BlockHandle handle = manager.pinBlock(5);
+        ASSERT_TRUE(handle.isValid());
+        size_t stored_hash = 0;
+        std::memcpy(&stored_hash, handle.getData(), sizeof(stored_hash));
+        EXPECT_EQ(stored_hash, static_cast<size_t>(5));
+        EXPECT_FALSE(manager.removeDataBlock(5));
+    }
+    EXPECT_TRUE(manager.removeDataBlock(5));
+    EXPECT_FALSE(manager.getDataBlock(5).isValid());
+
+    EXPECT_TRUE(manager.setMemoryBudget(BufferManager::getMemoryBudgetForBlocks(shards_count)));
+    EXPECT_LE(manager.getCacheSize(), shards_count);
+
+    manager.clearBuffer();
+    EXPECT_EQ(manager.getCacheSize(), static_cast<size_t>(0));
+    EXPECT_GT(manager.getResidentBytes(), static_cast<size_t>(0));
+}
+
+TEST(ShardedBufferManagerHappyTests, ConcurrentReadersAndWritersTest){
+    const size_t keys_count = 2000;
+    ShardedBufferManager manager(BufferManager::getMemoryBudgetForBlocks(keys_count / 2), 8);
+
+    std::atomic<size_t> corrupted_reads{0};
+    std::vector<std::thread> workers;
+    for (size_t thread_id = 0; thread_id < 8; ++thread_id){
+        workers.emplace_back([&, thread_id](){
+            size_t hash = thread_id;
+            for (size_t i = 0; i < 20000; ++i){
+                hash = (hash * 2654435761u + 1) % keys_count;
+                BlockHandle handle = manager.getDataBlock(hash);
+                if (!handle.isValid()){
+                    manager.addDataBlock(makeSelfDescribingBlock(hash), hash);
+                    continue;
+                }
+                size_t stored_hash = 0;
+                std::memcpy(&stored_hash, handle.getData(), sizeof(stored_hash));
+                corrupted_reads += stored_hash != hash || handle.getDataSize() != sizeof(hash);
+            }
+        });
+    }
+    for (std::thread& worker : workers){
+        worker.join();
+    }
+
+    EXPECT_EQ(corrupted_reads.load(), static_cast<size_t>(0));
+    EXPECT_LE(manager.getCacheSize(), manager.getMaxCacheSize());
+}
+
+TEST(ShardedBufferManagerHappyTests, ConcurrentOptimisticReadsTest){
+    const size_t keys_count = 512;
+    ShardedBufferManager manager(BufferManager::getMemoryBudgetForBlocks(keys_count / 2), 4);
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> corrupted_reads{0};
+    std::atomic<size_t> hits{0};
+
+    // writers keep replacing blocks, so readers run into frames being rewritten
+    std::vector<std::thread> workers;
+    for (size_t thread_id = 0; thread_id < 2; ++thread_id){
+        workers.emplace_back([&, thread_id](){
+            size_t hash = thread_id;
+            while (!stop.load()){
+                hash = (hash * 2654435761u + 7) % keys_count;
+                if (!manager.addDataBlock(makeSelfDescribingBlock(hash), hash)){
+                    continue;
+                }
+                if (hash % 3 == 0){
+                    manager.removeDataBlock(hash);
+                }
+            }
+        });
+    }
+    for (size_t thread_id = 0; thread_id < 4; ++thread_id){
+        workers.emplace_back([&, thread_id](){
+            char buffer[MAX_DATA_BLOCK_SIZE];
+            size_t hash = thread_id;
+            for (size_t i = 0; i < 50000; ++i){
+                hash = (hash * 2654435761u + 1) % keys_count;
+                size_t data_size = 0;
+                if (!manager.readBlock(hash, buffer, data_size)){
+                    continue;
+                }
+                size_t stored_hash = 0;
+                std::memcpy(&stored_hash, buffer, sizeof(stored_hash));
+                corrupted_reads += stored_hash != hash || data_size != sizeof(hash);
+                ++hits;
+            }
+        });
+    }
+    for (size_t i = 2; i < workers.size(); ++i){
+        workers[i].join();
+    }
+    stop.store(true);
+    workers[0].join();
+    workers[1].join();
+
+    EXPECT_EQ(corrupted_reads.load(), static_cast<size_t>(0));
+    EXPECT_GT(hits.load(), static_cast<size_t>(0));
+}
+
+TEST(ShardedBufferManagerHappyTests, ConcurrentOptimisticMissesTest){
+    const size_t keys_count = 64;
+    // one shard, so every removal shifts the index entries the readers probe
+    ShardedBufferManager manager(BufferManager::getMemoryBudgetForBlocks(keys_count), 1);
+    const size_t pinned_hash = keys_count;
+    ASSERT_TRUE(manager.addDataBlock(makeSelfDescribingBlock(pinned_hash), pinned_hash));
+    BlockHandle pinned_block = manager.pinBlock(pinned_hash);
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&](){
+        size_t hash = 0;
+        while (!stop.load()){
+            hash = (hash * 2654435761u + 7) % keys_count;
+            manager.addDataBlock(makeSelfDescribingBlock(hash), hash);
+            manager.removeDataBlock((hash * 31) % keys_count);
+        }
+    });
+
+    // the pinned block is always cached, so no read may miss it while the other entries move
+    std::atomic<size_t> misses{0};
+    std::vector<std::thread> readers;
+    for (size_t thread_id = 0; thread_id < 4; ++thread_id){
+        readers.emplace_back([&](){
+            char buffer[MAX_DATA_BLOCK_SIZE];
+            for (size_t i = 0; i < 50000; ++i){
+                size_t data_size = 0;
+                misses += manager.readBlock(pinned_hash, buffer, data_size) ? 0 : 1;
+            }
+        });
+    }
+    for (std::thread& reader : readers){
+        reader.join();
+    }
+    stop.store(true);
+    writer.join();
+
+    EXPECT_EQ(misses.load(), static_cast<size_t>(0));
+    pinned_block.release();
+}
@@ -0,0 +1,117 @@
+#include "tiny_lfu.hpp"
+
+namespace{
+    constexpr size_t COUNTERS_PER_WORD = 16;
+
+    size_t roundUpToPowerOfTwo(const size_t value) noexcept{
+        size_t result = 1;
+        while (result < value){
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // splitmix64 finalizer: block hashes may be sequential ids, so they are mixed before use.
+    uint64_t mixHash(const size_t block_hash) noexcept{
+        uint64_t mixed = static_cast<uint64_t>(block_hash);
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+        return mixed ^ (mixed >> 31);
+    }
+}
+
+TinyLfuFilter::TinyLfuFilter(const size_t capacity)
+    : counters_per_row_(roundUpToPowerOfTwo(std::max(capacity, COUNTERS_PER_WORD))),
+      sketch_(SKETCH_DEPTH * counters_per_row_ / COUNTERS_PER_WORD, 0),
+      sample_size_(10 * std::max(capacity, static_cast<size_t>(1))){
+    // the doorkeeper sees every distinct block of a sample, 4 bits per block keep its false positive rate near 10%
+    doorkeeper_.assign(roundUpToPowerOfTwo(std::max(sample_size_ * 4, static_cast<size_t>(64))) / 64, 0);
+    doorkeeper_mask_ = doorkeeper_.size() * 64 - 1;
+}
+
+void TinyLfuFilter::recordAccess(const size_t block_hash) noexcept{
+    const uint64_t mixed_hash = mixHash(block_hash);
+
+    // the first request only marks the doorkeeper
+    if (testAndSetDoorkeeper(mixed_hash)){
+        // conservative update: only the counters equal to the current estimate are incremented
+        size_t counter_indexes[SKETCH_DEPTH];
+        uint32_t min_value = MAX_COUNTER_VALUE;
+        for (size_t row = 0; row < SKETCH_DEPTH; ++row){
+            counter_indexes[row] = getCounterIndex(mixed_hash, row);
+            min_value = std::min(min_value, getCounter(row, counter_indexes[row]));
+        }
+        if (min_value < MAX_COUNTER_VALUE){
+            for (size_t row = 0; row < SKETCH_DEPTH; ++row){
+                if (getCounter(row, counter_indexes[row]) == min_value){
+                    const size_t position = row * counters_per_row_ + counter_indexes[row];
+                    sketch_[position / COUNTERS_PER_WORD] += uint64_t{1} << ((position % COUNTERS_PER_WORD) * 4);
+                }
+            }
+        }
+    }
+
+    if (++recorded_accesses_ >= sample_size_){
+        age();
+    }
+}
+
+uint32_t TinyLfuFilter::estimateFrequency(const size_t block_hash) const noexcept{
+    const uint64_t mixed_hash = mixHash(block_hash);
+
+    uint32_t min_value = MAX_COUNTER_VALUE;
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row){
+        min_value = std::min(min_value, getCounter(row, getCounterIndex(mixed_hash, row)));
+    }
+    // the request absorbed by the doorkeeper counts as well
+    return min_value + (testDoorkeeper(mixed_hash) ? 1 : 0);
+}
+
+bool TinyLfuFilter::shouldAdmit(const size_t candidate_hash, const size_t victim_hash) const noexcept{
+    return estimateFrequency(candidate_hash) > estimateFrequency(victim_hash);
+}
+
+void TinyLfuFilter::clear() noexcept{
+    std::fill(sketch_.begin(), sketch_.end(), 0);
+    std::fill(doorkeeper_.begin(), doorkeeper_.end(), 0);
+    recorded_accesses_ = 0;
+}
+
+size_t TinyLfuFilter::getMemoryUsage() const noexcept{
+    return (sketch_.capacity() + doorkeeper_.capacity()) * sizeof(uint64_t);
+}
+
+size_t TinyLfuFilter::getCounterIndex(const uint64_t mixed_hash, const size_t row) const noexcept{
+    // double hashing gives every row an independent-enough position
+    const uint64_t step = (mixed_hash >> 32) | 1;
+    return static_cast<size_t>(mixed_hash + row * step) & (counters_per_row_ - 1);
+}
+
+uint32_t TinyLfuFilter::getCounter(const size_t row, const size_t counter_index) const noexcept{
+    const size_t position = row * counters_per_row_ + counter_index;
+    return static_cast<uint32_t>((sketch_[position / COUNTERS_PER_WORD] >> ((position % COUNTERS_PER_WORD) * 4)) & 0xF);
+}
+
+bool TinyLfuFilter::testAndSetDoorkeeper(const uint64_t mixed_hash) noexcept{
+    const bool was_set = testDoorkeeper(mixed_hash);
+    const size_t first_bit = static_cast<size_t>(mixed_hash) & doorkeeper_mask_;
+    const size_t second_bit = static_cast<size_t>(mixed_hash >> 32) & doorkeeper_mask_;
+    doorkeeper_[first_bit / 64] |= uint64_t{1} << (first_bit % 64);
+    doorkeeper_[second_bit / 64] |= uint64_t{1} << (second_bit % 64);
+    return was_set;
+}
+
+bool TinyLfuFilter::testDoorkeeper(const uint64_t mixed_hash) const noexcept{
+    const size_t first_bit = static_cast<size_t>(mixed_hash) & doorkeeper_mask_;
+    const size_t second_bit = static_cast<size_t>(mixed_hash >> 32) & doorkeeper_mask_;
+    return (doorkeeper_[first_bit / 64] >> (first_bit % 64) & 1) && (doorkeeper_[second_bit / 64] >> (second_bit % 64) & 1);
+}
+
+void TinyLfuFilter::age() noexcept{
+    // halve all 16 counters of a word at once; the mask drops the bit shifted in from the neighbouring counter
+    for (uint64_t& word : sketch_){
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    std::fill(doorkeeper_.begin(), doorkeeper_.end(), 0);
+    recorded_accesses_ /= 2;
+}
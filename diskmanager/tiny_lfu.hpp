@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common.hpp"
+
+/* TinyLFU admission filter (Einziger, Friedman & Manes). It estimates how often a block has been requested recently
+   and lets a new block into a full cache only if it is requested more often than the block it would evict.
+
+   - Frequencies are kept in a count-min sketch of 4-bit saturating counters (4 rows).
+   - A doorkeeper bloom filter absorbs the first request of every block, so one-hit wonders never reach the sketch.
+   - After a sample of `10 * capacity` recorded requests all counters are halved and the doorkeeper is cleared,
+     so the estimates follow changes of the workload. */
+class TinyLfuFilter{
+public:
+    /** Create a filter.
+     * @param[in] capacity number of blocks the protected cache can hold
+    */
+    explicit TinyLfuFilter(const size_t capacity);
+
+public:
+    // Count one request of the block.
+    void recordAccess(const size_t block_hash) noexcept;
+
+    // Get the estimated number of recent requests of the block (at most 16).
+    uint32_t estimateFrequency(const size_t block_hash) const noexcept;
+
+    /** Decide whether a new block may replace a cached one.
+     * @param[in] candidate_hash hash of the block that is about to be cached
+     * @param[in] victim_hash hash of the block the cache would evict for it
+     * @return `true` if the candidate is estimated to be requested more often than the victim.
+    */
+    bool shouldAdmit(const size_t candidate_hash, const size_t victim_hash) const noexcept;
+
+    // Forget all recorded requests.
+    void clear() noexcept;
+
+    // Get a number of bytes used by the sketch and the doorkeeper.
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    static constexpr size_t SKETCH_DEPTH = 4;
+    static constexpr uint32_t MAX_COUNTER_VALUE = 15;
+
+    // Get the position of the block's counter in the given sketch row.
+    size_t getCounterIndex(const uint64_t mixed_hash, const size_t row) const noexcept;
+
+    uint32_t getCounter(const size_t row, const size_t counter_index) const noexcept;
+
+    // Check the block in the doorkeeper, then set its bits. Returns `true` if the block has already been there.
+    bool testAndSetDoorkeeper(const uint64_t mixed_hash) noexcept;
+
+    bool testDoorkeeper(const uint64_t mixed_hash) const noexcept;
+
+    // Halve every counter and clear the doorkeeper.
+    void age() noexcept;
+
+private:
+    size_t counters_per_row_;                   /* power of two */
+    std::vector<uint64_t> sketch_;              /* SKETCH_DEPTH rows of 4-bit counters, 16 counters per word */
+    size_t sample_size_;                        /* recorded requests between two agings */
+    std::vector<uint64_t> doorkeeper_;          /* bloom filter bits */
+    size_t doorkeeper_mask_ = 0;
+    size_t recorded_accesses_ = 0;
+};
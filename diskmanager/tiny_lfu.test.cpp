@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "tiny_lfu.hpp"
+
+TEST(TinyLfuFilterHappyTests, EstimateFrequencyTest){
+    TinyLfuFilter filter(1000);
+    EXPECT_EQ(filter.estimateFrequency(1), static_cast<uint32_t>(0));
+
+    // the first request is absorbed by the doorkeeper
+    filter.recordAccess(1);
+    EXPECT_EQ(filter.estimateFrequency(1), static_cast<uint32_t>(1));
+
+    for (size_t i = 0; i < 4; ++i){
+        filter.recordAccess(2);
+    }
+    EXPECT_EQ(filter.estimateFrequency(2), static_cast<uint32_t>(4));
+    EXPECT_TRUE(filter.shouldAdmit(2, 1));
+    EXPECT_FALSE(filter.shouldAdmit(1, 2));
+    EXPECT_FALSE(filter.shouldAdmit(1, 1)); // a tie keeps the cached block
+
+    // counters saturate instead of overflowing into the neighbours
+    for (size_t i = 0; i < 100; ++i){
+        filter.recordAccess(3);
+    }
+    EXPECT_EQ(filter.estimateFrequency(3), static_cast<uint32_t>(16));
+    EXPECT_EQ(filter.estimateFrequency(2), static_cast<uint32_t>(4));
+
+    filter.clear();
+    EXPECT_EQ(filter.estimateFrequency(3), static_cast<uint32_t>(0));
+}
+
+TEST(TinyLfuFilterHappyTests, AgingTest){
+    const size_t capacity = 100;
+    TinyLfuFilter filter(capacity);
+    for (size_t i = 0; i < 9; ++i){
+        filter.recordAccess(42);
+    }
+    EXPECT_EQ(filter.estimateFrequency(42), static_cast<uint32_t>(9));
+
+    // once the sample of 10 * capacity requests is full, every counter is halved and the doorkeeper is reset
+    for (size_t i = 0; i < capacity * 10; ++i){
+        filter.recordAccess(1'000'000 + i);
+    }
+    EXPECT_LT(filter.estimateFrequency(42), static_cast<uint32_t>(9));
+}
@@ -0,0 +1,638 @@
+#include "wal_block_store.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define WAL_BLOCK_STORE_SUPPORTED
+#endif
+
+using namespace std::string_literals;
+
+namespace{
+    enum LogRecordType : uint32_t{
+        WRITE_RECORD = 1,
+        REMOVE_RECORD = 2
+    };
+
+    /* Header of a log record, followed by `data_size` bytes of the block and padded to `LOG_RECORD_ALIGNMENT`. */
+    struct LogRecordHeader{
+        uint32_t magic = 0;
+        uint32_t type = 0;
+        uint64_t block_hash = 0;
+        uint64_t fingerprint_high = 0;
+        uint64_t seq_no = 0;
+        uint32_t data_size = 0;
+        uint32_t checksum = 0;                          /* CRC32C of the header with this field zeroed and of the data */
+    };
+    static_assert(sizeof(LogRecordHeader) == 40, "the log record layout is part of the file format");
+
+    constexpr uint32_t LOG_RECORD_MAGIC = 0x324c4157;   /* "WAL2" */
+    constexpr size_t LOG_RECORD_ALIGNMENT = 8;
+
+    size_t getRecordSize(const size_t data_size) noexcept{
+        return (sizeof(LogRecordHeader) + data_size + LOG_RECORD_ALIGNMENT - 1) / LOG_RECORD_ALIGNMENT * LOG_RECORD_ALIGNMENT;
+    }
+
+    uint32_t checksumRecord(LogRecordHeader header, const char* data) noexcept{
+        header.checksum = 0;
+        return computeCrc32c(data, header.data_size, computeCrc32c(reinterpret_cast<const char*>(&header), sizeof(header)));
+    }
+
+#ifdef WAL_BLOCK_STORE_SUPPORTED
+    std::runtime_error makeIoError(const std::string& what){
+        return std::runtime_error(what + ": "s + std::strerror(errno));
+    }
+
+    int createSegmentFile(const std::filesystem::path& segment_path){
+        const int fd = ::open(segment_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0){
+            throw makeIoError("Failed to create the log segment "s + segment_path.string());
+        }
+        // the new directory entry has to survive a crash as well as the records written into it
+        const std::filesystem::path dir_path = segment_path.has_parent_path() ? segment_path.parent_path() : std::filesystem::path(".");
+        const int dir_fd = ::open(dir_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd >= 0){
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+        return fd;
+    }
+
+    void closeSegmentFile(const int fd) noexcept{
+        ::close(fd);
+    }
+
+    void writeFully(const int fd, const char* buffer, size_t size, off_t offset){
+        while (size > 0){
+            const ssize_t written_bytes = ::pwrite(fd, buffer, size, offset);
+            if (written_bytes < 0){
+                if (errno == EINTR){
+                    continue;
+                }
+                throw makeIoError("Failed to write the log"s);
+            }
+            buffer += written_bytes;
+            size -= static_cast<size_t>(written_bytes);
+            offset += written_bytes;
+        }
+    }
+
+    void syncFile(const int fd){
+#ifdef __APPLE__
+        const int res = ::fsync(fd);
+#else
+        const int res = ::fdatasync(fd);
+#endif
+        if (res != 0){
+            throw makeIoError("Failed to sync the log"s);
+        }
+    }
+#else
+    int createSegmentFile(const std::filesystem::path&){
+        throw std::runtime_error("The write-ahead log is not supported on this platform"s);
+    }
+
+    void closeSegmentFile(const int) noexcept{
+    }
+
+    void writeFully(const int, const char*, size_t, off_t){
+    }
+
+    void syncFile(const int){
+    }
+#endif
+}
+
+WalBlockStore::WalBlockStore(std::unique_ptr<BlockStore> store, const std::filesystem::path& log_path, const size_t segment_size)
+    : store_(std::move(store)), log_path_(log_path), segment_size_(std::max(segment_size, static_cast<size_t>(1))){
+    if (!store_){
+        throw std::invalid_argument("WalBlockStore needs a block storage"s);
+    }
+    const uint64_t generation = replaySegments();
+    next_seq_no_ = store_->getNextSeqNo();
+    openSegment(generation);
+
+    log_writer_ = std::thread(&WalBlockStore::writeLog, this);
+    checkpointer_ = std::thread(&WalBlockStore::applySegments, this);
+}
+
+WalBlockStore::~WalBlockStore(){
+    bool applied = true;
+    try{
+        checkpoint();
+    } catch (const std::exception&){
+        // the segments are replayed on the next open
+        applied = false;
+    }
+    stopThreads();
+
+    if (segment_fd_ >= 0){
+        closeSegmentFile(segment_fd_);
+        if (applied){
+            std::error_code ec;
+            std::filesystem::remove(getSegmentPath(segment_generation_), ec);
+        }
+    }
+}
+
+void WalBlockStore::writeBlocks(const std::vector<StoredDataBlock>& dblocks){
+    if (dblocks.empty()){
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(latch_);
+    // the logged blocks are kept in memory, so writers wait for a lagging checkpointer
+    segment_applied_.wait(lock, [this](){
+        return sealed_segments_.size() < MAX_SEALED_SEGMENTS || !log_error_.empty() || !apply_error_.empty();
+    });
+    if (!log_error_.empty()){
+        throw std::runtime_error("Failed to write the log: "s + log_error_);
+    }
+    if (sealed_segments_.size() >= MAX_SEALED_SEGMENTS){
+        throw std::runtime_error("Failed to apply the log: "s + apply_error_);
+    }
+
+    uint64_t wait_lsn = 0;
+    for (const StoredDataBlock& stored_block : dblocks){
+        // a block logged by this batch or by a concurrent writer is committed with its first record
+        const auto logged = logged_blocks_.find(stored_block.block_hash);
+        if (logged != logged_blocks_.end()){
+            wait_lsn = std::max(wait_lsn, logged->second.lsn);
+            continue;
+        }
+        const size_t data_size = std::min(stored_block.dblock.data_size, static_cast<size_t>(MAX_DATA_BLOCK_SIZE));
+        const uint64_t lsn = appendRecord(WRITE_RECORD, stored_block.block_hash, stored_block.fingerprint_high, stored_block.seq_no,
+                                          stored_block.dblock.data, data_size);
+        LoggedBlock& logged_block = logged_blocks_[stored_block.block_hash];
+        logged_block.stored_block = stored_block;
+        // served from memory until it is applied, the storage computes the checksum then
+        logged_block.stored_block.checksum = 0;
+        logged_block.lsn = lsn;
+        next_seq_no_ = std::max(next_seq_no_, stored_block.seq_no + 1);
+        wait_lsn = lsn;
+    }
+    waitForLsn(wait_lsn, lock);
+}
+
+std::vector<StoredDataBlock> WalBlockStore::readBlocks(const std::vector<size_t>& block_hashes){
+    std::vector<StoredDataBlock> loaded_blocks;
+    std::vector<size_t> stored_hashes;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (const size_t block_hash : block_hashes){
+            const auto logged = logged_blocks_.find(block_hash);
+            if (logged != logged_blocks_.end()){
+                loaded_blocks.push_back(logged->second.stored_block);
+            } else{
+                stored_hashes.push_back(block_hash);
+            }
+        }
+    }
+    // a block leaves the log only after it has been applied, so a block which is not logged is in the storage
+    if (!stored_hashes.empty()){
+        std::vector<StoredDataBlock> stored_blocks = store_->readBlocks(stored_hashes);
+        loaded_blocks.insert(loaded_blocks.end(), std::make_move_iterator(stored_blocks.begin()), std::make_move_iterator(stored_blocks.end()));
+    }
+    return loaded_blocks;
+}
+
+void WalBlockStore::readBlocksInto(BlockReadTarget* targets, const size_t count){
+    std::vector<BlockReadTarget> stored_targets;
+    std::vector<size_t> stored_indexes;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (size_t i = 0; i < count; ++i){
+            const auto logged = logged_blocks_.find(targets[i].block_hash);
+            if (logged == logged_blocks_.end()){
+                stored_targets.push_back(targets[i]);
+                stored_indexes.push_back(i);
+                continue;
+            }
+            const StoredDataBlock& logged_block = logged->second.stored_block;
+            targets[i].data_size = logged_block.dblock.data_size;
+            targets[i].seq_no = logged_block.seq_no;
+            targets[i].checksum = logged_block.checksum;
+            std::memcpy(targets[i].buffer, logged_block.dblock.data, MAX_DATA_BLOCK_SIZE);
+        }
+    }
+    if (stored_targets.empty()){
+        return;
+    }
+
+    store_->readBlocksInto(stored_targets.data(), stored_targets.size());
+    for (size_t i = 0; i < stored_targets.size(); ++i){
+        targets[stored_indexes[i]] = stored_targets[i];
+    }
+}
+
+std::vector<StoredDataBlock> WalBlockStore::readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no){
+    std::vector<StoredDataBlock> loaded_blocks;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (const auto& logged : logged_blocks_){
+            const uint64_t seq_no = logged.second.stored_block.seq_no;
+            if (seq_no >= first_seq_no && seq_no < last_seq_no){
+                loaded_blocks.push_back(logged.second.stored_block);
+            }
+        }
+    }
+
+    // a block being applied right now may be found in both places
+    std::unordered_set<size_t> logged_hashes;
+    for (const StoredDataBlock& loaded_block : loaded_blocks){
+        logged_hashes.insert(loaded_block.block_hash);
+    }
+    for (StoredDataBlock& stored_block : store_->readBlockRange(first_seq_no, last_seq_no)){
+        if (logged_hashes.count(stored_block.block_hash) == 0){
+            loaded_blocks.push_back(std::move(stored_block));
+        }
+    }
+    std::sort(loaded_blocks.begin(), loaded_blocks.end(), [](const StoredDataBlock& lhs, const StoredDataBlock& rhs){
+        return lhs.seq_no < rhs.seq_no;
+    });
+    return loaded_blocks;
+}
+
+uint64_t WalBlockStore::getNextSeqNo(){
+    std::lock_guard<std::mutex> guard(latch_);
+    return next_seq_no_;
+}
+
+std::vector<StoredBlockKey> WalBlockStore::listBlockKeys(){
+    // a block moved from the log to the storage meanwhile would be missed by both lists
+    std::lock_guard<std::mutex> apply_guard(apply_latch_);
+    std::vector<StoredBlockKey> block_keys = store_->listBlockKeys();
+    std::lock_guard<std::mutex> guard(latch_);
+    for (const auto& logged : logged_blocks_){
+        block_keys.push_back(StoredBlockKey{logged.first, logged.second.stored_block.fingerprint_high});
+    }
+    return block_keys;
+}
+
+size_t WalBlockStore::removeBlocks(const std::vector<size_t>& block_hashes){
+    if (block_hashes.empty()){
+        return 0;
+    }
+
+    // the checkpointer cannot write a removed block to the storage after it has been removed there
+    std::lock_guard<std::mutex> apply_guard(apply_latch_);
+    size_t removed_count = 0;
+    {
+        std::unique_lock<std::mutex> lock(latch_);
+        if (!log_error_.empty()){
+            throw std::runtime_error("Failed to write the log: "s + log_error_);
+        }
+        uint64_t lsn = 0;
+        for (const size_t block_hash : block_hashes){
+            lsn = appendRecord(REMOVE_RECORD, block_hash, 0, 0, nullptr, 0);
+            removed_count += logged_blocks_.erase(block_hash);
+        }
+        waitForLsn(lsn, lock);
+    }
+    return std::min(removed_count + store_->removeBlocks(block_hashes), block_hashes.size());
+}
+
+void WalBlockStore::sync(){
+}
+
+IoEngine* WalBlockStore::getIoEngine() const noexcept{
+    return store_->getIoEngine();
+}
+
+void WalBlockStore::checkpoint(){
+    std::unique_lock<std::mutex> lock(latch_);
+    const uint64_t target_lsn = last_lsn_;
+    if (applied_lsn_ >= target_lsn){
+        return;
+    }
+
+    // the segment holding the last record is sealed as soon as the record is durable
+    seal_lsn_ = std::max(seal_lsn_, target_lsn);
+    apply_error_.clear();
+    log_wakeup_.notify_one();
+    segment_applied_.wait(lock, [this, target_lsn](){
+        return applied_lsn_ >= target_lsn || !log_error_.empty() || !apply_error_.empty();
+    });
+    if (applied_lsn_ >= target_lsn){
+        return;
+    }
+    if (!log_error_.empty()){
+        throw std::runtime_error("Failed to write the log: "s + log_error_);
+    }
+    throw std::runtime_error("Failed to apply the log: "s + apply_error_);
+}
+
+size_t WalBlockStore::getLoggedBlocksCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return logged_blocks_.size();
+}
+
+size_t WalBlockStore::getLogSyncsCount() const noexcept{
+    std::lock_guard<std::mutex> guard(latch_);
+    return log_syncs_count_;
+}
+
+uint64_t WalBlockStore::replaySegments(){
+    const std::filesystem::path dir_path = log_path_.has_parent_path() ? log_path_.parent_path() : std::filesystem::path(".");
+    const std::string prefix = log_path_.filename().string() + "."s;
+    std::vector<uint64_t> generations;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir_path, ec), end; !ec && it != end; it.increment(ec)){
+        const std::string file_name = it->path().filename().string();
+        if (file_name.size() > prefix.size() && file_name.compare(0, prefix.size(), prefix) == 0
+            && file_name.find_first_not_of("0123456789", prefix.size()) == std::string::npos){
+            generations.push_back(std::stoull(file_name.substr(prefix.size())));
+        }
+    }
+    if (ec){
+        throw std::runtime_error("Failed to list the log segments in "s + dir_path.string() + ": "s + ec.message());
+    }
+    std::sort(generations.begin(), generations.end());
+
+    std::vector<StoredDataBlock> written_blocks;
+    std::vector<size_t> removed_hashes;
+    // consecutive records of one kind are applied with one call, a change of the kind keeps the order
+    const auto applyWrites = [this, &written_blocks](){
+        store_->writeBlocks(written_blocks);
+        written_blocks.clear();
+    };
+    const auto applyRemovals = [this, &removed_hashes](){
+        store_->removeBlocks(removed_hashes);
+        removed_hashes.clear();
+    };
+    for (const uint64_t generation : generations){
+        std::ifstream segment_file(getSegmentPath(generation), std::ios::binary);
+        if (!segment_file.is_open()){
+            throw std::runtime_error("Failed to read the log segment "s + getSegmentPath(generation).string());
+        }
+        const std::vector<char> records((std::istreambuf_iterator<char>(segment_file)), std::istreambuf_iterator<char>());
+
+        size_t offset = 0;
+        while (offset + sizeof(LogRecordHeader) <= records.size()){
+            LogRecordHeader header;
+            std::memcpy(&header, records.data() + offset, sizeof(header));
+            const size_t record_size = getRecordSize(header.data_size);
+            // the records after a torn one have never been acknowledged
+            if (header.magic != LOG_RECORD_MAGIC || header.data_size > MAX_DATA_BLOCK_SIZE || offset + record_size > records.size()
+                || checksumRecord(header, records.data() + offset + sizeof(header)) != header.checksum){
+                break;
+            }
+
+            if (header.type == WRITE_RECORD){
+                if (!removed_hashes.empty()){
+                    applyRemovals();
+                }
+                StoredDataBlock& stored_block = written_blocks.emplace_back();
+                stored_block.block_hash = static_cast<size_t>(header.block_hash);
+                stored_block.fingerprint_high = header.fingerprint_high;
+                stored_block.seq_no = header.seq_no;
+                stored_block.dblock.data_size = header.data_size;
+                std::memcpy(stored_block.dblock.data, records.data() + offset + sizeof(header), header.data_size);
+                if (written_blocks.size() >= APPLY_BATCH_SIZE){
+                    applyWrites();
+                }
+            } else if (header.type == REMOVE_RECORD){
+                if (!written_blocks.empty()){
+                    applyWrites();
+                }
+                removed_hashes.push_back(static_cast<size_t>(header.block_hash));
+            }
+            offset += record_size;
+        }
+        if (!written_blocks.empty()){
+            applyWrites();
+        }
+        if (!removed_hashes.empty()){
+            applyRemovals();
+        }
+    }
+    if (generations.empty()){
+        return 1;
+    }
+
+    // the segments are deleted only once the storage has everything they held
+    store_->sync();
+    for (const uint64_t generation : generations){
+        std::filesystem::remove(getSegmentPath(generation), ec);
+    }
+    return generations.back() + 1;
+}
+
+void WalBlockStore::openSegment(const uint64_t generation){
+    segment_fd_ = createSegmentFile(getSegmentPath(generation));
+    segment_generation_ = generation;
+    segment_bytes_ = 0;
+}
+
+std::filesystem::path WalBlockStore::getSegmentPath(const uint64_t generation) const{
+    std::filesystem::path segment_path = log_path_;
+    segment_path += "."s + std::to_string(generation);
+    return segment_path;
+}
+
+uint64_t WalBlockStore::appendRecord(const uint32_t type, const size_t block_hash, const uint64_t fingerprint_high, const uint64_t seq_no,
+                                     const char* data, const size_t data_size){
+    LogRecordHeader header;
+    header.magic = LOG_RECORD_MAGIC;
+    header.type = type;
+    header.block_hash = block_hash;
+    header.fingerprint_high = fingerprint_high;
+    header.seq_no = seq_no;
+    header.data_size = static_cast<uint32_t>(data_size);
+    header.checksum = checksumRecord(header, data);
+
+    const size_t offset = log_buffer_.size();
+    log_buffer_.resize(offset + getRecordSize(data_size), 0);
+    std::memcpy(log_buffer_.data() + offset, &header, sizeof(header));
+    if (data_size != 0){
+        std::memcpy(log_buffer_.data() + offset + sizeof(header), data, data_size);
+    }
+    return ++last_lsn_;
+}
+
+void WalBlockStore::waitForLsn(const uint64_t lsn, std::unique_lock<std::mutex>& lock){
+    if (lsn == 0){
+        return;
+    }
+    log_wakeup_.notify_one();
+    log_synced_.wait(lock, [this, lsn](){
+        return durable_lsn_ >= lsn || !log_error_.empty();
+    });
+    if (durable_lsn_ < lsn){
+        throw std::runtime_error("Failed to write the log: "s + log_error_);
+    }
+}
+
+void WalBlockStore::writeLog(){
+    std::vector<char> group;
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true){
+        log_wakeup_.wait(lock, [this](){
+            return stop_log_writer_ || !log_buffer_.empty() || (seal_lsn_ != 0 && durable_lsn_ >= seal_lsn_);
+        });
+
+        if (!log_buffer_.empty()){
+            // everything appended while the previous group was being synced goes out as one write and one sync
+            group.swap(log_buffer_);
+            const uint64_t group_lsn = last_lsn_;
+            const size_t group_offset = segment_bytes_;
+            lock.unlock();
+
+            std::string error;
+            try{
+                writeFully(segment_fd_, group.data(), group.size(), static_cast<off_t>(group_offset));
+                syncFile(segment_fd_);
+            } catch (const std::exception& e){
+                error = e.what();
+            }
+
+            lock.lock();
+            if (error.empty()){
+                segment_bytes_ += group.size();
+                durable_lsn_ = group_lsn;
+                ++log_syncs_count_;
+            } else{
+                // after a failed sync the kernel may have dropped the pages, so nothing written later could be trusted
+                log_error_ = std::move(error);
+                log_buffer_.clear();
+                for (auto it = logged_blocks_.begin(); it != logged_blocks_.end();){
+                    it = it->second.lsn > durable_lsn_ ? logged_blocks_.erase(it) : std::next(it);
+                }
+                segment_applied_.notify_all();
+            }
+            log_synced_.notify_all();
+            // the buffer keeps its capacity for the next group
+            group.clear();
+            if (log_buffer_.empty()){
+                group.swap(log_buffer_);
+            }
+        }
+
+        const bool seal_reached = seal_lsn_ != 0 && durable_lsn_ >= seal_lsn_;
+        if (log_error_.empty() && segment_bytes_ != 0 && (segment_bytes_ >= segment_size_ || seal_reached)){
+            sealSegment();
+        }
+        if (seal_reached){
+            seal_lsn_ = 0;
+        }
+        if (stop_log_writer_ && log_buffer_.empty()){
+            return;
+        }
+    }
+}
+
+void WalBlockStore::sealSegment(){
+    closeSegmentFile(segment_fd_);
+    segment_fd_ = -1;
+    sealed_segments_.push_back(SealedSegment{segment_generation_, durable_lsn_});
+    checkpoint_wakeup_.notify_one();
+
+    try{
+        openSegment(segment_generation_ + 1);
+    } catch (const std::exception& e){
+        log_error_ = e.what();
+        log_synced_.notify_all();
+        segment_applied_.notify_all();
+    }
+}
+
+void WalBlockStore::applySegments(){
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true){
+        checkpoint_wakeup_.wait(lock, [this](){
+            return stop_checkpointer_ || !sealed_segments_.empty();
+        });
+        if (sealed_segments_.empty()){
+            return;
+        }
+
+        const SealedSegment segment = sealed_segments_.front();
+        lock.unlock();
+        std::string error;
+        try{
+            applyLoggedBlocks(segment.last_lsn);
+            std::error_code ec;
+            std::filesystem::remove(getSegmentPath(segment.generation), ec);
+        } catch (const std::exception& e){
+            error = e.what();
+        }
+
+        lock.lock();
+        if (!error.empty()){
+            // the segment stays sealed and is retried after a pause; writers wait for it meanwhile
+            apply_error_ = std::move(error);
+            segment_applied_.notify_all();
+            if (checkpoint_wakeup_.wait_for(lock, APPLY_RETRY_INTERVAL, [this](){ return stop_checkpointer_; })){
+                return;
+            }
+            continue;
+        }
+        sealed_segments_.pop_front();
+        applied_lsn_ = segment.last_lsn;
+        apply_error_.clear();
+        segment_applied_.notify_all();
+    }
+}
+
+void WalBlockStore::applyLoggedBlocks(const uint64_t last_lsn){
+    std::lock_guard<std::mutex> apply_guard(apply_latch_);
+    // only a removal could take a block out of the log meanwhile, and it waits for the apply latch
+    std::vector<std::pair<uint64_t, size_t>> block_order;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (const auto& logged : logged_blocks_){
+            if (logged.second.lsn <= last_lsn){
+                block_order.emplace_back(logged.second.stored_block.seq_no, logged.first);
+            }
+        }
+    }
+    // the storage lays the blocks out in the order they have been written
+    std::sort(block_order.begin(), block_order.end());
+
+    std::vector<StoredDataBlock> batch;
+    for (size_t batch_begin = 0; batch_begin < block_order.size(); batch_begin += APPLY_BATCH_SIZE){
+        const size_t batch_end = std::min(batch_begin + APPLY_BATCH_SIZE, block_order.size());
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            for (size_t i = batch_begin; i < batch_end; ++i){
+                batch.push_back(logged_blocks_.at(block_order[i].second).stored_block);
+            }
+        }
+        store_->writeBlocks(batch);
+    }
+    store_->sync();
+
+    std::lock_guard<std::mutex> guard(latch_);
+    for (const auto& applied_block : block_order){
+        logged_blocks_.erase(applied_block.second);
+    }
+}
+
+void WalBlockStore::stopThreads() noexcept{
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stop_log_writer_ = true;
+    }
+    log_wakeup_.notify_one();
+    if (log_writer_.joinable()){
+        log_writer_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stop_checkpointer_ = true;
+    }
+    checkpoint_wakeup_.notify_one();
+    if (checkpointer_.joinable()){
+        checkpointer_.join();
+    }
+}
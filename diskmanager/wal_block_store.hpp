@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "block_store.hpp"
+
+/* Write-ahead log in front of another block storage, so a write costs one log sync shared with every concurrent writer
+   instead of a commit of the storage per batch.
+
+   - `writeBlocks()` appends the batch to an in-memory log buffer and waits until it is durable. A single log writer thread
+     writes everything appended in the meantime with one `pwrite` and one `fdatasync` (group commit).
+   - Logged blocks are served to readers from memory until they are applied. The log is applied to the wrapped storage
+     lazily: once a segment fills up, a checkpointer thread writes its blocks to the storage in batches, syncs the storage
+     and deletes the segment.
+   - The log is a sequence of segment files `<path>.<generation>`. On open every segment left behind is replayed into the
+     wrapped storage in order. Every record carries a checksum, so a torn record at the end of a segment ends its replay.
+   - A failed log write or sync leaves the log in an unknown state, so all later writes fail as well; reads keep working. */
+class WalBlockStore : public BlockStore{
+public:
+    /** Open the log, replaying the segments left by a crash into the storage.
+     * @param[in] store the storage the log is applied to; must not be `nullptr`
+     * @param[in] log_path base path of the log segments
+     * @param[in] segment_size number of bytes after which a segment is sealed and applied
+     * @throw `std::invalid_argument` if there is no storage, `std::runtime_error` if the log cannot be opened or replayed.
+    */
+    explicit WalBlockStore(std::unique_ptr<BlockStore> store, const std::filesystem::path& log_path,
+                           const size_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+    // Applies the whole log to the storage. If that fails, the segments are kept and replayed on the next open.
+    ~WalBlockStore() override;
+
+    WalBlockStore(const WalBlockStore&) = delete;
+    WalBlockStore& operator=(const WalBlockStore&) = delete;
+
+public:
+    // Returns once the batch is durable in the log. Blocks which are logged already are not logged again.
+    void writeBlocks(const std::vector<StoredDataBlock>& dblocks) override;
+
+    // Logged blocks are copied from memory, the rest is read from the storage.
+    std::vector<StoredDataBlock> readBlocks(const std::vector<size_t>& block_hashes) override;
+
+    void readBlocksInto(BlockReadTarget* targets, const size_t count) override;
+
+    std::vector<StoredDataBlock> readBlockRange(const uint64_t first_seq_no, const uint64_t last_seq_no) override;
+
+    uint64_t getNextSeqNo() override;
+
+    // Lists the blocks of the storage together with the logged ones; a stored block which has been logged again is listed twice.
+    std::vector<StoredBlockKey> listBlockKeys() override;
+
+    // The removal is logged before the blocks leave the storage, so a replay cannot bring them back.
+    size_t removeBlocks(const std::vector<size_t>& block_hashes) override;
+
+    // Every written batch is durable in the log already, so there is nothing to do.
+    void sync() override;
+
+    IoEngine* getIoEngine() const noexcept override;
+
+public:
+    /** Apply every block logged so far to the storage and delete the segments holding them.
+     * @throw `std::runtime_error` if the log cannot be written or the storage cannot be updated.
+    */
+    void checkpoint();
+
+    // Get a number of logged blocks which have not been applied to the storage yet.
+    size_t getLoggedBlocksCount() const noexcept;
+
+    // Get a number of log syncs done so far; concurrent writes share them.
+    size_t getLogSyncsCount() const noexcept;
+
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 64u << 20;
+
+private:
+    /* A block waiting in the log to be applied. */
+    struct LoggedBlock{
+        StoredDataBlock stored_block;
+        uint64_t lsn = 0;                               /* log sequence number of its record */
+    };
+
+    /* A full segment waiting for the checkpointer. */
+    struct SealedSegment{
+        uint64_t generation = 0;
+        uint64_t last_lsn = 0;                          /* the blocks logged up to it are in this or earlier segments */
+    };
+
+    /** Replay the segments found next to `log_path_` into the storage in order and delete them.
+     * @return the generation following the last replayed one.
+     * @throw `std::runtime_error` if a segment cannot be read or the storage cannot be updated.
+    */
+    uint64_t replaySegments();
+
+    /** Create an empty segment and make it the one the log is written to.
+     * @throw `std::runtime_error` if the file cannot be created.
+    */
+    void openSegment(const uint64_t generation);
+
+    std::filesystem::path getSegmentPath(const uint64_t generation) const;
+
+    // Append a record to the log buffer and get its log sequence number. Must be called under the latch.
+    uint64_t appendRecord(const uint32_t type, const size_t block_hash, const uint64_t fingerprint_high, const uint64_t seq_no,
+                          const char* data, const size_t data_size);
+
+    /** Wait until the record is durable. Must be called under the latch.
+     * @throw `std::runtime_error` if the log has failed.
+    */
+    void waitForLsn(const uint64_t lsn, std::unique_lock<std::mutex>& lock);
+
+    // Body of the log writer thread: writes and syncs the buffer a group at a time and seals full segments.
+    void writeLog();
+
+    // Close the current segment, queue it for the checkpointer and continue in a new one. Must be called under the latch.
+    void sealSegment();
+
+    // Body of the checkpointer thread: applies sealed segments to the storage one by one.
+    void applySegments();
+
+    /** Write the logged blocks up to `last_lsn` to the storage in batches, in the write order, and sync it.
+     * @throw `std::runtime_error` if the storage cannot be updated.
+    */
+    void applyLoggedBlocks(const uint64_t last_lsn);
+
+    void stopThreads() noexcept;
+
+private:
+    static constexpr size_t APPLY_BATCH_SIZE = 1024;                        /* Blocks written to the storage in one call */
+    static constexpr size_t MAX_SEALED_SEGMENTS = 2;                        /* Writers wait once the checkpointer lags this far */
+    static constexpr std::chrono::milliseconds APPLY_RETRY_INTERVAL{100};
+
+    std::unique_ptr<BlockStore> store_;
+    std::filesystem::path log_path_;
+    size_t segment_size_;
+
+    mutable std::mutex latch_;                          /* Guards everything below but the segment file, which only the log writer touches */
+    std::vector<char> log_buffer_;                      /* Records appended since the last group was taken */
+    uint64_t last_lsn_ = 0;                             /* Log sequence number of the last appended record */
+    uint64_t durable_lsn_ = 0;
+    uint64_t applied_lsn_ = 0;
+    std::unordered_map<size_t, LoggedBlock> logged_blocks_;
+    uint64_t next_seq_no_ = 0;
+    std::string log_error_;                             /* Set once a log write fails, every later write fails with it */
+    std::string apply_error_;                           /* Error of the last failed apply, reported by `checkpoint()` */
+    size_t log_syncs_count_ = 0;
+
+    std::thread log_writer_;
+    std::condition_variable log_wakeup_;
+    std::condition_variable log_synced_;
+    uint64_t seal_lsn_ = 0;                             /* A checkpoint seals the segment once the log is durable up to it */
+    bool stop_log_writer_ = false;
+    int segment_fd_ = -1;
+    uint64_t segment_generation_ = 0;
+    size_t segment_bytes_ = 0;
+
+    std::thread checkpointer_;
+    std::condition_variable checkpoint_wakeup_;
+    std::condition_variable segment_applied_;
+    std::deque<SealedSegment> sealed_segments_;
+    bool stop_checkpointer_ = false;
+    std::mutex apply_latch_;                            /* Held while blocks move to the storage, so a removal cannot interleave */
+};
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "raw_file_block_store.hpp"
+#include "wal_block_store.hpp"
+
+using namespace std::filesystem;
+using namespace std::string_literals;
+
+class WalBlockStoreTests : public testing::Test{
+protected:
+    void SetUp() override{
+        create_directories(test_dir_path_ / path("store"));
+        create_directories(test_dir_path_ / path("log"));
+    }
+
+    void TearDown() override{
+        remove_all(test_dir_path_);
+    }
+
+    static StoredDataBlock makeStoredBlock(const std::string& data, const uint64_t seq_no){
+        StoredDataBlock stored_block;
+        stored_block.dblock.data_size = data.size();
+        std::memcpy(stored_block.dblock.data, data.data(), data.size());
+        const BlockFingerprint fingerprint = stored_block.dblock.Fingerprint();
+        stored_block.block_hash = static_cast<size_t>(fingerprint.low);
+        stored_block.fingerprint_high = fingerprint.high;
+        stored_block.seq_no = seq_no;
+        return stored_block;
+    }
+
+    static std::unique_ptr<BlockStore> makeRawStore(){
+        return std::make_unique<RawFileBlockStore>(test_dir_path_ / path("store") / path("blocks.raw"));
+    }
+
+    static size_t countSegments(){
+        return static_cast<size_t>(std::distance(directory_iterator(test_dir_path_ / path("log")), directory_iterator()));
+    }
+
+    static path test_dir_path_;
+    static path log_path_;
+};
+
+path WalBlockStoreTests::test_dir_path_ = std::filesystem::temp_directory_path() / path("wal_block_store_test_tmp_dir");
+path WalBlockStoreTests::log_path_ = test_dir_path_ / path("log") / path("blocks.wal");
+
+TEST_F(WalBlockStoreTests, WriteReadAndCheckpointTest){
+    std::vector<StoredDataBlock> stored_blocks;
+    for (size_t i = 0; i < 50; ++i){
+        stored_blocks.push_back(makeStoredBlock("Block number "s + std::to_string(i), i));
+    }
+    WalBlockStore store(makeRawStore(), log_path_);
+    EXPECT_THROW(WalBlockStore(nullptr, log_path_), std::invalid_argument);
+
+    // the blocks are served from the log until they are applied
+    store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks.begin(), stored_blocks.begin() + 30));
+    store.writeBlocks(std::vector<StoredDataBlock>(stored_blocks.begin() + 20, stored_blocks.end()));
+    EXPECT_EQ(store.getLoggedBlocksCount(), stored_blocks.size());
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(stored_blocks.size()));
+    EXPECT_EQ(store.readBlocks({stored_blocks[7].block_hash, 42}).size(), static_cast<size_t>(1));
+
+    store.checkpoint();
+    EXPECT_EQ(store.getLoggedBlocksCount(), static_cast<size_t>(0));
+    EXPECT_EQ(countSegments(), static_cast<size_t>(1));
+
+    // a range is merged from both places
+    store.writeBlocks({makeStoredBlock("Block after the checkpoint"s, 50)});
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlockRange(45, 100);
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(6));
+    for (size_t i = 0; i < 5; ++i){
+        EXPECT_EQ(loaded_blocks[i].seq_no, static_cast<uint64_t>(45 + i));
+        EXPECT_EQ(loaded_blocks[i].dblock, stored_blocks[45 + i].dblock);
+    }
+    EXPECT_EQ(loaded_blocks.back().seq_no, static_cast<uint64_t>(50));
+    // so is the list of the blocks, with the high halves of their fingerprints
+    const std::vector<StoredBlockKey> listed_keys = store.listBlockKeys();
+    std::map<size_t, uint64_t> listed_highs;
+    for (const StoredBlockKey& block_key : listed_keys){
+        listed_highs.emplace(block_key.block_hash, block_key.fingerprint_high);
+    }
+    EXPECT_EQ(listed_keys.size(), stored_blocks.size() + 1);
+    EXPECT_EQ(listed_highs[stored_blocks[45].block_hash], stored_blocks[45].fingerprint_high);
+    EXPECT_EQ(listed_highs[loaded_blocks.back().block_hash], makeStoredBlock("Block after the checkpoint"s, 50).fingerprint_high);
+
+    std::vector<char> buffer(MAX_DATA_BLOCK_SIZE);
+    BlockReadTarget target;
+    target.block_hash = stored_blocks[3].block_hash;
+    target.buffer = buffer.data();
+    store.readBlocksInto(&target, 1);
+    EXPECT_EQ(target.data_size, stored_blocks[3].dblock.data_size);
+    EXPECT_EQ(std::memcmp(buffer.data(), stored_blocks[3].dblock.data, MAX_DATA_BLOCK_SIZE), 0);
+
+    EXPECT_EQ(store.removeBlocks({stored_blocks[3].block_hash, loaded_blocks.back().block_hash, 42}), static_cast<size_t>(2));
+    EXPECT_TRUE(store.readBlocks({stored_blocks[3].block_hash, loaded_blocks.back().block_hash}).empty());
+}
+
+TEST_F(WalBlockStoreTests, GroupCommitTest){
+    constexpr size_t THREADS_COUNT = 16;
+    constexpr size_t WRITES_COUNT = 100;
+    // small segments make the checkpointer apply them while the writers are busy
+    WalBlockStore store(makeRawStore(), log_path_, 64 * MAX_DATA_BLOCK_SIZE);
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < THREADS_COUNT; ++t){
+        writers.emplace_back([&store, t](){
+            for (size_t i = 0; i < WRITES_COUNT; ++i){
+                store.writeBlocks({makeStoredBlock("Writer "s + std::to_string(t) + " block "s + std::to_string(i), t * WRITES_COUNT + i)});
+            }
+        });
+    }
+    for (std::thread& writer : writers){
+        writer.join();
+    }
+
+    // every write has waited for a sync, but the writers waiting together have shared them
+    EXPECT_LT(store.getLogSyncsCount(), THREADS_COUNT * WRITES_COUNT);
+    store.checkpoint();
+    for (size_t t = 0; t < THREADS_COUNT; ++t){
+        const StoredDataBlock stored_block = makeStoredBlock("Writer "s + std::to_string(t) + " block 7"s, 0);
+        const std::vector<StoredDataBlock> loaded_blocks = store.readBlocks({stored_block.block_hash});
+        ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(1));
+        EXPECT_EQ(loaded_blocks.front().seq_no, static_cast<uint64_t>(t * WRITES_COUNT + 7));
+    }
+}
+
+TEST_F(WalBlockStoreTests, ReplayTest){
+    const StoredDataBlock block1 = makeStoredBlock("This is test string number one"s, 0);
+    const StoredDataBlock block2 = makeStoredBlock(std::string(MAX_DATA_BLOCK_SIZE, 'x'), 1);
+    const StoredDataBlock block3 = makeStoredBlock("This is test string number three"s, 2);
+    const path backup_dir_path = test_dir_path_ / path("backup");
+    {
+        // the segments are copied while the blocks are only in the log, as a crash would leave them
+        WalBlockStore store(makeRawStore(), log_path_);
+        store.writeBlocks({block1, block2});
+        store.writeBlocks({block3});
+        store.removeBlocks({block1.block_hash});
+        copy(test_dir_path_ / path("log"), backup_dir_path);
+    }
+    remove_all(test_dir_path_ / path("store"));
+    remove_all(test_dir_path_ / path("log"));
+    create_directories(test_dir_path_ / path("store"));
+    copy(backup_dir_path, test_dir_path_ / path("log"));
+
+    // a record torn by the crash ends the replay
+    for (const directory_entry& segment : directory_iterator(test_dir_path_ / path("log"))){
+        std::ofstream segment_file(segment.path(), std::ios::binary | std::ios::app);
+        segment_file << "torn record"s;
+    }
+
+    WalBlockStore store(makeRawStore(), log_path_);
+    EXPECT_EQ(store.getLoggedBlocksCount(), static_cast<size_t>(0));
+    EXPECT_EQ(store.getNextSeqNo(), static_cast<uint64_t>(3));
+    EXPECT_TRUE(store.readBlocks({block1.block_hash}).empty());
+    const std::vector<StoredDataBlock> loaded_blocks = store.readBlockRange(0, 3);
+    ASSERT_EQ(loaded_blocks.size(), static_cast<size_t>(2));
+    EXPECT_EQ(loaded_blocks[0].dblock, block2.dblock);
+    EXPECT_EQ(loaded_blocks[1].dblock, block3.dblock);
+    const std::vector<StoredBlockKey> listed_keys = store.listBlockKeys();
+    ASSERT_EQ(listed_keys.size(), static_cast<size_t>(2));
+    for (const StoredBlockKey& block_key : listed_keys){
+        EXPECT_EQ(block_key.fingerprint_high, block_key.block_hash == block2.block_hash ? block2.fingerprint_high : block3.fingerprint_high);
+    }
+    // the replayed segments are gone, only the new one is left
+    EXPECT_EQ(countSegments(), static_cast<size_t>(1));
+}